@@ -54,6 +54,7 @@
 #endif
 #endif
 
+#include <atomic>
 #include <unordered_map>
 
 namespace pdf
@@ -1857,6 +1858,12 @@ PDFColorProfileIdentifier PDFColorProfileIdentifier::createOutputIntent(PDFColor
     return result;
 }
 
+PDFCMS::PDFCMS()
+{
+    static std::atomic<quint64> s_id = 0;
+    m_id = ++s_id;
+}
+
 PDFColor3 PDFCMS::getDefaultXYZWhitepoint()
 {
     const cmsCIEXYZ* whitePoint = cmsD50_XYZ();
@@ -91,9 +91,13 @@ struct PDFCMSSettings
 class PDFCMS
 {
 public:
-    explicit inline PDFCMS() = default;
+    explicit PDFCMS();
     virtual ~PDFCMS() = default;
 
+    /// Returns unique identifier of this color management system. Identifiers
+    /// are never reused in the process, so they can be used as keys in caches.
+    quint64 getId() const { return m_id; }
+
     /// This function should decide, if color management system is compatible with these
     /// settings (so, it transforms colors according to this setting). If this
     /// function returns false, then this color management system should be replaced
@@ -246,6 +250,9 @@ public:
 
     /// Get D50 white point for XYZ color space
     static PDFColor3 getDefaultXYZWhitepoint();
+
+private:
+    quint64 m_id;
 };
 
 using PDFCMSPointer = QSharedPointer<PDFCMS>;
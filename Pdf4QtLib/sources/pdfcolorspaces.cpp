@@ -27,6 +27,12 @@
 
 #include <QCryptographicHash>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PDF4QT_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+#include <cstring>
 #include <execution>
 
 namespace pdf
@@ -243,38 +249,10 @@ QImage PDFAbstractColorSpace::getImage(const PDFImageData& imageData,
 
                     try
                     {
-                        PDFBitReader reader(&imageData.getData(), imageData.getBitsPerComponent());
-                        reader.seek(i * imageData.getStride());
-
-                        const double max = reader.max();
-                        const double coefficient = 1.0 / max;
                         unsigned char* outputLine = image.scanLine(i);
 
                         std::vector<float> inputColors(imageWidth * componentCount, 0.0f);
-                        auto itInputColor = inputColors.begin();
-
-                        if (!decode.empty())
-                        {
-                            // Interpolate value
-                            for (unsigned int j = 0; j < imageData.getWidth(); ++j)
-                            {
-                                for (unsigned int k = 0; k < componentCount; ++k)
-                                {
-                                    PDFReal value = reader.read();
-                                    *itInputColor++ = interpolate(value, 0.0, max, decode[2 * k], decode[2 * k + 1]);
-                                }
-                            }
-                        }
-                        else
-                        {
-                            // Just read all values and multiply them with coefficient
-                            const unsigned int pixelCount = imageData.getWidth() * componentCount;
-                            for (unsigned int j = 0; j < pixelCount; ++j)
-                            {
-                                PDFReal value = reader.read();
-                                *itInputColor++ = value * coefficient;
-                            }
-                        }
+                        readImageRow(imageData, i, inputColors.data());
 
                         fillRGBBuffer(inputColors, outputLine, intent, cms, reporter);
                     }
@@ -340,35 +318,12 @@ QImage PDFAbstractColorSpace::getImage(const PDFImageData& imageData,
 
                     try
                     {
-                        PDFBitReader reader(&imageData.getData(), imageData.getBitsPerComponent());
-                        reader.seek(i * imageData.getStride());
-
-                        const double max = reader.max();
-                        const double coefficient = 1.0 / max;
                         unsigned char* outputLine = image.scanLine(i);
                         unsigned char* alphaLine = alphaMask.scanLine(i);
 
                         std::vector<float> inputColors(imageWidth * componentCount, 0.0f);
                         std::vector<unsigned char> outputColors(imageWidth * 3, 0);
-
-                        auto itInputColor = inputColors.begin();
-                        for (unsigned int j = 0; j < imageData.getWidth(); ++j)
-                        {
-                            for (unsigned int k = 0; k < componentCount; ++k)
-                            {
-                                PDFReal value = reader.read();
-
-                                // Interpolate value, if it is not empty
-                                if (!decode.empty())
-                                {
-                                    *itInputColor++ = interpolate(value, 0.0, max, decode[2 * k], decode[2 * k + 1]);
-                                }
-                                else
-                                {
-                                    *itInputColor++ = value * coefficient;
-                                }
-                            }
-                        }
+                        readImageRow(imageData, i, inputColors.data());
 
                         fillRGBBuffer(inputColors, outputColors.data(), intent, cms, reporter);
 
@@ -526,6 +481,130 @@ QColor PDFAbstractColorSpace::getCheckedColor(const PDFColor& color, const PDFCM
     return getColor(color, cms, intent, reporter, true);
 }
 
+void PDFAbstractColorSpace::readImageRow(const PDFImageData& imageData, unsigned int row, float* output)
+{
+    const unsigned int componentCount = imageData.getComponents();
+    const unsigned int bitsPerComponent = imageData.getBitsPerComponent();
+    const unsigned int sampleCount = imageData.getWidth() * componentCount;
+    const std::vector<PDFReal>& decode = imageData.getDecode();
+    const QByteArray& data = imageData.getData();
+    const qint64 rowOffset = qint64(row) * imageData.getStride();
+
+    const bool isFastPathComponentCount = componentCount == 1 || componentCount == 3 || componentCount == 4;
+    const bool isFastPathBitsPerComponent = bitsPerComponent == 8 || bitsPerComponent == 16;
+    const bool hasData = rowOffset + qint64(sampleCount) * (bitsPerComponent / 8) <= data.size();
+
+    if (!isFastPathComponentCount || !isFastPathBitsPerComponent || !hasData)
+    {
+        PDFBitReader reader(&data, bitsPerComponent);
+        reader.seek(rowOffset);
+
+        const double max = reader.max();
+        const double coefficient = 1.0 / max;
+
+        if (!decode.empty())
+        {
+            // Interpolate value
+            for (unsigned int j = 0; j < imageData.getWidth(); ++j)
+            {
+                for (unsigned int k = 0; k < componentCount; ++k)
+                {
+                    PDFReal value = reader.read();
+                    *output++ = interpolate(value, 0.0, max, decode[2 * k], decode[2 * k + 1]);
+                }
+            }
+        }
+        else
+        {
+            // Just read all values and multiply them with coefficient
+            for (unsigned int j = 0; j < sampleCount; ++j)
+            {
+                PDFReal value = reader.read();
+                *output++ = value * coefficient;
+            }
+        }
+
+        return;
+    }
+
+    // Fast path. Each sample is converted as value * scale + shift. Scales and shifts
+    // are repeated with period of 12 samples, which is divisible by 1, 3 and 4 (component
+    // counts) and by 4 (count of floats in SSE register).
+    constexpr unsigned int PERIOD = 12;
+    const PDFReal max = (1 << bitsPerComponent) - 1;
+    alignas(16) float scale[PERIOD] = { };
+    alignas(16) float shift[PERIOD] = { };
+    for (unsigned int i = 0; i < PERIOD; ++i)
+    {
+        const unsigned int k = i % componentCount;
+        scale[i] = decode.empty() ? 1.0 / max : (decode[2 * k + 1] - decode[2 * k]) / max;
+        shift[i] = decode.empty() ? 0.0 : decode[2 * k];
+    }
+
+    const unsigned char* source = reinterpret_cast<const unsigned char*>(data.constData() + rowOffset);
+    unsigned int i = 0;
+
+#if defined(PDF4QT_USE_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 scaleVector[3] = { _mm_load_ps(scale), _mm_load_ps(scale + 4), _mm_load_ps(scale + 8) };
+    const __m128 shiftVector[3] = { _mm_load_ps(shift), _mm_load_ps(shift + 4), _mm_load_ps(shift + 8) };
+
+    if (bitsPerComponent == 8)
+    {
+        for (; i + PERIOD <= sampleCount; i += PERIOD)
+        {
+            for (int j = 0; j < 3; ++j)
+            {
+                // Load 4 bytes and zero-extend them to 32-bit integers
+                int packed = 0;
+                std::memcpy(&packed, source + i + 4 * j, sizeof(packed));
+                __m128i samples = _mm_cvtsi32_si128(packed);
+                samples = _mm_unpacklo_epi8(samples, zero);
+                samples = _mm_unpacklo_epi16(samples, zero);
+
+                __m128 values = _mm_cvtepi32_ps(samples);
+                values = _mm_add_ps(_mm_mul_ps(values, scaleVector[j]), shiftVector[j]);
+                _mm_storeu_ps(output + i + 4 * j, values);
+            }
+        }
+    }
+    else
+    {
+        for (; i + PERIOD <= sampleCount; i += PERIOD)
+        {
+            for (int j = 0; j < 3; ++j)
+            {
+                // Load 4 big-endian 16-bit samples, swap bytes and zero-extend them to 32-bit integers
+                __m128i samples = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(source + 2 * (i + 4 * j)));
+                samples = _mm_or_si128(_mm_slli_epi16(samples, 8), _mm_srli_epi16(samples, 8));
+                samples = _mm_unpacklo_epi16(samples, zero);
+
+                __m128 values = _mm_cvtepi32_ps(samples);
+                values = _mm_add_ps(_mm_mul_ps(values, scaleVector[j]), shiftVector[j]);
+                _mm_storeu_ps(output + i + 4 * j, values);
+            }
+        }
+    }
+#endif
+
+    // Scalar code for the remaining samples (or for all samples, if SSE2 is not available)
+    if (bitsPerComponent == 8)
+    {
+        for (; i < sampleCount; ++i)
+        {
+            output[i] = source[i] * scale[i % PERIOD] + shift[i % PERIOD];
+        }
+    }
+    else
+    {
+        for (; i < sampleCount; ++i)
+        {
+            const unsigned int value = (static_cast<unsigned int>(source[2 * i]) << 8) | source[2 * i + 1];
+            output[i] = value * scale[i % PERIOD] + shift[i % PERIOD];
+        }
+    }
+}
+
 QImage PDFAbstractColorSpace::createAlphaMask(const PDFImageData& softMask)
 {
     if (softMask.getMaskingType() != PDFImageData::MaskingType::None)
@@ -2250,6 +2329,15 @@ std::vector<PDFColorComponent> PDFSeparationColorSpace::transformColorsToBaseCol
     std::vector<double> outputColor;
     outputColor.resize(colorComponentCount, 0.0);
 
+    // For large buffers (images), tint transform is sampled into the lookup table,
+    // and then, lookup table is used instead of the function for each color. Tint
+    // transform must be continuous, otherwise interpolated values can be wrong.
+    PDFFunctionLookupTable lookupTable;
+    if (!m_isAll && buffer.size() >= LOOKUP_TABLE_MINIMAL_COLOR_COUNT && PDFFunctionLookupTable::isApproximationAccurate({ m_tintTransform }))
+    {
+        lookupTable = PDFFunctionLookupTable::create({ m_tintTransform }, colorComponentCount, 0.0, 1.0);
+    }
+
     auto outputIt = result.begin();
     for (PDFColorComponent input : buffer)
     {
@@ -2265,7 +2353,14 @@ std::vector<PDFColorComponent> PDFSeparationColorSpace::transformColorsToBaseCol
         }
         else
         {
-            m_tintTransform->apply(&tint, &tint + 1, outputColor.data(), outputColor.data() + outputColor.size());
+            if (lookupTable.isValid())
+            {
+                lookupTable.apply(tint, outputColor.data());
+            }
+            else
+            {
+                m_tintTransform->apply(&tint, &tint + 1, outputColor.data(), outputColor.data() + outputColor.size());
+            }
             std::copy(outputColor.cbegin(), outputColor.cend(), outputIt);
         }
 
@@ -2488,16 +2583,34 @@ std::vector<PDFColorComponent> PDFDeviceNColorSpace::transformColorsToBaseColorS
         const std::size_t alternateColorSpaceComponentCount = m_alternateColorSpace->getColorComponentCount();
         result.resize(inputColorCount * alternateColorSpaceComponentCount, 0.0f);
 
-        std::vector<double> inputColor(colorantCount, 0.0);
-        std::vector<double> outputColor(alternateColorSpaceComponentCount, 0.0);
+        // Colors are transformed in chunks using batch evaluation of the tint transform,
+        // if the tint transform has matching number of inputs and outputs.
+        const bool isBatchEvaluated = m_tintTransform->getInputVariableCount() == colorantCount &&
+                                      m_tintTransform->getOutputVariableCount() == alternateColorSpaceComponentCount;
+        const std::size_t chunkColorCount = isBatchEvaluated ? BATCH_COLOR_COUNT : 1;
+
+        std::vector<double> inputColor(chunkColorCount * colorantCount, 0.0);
+        std::vector<double> outputColor(chunkColorCount * alternateColorSpaceComponentCount, 0.0);
 
         auto outputIt = result.begin();
-        for (auto it = buffer.begin(); it != buffer.end(); it = std::next(it, colorantCount))
+        for (std::size_t colorIndex = 0; colorIndex < inputColorCount; colorIndex += chunkColorCount)
         {
-            std::copy(it, it + colorantCount, inputColor.begin());
-            m_tintTransform->apply(inputColor.data(), inputColor.data() + inputColor.size(), outputColor.data(), outputColor.data() + outputColor.size());
-            std::copy(outputColor.cbegin(), outputColor.cend(), outputIt);
-            outputIt = std::next(outputIt, alternateColorSpaceComponentCount);
+            const std::size_t colorCount = qMin(chunkColorCount, inputColorCount - colorIndex);
+            auto it = std::next(buffer.begin(), colorIndex * colorantCount);
+            std::copy(it, std::next(it, colorCount * colorantCount), inputColor.begin());
+
+            if (isBatchEvaluated)
+            {
+                m_tintTransform->apply(inputColor.data(), outputColor.data(), colorCount);
+            }
+            else
+            {
+                m_tintTransform->apply(inputColor.data(), inputColor.data() + inputColor.size(), outputColor.data(), outputColor.data() + outputColor.size());
+            }
+
+            const std::size_t outputValueCount = colorCount * alternateColorSpaceComponentCount;
+            std::copy(outputColor.cbegin(), std::next(outputColor.cbegin(), outputValueCount), outputIt);
+            outputIt = std::next(outputIt, outputValueCount);
         }
         Q_ASSERT(outputIt == result.cend());
     }
@@ -403,6 +403,15 @@ public:
     /// \param softMask Soft mask
     static QImage createAlphaMask(const PDFImageData& softMask);
 
+    /// Reads one row of image samples and converts them to color components in range
+    /// given by decode array (or to range [0, 1], if decode array is empty). Common
+    /// cases (8-bit and 16-bit samples with 1, 3 or 4 components) are converted
+    /// using fast path without bit reader. Exception is thrown, if data are missing.
+    /// \param imageData Image data
+    /// \param row Row index
+    /// \param output Output buffer (must have width * components items)
+    static void readImageRow(const PDFImageData& imageData, unsigned int row, float* output);
+
     /// Parses the desired color space. If desired color space is not found, then exception is thrown.
     /// If everything is OK, then shared pointer to the new color space is returned.
     /// \param colorSpaceDictionary Dictionary containing color spaces of the page
@@ -821,6 +830,9 @@ public:
     const QByteArray& getColorName() const;
 
 private:
+    /// Minimal number of colors, for which tint transform is sampled into the lookup table
+    static constexpr size_t LOOKUP_TABLE_MINIMAL_COLOR_COUNT = 4 * PDFFunctionLookupTable::DEFAULT_SAMPLE_COUNT;
+
     QByteArray m_colorName;
     PDFColorSpacePointer m_alternateColorSpace;
     PDFFunctionPtr m_tintTransform;
@@ -889,6 +901,9 @@ public:
                                                         std::set<QByteArray>& usedNames);
 
 private:
+    /// Number of colors, which are transformed by tint transform at once
+    static constexpr size_t BATCH_COLOR_COUNT = 256;
+
     Type m_type;
     Colorants m_colorants;
     PDFColorSpacePointer m_alternateColorSpace;
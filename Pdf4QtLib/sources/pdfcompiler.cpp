@@ -17,6 +17,9 @@
 
 #include "pdfcompiler.h"
 #include "pdfcms.h"
+#include "pdfimage.h"
+#include "pdfpattern.h"
+#include "pdfpainter.h"
 #include "pdfdrawspacecontroller.h"
 #include "pdfprogress.h"
 #include "pdfexecutionpolicy.h"
@@ -25,6 +28,7 @@
 #include <QtConcurrent/QtConcurrent>
 
 #include <execution>
+#include <limits>
 
 namespace pdf
 {
@@ -70,7 +74,7 @@ void PDFAsynchronousPageCompilerWorkerThread::run()
                         PDFCMSPointer cms = proxy->getCMSManager()->getCurrentCMS();
                         PDFRenderer renderer(proxy->getDocument(), proxy->getFontCache(), cms.data(), proxy->getOptionalContentActivity(), proxy->getFeatures(), proxy->getMeshQualitySettings());
                         renderer.setOperationControl(m_compiler);
-                        renderer.compile(&task.precompiledPage, task.pageIndex);
+                        renderer.compile(&task.precompiledPage, task.createTextLayout ? &task.textLayout : nullptr, task.pageIndex);
                         task.finished = true;
                         return compiledPage;
                     };
@@ -115,12 +119,13 @@ PDFAsynchronousPageCompiler::PDFAsynchronousPageCompiler(PDFDrawWidgetProxy* pro
     BaseClass(proxy),
     m_proxy(proxy)
 {
-    m_cache.setMaxCost(128 * 1024 * 1024);
+    setCacheLimit(128 * 1024 * 1024);
 }
 
 PDFAsynchronousPageCompiler::~PDFAsynchronousPageCompiler()
 {
     stop(true);
+    PDFImageCache::getInstance()->removeLimit(this);
 }
 
 bool PDFAsynchronousPageCompiler::isOperationCancelled() const
@@ -206,7 +211,16 @@ void PDFAsynchronousPageCompiler::reset()
 
 void PDFAsynchronousPageCompiler::setCacheLimit(int limit)
 {
-    m_cache.setMaxCost(limit);
+    // Memory budget is shared between precompiled pages, decoded images, shading
+    // meshes and glyph images. Images in the image cache are usually also referenced
+    // by precompiled pages, so image cache doesn't need large part of the budget.
+    const int imageCacheLimit = limit / IMAGE_CACHE_LIMIT_DIVISOR;
+    const int shadingMeshCacheLimit = limit / SHADING_MESH_CACHE_LIMIT_DIVISOR;
+    const int glyphAtlasLimit = limit / GLYPH_ATLAS_LIMIT_DIVISOR;
+    m_cache.setMaxCost(limit - imageCacheLimit - shadingMeshCacheLimit - glyphAtlasLimit);
+    PDFImageCache::getInstance()->setLimit(this, imageCacheLimit);
+    PDFShadingMeshCache::getInstance()->setLimit(shadingMeshCacheLimit);
+    PDFGlyphAtlas::getInstance()->setLimit(glyphAtlasLimit);
 }
 
 const PDFPrecompiledPage* PDFAsynchronousPageCompiler::getCompiledPage(PDFInteger pageIndex, bool compile)
@@ -217,14 +231,22 @@ const PDFPrecompiledPage* PDFAsynchronousPageCompiler::getCompiledPage(PDFIntege
         return nullptr;
     }
 
-    PDFPrecompiledPage* page = m_cache.object(pageIndex);
+    QSharedPointer<PDFPrecompiledPage>* pagePointer = m_cache.object(pageIndex);
+    PDFPrecompiledPage* page = pagePointer ? pagePointer->data() : nullptr;
 
     if (!page && compile)
     {
         QMutexLocker locker(&m_mutex);
         if (!m_tasks.count(pageIndex))
         {
-            m_tasks.insert(std::make_pair(pageIndex, CompileTask(pageIndex)));
+            CompileTask task(pageIndex);
+
+            // Create text layout in the same pass as precompiled page, so
+            // page contents needn't be processed again for text layout.
+            PDFAsynchronousTextLayoutCompiler* textLayoutCompiler = m_proxy->getTextLayoutCompiler();
+            task.createTextLayout = textLayoutCompiler && textLayoutCompiler->isPageTextLayoutNeeded(pageIndex);
+
+            m_tasks.insert(std::make_pair(pageIndex, qMove(task)));
             m_waitCondition.wakeOne();
         }
     }
@@ -237,6 +259,21 @@ const PDFPrecompiledPage* PDFAsynchronousPageCompiler::getCompiledPage(PDFIntege
     return page;
 }
 
+QSharedPointer<const PDFPrecompiledPage> PDFAsynchronousPageCompiler::getCompiledPagePointer(PDFInteger pageIndex) const
+{
+    if (m_state != State::Active)
+    {
+        return nullptr;
+    }
+
+    if (const QSharedPointer<PDFPrecompiledPage>* pagePointer = m_cache.object(pageIndex))
+    {
+        return *pagePointer;
+    }
+
+    return nullptr;
+}
+
 void PDFAsynchronousPageCompiler::smartClearCache(const int milisecondsLimit, const std::vector<PDFInteger>& activePages)
 {
     if (m_state != State::Active)
@@ -258,8 +295,8 @@ void PDFAsynchronousPageCompiler::smartClearCache(const int milisecondsLimit, co
             continue;
         }
 
-        const PDFPrecompiledPage* page = m_cache.object(pageIndex);
-        if (page && page->hasExpired(milisecondsLimit))
+        const QSharedPointer<PDFPrecompiledPage>* page = m_cache.object(pageIndex);
+        if (page && (*page)->hasExpired(milisecondsLimit))
         {
             m_cache.remove(pageIndex);
         }
@@ -270,6 +307,7 @@ void PDFAsynchronousPageCompiler::onPageCompiled()
 {
     std::vector<PDFInteger> compiledPages;
     std::map<PDFInteger, PDFRenderError> errors;
+    std::map<PDFInteger, PDFTextLayout> textLayouts;
 
     {
         QMutexLocker locker(&m_mutex);
@@ -283,9 +321,9 @@ void PDFAsynchronousPageCompiler::onPageCompiled()
                 if (m_state == State::Active)
                 {
                     // If we are in active state, try to store precompiled page
-                    PDFPrecompiledPage* page = new PDFPrecompiledPage(std::move(task.precompiledPage));
-                    page->markAccessed();
-                    qint64 memoryConsumptionEstimate = page->getMemoryConsumptionEstimate();
+                    QSharedPointer<PDFPrecompiledPage>* page = new QSharedPointer<PDFPrecompiledPage>(new PDFPrecompiledPage(std::move(task.precompiledPage)));
+                    (*page)->markAccessed();
+                    qint64 memoryConsumptionEstimate = (*page)->getMemoryConsumptionEstimate();
                     if (m_cache.insert(it->first, page, memoryConsumptionEstimate))
                     {
                         compiledPages.push_back(it->first);
@@ -297,6 +335,11 @@ void PDFAsynchronousPageCompiler::onPageCompiled()
                         QString message = PDFTranslationContext::tr("Precompiled page size is too high (%1 kB). Cache size is %2 kB. Increase the cache size!").arg(memoryConsumptionEstimate / 1024).arg(m_cache.maxCost() / 1024);
                         errors[it->first] = PDFRenderError(RenderErrorType::Error, message);
                     }
+
+                    if (task.createTextLayout)
+                    {
+                        textLayouts[it->first] = qMove(task.textLayout);
+                    }
                 }
 
                 it = m_tasks.erase(it);
@@ -309,6 +352,14 @@ void PDFAsynchronousPageCompiler::onPageCompiled()
         }
     }
 
+    if (PDFAsynchronousTextLayoutCompiler* textLayoutCompiler = m_proxy->getTextLayoutCompiler())
+    {
+        for (const auto& textLayout : textLayouts)
+        {
+            textLayoutCompiler->setPageTextLayout(textLayout.first, textLayout.second);
+        }
+    }
+
     for (const auto& error : errors)
     {
         Q_EMIT renderingError(error.first, { error.second });
@@ -384,6 +435,9 @@ void PDFAsynchronousTextLayoutCompiler::start()
     {
         case State::Inactive:
         {
+            // Cache can contain empty text layouts, which were
+            // returned, when compiler was inactive.
+            m_cache.clear();
             m_state = State::Active;
             break;
         }
@@ -411,12 +465,36 @@ void PDFAsynchronousTextLayoutCompiler::stop(bool clearCache)
         {
             // Stop the engine
             m_state = State::Stopping;
+            m_cancelled = true;
             m_textLayoutCompileFutureWatcher.waitForFinished();
 
+            if (m_isRunning)
+            {
+                // Text layout job was interrupted (or its result was not
+                // yet processed), keep text layouts of pages created so far.
+                PDFTextLayoutStorage textLayouts = m_textLayoutCompileFuture.result();
+                if (m_pageTextLayouts.getCount() != textLayouts.getCount())
+                {
+                    m_pageTextLayouts = qMove(textLayouts);
+                }
+                else
+                {
+                    m_pageTextLayouts.merge(textLayouts);
+                }
+
+                m_proxy->getFontCache()->setCacheShrinkEnabled(this, true);
+                m_proxy->getProgress()->finish();
+                m_isRunning = false;
+            }
+
             if (clearCache)
             {
                 m_textLayouts = std::nullopt;
+                m_pageTextLayouts = PDFTextLayoutStorage();
                 m_cache.clear();
+
+                QMutexLocker lock(&m_textIndexMutex);
+                m_textIndex = PDFTextIndex();
             }
 
             m_state = State::Inactive;
@@ -446,6 +524,11 @@ PDFTextLayout PDFAsynchronousTextLayoutCompiler::createTextLayout(PDFInteger pag
     {
         result = getTextLayout(pageIndex);
     }
+    else if (m_state == State::Active && m_pageTextLayouts.hasTextLayout(pageIndex))
+    {
+        // Text layout was created by page compiler
+        result = m_pageTextLayouts.getTextLayout(pageIndex);
+    }
     else
     {
         if (m_state != State::Active || !m_proxy->getDocument())
@@ -482,6 +565,38 @@ PDFTextLayout PDFAsynchronousTextLayoutCompiler::createTextLayout(PDFInteger pag
     return result;
 }
 
+bool PDFAsynchronousTextLayoutCompiler::isPageTextLayoutNeeded(PDFInteger pageIndex) const
+{
+    if (m_state != State::Active || !m_proxy->getDocument() || isTextLayoutReady())
+    {
+        return false;
+    }
+
+    return !m_pageTextLayouts.hasTextLayout(pageIndex);
+}
+
+void PDFAsynchronousTextLayoutCompiler::setPageTextLayout(PDFInteger pageIndex, const PDFTextLayout& textLayout)
+{
+    if (!isPageTextLayoutNeeded(pageIndex))
+    {
+        return;
+    }
+
+    const PDFInteger pageCount = PDFInteger(m_proxy->getDocument()->getCatalog()->getPageCount());
+    if (pageIndex < 0 || pageIndex >= pageCount)
+    {
+        return;
+    }
+
+    if (static_cast<PDFInteger>(m_pageTextLayouts.getCount()) != pageCount)
+    {
+        m_pageTextLayouts = PDFTextLayoutStorage(pageCount);
+    }
+
+    m_pageTextLayouts.setTextLayout(pageIndex, textLayout, nullptr);
+    m_textIndex.addPage(pageIndex, textLayout, &m_textIndexMutex);
+}
+
 PDFTextLayout PDFAsynchronousTextLayoutCompiler::getTextLayout(PDFInteger pageIndex)
 {
     if (m_state != State::Active || !m_proxy->getDocument())
@@ -578,9 +693,12 @@ void PDFAsynchronousTextLayoutCompiler::makeTextLayout()
     // Jakub Melka: Mark, that we are running (test for future is not enough,
     // because future can finish before this function exits, for example)
     m_isRunning = true;
+    m_cancelled = false;
 
+    // Document can be used during indexing (text layouts of pages are
+    // published incrementally), so we do not show modal progress dialog.
     ProgressStartupInfo info;
-    info.showDialog = true;
+    info.showDialog = false;
     info.text = tr("Indexing document contents...");
 
     m_proxy->getFontCache()->setCacheShrinkEnabled(this, false);
@@ -589,9 +707,30 @@ void PDFAsynchronousTextLayoutCompiler::makeTextLayout()
 
     PDFCMSPointer cms = m_proxy->getCMSManager()->getCurrentCMS();
 
-    auto createTextLayout = [this, cms, catalog]() -> PDFTextLayoutStorage
+    // Text layouts of pages, which were already created (for example, by page
+    // compiler), are reused, so we do not process contents of these pages again.
+    PDFTextLayoutStorage pageTextLayouts = m_pageTextLayouts;
+    const quint64 jobId = ++m_textLayoutJobId;
+    updatePriorityPages();
+
+    // Text layouts, which are not yet created, are loaded from the disk cache
+    const bool useDiskCache = isDiskCacheUsable();
+    PDFTextLayoutDiskCache diskCache = m_diskCache;
+    QByteArray documentHash = m_diskCacheDocumentHash;
+
+    auto createTextLayout = [this, cms, catalog, pageTextLayouts, jobId, useDiskCache, diskCache, documentHash]() -> PDFTextLayoutStorage
     {
-        PDFTextLayoutStorage result(catalog->getPageCount());
+        const PDFInteger pageCount = PDFInteger(catalog->getPageCount());
+        PDFTextLayoutStorage result = (static_cast<PDFInteger>(pageTextLayouts.getCount()) == pageCount) ? pageTextLayouts : PDFTextLayoutStorage(pageCount);
+
+        if (useDiskCache)
+        {
+            if (std::optional<PDFTextLayoutStorage> cachedTextLayouts = diskCache.load(documentHash, catalog))
+            {
+                result.merge(*cachedTextLayouts);
+            }
+        }
+
         QMutex mutex;
         auto generateTextLayout = [this, &result, &mutex, cms, catalog](PDFInteger pageIndex)
         {
@@ -607,12 +746,81 @@ void PDFAsynchronousTextLayoutCompiler::makeTextLayout()
 
             PDFTextLayoutGenerator generator(m_proxy->getFeatures(), page, m_proxy->getDocument(), m_proxy->getFontCache(), cms.data(), m_proxy->getOptionalContentActivity(), QTransform(), m_proxy->getMeshQualitySettings());
             generator.processContents();
-            result.setTextLayout(pageIndex, generator.createTextLayout(), &mutex);
+            PDFTextLayout textLayout = generator.createTextLayout();
+            m_textIndex.addPage(pageIndex, textLayout, &m_textIndexMutex);
+            result.setTextLayout(pageIndex, textLayout, &mutex);
             m_proxy->getProgress()->step();
         };
 
-        auto pageRange = PDFIntegerRange<PDFInteger>(0, catalog->getPageCount());
-        PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, pageRange.begin(), pageRange.end(), generateTextLayout);
+        // Text layouts loaded from the disk cache must be indexed too. Pages,
+        // which are not indexed yet, are always searched, so they are indexed
+        // after text layouts of remaining pages are created.
+        auto indexTextLayout = [this, &result](PDFInteger pageIndex)
+        {
+            {
+                QMutexLocker lock(&m_textIndexMutex);
+                if (m_textIndex.isPageIndexed(pageIndex))
+                {
+                    return;
+                }
+            }
+
+            m_textIndex.addPage(pageIndex, result.getTextLayout(pageIndex), &m_textIndexMutex);
+        };
+
+        std::vector<PDFInteger> remainingPages;
+        std::vector<PDFInteger> existingPages;
+        for (PDFInteger pageIndex = 0; pageIndex < pageCount; ++pageIndex)
+        {
+            if (result.hasTextLayout(pageIndex))
+            {
+                existingPages.push_back(pageIndex);
+                m_proxy->getProgress()->step();
+            }
+            else
+            {
+                remainingPages.push_back(pageIndex);
+            }
+        }
+
+        // Text layouts, which already exist (created by page compiler or loaded
+        // from the disk cache), are published as the first batch, so they can
+        // be used before text layouts of remaining pages are created.
+        if (!existingPages.empty() && !m_cancelled)
+        {
+            PDFTextLayoutStorage storage = result;
+            QMetaObject::invokeMethod(this, [this, jobId, storage = qMove(storage), batch = existingPages]()
+            {
+                onTextLayoutPagesCreated(jobId, storage, batch);
+            }, Qt::QueuedConnection);
+        }
+
+        // Process pages in batches ordered by priority. After each batch,
+        // text layouts are published, so they can be used (for example,
+        // for searching) before whole document is processed.
+        const bool hasRemainingPages = !remainingPages.empty();
+        while (!remainingPages.empty() && !m_cancelled)
+        {
+            std::vector<PDFInteger> batch = takeTextLayoutBatch(remainingPages);
+            PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, batch.cbegin(), batch.cend(), generateTextLayout);
+
+            PDFTextLayoutStorage storage = result;
+            QMetaObject::invokeMethod(this, [this, jobId, storage = qMove(storage), batch = qMove(batch)]()
+            {
+                onTextLayoutPagesCreated(jobId, storage, batch);
+            }, Qt::QueuedConnection);
+        }
+
+        if (!m_cancelled)
+        {
+            PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, existingPages.cbegin(), existingPages.cend(), indexTextLayout);
+        }
+
+        if (useDiskCache && hasRemainingPages && remainingPages.empty())
+        {
+            diskCache.store(documentHash, catalog, result);
+        }
+
         return result;
     };
 
@@ -621,13 +829,137 @@ void PDFAsynchronousTextLayoutCompiler::makeTextLayout()
     m_textLayoutCompileFutureWatcher.setFuture(m_textLayoutCompileFuture);
 }
 
+void PDFAsynchronousTextLayoutCompiler::onTextLayoutPagesCreated(quint64 jobId, const PDFTextLayoutStorage& storage, const std::vector<PDFInteger>& pageIndices)
+{
+    if (!m_isRunning || jobId != m_textLayoutJobId)
+    {
+        // Text layout job was stopped
+        return;
+    }
+
+    if (m_pageTextLayouts.getCount() != storage.getCount())
+    {
+        m_pageTextLayouts = storage;
+    }
+    else
+    {
+        m_pageTextLayouts.merge(storage);
+    }
+
+    // User can scroll the document, so pages nearest to
+    // active pages should be processed first.
+    updatePriorityPages();
+
+    Q_EMIT textLayoutPagesCreated(pageIndices);
+}
+
+void PDFAsynchronousTextLayoutCompiler::updatePriorityPages()
+{
+    std::vector<PDFInteger> priorityPages = m_proxy->getActivePages();
+    std::sort(priorityPages.begin(), priorityPages.end());
+
+    QMutexLocker lock(&m_priorityPagesMutex);
+    m_priorityPages = qMove(priorityPages);
+}
+
+std::vector<PDFInteger> PDFAsynchronousTextLayoutCompiler::takeTextLayoutBatch(std::vector<PDFInteger>& remainingPages)
+{
+    std::vector<PDFInteger> priorityPages;
+    {
+        QMutexLocker lock(&m_priorityPagesMutex);
+        priorityPages = m_priorityPages;
+    }
+
+    // Distance of the page to the nearest priority page. If we do not
+    // have priority pages, pages are processed from the first page.
+    auto getDistance = [&priorityPages](PDFInteger pageIndex) -> PDFInteger
+    {
+        if (priorityPages.empty())
+        {
+            return pageIndex;
+        }
+
+        PDFInteger distance = std::numeric_limits<PDFInteger>::max();
+        auto it = std::lower_bound(priorityPages.cbegin(), priorityPages.cend(), pageIndex);
+        if (it != priorityPages.cend())
+        {
+            distance = *it - pageIndex;
+        }
+        if (it != priorityPages.cbegin())
+        {
+            distance = qMin(distance, pageIndex - *std::prev(it));
+        }
+        return distance;
+    };
+
+    auto comparator = [&getDistance](PDFInteger left, PDFInteger right)
+    {
+        return std::make_pair(getDistance(left), left) < std::make_pair(getDistance(right), right);
+    };
+
+    const size_t batchSize = qMin(TEXT_LAYOUT_BATCH_SIZE, remainingPages.size());
+    std::partial_sort(remainingPages.begin(), std::next(remainingPages.begin(), batchSize), remainingPages.end(), comparator);
+
+    std::vector<PDFInteger> batch(remainingPages.begin(), std::next(remainingPages.begin(), batchSize));
+    remainingPages.erase(remainingPages.begin(), std::next(remainingPages.begin(), batchSize));
+    return batch;
+}
+
+void PDFAsynchronousTextLayoutCompiler::setDiskCache(PDFTextLayoutDiskCache diskCache, QByteArray documentHash)
+{
+    const PDFDocument* document = m_proxy->getDocument();
+
+    m_diskCache = qMove(diskCache);
+    m_diskCacheDocumentHash = qMove(documentHash);
+    m_diskCacheContentId = document ? document->getStorage().getContentId() : 0;
+}
+
+std::vector<PDFInteger> PDFAsynchronousTextLayoutCompiler::getCandidatePages(const QString& text, PDFTextFlow::FlowFlags flowFlags, const std::vector<PDFInteger>& pageIndices) const
+{
+    QMutexLocker lock(&m_textIndexMutex);
+
+    if (m_textIndex.getFlowFlags() != flowFlags)
+    {
+        return pageIndices;
+    }
+
+    return m_textIndex.getCandidatePages(text, pageIndices);
+}
+
+bool PDFAsynchronousTextLayoutCompiler::isDiskCacheUsable() const
+{
+    const PDFDocument* document = m_proxy->getDocument();
+
+    if (!m_diskCache.isEnabled() || m_diskCacheDocumentHash.isEmpty() || !document || !PDFTextLayoutDiskCache::isDocumentCacheable(document))
+    {
+        return false;
+    }
+
+    // Document was modified, so its content differs from the document file
+    if (document->getStorage().getContentId() != m_diskCacheContentId)
+    {
+        return false;
+    }
+
+    // Text layouts depend on the state of optional content, so we do not use the cache
+    const bool hasOptionalContent = document->getCatalog()->getOptionalContentProperties()->isValid();
+    return !hasOptionalContent || m_proxy->getFeatures().testFlag(PDFRenderer::IgnoreOptionalContent);
+}
+
 void PDFAsynchronousTextLayoutCompiler::onTextLayoutCreated()
 {
+    if (!m_isRunning)
+    {
+        // Result was already processed, when compiler was stopped
+        return;
+    }
+
     m_proxy->getFontCache()->setCacheShrinkEnabled(this, true);
     m_proxy->getProgress()->finish();
     m_cache.clear();
 
     m_textLayouts = m_textLayoutCompileFuture.result();
+    m_pageTextLayouts = PDFTextLayoutStorage();
     m_isRunning = false;
     Q_EMIT textLayoutChanged();
 }
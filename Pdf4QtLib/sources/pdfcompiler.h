@@ -21,12 +21,15 @@
 #include "pdfrenderer.h"
 #include "pdfpainter.h"
 #include "pdftextlayout.h"
+#include "pdftextindex.h"
 
 #include <QCache>
 #include <QFuture>
 #include <QFutureWatcher>
 #include <QWaitCondition>
 
+#include <atomic>
+
 namespace pdf
 {
 class PDFDrawWidgetProxy;
@@ -81,7 +84,8 @@ public:
     /// Resets the engine - calls stop and then calls start.
     void reset();
 
-    /// Sets cache limit in bytes
+    /// Sets cache limit in bytes. Limit is shared by the cache
+    /// of precompiled pages and by the global image cache.
     /// \param limit Cache limit [bytes]
     void setCacheLimit(int limit);
 
@@ -106,6 +110,13 @@ public:
     /// \param compile Compile the page, if it is not found in the cache
     const PDFPrecompiledPage* getCompiledPage(PDFInteger pageIndex, bool compile);
 
+    /// Returns shared pointer to the precompiled page from the cache. If page is not
+    /// found, then null pointer is returned (page is not compiled). Returned pointer
+    /// keeps the page alive, even if it is removed from the cache, so page can be
+    /// safely used in other threads.
+    /// \param pageIndex Index of page
+    QSharedPointer<const PDFPrecompiledPage> getCompiledPagePointer(PDFInteger pageIndex) const;
+
     /// Performs smart cache clear. Too old pages are removed from the cache,
     /// but only if these pages are not in active pages. Use this function to
     /// clear cache to avoid huge memory consumption.
@@ -125,6 +136,15 @@ private:
 
     void onPageCompiled();
 
+    /// Part of the cache limit, which is used by the image cache
+    static constexpr int IMAGE_CACHE_LIMIT_DIVISOR = 4;
+
+    /// Part of the cache limit, which is used by the shading mesh cache
+    static constexpr int SHADING_MESH_CACHE_LIMIT_DIVISOR = 16;
+
+    /// Part of the cache limit, which is used by the glyph atlas
+    static constexpr int GLYPH_ATLAS_LIMIT_DIVISOR = 16;
+
     struct CompileTask
     {
         CompileTask() = default;
@@ -132,7 +152,9 @@ private:
 
         PDFInteger pageIndex = 0;
         bool finished = false;
+        bool createTextLayout = false;  ///< Create text layout in the same pass as precompiled page
         PDFPrecompiledPage precompiledPage;
+        PDFTextLayout textLayout;
     };
 
     State m_state = State::Inactive;
@@ -141,7 +163,7 @@ private:
     PDFAsynchronousPageCompilerWorkerThread* m_thread = nullptr;
 
     PDFDrawWidgetProxy* m_proxy;
-    QCache<PDFInteger, PDFPrecompiledPage> m_cache;
+    QCache<PDFInteger, QSharedPointer<PDFPrecompiledPage>> m_cache;
 
     /// This task is protected by mutex. Every access to this
     /// variable must be done with locked mutex.
@@ -201,29 +223,101 @@ public:
     PDFTextSelection getTextSelectionAll(QColor color) const;
 
     /// Create text layout for the document. Function is asynchronous,
-    /// it returns immediately. After text layout is created, signal
-    /// \p textLayoutChanged is emitted.
+    /// it returns immediately. Already existing text layouts (created by page
+    /// compiler or loaded from the disk cache) are published as the first batch,
+    /// then pages are processed in batches, active pages (visible pages) first,
+    /// then pages nearest to them. After each batch,
+    /// signal \p textLayoutPagesCreated is emitted, and after text layout
+    /// of the whole document is created, signal \p textLayoutChanged is emitted.
     void makeTextLayout();
 
     /// Returns true, if text layout is ready
     bool isTextLayoutReady() const { return m_textLayouts.has_value(); }
 
+    /// Returns true, if text layout of the page should be created together
+    /// with the precompiled page, i.e. text layout of the document is not
+    /// ready and text layout of the page wasn't created yet.
+    /// \param pageIndex Page index
+    bool isPageTextLayoutNeeded(PDFInteger pageIndex) const;
+
+    /// Sets text layout of the page, which was created by the page compiler
+    /// in the same pass as precompiled page. Text layout is then used instead
+    /// of processing the page contents again, both for text layout of
+    /// the single page, and for text layout of the whole document.
+    /// \param pageIndex Page index
+    /// \param textLayout Text layout of the page
+    void setPageTextLayout(PDFInteger pageIndex, const PDFTextLayout& textLayout);
+
     /// Returns text layout storage (if it is ready), or nullptr
     const PDFTextLayoutStorage* getTextLayoutStorage() const { return isTextLayoutReady() ? &m_textLayouts.value() : nullptr; }
 
+    /// Returns text layout storage, which contains text layouts of pages created
+    /// so far, while text layout of the document is not ready. Storage can be
+    /// empty, or some pages can be missing.
+    const PDFTextLayoutStorage* getPartialTextLayoutStorage() const { return &m_pageTextLayouts; }
+
+    /// Sets persistent cache of text layouts for the current document. Text layout
+    /// job then loads text layouts from the cache, and stores text layouts of the whole
+    /// document into the cache, when they are created. Cache is used only for the current
+    /// document (if document is modified, cache is not used), and only, if text layouts
+    /// do not depend on the state of optional content.
+    /// \param diskCache Persistent cache of text layouts
+    /// \param documentHash Hash of the document file content (see PDFTextLayoutDiskCache::createDocumentHash)
+    void setDiskCache(PDFTextLayoutDiskCache diskCache, QByteArray documentHash);
+
+    /// Returns pages from \p pageIndices, which can contain the text. Full-text index
+    /// of text layouts created so far is used (see PDFTextIndex::getCandidatePages),
+    /// so text layouts of other pages need not to be searched. If text flow flags
+    /// differ from flags of the index, all pages are returned.
+    /// \param text Text to be found
+    /// \param flowFlags Text flow flags used for searching
+    /// \param pageIndices Indices of pages
+    std::vector<PDFInteger> getCandidatePages(const QString& text, PDFTextFlow::FlowFlags flowFlags, const std::vector<PDFInteger>& pageIndices) const;
+
 signals:
     void textLayoutChanged();
+    void textLayoutPagesCreated(const std::vector<pdf::PDFInteger>& pageIndices);
 
 private:
     void onTextLayoutCreated();
 
+    /// Stores text layouts of pages created by text layout job so far
+    /// \param jobId Identifier of the text layout job
+    /// \param storage Text layouts created so far
+    /// \param pageIndices Indices of pages created in last batch
+    void onTextLayoutPagesCreated(quint64 jobId, const PDFTextLayoutStorage& storage, const std::vector<PDFInteger>& pageIndices);
+
+    /// Updates pages, which are processed by text layout job with the highest priority
+    void updatePriorityPages();
+
+    /// Removes next batch of pages from remaining pages and returns it. Pages nearest
+    /// to the priority pages are taken first. This function is called from text layout job.
+    /// \param remainingPages Pages without text layout
+    std::vector<PDFInteger> takeTextLayoutBatch(std::vector<PDFInteger>& remainingPages);
+
+    /// Returns true, if persistent cache of text layouts can be used for the current document
+    bool isDiskCacheUsable() const;
+
+    /// Number of pages processed by text layout job before they are published
+    static constexpr size_t TEXT_LAYOUT_BATCH_SIZE = 16;
+
     PDFDrawWidgetProxy* m_proxy;
     State m_state = State::Inactive;
     bool m_isRunning;
+    std::atomic_bool m_cancelled = false;       ///< Text layout job should stop (read by the worker thread)
     std::optional<PDFTextLayoutStorage> m_textLayouts;
+    PDFTextLayoutStorage m_pageTextLayouts;     ///< Text layouts of single pages created so far
+    mutable QMutex m_textIndexMutex;
+    PDFTextIndex m_textIndex;                   ///< Full-text index of text layouts created so far (protected by mutex)
+    quint64 m_textLayoutJobId = 0;
+    QMutex m_priorityPagesMutex;
+    std::vector<PDFInteger> m_priorityPages;    ///< Pages with the highest priority (protected by mutex)
     QFuture<PDFTextLayoutStorage> m_textLayoutCompileFuture;
     QFutureWatcher<PDFTextLayoutStorage> m_textLayoutCompileFutureWatcher;
     PDFTextLayoutCache m_cache;
+    PDFTextLayoutDiskCache m_diskCache;
+    QByteArray m_diskCacheDocumentHash;
+    quint64 m_diskCacheContentId = 0;           ///< Content identifier of the document, for which disk cache is set
 };
 
 class PDFTextLayoutGenerator : public PDFPageContentProcessor
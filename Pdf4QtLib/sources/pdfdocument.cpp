@@ -21,8 +21,13 @@
 #include "pdfexception.h"
 #include "pdfstreamfilters.h"
 #include "pdfconstants.h"
+#include "pdfexecutionpolicy.h"
 #include "pdfdbgheap.h"
 
+#include <atomic>
+#include <algorithm>
+#include <numeric>
+
 namespace pdf
 {
 
@@ -30,7 +35,137 @@ static constexpr const char* PDF_DOCUMENT_INFO_ENTRY = "Info";
 
 QByteArray PDFObjectStorage::getDecodedStream(const PDFStream* stream) const
 {
-    return PDFStreamFilterStorage::getDecodedStream(stream, std::bind(QOverload<const PDFObject&>::of(&PDFObjectStorage::getObject), this, std::placeholders::_1), getSecurityHandler());
+    auto decode = [this, stream]()
+    {
+        return PDFStreamFilterStorage::getDecodedStream(stream, std::bind(QOverload<const PDFObject&>::of(&PDFObjectStorage::getObject), this, std::placeholders::_1), getSecurityHandler());
+    };
+
+    return m_decodedStreamCache->getDecodedStream(stream, decode);
+}
+
+void PDFObjectStorage::invalidateCaches()
+{
+    // Storage can be in moved-from state, so cache can be null
+    const qint64 limit = m_decodedStreamCache ? m_decodedStreamCache->getStatistics().limit : PDFDecodedStreamCache::DEFAULT_LIMIT;
+    m_decodedStreamCache = PDFDecodedStreamCachePointer::create(limit);
+    m_contentId = createContentId();
+}
+
+quint64 PDFObjectStorage::createContentId()
+{
+    static std::atomic<quint64> s_contentId = 0;
+    return ++s_contentId;
+}
+
+PDFDecodedStreamCache::PDFDecodedStreamCache(qint64 limit) :
+    m_limit(limit)
+{
+
+}
+
+QByteArray PDFDecodedStreamCache::getDecodedStream(const PDFStream* stream, const std::function<QByteArray(void)>& decode)
+{
+    const QByteArray* content = stream ? stream->getContent() : nullptr;
+    if (!content || content->isEmpty())
+    {
+        return decode();
+    }
+
+    {
+        QMutexLocker lock(&m_mutex);
+
+        auto it = m_entryMap.find(stream);
+        if (it != m_entryMap.cend())
+        {
+            Entries::iterator entryIt = it->second;
+            if (isEntryValid(*entryIt, stream))
+            {
+                ++m_hits;
+                m_entries.splice(m_entries.begin(), m_entries, entryIt);
+                return entryIt->decodedData;
+            }
+
+            // Stream address was reused by another stream, entry is obsolete
+            m_size -= entryIt->decodedData.size();
+            m_entries.erase(entryIt);
+            m_entryMap.erase(it);
+        }
+
+        ++m_misses;
+    }
+
+    // Decode the stream outside the lock, so other threads are not blocked
+    QByteArray decodedData = decode();
+
+    QMutexLocker lock(&m_mutex);
+    if (decodedData.isEmpty() || decodedData.size() > m_limit || m_entryMap.count(stream))
+    {
+        // Do not cache failed decodings and data not fitting into the cache. Also,
+        // another thread may have decoded the stream in the meantime.
+        return decodedData;
+    }
+
+    Entry entry;
+    entry.stream = stream;
+    entry.content = *content;
+    entry.dictionary = *stream->getDictionary();
+    entry.decodedData = decodedData;
+
+    m_size += decodedData.size();
+    m_entries.push_front(qMove(entry));
+    m_entryMap[stream] = m_entries.begin();
+    shrink();
+
+    return decodedData;
+}
+
+void PDFDecodedStreamCache::clear()
+{
+    QMutexLocker lock(&m_mutex);
+    m_entries.clear();
+    m_entryMap.clear();
+    m_size = 0;
+}
+
+void PDFDecodedStreamCache::setLimit(qint64 limit)
+{
+    QMutexLocker lock(&m_mutex);
+    m_limit = limit;
+    shrink();
+}
+
+PDFDecodedStreamCache::Statistics PDFDecodedStreamCache::getStatistics() const
+{
+    QMutexLocker lock(&m_mutex);
+
+    Statistics statistics;
+    statistics.hits = m_hits;
+    statistics.misses = m_misses;
+    statistics.size = m_size;
+    statistics.count = static_cast<qint64>(m_entries.size());
+    statistics.limit = m_limit;
+    return statistics;
+}
+
+bool PDFDecodedStreamCache::isEntryValid(const Entry& entry, const PDFStream* stream)
+{
+    // Cached content copy keeps the data alive, so if data pointers are the same,
+    // then the stream shares content with the stream, for which entry was created.
+    const QByteArray* content = stream->getContent();
+    return entry.content.constData() == content->constData() &&
+           entry.content.size() == content->size() &&
+           entry.dictionary.equals(stream->getDictionary());
+}
+
+void PDFDecodedStreamCache::shrink()
+{
+    while (m_size > m_limit && !m_entries.empty())
+    {
+        const Entry& entry = m_entries.back();
+        m_size -= entry.decodedData.size();
+        m_entryMap.erase(entry.stream);
+        m_entries.pop_back();
+    }
 }
 
 PDFDocument::~PDFDocument()
@@ -124,6 +259,9 @@ void PDFDocument::initInfo()
 
 bool PDFObjectStorage::operator==(const PDFObjectStorage& other) const
 {
+    loadAllObjects();
+    other.loadAllObjects();
+
     // We compare just content. Security handler just defines encryption behavior.
     return m_objects == other.m_objects &&
            m_trailerDictionary == other.m_trailerDictionary;
@@ -135,6 +273,11 @@ const PDFObject& PDFObjectStorage::getObject(PDFObjectReference reference) const
         reference.objectNumber < static_cast<PDFInteger>(m_objects.size()) &&
         m_objects[reference.objectNumber].generation == reference.generation)
     {
+        if (m_objectLoader)
+        {
+            loadObject(reference.objectNumber);
+        }
+
         return m_objects[reference.objectNumber].object;
     }
     else
@@ -144,16 +287,159 @@ const PDFObject& PDFObjectStorage::getObject(PDFObjectReference reference) const
     }
 }
 
+PDFObjectStorage::PDFObjects& PDFObjectStorage::getObjects()
+{
+    if (m_objectLoader)
+    {
+        // Objects can be modified by the caller, so we must turn off lazy loading
+        loadAllObjects();
+        m_objectLoader.reset();
+        m_objectLoaderMutex.reset();
+        m_loadStates.clear();
+        m_residentObjects.clear();
+    }
+
+    // Objects can be modified by the caller, decoded streams can be obsolete
+    invalidateCaches();
+    return m_objects;
+}
+
+void PDFObjectStorage::setObjects(PDFObjects&& objects)
+{
+    m_objects = qMove(objects);
+    invalidateCaches();
+    m_objectLoader.reset();
+    m_objectLoaderMutex.reset();
+    m_loadStates.clear();
+    m_residentObjects.clear();
+}
+
+void PDFObjectStorage::addMappedFiles(const PDFObjectStorage& storage)
+{
+    for (const QSharedPointer<QFile>& mappedFile : storage.m_mappedFiles)
+    {
+        if (std::find(m_mappedFiles.cbegin(), m_mappedFiles.cend(), mappedFile) == m_mappedFiles.cend())
+        {
+            m_mappedFiles.push_back(mappedFile);
+        }
+    }
+}
+
 PDFObjectReference PDFObjectStorage::addObject(PDFObject object)
 {
     PDFObjectReference reference(m_objects.size(), 0);
     m_objects.emplace_back(0, qMove(object));
+
+    if (m_objectLoader)
+    {
+        m_loadStates.push_back(LoadState::Loaded);
+    }
+
     return reference;
 }
 
 void PDFObjectStorage::setObject(PDFObjectReference reference, PDFObject object)
 {
     m_objects[reference.objectNumber] = Entry(reference.generation, qMove(object));
+    invalidateCaches();
+
+    if (m_objectLoader)
+    {
+        // Modified object must never be released
+        m_loadStates[reference.objectNumber] = LoadState::Loaded;
+    }
+}
+
+void PDFObjectStorage::setObjectLoader(PDFObjectLoaderPointer loader, size_t residentObjectLimit)
+{
+    m_objectLoader = qMove(loader);
+    m_objectLoaderMutex.reset();
+    m_loadStates.clear();
+    m_residentObjects.clear();
+    m_residentObjectLimit = residentObjectLimit;
+
+    if (m_objectLoader)
+    {
+        m_objectLoaderMutex.reset(new QMutex());
+        m_loadStates.reserve(m_objects.size());
+
+        for (const Entry& entry : m_objects)
+        {
+            m_loadStates.push_back(entry.object.isNull() ? LoadState::NotLoaded : LoadState::Loaded);
+        }
+    }
+}
+
+void PDFObjectStorage::releaseObjects() const
+{
+    if (!m_objectLoader)
+    {
+        return;
+    }
+
+    QMutexLocker lock(m_objectLoaderMutex.data());
+    while (m_residentObjects.size() > m_residentObjectLimit)
+    {
+        const PDFInteger objectNumber = m_residentObjects.front();
+        m_residentObjects.pop_front();
+
+        if (m_loadStates[objectNumber] == LoadState::LoadedOnDemand)
+        {
+            m_objects[objectNumber].object = PDFObject();
+            m_loadStates[objectNumber] = LoadState::NotLoaded;
+        }
+    }
+}
+
+void PDFObjectStorage::loadObject(PDFInteger objectNumber) const
+{
+    {
+        QMutexLocker lock(m_objectLoaderMutex.data());
+        if (m_loadStates[objectNumber] != LoadState::NotLoaded)
+        {
+            return;
+        }
+    }
+
+    // Object is loaded without the lock, so more objects can be loaded in parallel.
+    // If two threads load the same object, then the first one wins.
+    PDFObject object = m_objectLoader->loadObject(PDFObjectReference(objectNumber, m_objects[objectNumber].generation));
+
+    QMutexLocker lock(m_objectLoaderMutex.data());
+    if (m_loadStates[objectNumber] == LoadState::NotLoaded)
+    {
+        m_objects[objectNumber].object = qMove(object);
+        m_loadStates[objectNumber] = LoadState::LoadedOnDemand;
+        m_residentObjects.push_back(objectNumber);
+    }
+}
+
+void PDFObjectStorage::loadAllObjects() const
+{
+    if (!m_objectLoader)
+    {
+        return;
+    }
+
+    {
+        QMutexLocker lock(m_objectLoaderMutex.data());
+        if (std::all_of(m_loadStates.cbegin(), m_loadStates.cend(), [](LoadState state) { return state == LoadState::Loaded; }))
+        {
+            return;
+        }
+    }
+
+    std::vector<PDFInteger> objectNumbers(m_objects.size(), 0);
+    std::iota(objectNumbers.begin(), objectNumbers.end(), 0);
+
+    auto loadEntry = [this](PDFInteger objectNumber) { loadObject(objectNumber); };
+    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, objectNumbers.cbegin(), objectNumbers.cend(), loadEntry);
+
+    // References to all objects can be held by the caller now,
+    // so objects can't be released anymore.
+    QMutexLocker lock(m_objectLoaderMutex.data());
+    std::fill(m_loadStates.begin(), m_loadStates.end(), LoadState::Loaded);
+    m_residentObjects.clear();
 }
 
 void PDFObjectStorage::updateTrailerDictionary(PDFObject trailerDictionary)
@@ -28,13 +28,98 @@
 #include <QTransform>
 #include <QDateTime>
 
+#include <list>
+#include <deque>
 #include <optional>
+#include <unordered_map>
 
 namespace pdf
 {
 class PDFDocument;
 class PDFDocumentBuilder;
 
+/// Interface for loading objects on demand. It is used, when document is being
+/// read lazily - objects are parsed (and decrypted) when they are accessed for
+/// the first time. Implementation must be thread safe.
+class PDF4QTLIBSHARED_EXPORT PDFObjectLoader
+{
+public:
+    explicit PDFObjectLoader() = default;
+    virtual ~PDFObjectLoader() = default;
+
+    /// Loads object with given reference. If object can't be loaded,
+    /// then null object is returned (no exception is thrown).
+    /// \param reference Reference to the object
+    virtual PDFObject loadObject(PDFObjectReference reference) const = 0;
+};
+
+using PDFObjectLoaderPointer = QSharedPointer<PDFObjectLoader>;
+
+/// Cache of decoded stream data. Decoding the same streams over and over again
+/// (for example, form XObjects shared by all pages, fonts, or color profiles) is
+/// avoided. Streams are identified by their address, the cache holds a copy of stream
+/// content and dictionary to detect, that the address was reused by another stream.
+/// If total size of decoded data exceeds the limit, least recently used data are
+/// removed from the cache. This class is thread safe.
+class PDF4QTLIBSHARED_EXPORT PDFDecodedStreamCache
+{
+public:
+    static constexpr const qint64 DEFAULT_LIMIT = 64 * 1024 * 1024;
+
+    explicit PDFDecodedStreamCache(qint64 limit = DEFAULT_LIMIT);
+
+    struct Statistics
+    {
+        qint64 hits = 0;        ///< Count of requests, which were satisfied from the cache
+        qint64 misses = 0;      ///< Count of requests, for which stream was decoded
+        qint64 size = 0;        ///< Total size of cached decoded data in bytes
+        qint64 count = 0;       ///< Count of cached streams
+        qint64 limit = 0;       ///< Limit of total size of cached decoded data in bytes
+    };
+
+    /// Returns decoded data of the stream. If they are not present in the cache,
+    /// then they are decoded using \p decode function and stored in the cache.
+    /// \param stream Stream
+    /// \param decode Function, which decodes the stream
+    QByteArray getDecodedStream(const PDFStream* stream, const std::function<QByteArray(void)>& decode);
+
+    /// Removes all decoded data from the cache (statistics are preserved)
+    void clear();
+
+    /// Sets limit of total size of decoded data in bytes
+    void setLimit(qint64 limit);
+
+    /// Returns cache statistics
+    Statistics getStatistics() const;
+
+private:
+    struct Entry
+    {
+        const PDFStream* stream = nullptr;
+        QByteArray content;
+        PDFDictionary dictionary;
+        QByteArray decodedData;
+    };
+
+    using Entries = std::list<Entry>;
+
+    /// Returns true, if entry was created for given stream
+    static bool isEntryValid(const Entry& entry, const PDFStream* stream);
+
+    /// Removes least recently used entries, until size of decoded data fits into the limit
+    void shrink();
+
+    mutable QMutex m_mutex;
+    Entries m_entries;  ///< Most recently used entries are at the front
+    std::unordered_map<const PDFStream*, Entries::iterator> m_entryMap;
+    qint64 m_limit = DEFAULT_LIMIT;
+    qint64 m_size = 0;
+    qint64 m_hits = 0;
+    qint64 m_misses = 0;
+};
+
+using PDFDecodedStreamCachePointer = QSharedPointer<PDFDecodedStreamCache>;
+
 /// Storage for objects. This class is not thread safe for writing (calling non-const functions). Caller must ensure
 /// locking, if this object is used from multiple threads. Calling const functions should be thread safe.
 class PDF4QTLIBSHARED_EXPORT PDFObjectStorage
@@ -91,14 +176,17 @@ public:
     /// is returned (no exception is thrown).
     const PDFObject& getObjectByReference(PDFObjectReference reference) const;
 
-    /// Returns array of objects stored in this storage
-    const PDFObjects& getObjects() const { return m_objects; }
+    /// Returns array of objects stored in this storage. If objects are
+    /// loaded on demand, all remaining objects are loaded.
+    const PDFObjects& getObjects() const { loadAllObjects(); return m_objects; }
 
-    /// Returns array of objects stored in this storage
-    PDFObjects& getObjects() { return m_objects; }
+    /// Returns array of objects stored in this storage. If objects are
+    /// loaded on demand, all remaining objects are loaded and lazy loading
+    /// is turned off (objects can be modified by the caller).
+    PDFObjects& getObjects();
 
     /// Sets array of objects
-    void setObjects(PDFObjects&& objects) { m_objects = qMove(objects); }
+    void setObjects(PDFObjects&& objects);
 
     /// Returns trailer dictionary
     const PDFObject& getTrailerDictionary() const { return m_trailerDictionary; }
@@ -107,7 +195,7 @@ public:
     const PDFSecurityHandler* getSecurityHandler() const { return m_securityHandler.data(); }
 
     /// Sets security handler associated with these objects
-    void setSecurityHandler(PDFSecurityHandlerPointer handler) { m_securityHandler = qMove(handler); }
+    void setSecurityHandler(PDFSecurityHandlerPointer handler) { m_securityHandler = qMove(handler); invalidateCaches(); }
 
     /// Adds a new object to the object list. This function
     /// is not thread safe, do not call it from multiple threads.
@@ -127,18 +215,89 @@ public:
     void updateTrailerDictionary(PDFObject trailerDictionary);
 
     /// Returns the decoded stream. If stream data cannot be decoded,
-    /// then empty byte array is returned.
+    /// then empty byte array is returned. Decoded data are cached.
     /// \param stream Stream to be decoded
     QByteArray getDecodedStream(const PDFStream* stream) const;
 
+    /// Returns cache of decoded streams
+    PDFDecodedStreamCache* getDecodedStreamCache() const { return m_decodedStreamCache.data(); }
+
+    /// Returns identifier of the storage content. Identifier is unique in the process
+    /// and is changed, when objects are modified. Two storages with the same identifier
+    /// have the same content, so it can be used as a key of process-wide caches.
+    quint64 getContentId() const { return m_contentId; }
+
     /// Set trailer dictionary
     /// \param object Object defining trailer dictionary
     void setTrailerDictionary(const PDFObject& object) { m_trailerDictionary = object; }
 
+    /// Turns on lazy loading of objects. Objects, which are null in this storage,
+    /// are loaded using \p loader, when they are accessed for the first time.
+    /// Objects loaded on demand can be released by function \p releaseObjects.
+    /// \param loader Object loader
+    /// \param residentObjectLimit Count of objects loaded on demand, which are kept in memory
+    void setObjectLoader(PDFObjectLoaderPointer loader, size_t residentObjectLimit);
+
+    /// Sets memory mapped file, whose data are referenced by objects of this
+    /// storage (for example, stream data). File is kept mapped, while this
+    /// storage (or any of its copies) exists.
+    /// \param file Memory mapped file
+    void setMappedFile(QSharedPointer<QFile> file) { m_mappedFiles = { qMove(file) }; }
+
+    /// Adds memory mapped files of storage \p storage to this storage. Must be
+    /// called, when objects are copied from \p storage to this storage, because
+    /// copied objects can reference data of these files.
+    /// \param storage Storage, from which objects are copied
+    void addMappedFiles(const PDFObjectStorage& storage);
+
+    /// Returns true, if objects are loaded on demand
+    bool isLazyLoading() const { return !m_objectLoader.isNull(); }
+
+    /// Releases objects loaded on demand, so at most resident object limit of
+    /// such objects remains in memory. Oldest loaded objects are released first,
+    /// they are loaded again, when they are accessed. Modified objects are never
+    /// released. Caller must ensure, that no other thread accesses this storage
+    /// and no references to the objects are held during this call.
+    void releaseObjects() const;
+
 private:
-    PDFObjects m_objects;
+    /// Load state of the object (used only, when objects are loaded on demand)
+    enum class LoadState : uint8_t
+    {
+        Loaded,             ///< Object is present, it can't be released
+        NotLoaded,          ///< Object was not loaded yet (or it was released)
+        LoadedOnDemand      ///< Object was loaded on demand, it can be released
+    };
+
+    /// Loads object with given object number, if it is not loaded yet
+    /// \param objectNumber Object number
+    void loadObject(PDFInteger objectNumber) const;
+
+    /// Loads all objects, which are not loaded yet. Loaded
+    /// objects can't be released afterwards.
+    void loadAllObjects() const;
+
+    /// Replaces cache of decoded streams by a new one and assigns new content
+    /// identifier. Must be called, when objects are modified, because the cache
+    /// and the identifier can be shared with copies of this storage.
+    void invalidateCaches();
+
+    /// Creates new unique content identifier
+    static quint64 createContentId();
+
+    /// Objects (mutable, because they can be loaded on demand)
+    mutable PDFObjects m_objects;
     PDFObject m_trailerDictionary;
     PDFSecurityHandlerPointer m_securityHandler;
+    std::vector<QSharedPointer<QFile>> m_mappedFiles;
+    PDFDecodedStreamCachePointer m_decodedStreamCache = PDFDecodedStreamCachePointer::create();
+    quint64 m_contentId = createContentId();
+
+    PDFObjectLoaderPointer m_objectLoader;
+    QSharedPointer<QMutex> m_objectLoaderMutex;
+    mutable std::vector<LoadState> m_loadStates;
+    mutable std::deque<PDFInteger> m_residentObjects;
+    size_t m_residentObjectLimit = 0;
 };
 
 /// Loads data from the object contained in the PDF document, such as integers,
@@ -1776,6 +1776,13 @@ std::vector<PDFObject> PDFDocumentBuilder::copyFrom(const std::vector<PDFObject>
     //    we must also collect references of referenced object.
     std::set<PDFObjectReference> references = PDFObjectUtils::getReferences(objects, storage);
 
+    // Copied objects can reference data of memory mapped files of the source storage,
+    // so these files must be kept mapped, while this storage exists.
+    if (&storage != &m_storage)
+    {
+        m_storage.addMappedFiles(storage);
+    }
+
     // 2) Make room for new objects, together with mapping
     std::map<PDFObjectReference, PDFObjectReference> referenceMapping;
     for (const PDFObjectReference& reference : references)
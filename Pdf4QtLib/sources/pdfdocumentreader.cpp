@@ -28,6 +28,7 @@
 #include <QFile>
 
 #include <regex>
+#include <deque>
 #include <cctype>
 #include <algorithm>
 #include <execution>
@@ -35,6 +36,306 @@
 namespace pdf
 {
 
+/// Fetches indirect object from the source data from the specified offset.
+/// Throws exception, if object can't be read, or if it has different reference.
+/// \param source Source data
+/// \param context Context
+/// \param offset Offset
+/// \param reference Reference to parsed object
+/// \param features Parser features
+static PDFObject readIndirectObject(const QByteArray& source, PDFParsingContext* context, PDFInteger offset, PDFObjectReference reference, PDFParser::Features features)
+{
+    PDFParsingContext::PDFParsingContextGuard guard(context, reference);
+
+    PDFParser parser(source, context, features);
+    parser.seek(offset);
+
+    PDFObject objectNumber = parser.getObject();
+    PDFObject generation = parser.getObject();
+
+    if (!objectNumber.isInt() || !generation.isInt())
+    {
+        throw PDFException(PDFDocumentReader::tr("Can't read object at position %1.").arg(offset));
+    }
+
+    if (!parser.fetchCommand(PDF_OBJECT_START_MARK))
+    {
+        throw PDFException(PDFDocumentReader::tr("Can't read object at position %1.").arg(offset));
+    }
+
+    PDFObject object = parser.getObject();
+
+    if (!parser.fetchCommand(PDF_OBJECT_END_MARK))
+    {
+        throw PDFException(PDFDocumentReader::tr("Can't read object at position %1.").arg(offset));
+    }
+
+    PDFObjectReference scannedReference(objectNumber.getInteger(), generation.getInteger());
+    if (scannedReference != reference)
+    {
+        throw PDFException(PDFDocumentReader::tr("Can't read object at position %1.").arg(offset));
+    }
+
+    return object;
+}
+
+/// Returns true, if header of the indirect object ("number generation obj") with
+/// given reference is at the offset. Object itself is not read.
+static bool isIndirectObjectHeaderValid(const QByteArray& source, PDFInteger offset, PDFObjectReference reference)
+{
+    if (offset < 0 || offset >= source.size())
+    {
+        return false;
+    }
+
+    try
+    {
+        PDFLexicalAnalyzer analyzer(source.constData(), source.constData() + source.size());
+        analyzer.seek(offset);
+
+        PDFLexicalAnalyzer::Token objectNumber = analyzer.fetch();
+        PDFLexicalAnalyzer::Token generation = analyzer.fetch();
+        PDFLexicalAnalyzer::Token command = analyzer.fetch();
+
+        return objectNumber.type == PDFLexicalAnalyzer::TokenType::Integer && objectNumber.getInteger() == reference.objectNumber &&
+               generation.type == PDFLexicalAnalyzer::TokenType::Integer && generation.getInteger() == reference.generation &&
+               command.type == PDFLexicalAnalyzer::TokenType::Command && command.getBytes() == PDF_OBJECT_START_MARK;
+    }
+    catch (const PDFException&)
+    {
+        return false;
+    }
+}
+
+/// Decodes object stream and reads its header. Returns decoded data of the object
+/// stream and fills pairs of object number and offset of the object in decoded data.
+/// Throws exception, if object stream is invalid.
+/// \param object Object stream (already decrypted)
+/// \param objectStreamReference Reference to the object stream
+/// \param context Context
+/// \param securityHandler Security handler
+/// \param[out] objectNumberAndOffset Pairs of object number and offset
+static QByteArray decodeObjectStream(const PDFObject& object,
+                                     PDFObjectReference objectStreamReference,
+                                     PDFParsingContext* context,
+                                     const PDFSecurityHandler* securityHandler,
+                                     std::vector<std::pair<PDFInteger, PDFInteger>>& objectNumberAndOffset)
+{
+    if (!object.isStream())
+    {
+        throw PDFException(PDFTranslationContext::tr("Object stream %1 is invalid.").arg(objectStreamReference.objectNumber));
+    }
+
+    const PDFStream* objectStream = object.getStream();
+    const PDFDictionary* objectStreamDictionary = objectStream->getDictionary();
+
+    const PDFObject& objectStreamType = objectStreamDictionary->get("Type");
+    if (!objectStreamType.isName() || objectStreamType.getString() != "ObjStm")
+    {
+        throw PDFException(PDFTranslationContext::tr("Object stream %1 is invalid.").arg(objectStreamReference.objectNumber));
+    }
+
+    const PDFObject& nObject = objectStreamDictionary->get("N");
+    const PDFObject& firstObject = objectStreamDictionary->get("First");
+    if (!nObject.isInt() || !firstObject.isInt())
+    {
+        throw PDFException(PDFTranslationContext::tr("Object stream %1 is invalid.").arg(objectStreamReference.objectNumber));
+    }
+
+    // Number of objects in object stream dictionary
+    const PDFInteger n = nObject.getInteger();
+    const PDFInteger first = firstObject.getInteger();
+
+    QByteArray objectStreamData = PDFStreamFilterStorage::getDecodedStream(objectStream, securityHandler);
+
+    PDFParsingContext::PDFParsingContextGuard guard(context, objectStreamReference);
+    PDFParser parser(objectStreamData, context, PDFParser::AllowStreams);
+
+    objectNumberAndOffset.clear();
+    objectNumberAndOffset.reserve(n);
+    for (PDFInteger i = 0; i < n; ++i)
+    {
+        PDFObject currentObjectNumber = parser.getObject();
+        PDFObject currentOffset = parser.getObject();
+
+        if (!currentObjectNumber.isInt() || !currentOffset.isInt())
+        {
+            throw PDFException(PDFTranslationContext::tr("Object stream %1 is invalid.").arg(objectStreamReference.objectNumber));
+        }
+
+        const PDFInteger objectNumber = currentObjectNumber.getInteger();
+        const PDFInteger offset = currentOffset.getInteger() + first;
+        objectNumberAndOffset.emplace_back(objectNumber, offset);
+    }
+
+    return objectStreamData;
+}
+
+/// Object loader used, when document is read lazily. Objects are read directly
+/// from the source data using the cross reference table, and are decrypted,
+/// if document is encrypted. Recently decoded object streams are cached.
+class PDFDocumentReaderObjectLoader : public PDFObjectLoader
+{
+public:
+    explicit PDFDocumentReaderObjectLoader(QByteArray source,
+                                           PDFXRefTable xrefTable,
+                                           PDFSecurityHandlerPointer securityHandler,
+                                           PDFObjectReference encryptObjectReference,
+                                           PDFParser::Features parserFeatures) :
+        m_source(qMove(source)),
+        m_xrefTable(qMove(xrefTable)),
+        m_securityHandler(qMove(securityHandler)),
+        m_encryptObjectReference(encryptObjectReference),
+        m_parserFeatures(parserFeatures)
+    {
+
+    }
+
+    virtual PDFObject loadObject(PDFObjectReference reference) const override;
+
+private:
+    static constexpr const size_t OBJECT_STREAM_CACHE_SIZE = 8;
+
+    struct ObjectStream
+    {
+        PDFObjectReference reference;
+        QByteArray data;
+        std::map<PDFInteger, PDFInteger> offsets;
+    };
+
+    using ObjectStreamPointer = std::shared_ptr<const ObjectStream>;
+
+    /// Reads object from the source data, object is not decrypted. Used
+    /// to resolve references during parsing (for example, stream length).
+    PDFObject fetchObject(PDFParsingContext* context, PDFObjectReference reference) const;
+
+    /// Reads regular object from the source data and decrypts it
+    PDFObject readObject(PDFParsingContext* context, PDFObjectReference reference, PDFInteger offset) const;
+
+    /// Returns decoded object stream, either from the cache, or reads it
+    ObjectStreamPointer getObjectStream(PDFObjectReference reference) const;
+
+    QByteArray m_source;
+    PDFXRefTable m_xrefTable;
+    PDFSecurityHandlerPointer m_securityHandler;
+    PDFObjectReference m_encryptObjectReference;
+    PDFParser::Features m_parserFeatures;
+
+    mutable QMutex m_mutex;
+    mutable std::deque<ObjectStreamPointer> m_objectStreams;
+};
+
+PDFObject PDFDocumentReaderObjectLoader::loadObject(PDFObjectReference reference) const
+{
+    try
+    {
+        PDFParsingContext context([this](PDFParsingContext* context, PDFObjectReference reference) { return fetchObject(context, reference); });
+        const PDFXRefTable::Entry& entry = m_xrefTable.getEntry(reference);
+
+        switch (entry.type)
+        {
+            case PDFXRefTable::EntryType::Free:
+                break;
+
+            case PDFXRefTable::EntryType::Occupied:
+                return readObject(&context, reference, entry.offset);
+
+            case PDFXRefTable::EntryType::InObjectStream:
+            {
+                ObjectStreamPointer objectStream = getObjectStream(entry.objectStream);
+                auto it = objectStream->offsets.find(reference.objectNumber);
+                if (it != objectStream->offsets.cend())
+                {
+                    PDFParsingContext::PDFParsingContextGuard guard(&context, entry.objectStream);
+                    PDFParser parser(objectStream->data, &context, PDFParser::AllowStreams);
+                    parser.seek(it->second);
+                    return parser.getObject();
+                }
+                break;
+            }
+
+            default:
+            {
+                Q_ASSERT(false);
+                break;
+            }
+        }
+    }
+    catch (const PDFException&)
+    {
+        // Object can't be read, null object is returned
+    }
+
+    return PDFObject();
+}
+
+PDFObject PDFDocumentReaderObjectLoader::fetchObject(PDFParsingContext* context, PDFObjectReference reference) const
+{
+    const PDFXRefTable::Entry& entry = m_xrefTable.getEntry(reference);
+    if (entry.type == PDFXRefTable::EntryType::Occupied)
+    {
+        return readIndirectObject(m_source, context, entry.offset, reference, m_parserFeatures);
+    }
+
+    return PDFObject();
+}
+
+PDFObject PDFDocumentReaderObjectLoader::readObject(PDFParsingContext* context, PDFObjectReference reference, PDFInteger offset) const
+{
+    PDFObject object = readIndirectObject(m_source, context, offset, reference, m_parserFeatures);
+
+    // Encryption dictionary is never encrypted, see PDFDocumentReader::processSecurityHandler
+    if (m_securityHandler && m_securityHandler->getMode() != EncryptionMode::None && reference != m_encryptObjectReference)
+    {
+        object = m_securityHandler->decryptObject(object, reference);
+    }
+
+    return object;
+}
+
+PDFDocumentReaderObjectLoader::ObjectStreamPointer PDFDocumentReaderObjectLoader::getObjectStream(PDFObjectReference reference) const
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        for (const ObjectStreamPointer& objectStream : m_objectStreams)
+        {
+            if (objectStream->reference == reference)
+            {
+                return objectStream;
+            }
+        }
+    }
+
+    const PDFXRefTable::Entry& entry = m_xrefTable.getEntry(reference);
+    if (entry.type != PDFXRefTable::EntryType::Occupied)
+    {
+        throw PDFException(PDFTranslationContext::tr("Object stream %1 not found.").arg(reference.objectNumber));
+    }
+
+    PDFParsingContext context([this](PDFParsingContext* context, PDFObjectReference reference) { return fetchObject(context, reference); });
+    PDFObject object = readObject(&context, reference, entry.offset);
+
+    std::vector<std::pair<PDFInteger, PDFInteger>> objectNumberAndOffset;
+    std::shared_ptr<ObjectStream> objectStream = std::make_shared<ObjectStream>();
+    objectStream->reference = reference;
+    objectStream->data = decodeObjectStream(object, reference, &context, m_securityHandler.data(), objectNumberAndOffset);
+
+    for (const auto& item : objectNumberAndOffset)
+    {
+        objectStream->offsets.insert(item);
+    }
+
+    QMutexLocker lock(&m_mutex);
+    m_objectStreams.push_back(objectStream);
+    if (m_objectStreams.size() > OBJECT_STREAM_CACHE_SIZE)
+    {
+        m_objectStreams.pop_front();
+    }
+
+    return objectStream;
+}
+
+
 PDFDocumentReader::PDFDocumentReader(PDFProgress* progress, const std::function<QString(bool*)>& getPasswordCallback, bool permissive, bool authorizeOwnerOnly) :
     m_result(Result::OK),
     m_getPasswordCallback(getPasswordCallback),
@@ -53,6 +354,24 @@ PDFDocument PDFDocumentReader::readFromFile(const QString& fileName)
 
     if (file.exists())
     {
+        if (m_memoryMapping)
+        {
+            QSharedPointer<QFile> mappedFile(new QFile(fileName));
+            if (mappedFile->open(QFile::ReadOnly) && mappedFile->size() > 0)
+            {
+                if (uchar* data = mappedFile->map(0, mappedFile->size()))
+                {
+                    // Data are not copied, they reference the mapped file. File is kept
+                    // mapped by this reader and by the storage of the read document.
+                    const qint64 size = mappedFile->size();
+                    m_mappedFile = qMove(mappedFile);
+                    return readFromBuffer(QByteArray::fromRawData(reinterpret_cast<const char*>(data), size));
+                }
+            }
+
+            // If file can't be mapped, we read it in the usual way
+        }
+
         if (file.open(QFile::ReadOnly))
         {
             PDFDocument document = readFromDevice(&file);
@@ -179,44 +498,13 @@ PDFInteger PDFDocumentReader::findXrefTableOffset(const QByteArray& buffer)
         throw PDFException(tr("Start of object reference table not found."));
     }
 
-    const PDFInteger firstXrefTableOffset = token.data.toLongLong();
+    const PDFInteger firstXrefTableOffset = token.getInteger();
     return firstXrefTableOffset;
 }
 
 PDFObject PDFDocumentReader::getObject(PDFParsingContext* context, PDFInteger offset, PDFObjectReference reference) const
 {
-    PDFParsingContext::PDFParsingContextGuard guard(context, reference);
-
-    PDFParser parser(m_source, context, PDFParser::AllowStreams);
-    parser.seek(offset);
-
-    PDFObject objectNumber = parser.getObject();
-    PDFObject generation = parser.getObject();
-
-    if (!objectNumber.isInt() || !generation.isInt())
-    {
-        throw PDFException(tr("Can't read object at position %1.").arg(offset));
-    }
-
-    if (!parser.fetchCommand(PDF_OBJECT_START_MARK))
-    {
-        throw PDFException(tr("Can't read object at position %1.").arg(offset));
-    }
-
-    PDFObject object = parser.getObject();
-
-    if (!parser.fetchCommand(PDF_OBJECT_END_MARK))
-    {
-        throw PDFException(tr("Can't read object at position %1.").arg(offset));
-    }
-
-    PDFObjectReference scannedReference(objectNumber.getInteger(), generation.getInteger());
-    if (scannedReference != reference)
-    {
-        throw PDFException(tr("Can't read object at position %1.").arg(offset));
-    }
-
-    return object;
+    return readIndirectObject(m_source, context, offset, reference, getParserFeatures());
 }
 
 PDFObject PDFDocumentReader::getObjectFromXrefTable(PDFXRefTable* xrefTable, PDFParsingContext* context, PDFObjectReference reference) const
@@ -452,53 +740,13 @@ void PDFDocumentReader::processObjectStreams(PDFXRefTable* xrefTable, PDFObjectS
             }
 
             const PDFObject& object = objects[objectStreamReference.objectNumber].object;
-            if (!object.isStream())
-            {
-                throw PDFException(PDFTranslationContext::tr("Object stream %1 is invalid.").arg(objectStreamReference.objectNumber));
-            }
-
-            const PDFStream* objectStream = object.getStream();
-            const PDFDictionary* objectStreamDictionary = objectStream->getDictionary();
-
-            const PDFObject& objectStreamType = objectStreamDictionary->get("Type");
-            if (!objectStreamType.isName() || objectStreamType.getString() != "ObjStm")
-            {
-                throw PDFException(PDFTranslationContext::tr("Object stream %1 is invalid.").arg(objectStreamReference.objectNumber));
-            }
-
-            const PDFObject& nObject = objectStreamDictionary->get("N");
-            const PDFObject& firstObject = objectStreamDictionary->get("First");
-            if (!nObject.isInt() || !firstObject.isInt())
-            {
-                throw PDFException(PDFTranslationContext::tr("Object stream %1 is invalid.").arg(objectStreamReference.objectNumber));
-            }
 
-            // Number of objects in object stream dictionary
-            const PDFInteger n = nObject.getInteger();
-            const PDFInteger first = firstObject.getInteger();
-
-            QByteArray objectStreamData = PDFStreamFilterStorage::getDecodedStream(objectStream, m_securityHandler.data());
+            std::vector<std::pair<PDFInteger, PDFInteger>> objectNumberAndOffset;
+            QByteArray objectStreamData = decodeObjectStream(object, objectStreamReference, &context, m_securityHandler.data(), objectNumberAndOffset);
 
             PDFParsingContext::PDFParsingContextGuard guard(&context, objectStreamReference);
             PDFParser parser(objectStreamData, &context, PDFParser::AllowStreams);
 
-            std::vector<std::pair<PDFInteger, PDFInteger>> objectNumberAndOffset;
-            objectNumberAndOffset.reserve(n);
-            for (PDFInteger i = 0; i < n; ++i)
-            {
-                PDFObject currentObjectNumber = parser.getObject();
-                PDFObject currentOffset = parser.getObject();
-
-                if (!currentObjectNumber.isInt() || !currentOffset.isInt())
-                {
-                    throw PDFException(PDFTranslationContext::tr("Object stream %1 is invalid.").arg(objectStreamReference.objectNumber));
-                }
-
-                const PDFInteger objectNumber = currentObjectNumber.getInteger();
-                const PDFInteger offset = currentOffset.getInteger() + first;
-                objectNumberAndOffset.emplace_back(objectNumber, offset);
-            }
-
             for (size_t i = 0; i < objectNumberAndOffset.size(); ++i)
             {
                 const PDFInteger objectNumber = objectNumberAndOffset[i].first;
@@ -563,6 +811,20 @@ PDFDocument PDFDocumentReader::readFromBuffer(const QByteArray& buffer)
 
         std::vector<PDFXRefTable::Entry> occupiedEntries = xrefTable.getOccupiedEntries();
 
+        if (m_lazyLoading)
+        {
+            // Damaged document can be restored only, if it is read completely. So we check,
+            // that objects are at the offsets given by the cross reference table,
+            // before objects are loaded on demand.
+            auto isEntryValid = [&buffer](const PDFXRefTable::Entry& entry) { return isIndirectObjectHeaderValid(buffer, entry.offset, entry.reference); };
+            if (std::all_of(occupiedEntries.cbegin(), occupiedEntries.cend(), isEntryValid))
+            {
+                return readLazyDocument(qMove(xrefTable), qMove(objects), occupiedEntries);
+            }
+
+            m_warnings << tr("Cross reference table doesn't match objects of the document, document is read completely.");
+        }
+
         // First, process regular objects
         if (processReferenceTableEntries(&xrefTable, occupiedEntries, objects) != Result::OK)
         {
@@ -582,6 +844,7 @@ PDFDocument PDFDocumentReader::readFromBuffer(const QByteArray& buffer)
         processObjectStreams(&xrefTable, objects);
 
         PDFObjectStorage storage(std::move(objects), PDFObject(xrefTable.getTrailerDictionary()), qMove(m_securityHandler));
+        storage.setMappedFile(m_mappedFile);
         return PDFDocument(std::move(storage), m_version);
     }
     catch (const PDFException &parserException)
@@ -599,6 +862,59 @@ PDFDocument PDFDocumentReader::readFromBuffer(const QByteArray& buffer)
     return PDFDocument();
 }
 
+PDFDocument PDFDocumentReader::readLazyDocument(PDFXRefTable xrefTable, PDFObjectStorage::PDFObjects objects, const std::vector<PDFXRefTable::Entry>& occupiedEntries)
+{
+    // Objects are not read here, only generation numbers are filled. Objects
+    // will be read by the object loader, when they are accessed.
+    for (const PDFXRefTable::Entry& entry : occupiedEntries)
+    {
+        objects[entry.reference.objectNumber].generation = entry.reference.generation;
+    }
+
+    // Security handler needs the encryption dictionary, so we must read it now
+    PDFObjectReference encryptObjectReference;
+    const PDFObject& trailerDictionaryObject = xrefTable.getTrailerDictionary();
+    const PDFDictionary* trailerDictionary = nullptr;
+    if (trailerDictionaryObject.isDictionary())
+    {
+        trailerDictionary = trailerDictionaryObject.getDictionary();
+    }
+    else if (trailerDictionaryObject.isStream())
+    {
+        trailerDictionary = trailerDictionaryObject.getStream()->getDictionary();
+    }
+
+    if (trailerDictionary)
+    {
+        const PDFObject& encryptObject = trailerDictionary->get("Encrypt");
+        if (encryptObject.isReference())
+        {
+            encryptObjectReference = encryptObject.getReference();
+            if (encryptObjectReference.objectNumber >= 0 && static_cast<size_t>(encryptObjectReference.objectNumber) < objects.size())
+            {
+                auto objectFetcher = [this, &xrefTable](PDFParsingContext* context, PDFObjectReference reference) { return getObjectFromXrefTable(&xrefTable, context, reference); };
+                PDFParsingContext context(objectFetcher);
+                PDFObject object = getObjectFromXrefTable(&xrefTable, &context, encryptObjectReference);
+                objects[encryptObjectReference.objectNumber] = PDFObjectStorage::Entry(encryptObjectReference.generation, qMove(object));
+            }
+        }
+    }
+
+    // No entries are passed, so nothing is decrypted here, objects are
+    // decrypted by the object loader.
+    if (processSecurityHandler(trailerDictionaryObject, { }, objects) == Result::Cancelled)
+    {
+        return PDFDocument();
+    }
+
+    PDFObject trailerDictionaryCopy = trailerDictionaryObject;
+    PDFObjectLoaderPointer loader(new PDFDocumentReaderObjectLoader(m_source, qMove(xrefTable), m_securityHandler, encryptObjectReference, getParserFeatures()));
+    PDFObjectStorage storage(std::move(objects), qMove(trailerDictionaryCopy), qMove(m_securityHandler));
+    storage.setObjectLoader(qMove(loader), m_residentObjectLimit);
+    storage.setMappedFile(m_mappedFile);
+    return PDFDocument(std::move(storage), m_version);
+}
+
 std::vector<std::pair<int, int>> PDFDocumentReader::findObjectByteOffsets(const QByteArray& buffer) const
 {
     std::vector<std::pair<int, int>> offsets;
@@ -778,6 +1094,12 @@ PDFDocument PDFDocumentReader::readDamagedDocumentFromBuffer(const QByteArray& b
     return PDFDocument();
 }
 
+void PDFDocumentReader::setLazyLoading(bool lazyLoading, size_t residentObjectLimit)
+{
+    m_lazyLoading = lazyLoading;
+    m_residentObjectLimit = residentObjectLimit;
+}
+
 void PDFDocumentReader::reset()
 {
     m_result = Result::OK;
@@ -785,6 +1107,19 @@ void PDFDocumentReader::reset()
     m_version = PDFVersion();
     m_source = QByteArray();
     m_securityHandler = nullptr;
+    m_mappedFile.reset();
+}
+
+PDFParser::Features PDFDocumentReader::getParserFeatures() const
+{
+    if (m_mappedFile)
+    {
+        // Source data are memory mapped, stream data can reference them, because
+        // the mapped file is kept alive by the document storage.
+        return PDFParser::AllowStreams | PDFParser::ReferenceStreamData;
+    }
+
+    return PDFParser::AllowStreams;
 }
 
 int PDFDocumentReader::findFromEnd(const char* what, const QByteArray& byteArray, int limit)
@@ -23,6 +23,7 @@
 #include "pdfdocument.h"
 #include "pdfprogress.h"
 #include "pdfxreftable.h"
+#include "pdfparser.h"
 
 #include <QtCore>
 #include <QIODevice>
@@ -75,12 +76,33 @@ public:
     /// Returns error message, if document reading was unsuccessfull
     const QString& getErrorMessage() const { return m_errorMessage; }
 
-    /// Get source data of the document
+    /// Get source data of the document. If document file was memory mapped,
+    /// then source data reference the mapped file, which stays mapped while
+    /// this reader or the read document exists.
     const QByteArray& getSource() const { return m_source; }
 
     /// Returns warning messages
     const QStringList& getWarnings() const { return m_warnings; }
 
+    /// Enables or disables lazy loading of objects. If lazy loading is enabled,
+    /// then only cross reference table is read, and objects are parsed (and decrypted)
+    /// when they are accessed for the first time. Damaged documents are always
+    /// read completely (document is damaged, if some object isn't at the offset
+    /// given by the cross reference table).
+    /// \param lazyLoading Enable lazy loading
+    /// \param residentObjectLimit Count of objects loaded on demand, which are kept in memory
+    ///        after PDFObjectStorage::releaseObjects is called
+    void setLazyLoading(bool lazyLoading, size_t residentObjectLimit = DEFAULT_RESIDENT_OBJECT_LIMIT);
+
+    /// Enables or disables memory mapping of document files. If memory mapping
+    /// is enabled, then function \p readFromFile maps the file into the memory
+    /// instead of reading it, and stream data of the document reference
+    /// the mapped file (they are not copied).
+    /// \param memoryMapping Enable memory mapping
+    void setMemoryMapping(bool memoryMapping) { m_memoryMapping = memoryMapping; }
+
+    static constexpr const size_t DEFAULT_RESIDENT_OBJECT_LIMIT = 100000;
+
 private:
     static constexpr const int FIND_NOT_FOUND_RESULT = -1;
 
@@ -120,6 +142,13 @@ private:
     /// Fetch object from reference table
     PDFObject getObjectFromXrefTable(PDFXRefTable* xrefTable, PDFParsingContext* context, PDFObjectReference reference) const;
 
+    /// Creates document, whose objects are loaded on demand. Only encryption
+    /// dictionary is read here. Can throw exception.
+    /// \param xrefTable Cross reference table
+    /// \param objects Object entries (all of them are null)
+    /// \param occupiedEntries Occupied entries of cross reference table
+    PDFDocument readLazyDocument(PDFXRefTable xrefTable, PDFObjectStorage::PDFObjects objects, const std::vector<PDFXRefTable::Entry>& occupiedEntries);
+
     /// Tries to read damaged trailer dictionary
     PDFObject readDamagedTrailerDictionary() const;
 
@@ -134,6 +163,9 @@ private:
     /// \param buffer Buffer
     std::vector<std::pair<int, int>> findObjectByteOffsets(const QByteArray& buffer) const;
 
+    /// Returns parser features used for reading objects from the source data
+    PDFParser::Features getParserFeatures() const;
+
     void progressStart(size_t stepCount, QString text);
     void progressStep();
     void progressFinish();
@@ -172,6 +204,18 @@ private:
 
     /// Warnings
     QStringList m_warnings;
+
+    /// Read objects on demand, instead of reading them all at once
+    bool m_lazyLoading = false;
+
+    /// Count of objects loaded on demand, which are kept in memory
+    size_t m_residentObjectLimit = DEFAULT_RESIDENT_OBJECT_LIMIT;
+
+    /// Map document files into the memory instead of reading them
+    bool m_memoryMapping = false;
+
+    /// Memory mapped file, which is referenced by source data (if memory mapping is used)
+    QSharedPointer<QFile> m_mappedFile;
 };
 
 }   // namespace pdf
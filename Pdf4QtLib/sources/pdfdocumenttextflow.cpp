@@ -673,32 +673,11 @@ PDFDocumentTextFlow PDFDocumentTextFlowFactory::create(const PDFDocument* docume
     {
         case Algorithm::Layout:
         {
-            PDFFontCache fontCache(DEFAULT_FONT_CACHE_LIMIT, DEFAULT_REALIZED_FONT_CACHE_LIMIT);
-
             std::map<PDFInteger, PDFDocumentTextFlow::Items> items;
 
             QMutex mutex;
-            PDFCMSGeneric cms;
-            PDFMeshQualitySettings mqs;
-            PDFOptionalContentActivity oca(document, OCUsage::Export, nullptr);
-            pdf::PDFModifiedDocument md(const_cast<PDFDocument*>(document), &oca);
-            fontCache.setDocument(md);
-            fontCache.setCacheShrinkEnabled(nullptr, false);
-
-            auto generateTextLayout = [this, &items, &mutex, &fontCache, &cms, &mqs, &oca, document, catalog](PDFInteger pageIndex)
+            auto createTextFlows = [&items, &mutex](PDFInteger pageIndex, const PDFTextLayout& textLayout)
             {
-                if (!catalog->getPage(pageIndex))
-                {
-                    // Invalid page index
-                    return;
-                }
-
-                const PDFPage* page = catalog->getPage(pageIndex);
-                Q_ASSERT(page);
-
-                PDFTextLayoutGenerator generator(PDFRenderer::IgnoreOptionalContent, page, document, &fontCache, &cms, &oca, QTransform(), mqs);
-                QList<PDFRenderError> errors = generator.processContents();
-                PDFTextLayout textLayout = generator.createTextLayout();
                 PDFTextFlows textFlows = PDFTextFlow::createTextFlows(textLayout, PDFTextFlow::FlowFlags(PDFTextFlow::SeparateBlocks) | PDFTextFlow::RemoveSoftHyphen, pageIndex);
 
                 PDFDocumentTextFlow::Items flowItems;
@@ -711,12 +690,9 @@ PDFDocumentTextFlow PDFDocumentTextFlowFactory::create(const PDFDocument* docume
 
                 QMutexLocker lock(&mutex);
                 items[pageIndex] = qMove(flowItems);
-                m_errors.append(qMove(errors));
             };
 
-            PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, pageIndices.begin(), pageIndices.end(), generateTextLayout);
-
-            fontCache.setCacheShrinkEnabled(nullptr, true);
+            createTextLayoutsImpl(document, pageIndices, false, createTextFlows);
 
             PDFDocumentTextFlow::Items flowItems;
             for (const auto& item : items)
@@ -793,11 +769,100 @@ PDFDocumentTextFlow PDFDocumentTextFlowFactory::create(const PDFDocument* docume
     return create(document, pageIndices, algorithm);
 }
 
+PDFTextLayoutStorage PDFDocumentTextFlowFactory::createTextLayouts(const PDFDocument* document, const std::vector<PDFInteger>& pageIndices)
+{
+    return createTextLayoutsImpl(document, pageIndices, true, nullptr);
+}
+
+PDFTextLayoutStorage PDFDocumentTextFlowFactory::createTextLayoutsImpl(const PDFDocument* document,
+                                                                       const std::vector<PDFInteger>& pageIndices,
+                                                                       bool storeTextLayouts,
+                                                                       const std::function<void (PDFInteger, const PDFTextLayout&)>& callback)
+{
+    const PDFCatalog* catalog = document->getCatalog();
+
+    PDFFontCache fontCache(DEFAULT_FONT_CACHE_LIMIT, DEFAULT_REALIZED_FONT_CACHE_LIMIT);
+
+    QMutex mutex;
+    PDFCMSGeneric cms;
+    PDFMeshQualitySettings mqs;
+    PDFOptionalContentActivity oca(document, OCUsage::Export, nullptr);
+    pdf::PDFModifiedDocument md(const_cast<PDFDocument*>(document), &oca);
+    fontCache.setDocument(md);
+    fontCache.setCacheShrinkEnabled(nullptr, false);
+
+    // Text layouts of pages, which are in the disk cache, are not created again
+    const bool useDiskCache = m_diskCache.isEnabled() && PDFTextLayoutDiskCache::isDocumentCacheable(document);
+    PDFTextLayoutStorage textLayouts(catalog->getPageCount());
+    if (std::optional<PDFTextLayoutStorage> cachedTextLayouts = useDiskCache ? m_diskCache.load(m_diskCacheDocumentHash, catalog) : std::nullopt)
+    {
+        textLayouts = qMove(*cachedTextLayouts);
+    }
+    storeTextLayouts = storeTextLayouts || useDiskCache;
+    bool isTextLayoutCreated = false;
+
+    auto generateTextLayout = [this, &mutex, &fontCache, &cms, &mqs, &oca, &textLayouts, &isTextLayoutCreated, &callback, storeTextLayouts, document, catalog](PDFInteger pageIndex)
+    {
+        if (pageIndex < 0 || pageIndex >= PDFInteger(catalog->getPageCount()))
+        {
+            // Invalid page index
+            return;
+        }
+
+        if (textLayouts.hasTextLayout(pageIndex))
+        {
+            if (callback)
+            {
+                callback(pageIndex, textLayouts.getTextLayout(pageIndex));
+            }
+            return;
+        }
+
+        const PDFPage* page = catalog->getPage(pageIndex);
+        Q_ASSERT(page);
+
+        PDFTextLayoutGenerator generator(PDFRenderer::IgnoreOptionalContent, page, document, &fontCache, &cms, &oca, QTransform(), mqs);
+        QList<PDFRenderError> errors = generator.processContents();
+        PDFTextLayout textLayout = generator.createTextLayout();
+
+        if (storeTextLayouts)
+        {
+            textLayouts.setTextLayout(pageIndex, textLayout, &mutex);
+        }
+
+        if (callback)
+        {
+            callback(pageIndex, textLayout);
+        }
+
+        QMutexLocker lock(&mutex);
+        m_errors.append(qMove(errors));
+        isTextLayoutCreated = true;
+    };
+
+    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, pageIndices.begin(), pageIndices.end(), generateTextLayout);
+
+    fontCache.setCacheShrinkEnabled(nullptr, true);
+
+    if (isTextLayoutCreated && useDiskCache)
+    {
+        m_diskCache.store(m_diskCacheDocumentHash, catalog, textLayouts);
+    }
+
+    return textLayouts;
+}
+
 void PDFDocumentTextFlowFactory::setCalculateBoundingBoxes(bool calculateBoundingBoxes)
 {
     m_calculateBoundingBoxes = calculateBoundingBoxes;
 }
 
+void PDFDocumentTextFlowFactory::setTextLayoutDiskCache(PDFTextLayoutDiskCache diskCache, QByteArray documentHash)
+{
+    m_diskCache = qMove(diskCache);
+    m_diskCacheDocumentHash = qMove(documentHash);
+}
+
 void PDFDocumentTextFlowEditor::setTextFlow(PDFDocumentTextFlow textFlow)
 {
     m_originalTextFlow = std::move(textFlow);
@@ -21,6 +21,7 @@
 #include "pdfglobal.h"
 #include "pdfexception.h"
 #include "pdfutils.h"
+#include "pdftextlayout.h"
 
 namespace pdf
 {
@@ -132,6 +133,15 @@ public:
     /// \param algorithm Algorithm
     PDFDocumentTextFlow create(const PDFDocument* document, Algorithm algorithm);
 
+    /// Creates text layouts of given pages. If disk cache of text layouts
+    /// is set, text layouts are loaded from the cache, and text layouts,
+    /// which are not in the cache, are created and stored into the cache.
+    /// Storage can also contain text layouts of other pages, which
+    /// were loaded from the cache.
+    /// \param document Document
+    /// \param pageIndices Page indices
+    PDFTextLayoutStorage createTextLayouts(const PDFDocument* document, const std::vector<PDFInteger>& pageIndices);
+
     /// Has some error/warning occured during text layout creation?
     bool hasError() const { return !m_errors.isEmpty(); }
 
@@ -142,9 +152,29 @@ public:
     /// \param calculateBoundingBoxes Perform bounding box calculation?
     void setCalculateBoundingBoxes(bool calculateBoundingBoxes);
 
+    /// Sets persistent cache of text layouts. Layout algorithm then uses text layouts
+    /// of pages from the cache, and stores newly created text layouts into the cache.
+    /// \param diskCache Persistent cache of text layouts
+    /// \param documentHash Hash of the document file content (see PDFTextLayoutDiskCache::createDocumentHash)
+    void setTextLayoutDiskCache(PDFTextLayoutDiskCache diskCache, QByteArray documentHash);
+
 private:
+    /// Creates text layouts of given pages (text layouts, which are in the disk
+    /// cache, are loaded from the cache). Callback is called for text layout
+    /// of each page, it can be called from multiple threads at once.
+    /// \param document Document
+    /// \param pageIndices Page indices
+    /// \param storeTextLayouts Store created text layouts into returned storage
+    /// \param callback Callback called for text layout of each page (can be empty)
+    PDFTextLayoutStorage createTextLayoutsImpl(const PDFDocument* document,
+                                               const std::vector<PDFInteger>& pageIndices,
+                                               bool storeTextLayouts,
+                                               const std::function<void(PDFInteger, const PDFTextLayout&)>& callback);
+
     QList<PDFRenderError> m_errors;
     bool m_calculateBoundingBoxes = false;
+    PDFTextLayoutDiskCache m_diskCache;
+    QByteArray m_diskCacheDocumentHash;
 };
 
 /// Editor which can edit document text flow, modify user text,
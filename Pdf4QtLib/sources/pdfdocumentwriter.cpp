@@ -19,11 +19,16 @@
 #include "pdfconstants.h"
 #include "pdfvisitor.h"
 #include "pdfparser.h"
+#include "pdfstreamfilters.h"
 #include "pdfdbgheap.h"
 
 #include <QFile>
+#include <QBuffer>
 #include <QSaveFile>
 
+#include <cctype>
+#include <cstring>
+
 namespace pdf
 {
 
@@ -250,13 +255,20 @@ PDFOperationResult PDFDocumentWriter::write(QIODevice* device, const PDFDocument
 
     // Write header
     PDFVersion version = document->getInfo()->version;
-    device->write(QString("%PDF-%1.%2").arg(version.major).arg(version.minor).toLatin1());
-    writeCRLF(device);
-    device->write("% PDF producer: ");
-    device->write(PDF_LIBRARY_NAME);
-    writeCRLF(device);
-    writeCRLF(device);
-    writeCRLF(device);
+    if (m_objectStreamsEnabled)
+    {
+        // Object streams and cross-reference streams are supported since PDF 1.5
+        if (version.major < 1 || (version.major == 1 && version.minor < 5))
+        {
+            version = PDFVersion(1, 5);
+        }
+
+        writeHeader(device, version);
+        writeObjectStreams(device, document);
+        return true;
+    }
+
+    writeHeader(device, version);
 
     PDFObjectReference encryptObjectReference;
     PDFObject encryptObject = document->getTrailerDictionary()->get("Encrypt");
@@ -367,6 +379,544 @@ PDFOperationResult PDFDocumentWriter::write(QIODevice* device, const PDFDocument
     return true;
 }
 
+void PDFDocumentWriter::writeObjectStreams(QIODevice* device, const PDFDocument* document)
+{
+    const PDFObjectStorage& storage = document->getStorage();
+    const PDFObjectStorage::PDFObjects& objects = storage.getObjects();
+    const size_t objectCount = objects.size();
+    const bool isEncrypted = storage.getSecurityHandler()->getMode() != EncryptionMode::None;
+
+    PDFObjectReference encryptObjectReference;
+    PDFObject encryptObject = document->getTrailerDictionary()->get("Encrypt");
+    if (encryptObject.isReference())
+    {
+        encryptObjectReference = encryptObject.getReference();
+    }
+
+    auto writeObject = [&](PDFObjectReference reference, const PDFObject& object)
+    {
+        PDFObject objectToWrite = object;
+        if (isEncrypted && reference != encryptObjectReference)
+        {
+            objectToWrite = storage.getSecurityHandler()->encryptObject(objectToWrite, reference);
+        }
+
+        PDFWriteObjectVisitor visitor(device);
+        writeObjectHeader(device, reference);
+        objectToWrite.accept(&visitor);
+        writeObjectFooter(device);
+    };
+
+    // Indirect stream lengths must be stored directly in the file,
+    // because they are needed to parse the stream objects. Readers (including
+    // this library) don't resolve objects in object streams, until all regular
+    // objects are read.
+    std::vector<bool> isStreamLength(objectCount, false);
+    for (size_t i = 1; i < objectCount; ++i)
+    {
+        const PDFObject& object = objects[i].object;
+        if (object.isStream())
+        {
+            const PDFObject& lengthObject = object.getStream()->getDictionary()->get("Length");
+            if (lengthObject.isReference())
+            {
+                const PDFInteger lengthObjectNumber = lengthObject.getReference().objectNumber;
+                if (lengthObjectNumber > 0 && lengthObjectNumber < PDFInteger(objectCount))
+                {
+                    isStreamLength[lengthObjectNumber] = true;
+                }
+            }
+        }
+    }
+
+    // Objects, which can be stored in object streams, can't be streams, must have
+    // zero generation number and encryption dictionary must be stored directly in the file.
+    std::vector<size_t> compressedObjects;
+    for (size_t i = 1; i < objectCount; ++i)
+    {
+        const PDFObjectStorage::Entry& entry = objects[i];
+        if (!entry.object.isNull() &&
+            !entry.object.isStream() &&
+            entry.generation == 0 &&
+            !isStreamLength[i] &&
+            PDFObjectReference(i, 0) != encryptObjectReference)
+        {
+            compressedObjects.push_back(i);
+        }
+    }
+
+    const size_t objectStreamCount = (compressedObjects.size() + MAX_OBJECTS_IN_OBJECT_STREAM - 1) / MAX_OBJECTS_IN_OBJECT_STREAM;
+    const size_t xrefStreamObjectNumber = objectCount + objectStreamCount;
+    const size_t totalObjectCount = xrefStreamObjectNumber + 1;
+
+    std::vector<CrossReferenceStreamEntry> xrefEntries(xrefStreamObjectNumber);
+    for (size_t i = 0; i < xrefStreamObjectNumber; ++i)
+    {
+        xrefEntries[i].objectNumber = i;
+    }
+    for (size_t i = 0; i < objectCount; ++i)
+    {
+        xrefEntries[i].field3 = (i == 0) ? 65535 : objects[i].generation;
+    }
+
+    // Write objects, which are not stored in object streams
+    std::vector<bool> isCompressed(objectCount, false);
+    for (size_t objectIndex : compressedObjects)
+    {
+        isCompressed[objectIndex] = true;
+    }
+
+    for (size_t i = 0; i < objectCount; ++i)
+    {
+        const PDFObjectStorage::Entry& entry = objects[i];
+        if (entry.object.isNull() || isCompressed[i])
+        {
+            continue;
+        }
+
+        xrefEntries[i] = { PDFInteger(i), 1, device->pos(), entry.generation };
+        writeObject(PDFObjectReference(i, entry.generation), entry.object);
+    }
+
+    // Write object streams
+    for (size_t streamIndex = 0; streamIndex < objectStreamCount; ++streamIndex)
+    {
+        const size_t objectStreamNumber = objectCount + streamIndex;
+        const size_t first = streamIndex * MAX_OBJECTS_IN_OBJECT_STREAM;
+        const size_t last = qMin(first + MAX_OBJECTS_IN_OBJECT_STREAM, compressedObjects.size());
+
+        QByteArray offsetTable;
+        QByteArray objectData;
+        for (size_t i = first; i < last; ++i)
+        {
+            const size_t objectIndex = compressedObjects[i];
+            offsetTable.append(QByteArray::number(qulonglong(objectIndex)));
+            offsetTable.append(' ');
+            offsetTable.append(QByteArray::number(objectData.size()));
+            offsetTable.append(' ');
+            objectData.append(getSerializedObject(objects[objectIndex].object));
+            objectData.append('\n');
+
+            xrefEntries[objectIndex] = { PDFInteger(objectIndex), 2, PDFInteger(objectStreamNumber), PDFInteger(i - first) };
+        }
+        offsetTable.append('\n');
+
+        QByteArray compressedData = PDFFlateDecodeFilter::compress(offsetTable + objectData);
+
+        PDFDictionary dictionary;
+        dictionary.addEntry(PDFInplaceOrMemoryString("Type"), PDFObject::createName("ObjStm"));
+        dictionary.addEntry(PDFInplaceOrMemoryString("N"), PDFObject::createInteger(PDFInteger(last - first)));
+        dictionary.addEntry(PDFInplaceOrMemoryString("First"), PDFObject::createInteger(offsetTable.size()));
+        dictionary.addEntry(PDFInplaceOrMemoryString("Filter"), PDFObject::createName("FlateDecode"));
+        dictionary.addEntry(PDFInplaceOrMemoryString("Length"), PDFObject::createInteger(compressedData.size()));
+
+        xrefEntries[objectStreamNumber] = { PDFInteger(objectStreamNumber), 1, device->pos(), 0 };
+        writeObject(PDFObjectReference(objectStreamNumber, 0), PDFObject::createStream(std::make_shared<PDFStream>(qMove(dictionary), qMove(compressedData))));
+    }
+
+    // Write cross-reference stream
+    PDFDictionary xrefDictionary;
+    xrefDictionary.addEntry(PDFInplaceOrMemoryString("Size"), PDFObject::createInteger(PDFInteger(totalObjectCount)));
+
+    const PDFDictionary* trailerDictionary = document->getTrailerDictionary();
+    for (const char* entry : { "Root", "Encrypt", "Info", "ID" })
+    {
+        PDFObject object = trailerDictionary->get(entry);
+        if (!object.isNull())
+        {
+            xrefDictionary.addEntry(PDFInplaceOrMemoryString(entry), qMove(object));
+        }
+    }
+
+    writeCrossReferenceStream(device, PDFObjectReference(xrefStreamObjectNumber, 0), qMove(xrefEntries), qMove(xrefDictionary));
+}
+
+PDFOperationResult PDFDocumentWriter::writeIncremental(const QString& fileName,
+                                                       const QByteArray& originalData,
+                                                       const PDFDocument* originalDocument,
+                                                       const PDFDocument* document,
+                                                       bool safeWrite)
+{
+    Q_ASSERT(document);
+
+    const PDFObjectStorage& storage = document->getStorage();
+    if (!storage.getSecurityHandler()->isEncryptionAllowed())
+    {
+        return tr("Writing of encrypted documents is not supported.");
+    }
+
+    if (safeWrite)
+    {
+        QSaveFile file(fileName);
+        file.setDirectWriteFallback(true);
+
+        if (file.open(QFile::WriteOnly | QFile::Truncate))
+        {
+            PDFOperationResult result = writeIncremental(&file, originalData, originalDocument, document);
+            if (result)
+            {
+                if (!file.commit())
+                {
+                    return tr("File '%1' can't be opened for writing. %2").arg(fileName, file.errorString());
+                }
+            }
+            else
+            {
+                file.cancelWriting();
+            }
+            return result;
+        }
+        else
+        {
+            return tr("File '%1' can't be opened for writing. %2").arg(fileName, file.errorString());
+        }
+    }
+
+    // Without safe write, we can't truncate the file, because original data
+    // can be memory mapped from it. We write to the buffer and then to the file.
+    QBuffer buffer;
+    buffer.open(QBuffer::WriteOnly);
+    PDFOperationResult result = writeIncremental(&buffer, originalData, originalDocument, document);
+    buffer.close();
+
+    if (!result)
+    {
+        return result;
+    }
+
+    QFile file(fileName);
+    if (file.open(QFile::WriteOnly | QFile::Truncate))
+    {
+        file.write(buffer.data());
+        file.close();
+        return true;
+    }
+
+    return tr("File '%1' can't be opened for writing. %2").arg(fileName, file.errorString());
+}
+
+PDFOperationResult PDFDocumentWriter::writeIncremental(QIODevice* device,
+                                                       const QByteArray& originalData,
+                                                       const PDFDocument* originalDocument,
+                                                       const PDFDocument* document)
+{
+    if (!device->isWritable())
+    {
+        return tr("Device is not writable.");
+    }
+
+    const PDFObjectStorage& storage = document->getStorage();
+    if (!storage.getSecurityHandler()->isEncryptionAllowed())
+    {
+        return tr("Writing of encrypted documents is not supported.");
+    }
+
+    // Objects of the original document are encrypted by the original security
+    // handler, so update must be encrypted by the same handler with the same key.
+    const PDFObjectStorage& originalStorage = originalDocument->getStorage();
+    auto getEncryptionDictionary = [](const PDFDocument* document) { return document->getObject(document->getTrailerDictionary()->get("Encrypt")); };
+    const bool isEncryptionChanged = originalStorage.getSecurityHandler()->getMode() != storage.getSecurityHandler()->getMode() ||
+                                     getEncryptionDictionary(originalDocument) != getEncryptionDictionary(document) ||
+                                     (storage.getSecurityHandler()->getMode() != EncryptionMode::None && originalDocument->getIdPart(0) != document->getIdPart(0));
+    if (isEncryptionChanged)
+    {
+        return tr("Encryption of the document was changed, document must be written completely.");
+    }
+
+    // Find offset of the last cross-reference section of the original document
+    const int startxrefIndex = originalData.lastIndexOf("startxref");
+    if (startxrefIndex == -1)
+    {
+        return tr("Original document doesn't contain cross-reference table offset.");
+    }
+
+    PDFInteger previousXRefOffset = -1;
+    {
+        const char* it = originalData.constData() + startxrefIndex + int(std::strlen("startxref"));
+        const char* end = originalData.constData() + originalData.size();
+        while (it != end && PDFLexicalAnalyzer::isWhitespace(*it))
+        {
+            ++it;
+        }
+
+        const char* begin = it;
+        while (it != end && std::isdigit(static_cast<unsigned char>(*it)))
+        {
+            ++it;
+        }
+
+        bool ok = false;
+        previousXRefOffset = QByteArray(begin, int(it - begin)).toLongLong(&ok);
+        if (!ok || previousXRefOffset < 0 || previousXRefOffset >= originalData.size())
+        {
+            return tr("Original document has invalid cross-reference table offset.");
+        }
+    }
+
+    // If original document uses cross-reference streams, then we also must use
+    // cross-reference stream, otherwise classic cross-reference table is used.
+    const bool isCrossReferenceStream = !originalData.mid(previousXRefOffset, 4).startsWith("xref");
+
+    const PDFObjectStorage::PDFObjects& originalObjects = originalStorage.getObjects();
+    const PDFObjectStorage::PDFObjects& objects = storage.getObjects();
+    const size_t originalObjectCount = originalObjects.size();
+    const size_t objectCount = objects.size();
+    const bool isEncrypted = storage.getSecurityHandler()->getMode() != EncryptionMode::None;
+
+    PDFObjectReference encryptObjectReference;
+    PDFObject encryptObject = document->getTrailerDictionary()->get("Encrypt");
+    if (encryptObject.isReference())
+    {
+        encryptObjectReference = encryptObject.getReference();
+    }
+
+    // Original data are written unchanged, so signatures and other byte range
+    // dependent features of the original document remain valid.
+    if (device->write(originalData) != originalData.size())
+    {
+        return tr("Failed to write original document data. %1").arg(device->errorString());
+    }
+
+    if (!originalData.endsWith('\n') && !originalData.endsWith('\r'))
+    {
+        writeCRLF(device);
+    }
+
+    // Write changed and new objects, mark deleted objects as free
+    std::vector<CrossReferenceStreamEntry> xrefEntries;
+    for (size_t i = 1; i < qMax(objectCount, originalObjectCount); ++i)
+    {
+        const PDFObjectStorage::Entry* entry = (i < objectCount) ? &objects[i] : nullptr;
+        const PDFObjectStorage::Entry* originalEntry = (i < originalObjectCount) ? &originalObjects[i] : nullptr;
+
+        const bool isPresent = entry && !entry->object.isNull();
+        const bool isOriginalPresent = originalEntry && !originalEntry->object.isNull();
+
+        if (isPresent)
+        {
+            if (isOriginalPresent && entry->generation == originalEntry->generation && entry->object == originalEntry->object)
+            {
+                // Object is not changed
+                continue;
+            }
+
+            PDFObjectReference reference(i, entry->generation);
+            PDFObject objectToWrite = entry->object;
+            if (isEncrypted && reference != encryptObjectReference)
+            {
+                objectToWrite = storage.getSecurityHandler()->encryptObject(objectToWrite, reference);
+            }
+
+            xrefEntries.push_back({ PDFInteger(i), 1, device->pos(), entry->generation });
+
+            PDFWriteObjectVisitor visitor(device);
+            writeObjectHeader(device, reference);
+            objectToWrite.accept(&visitor);
+            writeObjectFooter(device);
+        }
+        else if (isOriginalPresent)
+        {
+            // Object was deleted, generation number is incremented for future use
+            xrefEntries.push_back({ PDFInteger(i), 0, 0, originalEntry->generation + 1 });
+        }
+    }
+
+    // Free entries are linked into the list of free objects. Entry of object zero
+    // is the head of the list, last free entry refers back to object zero.
+    PDFInteger firstFreeObjectNumber = 0;
+    for (auto it = xrefEntries.rbegin(); it != xrefEntries.rend(); ++it)
+    {
+        if (it->type == 0)
+        {
+            it->field2 = firstFreeObjectNumber;
+            firstFreeObjectNumber = it->objectNumber;
+        }
+    }
+
+    PDFInteger size = PDFInteger(qMax(objectCount, originalObjectCount));
+
+    PDFDictionary trailerDictionary;
+    const PDFDictionary* documentTrailerDictionary = document->getTrailerDictionary();
+    for (const char* entry : { "Root", "Encrypt", "Info", "ID" })
+    {
+        PDFObject object = documentTrailerDictionary->get(entry);
+        if (!object.isNull())
+        {
+            trailerDictionary.addEntry(PDFInplaceOrMemoryString(entry), qMove(object));
+        }
+    }
+    trailerDictionary.addEntry(PDFInplaceOrMemoryString("Prev"), PDFObject::createInteger(previousXRefOffset));
+
+    if (isCrossReferenceStream)
+    {
+        trailerDictionary.addEntry(PDFInplaceOrMemoryString("Size"), PDFObject::createInteger(size + 1));
+        if (firstFreeObjectNumber != 0)
+        {
+            xrefEntries.insert(xrefEntries.begin(), CrossReferenceStreamEntry{ 0, 0, firstFreeObjectNumber, 65535 });
+        }
+        writeCrossReferenceStream(device, PDFObjectReference(size, 0), qMove(xrefEntries), qMove(trailerDictionary));
+        return true;
+    }
+
+    trailerDictionary.addEntry(PDFInplaceOrMemoryString("Size"), PDFObject::createInteger(size));
+
+    // Write cross-reference table, consecutive entries are grouped into subsections.
+    // Entry for object zero must be always present.
+    PDFInteger xrefOffset = device->pos();
+    device->write("xref");
+    writeCRLF(device);
+    device->write("0 1");
+    writeCRLF(device);
+    device->write(QString::number(firstFreeObjectNumber).rightJustified(10, QChar('0'), true).toLatin1());
+    device->write(" 65535 f");
+    writeCRLF(device);
+
+    for (auto it = xrefEntries.cbegin(); it != xrefEntries.cend();)
+    {
+        auto itEnd = std::next(it);
+        while (itEnd != xrefEntries.cend() && itEnd->objectNumber == std::prev(itEnd)->objectNumber + 1)
+        {
+            ++itEnd;
+        }
+
+        device->write(QString("%1 %2").arg(it->objectNumber).arg(std::distance(it, itEnd)).toLatin1());
+        writeCRLF(device);
+
+        for (; it != itEnd; ++it)
+        {
+            QString offsetString = QString::number(it->field2).rightJustified(10, QChar('0'), true);
+            QString generationString = QString::number(it->field3).rightJustified(5, QChar('0'), true);
+
+            device->write(offsetString.toLatin1());
+            device->write(" ");
+            device->write(generationString.toLatin1());
+            device->write(" ");
+            device->write(it->type == 1 ? "n" : "f");
+            writeCRLF(device);
+        }
+    }
+
+    PDFObject trailerDictionaryObject = PDFObject::createDictionary(std::make_shared<PDFDictionary>(qMove(trailerDictionary)));
+
+    device->write("trailer");
+    writeCRLF(device);
+    PDFWriteObjectVisitor trailerVisitor(device);
+    trailerDictionaryObject.accept(&trailerVisitor);
+    writeCRLF(device);
+    device->write("startxref");
+    writeCRLF(device);
+    device->write(QString::number(xrefOffset).toLatin1());
+    writeCRLF(device);
+
+    // Write footer
+    device->write("%%EOF");
+    writeCRLF(device);
+
+    return true;
+}
+
+void PDFDocumentWriter::writeCrossReferenceStream(QIODevice* device,
+                                                  PDFObjectReference reference,
+                                                  std::vector<CrossReferenceStreamEntry> entries,
+                                                  PDFDictionary dictionary)
+{
+    // Cross-reference stream is never encrypted. It also contains entry for itself.
+    const PDFInteger xrefOffset = device->pos();
+    entries.push_back({ reference.objectNumber, 1, xrefOffset, reference.generation });
+
+    PDFInteger maxField2 = 0;
+    PDFInteger maxField3 = 0;
+    for (const CrossReferenceStreamEntry& entry : entries)
+    {
+        maxField2 = qMax(maxField2, entry.field2);
+        maxField3 = qMax(maxField3, entry.field3);
+    }
+
+    auto getByteCount = [](PDFInteger value)
+    {
+        int count = 1;
+        while (count < 8 && (value >> (8 * count)) > 0)
+        {
+            ++count;
+        }
+        return count;
+    };
+
+    const int field2Bytes = getByteCount(maxField2);
+    const int field3Bytes = getByteCount(maxField3);
+
+    QByteArray xrefData;
+    xrefData.reserve(int(entries.size()) * (1 + field2Bytes + field3Bytes));
+
+    auto writeField = [&xrefData](PDFInteger value, int bytes)
+    {
+        for (int i = bytes - 1; i >= 0; --i)
+        {
+            xrefData.append(char((value >> (8 * i)) & 0xFF));
+        }
+    };
+
+    // Consecutive entries are grouped into subsections
+    PDFArray index;
+    for (auto it = entries.cbegin(); it != entries.cend();)
+    {
+        auto itEnd = std::next(it);
+        while (itEnd != entries.cend() && itEnd->objectNumber == std::prev(itEnd)->objectNumber + 1)
+        {
+            ++itEnd;
+        }
+
+        index.appendItem(PDFObject::createInteger(it->objectNumber));
+        index.appendItem(PDFObject::createInteger(std::distance(it, itEnd)));
+
+        for (; it != itEnd; ++it)
+        {
+            writeField(it->type, 1);
+            writeField(it->field2, field2Bytes);
+            writeField(it->field3, field3Bytes);
+        }
+    }
+
+    QByteArray compressedXrefData = PDFFlateDecodeFilter::compress(xrefData);
+
+    PDFArray widths;
+    widths.appendItem(PDFObject::createInteger(1));
+    widths.appendItem(PDFObject::createInteger(field2Bytes));
+    widths.appendItem(PDFObject::createInteger(field3Bytes));
+
+    dictionary.addEntry(PDFInplaceOrMemoryString("Type"), PDFObject::createName("XRef"));
+    dictionary.addEntry(PDFInplaceOrMemoryString("W"), PDFObject::createArray(std::make_shared<PDFArray>(qMove(widths))));
+    dictionary.addEntry(PDFInplaceOrMemoryString("Index"), PDFObject::createArray(std::make_shared<PDFArray>(qMove(index))));
+    dictionary.addEntry(PDFInplaceOrMemoryString("Filter"), PDFObject::createName("FlateDecode"));
+    dictionary.addEntry(PDFInplaceOrMemoryString("Length"), PDFObject::createInteger(compressedXrefData.size()));
+
+    PDFObject xrefStreamObject = PDFObject::createStream(std::make_shared<PDFStream>(qMove(dictionary), qMove(compressedXrefData)));
+    PDFWriteObjectVisitor visitor(device);
+    writeObjectHeader(device, reference);
+    xrefStreamObject.accept(&visitor);
+    writeObjectFooter(device);
+
+    device->write("startxref");
+    writeCRLF(device);
+    device->write(QString::number(xrefOffset).toLatin1());
+    writeCRLF(device);
+
+    // Write footer
+    device->write("%%EOF");
+    writeCRLF(device);
+}
+
+void PDFDocumentWriter::writeHeader(QIODevice* device, PDFVersion version)
+{
+    device->write(QString("%PDF-%1.%2").arg(version.major).arg(version.minor).toLatin1());
+    writeCRLF(device);
+    device->write("% PDF producer: ");
+    device->write(PDF_LIBRARY_NAME);
+    writeCRLF(device);
+    writeCRLF(device);
+    writeCRLF(device);
+}
+
 void PDFDocumentWriter::writeCRLF(QIODevice* device)
 {
     device->write("\x0D\x0A");
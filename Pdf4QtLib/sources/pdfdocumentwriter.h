@@ -56,6 +56,39 @@ public:
     /// \param document Document
     PDFOperationResult write(QIODevice* device, const PDFDocument* document);
 
+    /// Writes document as an incremental update of the original document. Original
+    /// data are copied unchanged to the output, then only objects, which were changed,
+    /// added or deleted in \p document (compared to \p originalDocument), are appended
+    /// together with new cross-reference section and trailer, which refers to the
+    /// previous cross-reference section. Signatures of the original document remain
+    /// valid. If original document uses cross-reference stream, then cross-reference
+    /// stream is also used for the update. If \p safeWrite is false, then output
+    /// is assembled in memory before the file is truncated, because original data
+    /// can be memory mapped from the same file. If encryption of the document
+    /// was changed, then incremental update can't be written (objects of the original
+    /// document are encrypted by the original key) and error is returned.
+    /// \param fileName File name
+    /// \param originalData Data of the original document
+    /// \param originalDocument Original document (loaded from \p originalData)
+    /// \param document Modified document
+    /// \param safeWrite Write document to the temporary file and then rename
+    PDFOperationResult writeIncremental(const QString& fileName,
+                                        const QByteArray& originalData,
+                                        const PDFDocument* originalDocument,
+                                        const PDFDocument* document,
+                                        bool safeWrite);
+
+    /// Writes document as an incremental update of the original document
+    /// to the output device. Device must be writable (i.e. opened for writing).
+    /// \param device Output device
+    /// \param originalData Data of the original document
+    /// \param originalDocument Original document (loaded from \p originalData)
+    /// \param document Modified document
+    PDFOperationResult writeIncremental(QIODevice* device,
+                                        const QByteArray& originalData,
+                                        const PDFDocument* originalDocument,
+                                        const PDFDocument* document);
+
     /// Calculates document file size, as if it is written to the disk.
     /// No file is accessed by this function; document is written
     /// to fake stream, which counts operations. If error occurs, and
@@ -72,13 +105,59 @@ public:
     /// \param object Object to be written
     static QByteArray getSerializedObject(const PDFObject& object);
 
+    /// Enables or disables compact output. When enabled, small objects (all objects,
+    /// which are not streams, have zero generation number and are not used as
+    /// indirect stream lengths) are packed into Flate
+    /// compressed object streams and cross-reference stream is written instead of
+    /// classic cross-reference table and trailer. Written document has version
+    /// at least 1.5. Default value is false.
+    /// \param objectStreamsEnabled Enable object streams
+    void setObjectStreamsEnabled(bool objectStreamsEnabled) { m_objectStreamsEnabled = objectStreamsEnabled; }
+
+    /// Returns true, if object streams and cross-reference stream are used
+    bool isObjectStreamsEnabled() const { return m_objectStreamsEnabled; }
+
 private:
+    /// Maximal number of objects stored in one object stream
+    static constexpr size_t MAX_OBJECTS_IN_OBJECT_STREAM = 100;
+
+    /// Writes objects, object streams and cross-reference stream (after the header
+    /// has been written). Used, when object streams are enabled.
+    /// \param device Output device
+    /// \param document Document
+    void writeObjectStreams(QIODevice* device, const PDFDocument* document);
+
+    /// Entry of the cross-reference stream
+    struct CrossReferenceStreamEntry
+    {
+        PDFInteger objectNumber = 0;
+        PDFInteger type = 0;    ///< 0 - free object, 1 - object in the file, 2 - object in the object stream
+        PDFInteger field2 = 0;  ///< Next free object number, offset in the file or object stream number
+        PDFInteger field3 = 0;  ///< Generation number or index of the object in the object stream
+    };
+
+    /// Writes cross-reference stream object followed by the file footer. Entry for
+    /// the cross-reference stream itself is added automatically. Entries must be sorted
+    /// by object number, and cross-reference stream must have the highest object number.
+    /// \param device Output device
+    /// \param reference Reference of the cross-reference stream
+    /// \param entries Cross-reference entries
+    /// \param dictionary Trailer entries of the stream dictionary
+    static void writeCrossReferenceStream(QIODevice* device,
+                                          PDFObjectReference reference,
+                                          std::vector<CrossReferenceStreamEntry> entries,
+                                          PDFDictionary dictionary);
+
+    static void writeHeader(QIODevice* device, PDFVersion version);
     static void writeCRLF(QIODevice* device);
     static void writeObjectHeader(QIODevice* device, PDFObjectReference reference);
     static void writeObjectFooter(QIODevice* device);
 
     /// Progress indicator
     PDFProgress* m_progress;
+
+    /// Use object streams and cross-reference stream
+    bool m_objectStreamsEnabled = false;
 };
 
 }   // namespace pdf
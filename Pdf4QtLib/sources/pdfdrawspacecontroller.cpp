@@ -24,6 +24,8 @@
 #include "pdfconstants.h"
 #include "pdfcms.h"
 #include "pdfannotation.h"
+#include "pdfpagetilecache.h"
+#include "pdfpattern.h"
 #include "pdfdbgheap.h"
 
 #include <QTimer>
@@ -466,6 +468,7 @@ PDFDrawWidgetProxy::PDFDrawWidgetProxy(QObject* parent) :
     m_rasterizer(new PDFRasterizer(this)),
     m_progress(nullptr),
     m_cacheClearTimer(new QTimer(this)),
+    m_tileCache(new PDFPageTileCache(this)),
     m_useOpenGL(false)
 {
     m_controller = new PDFDrawSpaceController(this);
@@ -476,6 +479,8 @@ PDFDrawWidgetProxy::PDFDrawWidgetProxy(QObject* parent) :
     connect(m_compiler, &PDFAsynchronousPageCompiler::pageImageChanged, this, &PDFDrawWidgetProxy::pageImageChanged);
     connect(m_textLayoutCompiler, &PDFAsynchronousTextLayoutCompiler::textLayoutChanged, this, &PDFDrawWidgetProxy::onTextLayoutChanged);
     connect(m_cacheClearTimer, &QTimer::timeout, this, &PDFDrawWidgetProxy::performPageCacheClear);
+    connect(m_tileCache, &PDFPageTileCache::tileRendered, this, &PDFDrawWidgetProxy::repaintNeeded);
+    connect(this, &PDFDrawWidgetProxy::pageImageChanged, m_tileCache, &PDFPageTileCache::invalidate);
 }
 
 PDFDrawWidgetProxy::~PDFDrawWidgetProxy()
@@ -489,6 +494,22 @@ void PDFDrawWidgetProxy::setDocument(const PDFModifiedDocument& document)
     {
         m_cacheClearTimer->stop();
         m_compiler->stop(document.hasReset() || document.hasPageContentsChanged());
+
+        if (document.hasReset() || document.hasPageContentsChanged())
+        {
+            m_tileCache->invalidate(true, { });
+        }
+
+        // Shading meshes of the previous document content will not be used anymore. Cache
+        // is shared by all widgets, so only meshes of this document are removed. Glyph images
+        // are removed from the glyph atlas, when fonts of the previous document are destroyed.
+        const PDFDocument* previousDocument = getDocument();
+        const PDFDocument* newDocument = document.getDocument();
+        if (previousDocument && (!newDocument || previousDocument->getStorage().getContentId() != newDocument->getStorage().getContentId()))
+        {
+            PDFShadingMeshCache::getInstance()->removeContent(previousDocument->getStorage().getContentId());
+        }
+
         m_textLayoutCompiler->stop(document.hasReset() || document.hasPageContentsChanged());
         m_controller->setDocument(document);
 
@@ -788,7 +809,31 @@ void PDFDrawWidgetProxy::drawPages(QPainter* painter, QRect rect, PDFRenderer::F
 
                 const PDFPage* page = m_controller->getDocument()->getCatalog()->getPage(item.pageIndex);
                 QTransform matrix = QTransform(createPagePointToDevicePointMatrix(page, placedRect)) * baseMatrix;
-                compiledPage->draw(painter, page->getCropBox(), matrix, features, groupInfo.transparency);
+
+                // Tiles can be used only, if painter is not transformed (tiles are in device pixels)
+                QSharedPointer<const PDFPrecompiledPage> compiledPagePointer = m_compiler->getCompiledPagePointer(item.pageIndex);
+                if (baseMatrix.type() == QTransform::TxNone && compiledPagePointer)
+                {
+                    PDFPageTileCache::Page tilePage;
+                    tilePage.pageIndex = item.pageIndex;
+                    tilePage.compiledPage = qMove(compiledPagePointer);
+                    tilePage.cropBox = page->getCropBox();
+                    tilePage.pagePointToDevicePointMatrix = createPagePointToDevicePointMatrix(page, QRect(QPoint(0, 0), placedRect.size()));
+                    tilePage.size = placedRect.size();
+                    tilePage.features = features;
+                    tilePage.opacity = groupInfo.transparency;
+
+                    if (groupInfo.drawPaper)
+                    {
+                        tilePage.paperColor = paperColor;
+                    }
+
+                    m_tileCache->drawPage(painter, tilePage, placedRect, rect);
+                }
+                else
+                {
+                    compiledPage->draw(painter, page->getCropBox(), matrix, features, groupInfo.transparency, baseMatrix.mapRect(QRectF(rect)));
+                }
                 PDFTextLayoutGetter layoutGetter = m_textLayoutCompiler->getTextLayoutLazy(item.pageIndex);
 
                 // Draw text blocks/text lines, if it is enabled
@@ -1291,6 +1336,11 @@ QRectF PDFDrawWidgetProxy::fromDeviceSpace(const QRectF& rect) const
                   rect.height() * m_deviceSpaceUnitToPixel);
 }
 
+void PDFDrawWidgetProxy::setTileCacheLimit(qint64 limit)
+{
+    m_tileCache->setLimit(limit);
+}
+
 void PDFDrawWidgetProxy::performPageCacheClear()
 {
     std::vector<PDFInteger> activePage = getActivePages();
@@ -37,6 +37,7 @@ namespace pdf
 class PDFProgress;
 class PDFWidget;
 class PDFCMSManager;
+class PDFPageTileCache;
 class PDFTextLayoutGetter;
 class PDFWidgetAnnotationManager;
 class PDFAsynchronousPageCompiler;
@@ -358,6 +359,10 @@ public:
     void setMinimalMeshResolutionRatio(PDFReal ratio);
     void setColorTolerance(PDFReal colorTolerance);
 
+    /// Sets limit of total size of page tile images
+    /// \param limit Limit [bytes]
+    void setTileCacheLimit(qint64 limit);
+
     static constexpr PDFReal getMinZoom() { return MIN_ZOOM; }
     static constexpr PDFReal getMaxZoom() { return MAX_ZOOM; }
 
@@ -544,6 +549,9 @@ private:
     /// Cache clear timer
     QTimer* m_cacheClearTimer;
 
+    /// Cache of rasterized page tiles
+    PDFPageTileCache* m_tileCache;
+
     /// Additional drawing interfaces
     std::set<IDocumentDrawInterface*> m_drawInterfaces;
 
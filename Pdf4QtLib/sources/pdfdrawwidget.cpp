@@ -122,7 +122,11 @@ void PDFWidget::updateRenderer(RendererEngine engine, int samplesCount)
 
 void PDFWidget::updateCacheLimits(int compiledPageCacheLimit, int thumbnailsCacheLimit, int fontCacheLimit, int instancedFontCacheLimit)
 {
-    m_proxy->getCompiler()->setCacheLimit(compiledPageCacheLimit);
+    // Page tiles share the memory budget with precompiled pages and other caches
+    // of the compiler, so tile cache limit is deducted from the budget.
+    const int tileCacheLimit = compiledPageCacheLimit / TILE_CACHE_LIMIT_DIVISOR;
+    m_proxy->getCompiler()->setCacheLimit(compiledPageCacheLimit - tileCacheLimit);
+    m_proxy->setTileCacheLimit(tileCacheLimit);
     QPixmapCache::setCacheLimit(thumbnailsCacheLimit);
     m_proxy->getFontCache()->setCacheLimits(fontCacheLimit, instancedFontCacheLimit);
 }
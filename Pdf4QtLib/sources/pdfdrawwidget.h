@@ -76,7 +76,7 @@ public:
     void updateRenderer(RendererEngine engine, int samplesCount);
 
     /// Updates cache limits
-    /// \param compiledPageCacheLimit Compiled page cache limit [bytes]
+    /// \param compiledPageCacheLimit Compiled page cache limit [bytes], it is shared by the page tile cache
     /// \param thumbnailsCacheLimit Thumbnail image cache limit [kB]
     /// \param fontCacheLimit Font cache limit [-]
     /// \param instancedFontCacheLimit Instanced font cache limit [-]
@@ -106,6 +106,9 @@ signals:
     void pageRenderingErrorsChanged(pdf::PDFInteger pageIndex, int errorsCount);
 
 private:
+    /// Part of the compiled page cache limit, which is used by the page tile cache (remaining part is used by the compiler)
+    static constexpr int TILE_CACHE_LIMIT_DIVISOR = 4;
+
     RendererEngine getEffectiveRenderer(RendererEngine rendererEngine);
 
     void updateRendererImpl();
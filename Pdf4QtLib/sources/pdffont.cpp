@@ -21,6 +21,7 @@
 #include "pdfnametounicode.h"
 #include "pdfexception.h"
 #include "pdfutils.h"
+#include "pdfpainter.h"
 #include "pdfdbgheap.h"
 
 #include <ft2build.h>
@@ -31,8 +32,10 @@
 #include <freetype/t1tables.h>
 
 #include <QMutex>
+#include <QAtomicInteger>
 #include <QReadWriteLock>
 #include <QPainterPath>
+#include <QTransform>
 #include <QDataStream>
 #include <QTreeWidgetItem>
 
@@ -462,49 +465,56 @@ private:
     PDFFontPointer m_parentFont;
 };
 
-/// Implementation of the PDFRealizedFont class using PIMPL pattern
-class PDFRealizedFontImpl : public IRealizedFontImpl
+/// Font face shared between realized fonts of all sizes. Glyphs are loaded without
+/// hinting, so glyph outlines scale linearly with the font size. Face loads glyph
+/// outlines at unit size (size 1.0) and caches them, realized fonts then only transform
+/// cached outlines to their size. So when new font size is needed (for example, the font
+/// is used with different size on the page), glyphs are not loaded by FreeType again.
+class PDFRealizedFontFace
 {
 public:
-    explicit PDFRealizedFontImpl();
-    virtual ~PDFRealizedFontImpl();
+    explicit PDFRealizedFontFace();
+    ~PDFRealizedFontFace();
 
-    virtual void fillTextSequence(const QByteArray& byteArray, TextSequence& textSequence, PDFRenderErrorReporter* reporter) override;
-    virtual bool isHorizontalWritingSystem() const override { return !m_isVertical; }
-    virtual void dumpFontToTreeItem(QTreeWidgetItem* item) const override;
-    virtual QString getPostScriptName() const override { return m_postScriptName; }
-    virtual CharacterInfos getCharacterInfos() const override;
+    struct Glyph
+    {
+        QPainterPath glyph;
+        PDFReal advance = 0.0;
+        quint64 id = 0; ///< Unique glyph identifier (assigned to glyphs of realized fonts)
+    };
 
-    static constexpr const PDFReal PIXEL_SIZE_MULTIPLIER = 100.0;
+    /// Returns glyph of unit size for glyph index. Returned reference
+    /// remains valid during the lifetime of the face.
+    /// \param glyphIndex Glyph index
+    const Glyph& getUnitGlyph(unsigned int glyphIndex);
+
+    /// Returns true, if glyph can be loaded
+    /// \param glyphIndex Glyph index
+    bool isGlyphLoadable(unsigned int glyphIndex);
+
+    /// Function checks, if error occured, and if yes, then exception is thrown
+    static void checkFreeTypeError(FT_Error error);
 
 private:
     friend class PDFRealizedFont;
+    friend class PDFRealizedFontImpl;
 
-    static constexpr const PDFReal FONT_WIDTH_MULTIPLIER = 1.0 / 1000.0;
+    /// Pixel size of the FreeType face. Outlines are loaded at this size (to have
+    /// enough precision in 26.6 format) and then scaled to unit size.
+    static constexpr const PDFReal FACE_PIXEL_SIZE = 1000.0;
     static constexpr const PDFReal FORMAT_26_6_MULTIPLIER = 1 / 64.0;
-    static constexpr const PDFReal FONT_MULTIPLIER = FORMAT_26_6_MULTIPLIER / PIXEL_SIZE_MULTIPLIER;
-
-    struct Glyph
-    {
-        QPainterPath glyph;
-        PDFReal advance = 0.0;
-    };
+    static constexpr const PDFReal FONT_MULTIPLIER = FORMAT_26_6_MULTIPLIER / FACE_PIXEL_SIZE;
 
     static int outlineMoveTo(const FT_Vector* to, void* user);
     static int outlineLineTo(const FT_Vector* to, void* user);
     static int outlineConicTo(const FT_Vector* control, const FT_Vector* to, void* user);
     static int outlineCubicTo(const FT_Vector* control1, const FT_Vector* control2, const FT_Vector* to, void* user);
 
-    /// Get glyph for glyph index
-    const Glyph& getGlyph(unsigned int glyphIndex);
-
-    /// Function checks, if error occured, and if yes, then exception is thrown
-    static void checkFreeTypeError(FT_Error error);
-
     /// Read/write lock for accessing the glyph data
     QReadWriteLock m_readWriteLock;
 
-    /// Glyph cache, must be protected by the mutex above
+    /// Unit size glyph cache, must be protected by the lock above. Loading
+    /// of the glyph by FreeType is also done under the write lock.
     std::unordered_map<unsigned int, Glyph> m_glyphCache;
 
     /// For embedded fonts, this byte array contains embedded font data
@@ -513,18 +523,12 @@ private:
     /// For system fonts, this byte array contains system font data
     QByteArray m_systemFontData;
 
-    /// Instance of FreeType library assigned to this font
+    /// Instance of FreeType library assigned to this face
     FT_Library m_library;
 
     /// Face of the font
     FT_Face m_face;
 
-    /// Pixel size of the font
-    PDFReal m_pixelSize;
-
-    /// Parent font
-    PDFFontPointer m_parentFont;
-
     /// True, if font is embedded
     bool m_isEmbedded;
 
@@ -535,18 +539,63 @@ private:
     QString m_postScriptName;
 };
 
-PDFRealizedFontImpl::PDFRealizedFontImpl() :
+/// Implementation of the PDFRealizedFont class using PIMPL pattern
+class PDFRealizedFontImpl : public IRealizedFontImpl
+{
+public:
+    explicit PDFRealizedFontImpl();
+    virtual ~PDFRealizedFontImpl();
+
+    virtual void fillTextSequence(const QByteArray& byteArray, TextSequence& textSequence, PDFRenderErrorReporter* reporter) override;
+    virtual bool isHorizontalWritingSystem() const override { return !m_fontFace->m_isVertical; }
+    virtual void dumpFontToTreeItem(QTreeWidgetItem* item) const override;
+    virtual QString getPostScriptName() const override { return m_fontFace->m_postScriptName; }
+    virtual CharacterInfos getCharacterInfos() const override;
+
+private:
+    friend class PDFRealizedFont;
+
+    static constexpr const PDFReal FONT_WIDTH_MULTIPLIER = 1.0 / 1000.0;
+
+    using Glyph = PDFRealizedFontFace::Glyph;
+
+    /// Counter for unique identifiers of glyphs of all realized fonts. Identifiers
+    /// are never reused, so they can be used as keys of glyph caches.
+    static QAtomicInteger<quint64> s_glyphIdCounter;
+
+    /// Get glyph for glyph index
+    const Glyph& getGlyph(unsigned int glyphIndex);
+
+    /// Read/write lock for accessing the glyph data
+    QReadWriteLock m_readWriteLock;
+
+    /// Glyph cache of glyphs scaled to the pixel size of the font,
+    /// must be protected by the mutex above
+    std::unordered_map<unsigned int, Glyph> m_glyphCache;
+
+    /// Font face (shared between realized fonts of different sizes)
+    PDFRealizedFontFacePointer m_fontFace;
+
+    /// Face of the font (owned by the font face above)
+    FT_Face m_face;
+
+    /// Pixel size of the font
+    PDFReal m_pixelSize;
+
+    /// Parent font
+    PDFFontPointer m_parentFont;
+};
+
+PDFRealizedFontFace::PDFRealizedFontFace() :
     m_library(nullptr),
     m_face(nullptr),
-    m_pixelSize(0.0),
-    m_parentFont(nullptr),
     m_isEmbedded(false),
     m_isVertical(false)
 {
 
 }
 
-PDFRealizedFontImpl::~PDFRealizedFontImpl()
+PDFRealizedFontFace::~PDFRealizedFontFace()
 {
     if (m_face)
     {
@@ -561,6 +610,34 @@ PDFRealizedFontImpl::~PDFRealizedFontImpl()
     }
 }
 
+QAtomicInteger<quint64> PDFRealizedFontImpl::s_glyphIdCounter(0);
+
+PDFRealizedFontImpl::PDFRealizedFontImpl() :
+    m_face(nullptr),
+    m_pixelSize(0.0),
+    m_parentFont(nullptr)
+{
+
+}
+
+PDFRealizedFontImpl::~PDFRealizedFontImpl()
+{
+    // Glyph identifiers are never reused, so glyph images of this font are
+    // removed from the glyph atlas together with the font. Other documents
+    // use other fonts, so their glyph images are kept.
+    if (!m_glyphCache.empty())
+    {
+        std::vector<quint64> glyphIds;
+        glyphIds.reserve(m_glyphCache.size());
+        for (const auto& item : m_glyphCache)
+        {
+            glyphIds.push_back(item.second.id);
+        }
+        std::sort(glyphIds.begin(), glyphIds.end());
+        PDFGlyphAtlas::getInstance()->removeGlyphs(glyphIds);
+    }
+}
+
 void PDFRealizedFontImpl::fillTextSequence(const QByteArray& byteArray, TextSequence& textSequence, PDFRenderErrorReporter* reporter)
 {
     switch (m_parentFont->getFontType())
@@ -594,7 +671,7 @@ void PDFRealizedFontImpl::fillTextSequence(const QByteArray& byteArray, TextSequ
                 if (glyphIndex)
                 {
                     const Glyph& glyph = getGlyph(glyphIndex);
-                    textSequence.items.emplace_back(&glyph.glyph, (*encoding)[static_cast<uint8_t>(byteArray[i])], glyph.advance);
+                    textSequence.items.emplace_back(&glyph.glyph, glyph.id, (*encoding)[static_cast<uint8_t>(byteArray[i])], glyph.advance);
                 }
                 else
                 {
@@ -629,7 +706,7 @@ void PDFRealizedFontImpl::fillTextSequence(const QByteArray& byteArray, TextSequ
                 {
                     QChar character = toUnicode->getToUnicode(cid);
                     const Glyph& glyph = getGlyph(glyphIndex);
-                    textSequence.items.emplace_back(&glyph.glyph, character, glyph.advance);
+                    textSequence.items.emplace_back(&glyph.glyph, glyph.id, character, glyph.advance);
                 }
                 else
                 {
@@ -738,7 +815,7 @@ CharacterInfos PDFRealizedFontImpl::getCharacterInfos() const
                         continue;
                     }
 
-                    if (!FT_Load_Glyph(m_face, gid, FT_LOAD_NO_BITMAP | FT_LOAD_NO_HINTING))
+                    if (m_fontFace->isGlyphLoadable(gid))
                     {
                         CharacterInfo info;
                         info.gid = gid;
@@ -863,34 +940,95 @@ void PDFRealizedFontImpl::dumpFontToTreeItem(QTreeWidgetItem* item) const
     }
 }
 
-int PDFRealizedFontImpl::outlineMoveTo(const FT_Vector* to, void* user)
+int PDFRealizedFontFace::outlineMoveTo(const FT_Vector* to, void* user)
 {
     Glyph* glyph = reinterpret_cast<Glyph*>(user);
     glyph->glyph.moveTo(to->x * FONT_MULTIPLIER, to->y * FONT_MULTIPLIER);
     return 0;
 }
 
-int PDFRealizedFontImpl::outlineLineTo(const FT_Vector* to, void* user)
+int PDFRealizedFontFace::outlineLineTo(const FT_Vector* to, void* user)
 {
     Glyph* glyph = reinterpret_cast<Glyph*>(user);
     glyph->glyph.lineTo(to->x * FONT_MULTIPLIER, to->y * FONT_MULTIPLIER);
     return 0;
 }
 
-int PDFRealizedFontImpl::outlineConicTo(const FT_Vector* control, const FT_Vector* to, void* user)
+int PDFRealizedFontFace::outlineConicTo(const FT_Vector* control, const FT_Vector* to, void* user)
 {
     Glyph* glyph = reinterpret_cast<Glyph*>(user);
     glyph->glyph.quadTo(control->x * FONT_MULTIPLIER, control->y * FONT_MULTIPLIER, to->x * FONT_MULTIPLIER, to->y * FONT_MULTIPLIER);
     return 0;
 }
 
-int PDFRealizedFontImpl::outlineCubicTo(const FT_Vector* control1, const FT_Vector* control2, const FT_Vector* to, void* user)
+int PDFRealizedFontFace::outlineCubicTo(const FT_Vector* control1, const FT_Vector* control2, const FT_Vector* to, void* user)
 {
     Glyph* glyph = reinterpret_cast<Glyph*>(user);
     glyph->glyph.cubicTo(control1->x * FONT_MULTIPLIER, control1->y * FONT_MULTIPLIER, control2->x * FONT_MULTIPLIER, control2->y * FONT_MULTIPLIER, to->x * FONT_MULTIPLIER, to->y * FONT_MULTIPLIER);
     return 0;
 }
 
+const PDFRealizedFontFace::Glyph& PDFRealizedFontFace::getUnitGlyph(unsigned int glyphIndex)
+{
+    {
+        QReadLocker readLock(&m_readWriteLock);
+
+        // First look into cache
+        auto it = m_glyphCache.find(glyphIndex);
+        if (it != m_glyphCache.cend())
+        {
+            return it->second;
+        }
+    }
+
+    QWriteLocker writeLock(&m_readWriteLock);
+
+    // Glyph could be loaded by another thread meanwhile
+    auto it = m_glyphCache.find(glyphIndex);
+    if (it != m_glyphCache.cend())
+    {
+        return it->second;
+    }
+
+    Glyph glyph;
+
+    FT_Outline_Funcs glyphOutlineInterface;
+    glyphOutlineInterface.delta = 0;
+    glyphOutlineInterface.shift = 0;
+    glyphOutlineInterface.move_to = PDFRealizedFontFace::outlineMoveTo;
+    glyphOutlineInterface.line_to = PDFRealizedFontFace::outlineLineTo;
+    glyphOutlineInterface.conic_to = PDFRealizedFontFace::outlineConicTo;
+    glyphOutlineInterface.cubic_to = PDFRealizedFontFace::outlineCubicTo;
+
+    checkFreeTypeError(FT_Load_Glyph(m_face, glyphIndex, FT_LOAD_NO_BITMAP | FT_LOAD_NO_HINTING));
+    checkFreeTypeError(FT_Outline_Decompose(&m_face->glyph->outline, &glyphOutlineInterface, &glyph));
+    glyph.glyph.closeSubpath();
+    glyph.advance = !m_isVertical ? m_face->glyph->advance.x : m_face->glyph->advance.y;
+    glyph.advance *= FONT_MULTIPLIER;
+
+    return m_glyphCache.insert(std::make_pair(glyphIndex, qMove(glyph))).first->second;
+}
+
+bool PDFRealizedFontFace::isGlyphLoadable(unsigned int glyphIndex)
+{
+    QWriteLocker writeLock(&m_readWriteLock);
+    return !FT_Load_Glyph(m_face, glyphIndex, FT_LOAD_NO_BITMAP | FT_LOAD_NO_HINTING);
+}
+
+void PDFRealizedFontFace::checkFreeTypeError(FT_Error error)
+{
+    if (error)
+    {
+        QString message;
+        if (const char* errorString = FT_Error_String(error))
+        {
+            message = QString::fromLatin1(errorString);
+        }
+
+        throw PDFException(PDFTranslationContext::tr("FreeType error code %1: %2").arg(error).arg(message));
+    }
+}
+
 const PDFRealizedFontImpl::Glyph& PDFRealizedFontImpl::getGlyph(unsigned int glyphIndex)
 {
     if (glyphIndex)
@@ -906,26 +1044,17 @@ const PDFRealizedFontImpl::Glyph& PDFRealizedFontImpl::getGlyph(unsigned int gly
             }
         }
 
-        QWriteLocker writeLock(&m_readWriteLock);
-        Glyph glyph;
-
-        FT_Outline_Funcs glyphOutlineInterface;
-        glyphOutlineInterface.delta = 0;
-        glyphOutlineInterface.shift = 0;
-        glyphOutlineInterface.move_to = PDFRealizedFontImpl::outlineMoveTo;
-        glyphOutlineInterface.line_to = PDFRealizedFontImpl::outlineLineTo;
-        glyphOutlineInterface.conic_to = PDFRealizedFontImpl::outlineConicTo;
-        glyphOutlineInterface.cubic_to = PDFRealizedFontImpl::outlineCubicTo;
-
-        checkFreeTypeError(FT_Load_Glyph(m_face, glyphIndex, FT_LOAD_NO_BITMAP | FT_LOAD_NO_HINTING));
-        checkFreeTypeError(FT_Outline_Decompose(&m_face->glyph->outline, &glyphOutlineInterface, &glyph));
-        glyph.glyph.closeSubpath();
-        glyph.advance = !m_isVertical ? m_face->glyph->advance.x : m_face->glyph->advance.y;
-        glyph.advance *= FONT_MULTIPLIER;
+        // Glyph outline is shared between all sizes, we just scale it
+        const Glyph& unitGlyph = m_fontFace->getUnitGlyph(glyphIndex);
 
+        QWriteLocker writeLock(&m_readWriteLock);
         auto it = m_glyphCache.find(glyphIndex);
         if (it == m_glyphCache.cend())
         {
+            Glyph glyph;
+            glyph.glyph = QTransform::fromScale(m_pixelSize, m_pixelSize).map(unitGlyph.glyph);
+            glyph.advance = unitGlyph.advance * m_pixelSize;
+            glyph.id = s_glyphIdCounter.fetchAndAddRelaxed(1) + 1;
             it = m_glyphCache.insert(std::make_pair(glyphIndex, qMove(glyph))).first;
         }
         return it->second;
@@ -935,20 +1064,6 @@ const PDFRealizedFontImpl::Glyph& PDFRealizedFontImpl::getGlyph(unsigned int gly
     return dummy;
 }
 
-void PDFRealizedFontImpl::checkFreeTypeError(FT_Error error)
-{
-    if (error)
-    {
-        QString message;
-        if (const char* errorString = FT_Error_String(error))
-        {
-            message = QString::fromLatin1(errorString);
-        }
-
-        throw PDFException(PDFTranslationContext::tr("FreeType error code %1: %2").arg(error).arg(message));
-    }
-}
-
 PDFRealizedFont::~PDFRealizedFont()
 {
     delete m_impl;
@@ -980,6 +1095,11 @@ CharacterInfos PDFRealizedFont::getCharacterInfos() const
 }
 
 PDFRealizedFontPointer PDFRealizedFont::createRealizedFont(PDFFontPointer font, PDFReal pixelSize, PDFRenderErrorReporter* reporter)
+{
+    return createRealizedFont(font, PDFRealizedFontFacePointer(), pixelSize, reporter);
+}
+
+PDFRealizedFontPointer PDFRealizedFont::createRealizedFont(PDFFontPointer font, PDFRealizedFontFacePointer face, PDFReal pixelSize, PDFRenderErrorReporter* reporter)
 {
     PDFRealizedFontPointer result;
 
@@ -994,64 +1114,83 @@ PDFRealizedFontPointer PDFRealizedFont::createRealizedFont(PDFFontPointer font,
     }
     else
     {
-        std::unique_ptr<PDFRealizedFontImpl> implPtr(new PDFRealizedFontImpl());
+        if (!face)
+        {
+            face = createRealizedFontFace(font, reporter);
+        }
 
-        PDFRealizedFontImpl* impl = implPtr.get();
+        Q_ASSERT(face);
+
+        PDFRealizedFontImpl* impl = new PDFRealizedFontImpl();
         impl->m_parentFont = font;
         impl->m_pixelSize = pixelSize;
+        impl->m_face = face->m_face;
+        impl->m_fontFace = qMove(face);
+        result.reset(new PDFRealizedFont(impl));
+    }
 
-        const PDFFontCMap* cmap = font->getCMap();
-        const FontDescriptor* descriptor = font->getFontDescriptor();
-        if (descriptor->isEmbedded())
+    return result;
+}
+
+PDFRealizedFontFacePointer PDFRealizedFont::createRealizedFontFace(PDFFontPointer font, PDFRenderErrorReporter* reporter)
+{
+    if (font->getFontType() == FontType::Type3)
+    {
+        // Type 3 fonts are not FreeType fonts
+        return PDFRealizedFontFacePointer();
+    }
+
+    PDFRealizedFontFacePointer face(new PDFRealizedFontFace());
+
+    const PDFFontCMap* cmap = font->getCMap();
+    const FontDescriptor* descriptor = font->getFontDescriptor();
+    if (descriptor->isEmbedded())
+    {
+        PDFRealizedFontFace::checkFreeTypeError(FT_Init_FreeType(&face->m_library));
+        const QByteArray* embeddedFontData = descriptor->getEmbeddedFontData();
+        Q_ASSERT(embeddedFontData);
+        face->m_embeddedFontData = *embeddedFontData;
+
+        // At this time, embedded font data should not be empty!
+        Q_ASSERT(!face->m_embeddedFontData.isEmpty());
+
+        PDFRealizedFontFace::checkFreeTypeError(FT_New_Memory_Face(face->m_library, reinterpret_cast<const FT_Byte*>(face->m_embeddedFontData.constData()), face->m_embeddedFontData.size(), 0, &face->m_face));
+        FT_Select_Charmap(face->m_face, FT_ENCODING_UNICODE); // We try to select unicode encoding, but if it fails, we don't do anything (use glyph indices instead)
+        PDFRealizedFontFace::checkFreeTypeError(FT_Set_Pixel_Sizes(face->m_face, 0, qRound(PDFRealizedFontFace::FACE_PIXEL_SIZE)));
+        face->m_isVertical = cmap ? cmap->isVertical() : false;
+        face->m_isEmbedded = true;
+    }
+    else
+    {
+        StandardFontType standardFontType = StandardFontType::Invalid;
+        if (font->getFontType() == FontType::Type1 || font->getFontType() == FontType::MMType1)
         {
-            PDFRealizedFontImpl::checkFreeTypeError(FT_Init_FreeType(&impl->m_library));
-            const QByteArray* embeddedFontData = descriptor->getEmbeddedFontData();
-            Q_ASSERT(embeddedFontData);
-            impl->m_embeddedFontData = *embeddedFontData;
-
-            // At this time, embedded font data should not be empty!
-            Q_ASSERT(!impl->m_embeddedFontData.isEmpty());
-
-            PDFRealizedFontImpl::checkFreeTypeError(FT_New_Memory_Face(impl->m_library, reinterpret_cast<const FT_Byte*>(impl->m_embeddedFontData.constData()), impl->m_embeddedFontData.size(), 0, &impl->m_face));
-            FT_Select_Charmap(impl->m_face, FT_ENCODING_UNICODE); // We try to select unicode encoding, but if it fails, we don't do anything (use glyph indices instead)
-            PDFRealizedFontImpl::checkFreeTypeError(FT_Set_Pixel_Sizes(impl->m_face, 0, qRound(pixelSize * PDFRealizedFontImpl::PIXEL_SIZE_MULTIPLIER)));
-            impl->m_isVertical = cmap ? cmap->isVertical() : false;
-            impl->m_isEmbedded = true;
-            result.reset(new PDFRealizedFont(implPtr.release()));
+            Q_ASSERT(dynamic_cast<const PDFType1Font*>(font.get()));
+            const PDFType1Font* type1Font = static_cast<const PDFType1Font*>(font.get());
+            standardFontType = type1Font->getStandardFontType();
         }
-        else
-        {
-            StandardFontType standardFontType = StandardFontType::Invalid;
-            if (font->getFontType() == FontType::Type1 || font->getFontType() == FontType::MMType1)
-            {
-                Q_ASSERT(dynamic_cast<const PDFType1Font*>(font.get()));
-                const PDFType1Font* type1Font = static_cast<const PDFType1Font*>(font.get());
-                standardFontType = type1Font->getStandardFontType();
-            }
 
-            const PDFSystemFontInfoStorage* fontStorage = PDFSystemFontInfoStorage::getInstance();
-            impl->m_systemFontData = fontStorage->loadFont(descriptor, standardFontType, reporter);
+        const PDFSystemFontInfoStorage* fontStorage = PDFSystemFontInfoStorage::getInstance();
+        face->m_systemFontData = fontStorage->loadFont(descriptor, standardFontType, reporter);
 
-            if (impl->m_systemFontData.isEmpty())
-            {
-                throw PDFException(PDFTranslationContext::tr("Can't load system font '%1'.").arg(QString::fromLatin1(descriptor->fontName)));
-            }
+        if (face->m_systemFontData.isEmpty())
+        {
+            throw PDFException(PDFTranslationContext::tr("Can't load system font '%1'.").arg(QString::fromLatin1(descriptor->fontName)));
+        }
 
-            PDFRealizedFontImpl::checkFreeTypeError(FT_Init_FreeType(&impl->m_library));
-            PDFRealizedFontImpl::checkFreeTypeError(FT_New_Memory_Face(impl->m_library, reinterpret_cast<const FT_Byte*>(impl->m_systemFontData.constData()), impl->m_systemFontData.size(), 0, &impl->m_face));
-            FT_Select_Charmap(impl->m_face, FT_ENCODING_UNICODE); // We try to select unicode encoding, but if it fails, we don't do anything (use glyph indices instead)
-            PDFRealizedFontImpl::checkFreeTypeError(FT_Set_Pixel_Sizes(impl->m_face, 0, qRound(pixelSize * PDFRealizedFontImpl::PIXEL_SIZE_MULTIPLIER)));
-            impl->m_isVertical = cmap ? cmap->isVertical() : false;
-            impl->m_isEmbedded = false;
-            if (const char* postScriptName = FT_Get_Postscript_Name(impl->m_face))
-            {
-                impl->m_postScriptName = QString::fromLatin1(postScriptName);
-            }
-            result.reset(new PDFRealizedFont(implPtr.release()));
+        PDFRealizedFontFace::checkFreeTypeError(FT_Init_FreeType(&face->m_library));
+        PDFRealizedFontFace::checkFreeTypeError(FT_New_Memory_Face(face->m_library, reinterpret_cast<const FT_Byte*>(face->m_systemFontData.constData()), face->m_systemFontData.size(), 0, &face->m_face));
+        FT_Select_Charmap(face->m_face, FT_ENCODING_UNICODE); // We try to select unicode encoding, but if it fails, we don't do anything (use glyph indices instead)
+        PDFRealizedFontFace::checkFreeTypeError(FT_Set_Pixel_Sizes(face->m_face, 0, qRound(PDFRealizedFontFace::FACE_PIXEL_SIZE)));
+        face->m_isVertical = cmap ? cmap->isVertical() : false;
+        face->m_isEmbedded = false;
+        if (const char* postScriptName = FT_Get_Postscript_Name(face->m_face))
+        {
+            face->m_postScriptName = QString::fromLatin1(postScriptName);
         }
     }
 
-    return result;
+    return face;
 }
 
 FontDescriptor PDFFont::readFontDescriptor(const PDFObject& fontDescriptorObject, const PDFDocument* document)
@@ -1876,6 +2015,7 @@ void PDFFontCache::setDocument(const PDFModifiedDocument& document)
         {
             m_fontCache.clear();
             m_realizedFontCache.clear();
+            m_realizedFontFaceCache.clear();
         }
     }
 }
@@ -1920,8 +2060,20 @@ PDFRealizedFontPointer PDFFontCache::getRealizedFont(const PDFFontPointer& font,
     auto it = m_realizedFontCache.find(std::make_pair(font, size));
     if (it == m_realizedFontCache.cend())
     {
-        // We must create the realized font
-        PDFRealizedFontPointer realizedFont = PDFRealizedFont::createRealizedFont(font, size, reporter);
+        // We must create the realized font. Font face with glyph outlines is shared
+        // between all sizes of the font, so new size doesn't load glyphs again.
+        auto faceIt = m_realizedFontFaceCache.find(font);
+        if (faceIt == m_realizedFontFaceCache.cend())
+        {
+            if (m_fontCacheShrinkDisabledObjects.empty() && m_realizedFontFaceCache.size() >= m_fontCacheLimit)
+            {
+                m_realizedFontFaceCache.clear();
+            }
+
+            faceIt = m_realizedFontFaceCache.insert(std::make_pair(font, PDFRealizedFont::createRealizedFontFace(font, reporter))).first;
+        }
+
+        PDFRealizedFontPointer realizedFont = PDFRealizedFont::createRealizedFont(font, faceIt->second, size, reporter);
 
         if (m_fontCacheShrinkDisabledObjects.empty() && m_realizedFontCache.size() >= m_realizedFontCacheLimit)
         {
@@ -1972,6 +2124,10 @@ void PDFFontCache::shrink()
         {
             m_realizedFontCache.clear();
         }
+        if (m_realizedFontFaceCache.size() >= m_fontCacheLimit)
+        {
+            m_realizedFontFaceCache.clear();
+        }
     }
 }
 
@@ -2025,10 +2181,10 @@ PDFFontCMap PDFFontCMap::createFromData(const QByteArray& data)
     {
         PDFLexicalAnalyzer::Token token = parser.fetch();
 
-        if (token.type == PDFLexicalAnalyzer::TokenType::Name && token.data.toByteArray() == "WMode")
+        if (token.type == PDFLexicalAnalyzer::TokenType::Name && token.getBytes() == "WMode")
         {
             PDFLexicalAnalyzer::Token valueToken = parser.fetch();
-            vertical = valueToken.type == PDFLexicalAnalyzer::TokenType::Integer && valueToken.data.value<PDFInteger>() == 1;
+            vertical = valueToken.type == PDFLexicalAnalyzer::TokenType::Integer && valueToken.getInteger() == 1;
             continue;
         }
 
@@ -2036,7 +2192,7 @@ PDFFontCMap PDFFontCMap::createFromData(const QByteArray& data)
         {
             if (currentToken.type == PDFLexicalAnalyzer::TokenType::String)
             {
-                QByteArray byteArray = currentToken.data.toByteArray();
+                QByteArray byteArray = currentToken.getBytes();
 
                 unsigned int codeValue = 0;
                 for (int i = 0; i < byteArray.size(); ++i)
@@ -2054,7 +2210,7 @@ PDFFontCMap PDFFontCMap::createFromData(const QByteArray& data)
         {
             if (currentToken.type == PDFLexicalAnalyzer::TokenType::Integer)
             {
-                return currentToken.data.value<PDFInteger>();
+                return currentToken.getInteger();
             }
 
             throw PDFException(PDFTranslationContext::tr("Can't fetch CID from CMap definition."));
@@ -2064,7 +2220,7 @@ PDFFontCMap PDFFontCMap::createFromData(const QByteArray& data)
         {
             if (currentToken.type == PDFLexicalAnalyzer::TokenType::String)
             {
-                QByteArray byteArray = currentToken.data.toByteArray();
+                QByteArray byteArray = currentToken.getBytes();
 
                 if (byteArray.size() == 2)
                 {
@@ -2082,12 +2238,12 @@ PDFFontCMap PDFFontCMap::createFromData(const QByteArray& data)
 
         if (token.type == PDFLexicalAnalyzer::TokenType::Command)
         {
-            QByteArray command = token.data.toByteArray();
+            QByteArray command = token.getBytes();
             if (command == "usecmap")
             {
                 if (previousToken.type == PDFLexicalAnalyzer::TokenType::Name)
                 {
-                    additionalMappings.emplace_back(createFromName(previousToken.data.toByteArray()));
+                    additionalMappings.emplace_back(createFromName(previousToken.getBytes()));
                 }
                 else
                 {
@@ -2099,7 +2255,7 @@ PDFFontCMap PDFFontCMap::createFromData(const QByteArray& data)
                 PDFLexicalAnalyzer::Token token1 = parser.fetch();
 
                 if (token1.type == PDFLexicalAnalyzer::TokenType::Command &&
-                    token1.data.toByteArray() == "endbfrange")
+                    token1.getBytes() == "endbfrange")
                 {
                     break;
                 }
@@ -2120,7 +2276,7 @@ PDFFontCMap PDFFontCMap::createFromData(const QByteArray& data)
                     PDFLexicalAnalyzer::Token token1 = parser.fetch();
 
                     if (token1.type == PDFLexicalAnalyzer::TokenType::Command &&
-                        token1.data.toByteArray() == "endcidrange")
+                        token1.getBytes() == "endcidrange")
                     {
                         break;
                     }
@@ -2142,7 +2298,7 @@ PDFFontCMap PDFFontCMap::createFromData(const QByteArray& data)
                     PDFLexicalAnalyzer::Token token1 = parser.fetch();
 
                     if (token1.type == PDFLexicalAnalyzer::TokenType::Command &&
-                        token1.data.toByteArray() == "endcidchar")
+                        token1.getBytes() == "endcidchar")
                     {
                         break;
                     }
@@ -2162,7 +2318,7 @@ PDFFontCMap PDFFontCMap::createFromData(const QByteArray& data)
                     PDFLexicalAnalyzer::Token token1 = parser.fetch();
 
                     if (token1.type == PDFLexicalAnalyzer::TokenType::Command &&
-                        token1.data.toByteArray() == "endbfchar")
+                        token1.getBytes() == "endbfchar")
                     {
                         break;
                     }
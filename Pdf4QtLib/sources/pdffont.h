@@ -61,6 +61,7 @@ struct TextSequenceItem
 {
     inline explicit TextSequenceItem() = default;
     inline explicit TextSequenceItem(const QPainterPath* glyph, QChar character, PDFReal advance) : glyph(glyph), character(character), advance(advance) { }
+    inline explicit TextSequenceItem(const QPainterPath* glyph, quint64 glyphId, QChar character, PDFReal advance) : glyph(glyph), glyphId(glyphId), character(character), advance(advance) { }
     inline explicit TextSequenceItem(PDFReal advance) : character(), advance(advance) { }
     inline explicit TextSequenceItem(const QByteArray* characterContentStream, QChar character, PDFReal advance) : characterContentStream(characterContentStream), character(character), advance(advance) { }
 
@@ -70,6 +71,7 @@ struct TextSequenceItem
     inline bool isNull() const { return !isCharacter() && !isAdvance(); }
 
     const QPainterPath* glyph = nullptr;
+    quint64 glyphId = 0; ///< Unique identifier of the glyph path (zero, if glyph has no identifier)
     const QByteArray* characterContentStream = nullptr;
     QChar character;
     PDFReal advance = 0;
@@ -215,9 +217,11 @@ class PDFFont;
 using PDFFontPointer = QSharedPointer<PDFFont>;
 
 class PDFRealizedFont;
+class PDFRealizedFontFace;
 class IRealizedFontImpl;
 
 using PDFRealizedFontPointer = QSharedPointer<PDFRealizedFont>;
+using PDFRealizedFontFacePointer = QSharedPointer<PDFRealizedFontFace>;
 
 struct CharacterInfo
 {
@@ -256,6 +260,23 @@ public:
     /// then exception is thrown.
     static PDFRealizedFontPointer createRealizedFont(PDFFontPointer font, PDFReal pixelSize, PDFRenderErrorReporter* reporter);
 
+    /// Creates new realized font using font face \p face, which can be shared
+    /// between realized fonts of different sizes. Glyph outlines loaded by the face
+    /// are reused by all these realized fonts. If face is null, then new face is
+    /// created. If font can't be created, then exception is thrown.
+    /// \param font Font
+    /// \param face Font face created by \p createRealizedFontFace for the same font (can be null)
+    /// \param pixelSize Pixel size of the font
+    /// \param reporter Error reporter
+    static PDFRealizedFontPointer createRealizedFont(PDFFontPointer font, PDFRealizedFontFacePointer face, PDFReal pixelSize, PDFRenderErrorReporter* reporter);
+
+    /// Creates font face, which holds font program and size independent glyph outlines. Face
+    /// can be shared between realized fonts of different sizes. For Type 3 fonts, null
+    /// face is returned. If face can't be created, then exception is thrown.
+    /// \param font Font
+    /// \param reporter Error reporter
+    static PDFRealizedFontFacePointer createRealizedFontFace(PDFFontPointer font, PDFRenderErrorReporter* reporter);
+
 private:
     /// Constructs new realized font
     explicit PDFRealizedFont(IRealizedFontImpl* impl) : m_impl(impl) { }
@@ -426,6 +447,7 @@ private:
     const PDFDocument* m_document;
     mutable std::map<PDFObjectReference, PDFFontPointer> m_fontCache;
     mutable std::map<std::pair<PDFFontPointer, PDFReal>, PDFRealizedFontPointer> m_realizedFontCache;
+    mutable std::map<PDFFontPointer, PDFRealizedFontFacePointer> m_realizedFontFaceCache;
     mutable std::set<const void*> m_fontCacheShrinkDisabledObjects;
 };
 
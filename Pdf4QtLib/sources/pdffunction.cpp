@@ -23,8 +23,11 @@
 #include "pdfutils.h"
 #include "pdfdbgheap.h"
 
+#include <array>
 #include <stack>
+#include <limits>
 #include <iterator>
+#include <algorithm>
 #include <type_traits>
 
 namespace pdf
@@ -39,6 +42,20 @@ PDFFunction::PDFFunction(uint32_t m, uint32_t n, std::vector<PDFReal>&& domain,
 
 }
 
+PDFFunction::FunctionResult PDFFunction::apply(const_iterator x, iterator y, size_t count) const
+{
+    for (size_t point = 0; point < count; ++point, x += m_m, y += m_n)
+    {
+        FunctionResult result = apply(x, x + m_m, y, y + m_n);
+        if (!result)
+        {
+            return result;
+        }
+    }
+
+    return true;
+}
+
 PDFFunctionPtr PDFFunction::createFunction(const PDFDocument* document, const PDFObject& object)
 {
     PDFParsingContext context(nullptr);
@@ -419,76 +436,92 @@ PDFFunction::FunctionResult PDFSampledFunction::apply(const_iterator x_1,
         return PDFTranslationContext::tr("Invalid number of output variables for function. Expected %1, provided %2.").arg(m_n).arg(n);
     }
 
-    PDFFlatArray<uint32_t, DEFAULT_OPERAND_COUNT> encoded;
-    PDFFlatArray<PDFReal, DEFAULT_OPERAND_COUNT> encoded0;
-    PDFFlatArray<PDFReal, DEFAULT_OPERAND_COUNT> encoded1;
+    return apply(x_1, y_1, 1);
+}
 
-    for (uint32_t i = 0; i < m_m; ++i)
+PDFFunction::FunctionResult PDFSampledFunction::apply(const_iterator x, iterator y, size_t count) const
+{
+    // Weights of the hypercube nodes. Node weight is product of the weights
+    // of the input variables, i-th bit of the node index corresponds to the
+    // variable x_i (bit 0 = weight x0, bit 1 = weight x1). Instead of reducing
+    // the hypercube for each output separately, output values are computed
+    // as weighted sum of the node samples. Samples of the single node are
+    // stored consecutively, so inner loop over outputs can be vectorized.
+    PDFFlatArray<PDFReal, DEFAULT_OPERAND_COUNT> weights;
+    weights.resize(m_hypercubeNodeCount);
+
+    const size_t sampleCount = m_samples.size();
+    const size_t lastNodeOffset = m_hypercubeNodeOffsets.back();
+
+    for (size_t point = 0; point < count; ++point, x += m_m, y += m_n)
     {
-        const PDFReal x = *std::next(x_1, i);
+        // Index (offset) for hypercube node (0, 0, ..., 0)
+        uint32_t baseOffset = 0;
+        uint32_t stride = m_n;
+        uint32_t currentHypercubeNodeCount = 1;
+        weights[0] = 1.0;
 
-        // First clamp it in the function domain
-        const PDFReal xClamped = clampInput(i, x);
-        const PDFReal xEncoded = interpolate(xClamped, m_domain[2 * i], m_domain[2 * i + 1], m_encoder[2 * i], m_encoder[2 * i + 1]);
-        const PDFReal xClampedToSamples = qBound<PDFReal>(0, xEncoded, m_size[i]);
-
-        uint32_t xRounded = static_cast<uint32_t>(xClampedToSamples);
-        if (xRounded == m_size[i] && m_size[i] > 1)
+        for (uint32_t i = 0; i < m_m; ++i)
         {
-            // We want one value before the end (so we can use the "hypercube" algorithm)
-            xRounded = m_size[i] - 2;
-        }
+            // First clamp it in the function domain
+            const PDFReal xClamped = clampInput(i, x[i]);
+            const PDFReal xEncoded = interpolate(xClamped, m_domain[2 * i], m_domain[2 * i + 1], m_encoder[2 * i], m_encoder[2 * i + 1]);
+            const PDFReal xClampedToSamples = qBound<PDFReal>(0, xEncoded, m_size[i]);
 
-        const PDFReal x1 = xClampedToSamples - static_cast<PDFReal>(xRounded);
-        const PDFReal x0 = 1.0 - x1;
-        encoded.push_back(xRounded);
-        encoded0.push_back(x0);
-        encoded1.push_back(x1);
-    }
+            uint32_t xRounded = static_cast<uint32_t>(xClampedToSamples);
+            if (xRounded == m_size[i] && m_size[i] > 1)
+            {
+                // We want one value before the end (so we can use the "hypercube" algorithm)
+                xRounded = m_size[i] - 2;
+            }
 
-    // Index (offset) for hypercube node (0, 0, ..., 0)
-    uint32_t baseOffset = 0;
-    for (uint32_t i = m_m - 1; i > 0; --i)
-    {
-        baseOffset = (baseOffset + encoded[i]) * m_size[i - 1];
-    }
-    baseOffset = (baseOffset + encoded[0]) * m_n;
+            const PDFReal x1 = xClampedToSamples - static_cast<PDFReal>(xRounded);
+            const PDFReal x0 = 1.0 - x1;
 
-    // Samples for hypercube nodes (for each hypercube node, single
-    // sample is fetched). Of course, size of this array is 2^m, so
-    // it can be very huge.
-    PDFFlatArray<PDFReal, DEFAULT_OPERAND_COUNT> hyperCubeSamples;
-    hyperCubeSamples.resize(m_hypercubeNodeCount);
+            baseOffset += xRounded * stride;
+            stride *= m_size[i];
 
-    for (uint32_t outputIndex = 0; outputIndex < m_n; ++outputIndex)
-    {
-        // Load samples into hypercube
-        for (uint32_t i = 0; i < m_hypercubeNodeCount; ++i)
-        {
-            const uint32_t offset = baseOffset + m_hypercubeNodeOffsets[i] + outputIndex;
-            hyperCubeSamples[i] = (offset < m_samples.size()) ? m_samples[offset] : 0.0;
+            for (uint32_t j = 0; j < currentHypercubeNodeCount; ++j)
+            {
+                weights[j + currentHypercubeNodeCount] = weights[j] * x1;
+                weights[j] *= x0;
+            }
+            currentHypercubeNodeCount *= 2;
         }
 
-        // We have loaded samples into the hypercube. Now, in each round of algorithm,
-        // reduce the hypercube dimension by 1. At the end, we will have hypercube
-        // with dimension 0, e.g. node.
-        uint32_t currentHypercubeNodeCount = m_hypercubeNodeCount;
-        for (uint32_t i = 0; i < m_m; ++i)
+        std::fill(y, y + m_n, 0.0);
+
+        if (size_t(baseOffset) + lastNodeOffset + m_n <= sampleCount)
         {
-            for (uint32_t j = 0; j < currentHypercubeNodeCount; j += 2)
+            // Fast path - all samples of the hypercube are valid
+            for (uint32_t i = 0; i < m_hypercubeNodeCount; ++i)
             {
-                hyperCubeSamples[j / 2] = encoded0[i] * hyperCubeSamples[j] + encoded1[i] * hyperCubeSamples[j + 1];
-            }
+                const PDFReal weight = weights[i];
+                const PDFReal* samples = m_samples.data() + baseOffset + m_hypercubeNodeOffsets[i];
 
-            // We have reduced the hypercube node count 2 times - we have
-            // reduced it by one dimension.
-            currentHypercubeNodeCount = currentHypercubeNodeCount / 2;
+                for (uint32_t outputIndex = 0; outputIndex < m_n; ++outputIndex)
+                {
+                    y[outputIndex] += weight * samples[outputIndex];
+                }
+            }
+        }
+        else
+        {
+            for (uint32_t i = 0; i < m_hypercubeNodeCount; ++i)
+            {
+                for (uint32_t outputIndex = 0; outputIndex < m_n; ++outputIndex)
+                {
+                    const uint32_t offset = baseOffset + m_hypercubeNodeOffsets[i] + outputIndex;
+                    y[outputIndex] += weights[i] * ((offset < sampleCount) ? m_samples[offset] : 0.0);
+                }
+            }
         }
 
-        const PDFReal outputValue = hyperCubeSamples[0];
-        const PDFReal outputValueDecoded = interpolate(outputValue, 0.0, m_sampleMaximalValue, m_decoder[2 * outputIndex], m_decoder[2 * outputIndex + 1]);
-        const PDFReal outputValueClamped = clampOutput(outputIndex, outputValueDecoded);
-        *std::next(y_1, outputIndex) = outputValueClamped;
+        for (uint32_t outputIndex = 0; outputIndex < m_n; ++outputIndex)
+        {
+            const PDFReal outputValueDecoded = interpolate(y[outputIndex], 0.0, m_sampleMaximalValue, m_decoder[2 * outputIndex], m_decoder[2 * outputIndex + 1]);
+            y[outputIndex] = clampOutput(outputIndex, outputValueDecoded);
+        }
     }
 
     return true;
@@ -528,40 +561,79 @@ PDFFunction::FunctionResult PDFExponentialFunction::apply(PDFFunction::const_ite
         return PDFTranslationContext::tr("Invalid number of output variables for function. Expected %1, provided %2.").arg(m_n).arg(n);
     }
 
-    Q_ASSERT(m == 1);
-    const PDFReal x = clampInput(0, *x_1);
+    return apply(x_1, y_1, 1);
+}
+
+PDFFunction::FunctionResult PDFExponentialFunction::apply(const_iterator x, iterator y, size_t count) const
+{
+    // Points are processed in chunks. For each point of the chunk, power is computed
+    // only once (and not for each output value), in single loop, which compiler
+    // can vectorize, and then output values are interpolated.
+    constexpr size_t CHUNK_SIZE = 64;
+    std::array<PDFReal, CHUNK_SIZE> powers = { };
 
-    if (!m_isLinear)
+    for (size_t chunkStart = 0; chunkStart < count; chunkStart += CHUNK_SIZE)
     {
-        // Perform exponential interpolation
-        size_t index = 0;
-        for (PDFFunction::iterator y = y_1; y != y_n; ++y, ++index)
+        const size_t chunkCount = qMin(CHUNK_SIZE, count - chunkStart);
+        const_iterator chunkX = x + chunkStart;
+        iterator chunkY = y + chunkStart * m_n;
+
+        for (size_t i = 0; i < chunkCount; ++i)
         {
-            *y = m_c0[index] + std::pow(x, m_exponent) * (m_c1[index] - m_c0[index]);
+            powers[i] = clampInput(0, chunkX[i]);
         }
-    }
-    else
-    {
-        // Perform linear interpolation
-        size_t index = 0;
-        for (PDFFunction::iterator y = y_1; y != y_n; ++y, ++index)
+
+        if (!m_isLinear)
         {
-            *y = mix(x, m_c0[index], m_c1[index]);
+            // Perform exponential interpolation
+            for (size_t i = 0; i < chunkCount; ++i)
+            {
+                powers[i] = std::pow(powers[i], m_exponent);
+            }
+
+            for (size_t i = 0; i < chunkCount; ++i)
+            {
+                iterator pointY = chunkY + i * m_n;
+                for (size_t index = 0; index < m_n; ++index)
+                {
+                    pointY[index] = m_c0[index] + powers[i] * (m_c1[index] - m_c0[index]);
+                }
+            }
+        }
+        else
+        {
+            // Perform linear interpolation
+            for (size_t i = 0; i < chunkCount; ++i)
+            {
+                iterator pointY = chunkY + i * m_n;
+                for (size_t index = 0; index < m_n; ++index)
+                {
+                    pointY[index] = mix(powers[i], m_c0[index], m_c1[index]);
+                }
+            }
         }
     }
 
     if (hasRange())
     {
-        size_t index = 0;
-        for (PDFFunction::iterator y = y_1; y != y_n; ++y, ++index)
+        for (size_t point = 0; point < count; ++point)
         {
-            *y = clampOutput(index, *y);
+            iterator pointY = y + point * m_n;
+            for (size_t index = 0; index < m_n; ++index)
+            {
+                pointY[index] = clampOutput(index, pointY[index]);
+            }
         }
     }
 
     return true;
 }
 
+bool PDFExponentialFunction::isContinuous() const
+{
+    return m_exponent >= 0.0 || m_domain[0] > 0.0 || m_domain[1] < 0.0;
+}
+
 PDFStitchingFunction::PDFStitchingFunction(uint32_t m, uint32_t n,
                                            std::vector<PDFReal>&& domain,
                                            std::vector<PDFReal>&& range,
@@ -594,28 +666,81 @@ PDFFunction::FunctionResult PDFStitchingFunction::apply(const_iterator x_1,
         return PDFTranslationContext::tr("Invalid number of output variables for function. Expected %1, provided %2.").arg(m_n).arg(n);
     }
 
-    Q_ASSERT(m == 1);
-    const PDFReal x = clampInput(0, *x_1);
+    return apply(x_1, y_1, 1);
+}
+
+PDFFunction::FunctionResult PDFStitchingFunction::apply(const_iterator x, iterator y, size_t count) const
+{
+    Q_ASSERT(m_m == 1);
+    Q_ASSERT(!m_partialFunctions.empty());
 
-    // First search for partial function, which defines our range. Use algorithm
-    // similar to the std::lower_bound.
-    auto it = std::lower_bound(m_partialFunctions.cbegin(), m_partialFunctions.cend(), x, [](const auto& partialFunction, PDFReal value) { return partialFunction.bound1 < value; });
-    if (it == m_partialFunctions.cend())
+    // Encoded input values of the points, which are evaluated together
+    constexpr size_t CHUNK_SIZE = 64;
+    std::array<PDFReal, CHUNK_SIZE> encoded = { };
+
+    FunctionResult result(true);
+    for (size_t point = 0; point < count;)
     {
-        --it;
-    }
-    const PartialFunction& function = *it;
+        const PDFReal value = clampInput(0, x[point]);
+
+        // First search for partial function, which defines our range. Use algorithm
+        // similar to the std::lower_bound.
+        auto it = std::lower_bound(m_partialFunctions.cbegin(), m_partialFunctions.cend(), value, [](const auto& partialFunction, PDFReal value) { return partialFunction.bound1 < value; });
+        if (it == m_partialFunctions.cend())
+        {
+            --it;
+        }
+        const PartialFunction& function = *it;
+
+        // Interval of the input values, for which the same function is selected
+        const PDFReal lowerBound = (it != m_partialFunctions.cbegin()) ? std::prev(it)->bound1 : -std::numeric_limits<PDFReal>::infinity();
+        const PDFReal upperBound = (std::next(it) != m_partialFunctions.cend()) ? function.bound1 : std::numeric_limits<PDFReal>::infinity();
+
+        // Encode the values of the consecutive points, which fall into the same
+        // partial function, into the input range of the function.
+        size_t pointCount = 0;
+        while (point + pointCount < count && pointCount < encoded.size())
+        {
+            const PDFReal currentValue = clampInput(0, x[point + pointCount]);
+            if (currentValue <= lowerBound || currentValue > upperBound)
+            {
+                break;
+            }
 
-    // Encode the value into the input range of the function
-    const PDFReal xEncoded = interpolate(x, function.bound0, function.bound1, function.encode0, function.encode1);
-    FunctionResult result = function.function->apply(&xEncoded, &xEncoded + 1, y_1, y_n);
+            encoded[pointCount++] = interpolate(currentValue, function.bound0, function.bound1, function.encode0, function.encode1);
+        }
+        Q_ASSERT(pointCount > 0);
+
+        iterator pointY = y + point * m_n;
+        if (function.function->getInputVariableCount() == 1 && function.function->getOutputVariableCount() == m_n)
+        {
+            result = function.function->apply(encoded.data(), pointY, pointCount);
+        }
+        else
+        {
+            for (size_t i = 0; i < pointCount && result; ++i)
+            {
+                result = function.function->apply(encoded.data() + i, encoded.data() + i + 1, pointY + i * m_n, pointY + (i + 1) * m_n);
+            }
+        }
+
+        if (!result)
+        {
+            return result;
+        }
+
+        point += pointCount;
+    }
 
     if (hasRange())
     {
-        size_t index = 0;
-        for (PDFFunction::iterator y = y_1; y != y_n; ++y, ++index)
+        for (size_t point = 0; point < count; ++point)
         {
-            *y = clampOutput(index, *y);
+            iterator pointY = y + point * m_n;
+            for (size_t index = 0; index < m_n; ++index)
+            {
+                pointY[index] = clampOutput(index, pointY[index]);
+            }
         }
     }
 
@@ -645,18 +770,29 @@ PDFFunction::FunctionResult PDFIdentityFunction::apply(const_iterator x_1,
     return true;
 }
 
+PDFFunction::FunctionResult PDFIdentityFunction::apply(const_iterator x, iterator y, size_t count) const
+{
+    std::copy(x, x + count, y);
+    return true;
+}
+
 class PDFPostScriptFunctionStack
 {
 public:
-    inline explicit PDFPostScriptFunctionStack() = default;
-
     using OperandObject = PDFPostScriptFunction::OperandObject;
     using InstructionPointer = PDFPostScriptFunction::InstructionPointer;
 
-    inline void pushReal(PDFReal value) { m_stack.push_back(OperandObject::createReal(value)); checkOverflow(); }
-    inline void pushInteger(PDFInteger value) { m_stack.push_back(OperandObject::createInteger(value)); checkOverflow(); }
-    inline void pushBoolean(bool value) { m_stack.push_back(OperandObject::createBoolean(value)); checkOverflow(); }
-    inline void pushInstructionPointer(InstructionPointer value) { m_stack.push_back(OperandObject::createInstructionPointer(value)); checkOverflow(); }
+    /// Maximal number of operands on the stack (limit is 100, according to the PDF 1.7 specification)
+    static constexpr size_t MAX_STACK_SIZE = 100;
+
+    /// Creates new operand stack
+    /// \param checkStack Check stack overflow and underflow. Checks can be turned off only
+    ///        for programs, whose stack depth has been resolved during compilation.
+    inline explicit PDFPostScriptFunctionStack(bool checkStack) : m_checkStack(checkStack) { }
+
+    inline void pushReal(PDFReal value) { push(OperandObject::createReal(value)); }
+    inline void pushInteger(PDFInteger value) { push(OperandObject::createInteger(value)); }
+    inline void pushBoolean(bool value) { push(OperandObject::createBoolean(value)); }
 
     /// Returns true, if integer operation should be performed instead of operation with real values.
     /// (two top elements are integer).
@@ -678,22 +814,18 @@ public:
     /// or value is not of type boolean).
     bool popBoolean();
 
-    /// Pops the instruction pointer from the stack (throw exception, if stack underflow occurs,
-    /// or value is not of type instruction pointer).
-    InstructionPointer popInstructionPointer();
-
     /// Pops number (integer is converted to the real value) form the stack (throw exception, if stack underflow occurs,
     /// or value is not of type real or integer).
     PDFReal popNumber();
 
     /// Returns true, if current value is real
-    bool isReal() const { checkUnderflow(); return m_stack.back().type == PDFPostScriptFunction::OperandType::Real; }
+    bool isReal() const { checkUnderflow(); return m_stack[m_size - 1].type == PDFPostScriptFunction::OperandType::Real; }
 
     /// Returns true, if current value is integer
-    bool isInteger() const { checkUnderflow(); return m_stack.back().type == PDFPostScriptFunction::OperandType::Integer; }
+    bool isInteger() const { checkUnderflow(); return m_stack[m_size - 1].type == PDFPostScriptFunction::OperandType::Integer; }
 
     /// Pops the current value
-    inline void pop() { checkUnderflow(); m_stack.pop_back(); }
+    inline void pop() { checkUnderflow(); --m_size; }
 
     /// Exchange the two top elements
     void exch();
@@ -715,26 +847,50 @@ public:
     void roll(PDFInteger n, PDFInteger j);
 
     /// Pushes the operand onto the stack
-    void push(const OperandObject& operand) { m_stack.push_back(operand); checkOverflow(); }
+    inline void push(const OperandObject& operand) { checkOverflow(); m_stack[m_size++] = operand; }
+
+    /// Returns operand on the given index (bottom of the stack has index 0)
+    const OperandObject& get(size_t index) const { return m_stack[index]; }
+
+    /// Removes all operands from the stack
+    void clear() { m_size = 0; }
 
     /// Returns true, if stack is empty
-    bool empty() const { return m_stack.empty(); }
+    bool empty() const { return m_size == 0; }
 
     /// Returns size of the stack
-    std::size_t size() const { return m_stack.size(); }
+    std::size_t size() const { return m_size; }
 
 private:
-    /// Check operand stack overflow (maximum limit is 100, according to the PDF 1.7 specification)
-    void checkOverflow() const;
+    /// Check operand stack overflow (if \p n values can be pushed onto the stack)
+    /// \param n Number of values to check
+    inline void checkOverflow(size_t n = 1) const
+    {
+        if (m_checkStack && m_size + n > MAX_STACK_SIZE)
+        {
+            reportOverflow();
+        }
+    }
 
     /// Check operand stack underflow (if stack has at least \p n values)
     /// \param n Number of values to check
-    void checkUnderflow(size_t n = 1) const;
+    inline void checkUnderflow(size_t n = 1) const
+    {
+        if (m_checkStack && m_size < n)
+        {
+            reportUnderflow();
+        }
+    }
+
+    [[noreturn]] void reportOverflow() const;
+    [[noreturn]] void reportUnderflow() const;
 
-    PDFFlatArray<OperandObject, 8> m_stack;
+    std::array<OperandObject, MAX_STACK_SIZE> m_stack;
+    size_t m_size = 0;
+    bool m_checkStack;
 };
 
-/// Executes the postscript program. Can throw PDFPostScriptFunctionException.
+/// Executes the compiled postscript program. Can throw PDFPostScriptFunctionException.
 class PDFPostScriptFunctionExecutor
 {
 public:
@@ -744,7 +900,9 @@ public:
     using CodeObject = PDFPostScriptFunction::CodeObject;
     using PDFIntegerUnsigned = std::make_unsigned<PDFInteger>::type;
 
-    /// Creates new postscript program
+    /// Creates new postscript program executor
+    /// \param program Compiled program
+    /// \param stack Operand stack
     explicit inline PDFPostScriptFunctionExecutor(const Program& program, Stack& stack) :
         m_program(program),
         m_stack(stack)
@@ -779,19 +937,12 @@ private:
 
 void PDFPostScriptFunctionExecutor::execute()
 {
-    Q_ASSERT(!m_program.empty());
-
-    std::stack<InstructionPointer> callStack;
-
-    InstructionPointer ip = 0; // First instruction is at zero
-    while (ip != PDFPostScriptFunction::INVALID_INSTRUCTION_POINTER)
+    // Compiled program is linear, instructions are executed in order, until jump appears
+    const InstructionPointer programSize = m_program.size();
+    InstructionPointer ip = 0;
+    while (ip < programSize)
     {
-        if (ip >= m_program.size())
-        {
-            throw PDFPostScriptFunction::PDFPostScriptFunctionException(PDFTranslationContext::tr("Invalid instruction pointer."));
-        }
-
-        const CodeObject& instruction = m_program[ip];
+        const CodeObject& instruction = m_program[ip++];
         switch (instruction.code)
         {
             case PDFPostScriptFunction::Code::Add:
@@ -1233,50 +1384,21 @@ void PDFPostScriptFunctionExecutor::execute()
                 break;
             }
 
-            case PDFPostScriptFunction::Code::Execute:
+            case PDFPostScriptFunction::Code::Jump:
             {
-                const PDFPostScriptFunctionStack::InstructionPointer callIp = m_stack.popInstructionPointer();
-                callStack.push(instruction.next);
-                ip = callIp;
-                continue;
+                ip = instruction.operand.instructionPointer;
+                break;
             }
 
-            case PDFPostScriptFunction::Code::If:
+            case PDFPostScriptFunction::Code::JumpIfFalse:
             {
-                const PDFPostScriptFunctionStack::InstructionPointer callIp = m_stack.popInstructionPointer();
-                const bool condition = m_stack.popBoolean();
-
-                if (condition)
+                if (!m_stack.popBoolean())
                 {
-                    // Call the if block
-                    callStack.push(instruction.next);
-                    ip = callIp;
-                    continue;
+                    ip = instruction.operand.instructionPointer;
                 }
-
                 break;
             }
 
-            case PDFPostScriptFunction::Code::IfElse:
-            {
-                const PDFPostScriptFunctionStack::InstructionPointer falsePartIp = m_stack.popInstructionPointer();
-                const PDFPostScriptFunctionStack::InstructionPointer truePartIp = m_stack.popInstructionPointer();
-                const bool condition = m_stack.popBoolean();
-
-                callStack.push(instruction.next);
-                if (condition)
-                {
-                    // Call the if part
-                    ip = truePartIp;
-                }
-                else
-                {
-                    // Call the else part
-                    ip = falsePartIp;
-                }
-
-                continue;
-            }
             case PDFPostScriptFunction::Code::Pop:
             {
                 m_stack.pop();
@@ -1340,64 +1462,302 @@ void PDFPostScriptFunctionExecutor::execute()
             }
 
             case PDFPostScriptFunction::Code::Call:
+            case PDFPostScriptFunction::Code::Return:
+            case PDFPostScriptFunction::Code::Execute:
+            case PDFPostScriptFunction::Code::If:
+            case PDFPostScriptFunction::Code::IfElse:
+            {
+                // Blocks are resolved by the compiler, these operators remain in the compiled
+                // program only, if they are not used with the block.
+                throw PDFPostScriptFunction::PDFPostScriptFunctionException(PDFTranslationContext::tr("Instruction pointer expected (PostScript engine)."));
+            }
+
+            case PDFPostScriptFunction::Code::Push:
             {
-                Q_ASSERT(instruction.operand.type == PDFPostScriptFunction::OperandType::InstructionPointer);
-                m_stack.pushInstructionPointer(instruction.operand.instructionPointer);
+                m_stack.push(instruction.operand);
                 break;
             }
+        }
+    }
+}
 
-            case PDFPostScriptFunction::Code::Return:
+/// Compiles the parsed postscript program into the linear program. Blocks are inlined,
+/// if/ifelse operators are replaced by jumps, and operators with constant operands are
+/// evaluated during compilation. Can throw PDFException.
+class PDFPostScriptFunctionCompiler
+{
+public:
+    using Program = PDFPostScriptFunction::Program;
+    using Code = PDFPostScriptFunction::Code;
+    using CodeObject = PDFPostScriptFunction::CodeObject;
+    using OperandObject = PDFPostScriptFunction::OperandObject;
+    using InstructionPointer = PDFPostScriptFunction::InstructionPointer;
+
+    explicit inline PDFPostScriptFunctionCompiler(const Program& program) :
+        m_program(program)
+    {
+
+    }
+
+    /// Compiles the program
+    Program compile();
+
+    /// Returns number of operands, which operator consumes, if it can be evaluated
+    /// during compilation (operator doesn't depend on anything else than its operands).
+    /// For other operators, -1 is returned.
+    static int getConstantOperandCount(Code code);
+
+private:
+    /// Maximal nesting of the blocks
+    static constexpr int MAX_BLOCK_NESTING = 256;
+
+    /// Compiles the block (or main program) starting at the instruction pointer
+    void compileBlock(InstructionPointer ip, int nesting);
+
+    /// Returns instruction of the parsed program (or nullptr, if instruction pointer is invalid)
+    const CodeObject* getInstruction(InstructionPointer ip) const { return ip < m_program.size() ? &m_program[ip] : nullptr; }
+
+    /// Appends instruction to the compiled program. If operands of the instruction
+    /// are constants, instruction is evaluated and replaced by its result.
+    void emit(const CodeObject& instruction);
+
+    /// Appends jump instruction, target of the jump is set later
+    InstructionPointer emitJump(Code code);
+
+    /// Sets target of the jump to the end of the compiled program
+    void setJumpTarget(InstructionPointer jumpIp);
+
+    const Program& m_program;
+    Program m_compiledProgram;
+
+    /// Instructions before this instruction pointer can't be evaluated with
+    /// following operators, because they can be skipped by a jump.
+    InstructionPointer m_constantBarrier = 0;
+};
+
+PDFPostScriptFunction::Program PDFPostScriptFunctionCompiler::compile()
+{
+    compileBlock(0, 0);
+
+    // Instructions are executed in order, next instruction pointer is set just for consistency
+    for (size_t i = 0; i < m_compiledProgram.size(); ++i)
+    {
+        m_compiledProgram[i].next = i + 1;
+    }
+
+    if (!m_compiledProgram.empty())
+    {
+        m_compiledProgram.back().next = PDFPostScriptFunction::INVALID_INSTRUCTION_POINTER;
+    }
+
+    m_compiledProgram.shrink_to_fit();
+    return qMove(m_compiledProgram);
+}
+
+int PDFPostScriptFunctionCompiler::getConstantOperandCount(Code code)
+{
+    switch (code)
+    {
+        case Code::True:
+        case Code::False:
+            return 0;
+
+        case Code::Neg:
+        case Code::Abs:
+        case Code::Ceiling:
+        case Code::Floor:
+        case Code::Round:
+        case Code::Truncate:
+        case Code::Sqrt:
+        case Code::Sin:
+        case Code::Cos:
+        case Code::Ln:
+        case Code::Log:
+        case Code::Cvi:
+        case Code::Cvr:
+        case Code::Not:
+        case Code::Pop:
+        case Code::Dup:
+            return 1;
+
+        case Code::Add:
+        case Code::Sub:
+        case Code::Mul:
+        case Code::Div:
+        case Code::Idiv:
+        case Code::Mod:
+        case Code::Atan:
+        case Code::Exp:
+        case Code::Eq:
+        case Code::Ne:
+        case Code::Gt:
+        case Code::Ge:
+        case Code::Lt:
+        case Code::Le:
+        case Code::And:
+        case Code::Or:
+        case Code::Xor:
+        case Code::Bitshift:
+        case Code::Exch:
+            return 2;
+
+        default:
+            break;
+    }
+
+    return -1;
+}
+
+void PDFPostScriptFunctionCompiler::compileBlock(InstructionPointer ip, int nesting)
+{
+    if (nesting > MAX_BLOCK_NESTING)
+    {
+        throw PDFException(PDFTranslationContext::tr("Blocks are nested too deeply (PostScript function)."));
+    }
+
+    while (ip != PDFPostScriptFunction::INVALID_INSTRUCTION_POINTER)
+    {
+        const CodeObject* instruction = getInstruction(ip);
+        if (!instruction)
+        {
+            throw PDFException(PDFTranslationContext::tr("Invalid program (PostScript function)."));
+        }
+
+        switch (instruction->code)
+        {
+            case Code::Return:
+                return;
+
+            case Code::Call:
             {
-                if (callStack.empty())
+                const InstructionPointer blockIp = instruction->operand.instructionPointer;
+                const CodeObject* nextInstruction = getInstruction(instruction->next);
+                const CodeObject* nextNextInstruction = nextInstruction ? getInstruction(nextInstruction->next) : nullptr;
+
+                if (nextInstruction && nextInstruction->code == Code::Execute)
                 {
-                    throw PDFPostScriptFunction::PDFPostScriptFunctionException(PDFTranslationContext::tr("Call stack underflow (PostScript engine)."));
+                    // Block is executed unconditionally
+                    compileBlock(blockIp, nesting + 1);
+                    ip = nextInstruction->next;
+                    continue;
                 }
 
-                ip = callStack.top();
-                callStack.pop();
-                continue;
+                if (nextInstruction && nextInstruction->code == Code::If)
+                {
+                    const InstructionPointer jumpIp = emitJump(Code::JumpIfFalse);
+                    compileBlock(blockIp, nesting + 1);
+                    setJumpTarget(jumpIp);
+                    ip = nextInstruction->next;
+                    continue;
+                }
+
+                if (nextInstruction && nextInstruction->code == Code::Call && nextNextInstruction && nextNextInstruction->code == Code::IfElse)
+                {
+                    const InstructionPointer falsePartJumpIp = emitJump(Code::JumpIfFalse);
+                    compileBlock(blockIp, nesting + 1);
+                    const InstructionPointer endJumpIp = emitJump(Code::Jump);
+                    setJumpTarget(falsePartJumpIp);
+                    compileBlock(nextInstruction->operand.instructionPointer, nesting + 1);
+                    setJumpTarget(endJumpIp);
+                    ip = nextNextInstruction->next;
+                    continue;
+                }
+
+                // Block is not used by any operator. It should not happen, because parser
+                // inserts execute instruction after such blocks. Executor reports an error.
+                m_compiledProgram.push_back(*instruction);
+                ip = instruction->next;
+                break;
             }
 
-            case PDFPostScriptFunction::Code::Push:
+            default:
             {
-                m_stack.push(instruction.operand);
+                emit(*instruction);
+                ip = instruction->next;
                 break;
             }
         }
+    }
+}
+
+void PDFPostScriptFunctionCompiler::emit(const CodeObject& instruction)
+{
+    const int operandCount = getConstantOperandCount(instruction.code);
+    if (operandCount >= 0 && m_compiledProgram.size() >= m_constantBarrier + operandCount)
+    {
+        auto itOperandsBegin = std::prev(m_compiledProgram.end(), operandCount);
+        const bool isConstant = std::all_of(itOperandsBegin, m_compiledProgram.end(), [](const CodeObject& codeObject) { return codeObject.code == Code::Push; });
+
+        if (isConstant)
+        {
+            Program constantProgram(itOperandsBegin, m_compiledProgram.end());
+            constantProgram.push_back(instruction);
+
+            try
+            {
+                PDFPostScriptFunctionStack stack(true);
+                PDFPostScriptFunctionExecutor executor(constantProgram, stack);
+                executor.execute();
 
-        // Move to the next instruction
-        ip = instruction.next;
+                // Replace the operator and its operands by the result
+                m_compiledProgram.erase(itOperandsBegin, m_compiledProgram.end());
+                for (size_t i = 0; i < stack.size(); ++i)
+                {
+                    m_compiledProgram.emplace_back(stack.get(i), PDFPostScriptFunction::INVALID_INSTRUCTION_POINTER);
+                }
+                return;
+            }
+            catch (const PDFPostScriptFunction::PDFPostScriptFunctionException&)
+            {
+                // Operator can't be evaluated with these operands, error
+                // will be reported, when program is executed.
+            }
+        }
     }
+
+    m_compiledProgram.push_back(instruction);
+}
+
+PDFPostScriptFunctionCompiler::InstructionPointer PDFPostScriptFunctionCompiler::emitJump(Code code)
+{
+    const InstructionPointer jumpIp = m_compiledProgram.size();
+    m_compiledProgram.emplace_back(code, PDFPostScriptFunction::INVALID_INSTRUCTION_POINTER);
+    m_compiledProgram.back().operand = OperandObject::createInstructionPointer(PDFPostScriptFunction::INVALID_INSTRUCTION_POINTER);
+    m_constantBarrier = m_compiledProgram.size();
+    return jumpIp;
+}
+
+void PDFPostScriptFunctionCompiler::setJumpTarget(InstructionPointer jumpIp)
+{
+    m_compiledProgram[jumpIp].operand = OperandObject::createInstructionPointer(m_compiledProgram.size());
+    m_constantBarrier = m_compiledProgram.size();
 }
 
 bool PDFPostScriptFunctionStack::isBinaryOperationInteger() const
 {
     checkUnderflow(2);
 
-    const size_t size = m_stack.size();
-    return m_stack[size - 1].type == PDFPostScriptFunction::OperandType::Integer &&
-            m_stack[size - 2].type == PDFPostScriptFunction::OperandType::Integer;
+    return m_stack[m_size - 1].type == PDFPostScriptFunction::OperandType::Integer &&
+            m_stack[m_size - 2].type == PDFPostScriptFunction::OperandType::Integer;
 }
 
 bool PDFPostScriptFunctionStack::isBinaryOperationBoolean() const
 {
     checkUnderflow(2);
 
-    const size_t size = m_stack.size();
-    return m_stack[size - 1].type == PDFPostScriptFunction::OperandType::Boolean &&
-            m_stack[size - 2].type == PDFPostScriptFunction::OperandType::Boolean;
+    return m_stack[m_size - 1].type == PDFPostScriptFunction::OperandType::Boolean &&
+            m_stack[m_size - 2].type == PDFPostScriptFunction::OperandType::Boolean;
 }
 
 PDFReal PDFPostScriptFunctionStack::popReal()
 {
     checkUnderflow();
 
-    const PDFPostScriptFunction::OperandObject& topElement = m_stack.back();
+    const PDFPostScriptFunction::OperandObject& topElement = m_stack[m_size - 1];
     if (topElement.type == PDFPostScriptFunction::OperandType::Real)
     {
-        const PDFReal value = topElement.realNumber;
-        m_stack.pop_back();
-        return value;
+        --m_size;
+        return topElement.realNumber;
     }
     else
     {
@@ -1409,12 +1769,11 @@ PDFInteger PDFPostScriptFunctionStack::popInteger()
 {
     checkUnderflow();
 
-    const PDFPostScriptFunction::OperandObject& topElement = m_stack.back();
+    const PDFPostScriptFunction::OperandObject& topElement = m_stack[m_size - 1];
     if (topElement.type == PDFPostScriptFunction::OperandType::Integer)
     {
-        const PDFInteger value = topElement.integerNumber;
-        m_stack.pop_back();
-        return value;
+        --m_size;
+        return topElement.integerNumber;
     }
     else
     {
@@ -1426,12 +1785,11 @@ bool PDFPostScriptFunctionStack::popBoolean()
 {
     checkUnderflow();
 
-    const PDFPostScriptFunction::OperandObject& topElement = m_stack.back();
+    const PDFPostScriptFunction::OperandObject& topElement = m_stack[m_size - 1];
     if (topElement.type == PDFPostScriptFunction::OperandType::Boolean)
     {
-        const bool value = topElement.boolean;
-        m_stack.pop_back();
-        return value;
+        --m_size;
+        return topElement.boolean;
     }
     else
     {
@@ -1439,39 +1797,20 @@ bool PDFPostScriptFunctionStack::popBoolean()
     }
 }
 
-PDFPostScriptFunctionStack::InstructionPointer PDFPostScriptFunctionStack::popInstructionPointer()
-{
-    checkUnderflow();
-
-    const PDFPostScriptFunction::OperandObject& topElement = m_stack.back();
-    if (topElement.type == PDFPostScriptFunction::OperandType::InstructionPointer)
-    {
-        const InstructionPointer value = topElement.instructionPointer;
-        m_stack.pop_back();
-        return value;
-    }
-    else
-    {
-        throw PDFPostScriptFunction::PDFPostScriptFunctionException(PDFTranslationContext::tr("Instruction pointer expected (PostScript engine)."));
-    }
-}
-
 PDFReal PDFPostScriptFunctionStack::popNumber()
 {
     checkUnderflow();
 
-    const PDFPostScriptFunction::OperandObject& topElement = m_stack.back();
+    const PDFPostScriptFunction::OperandObject& topElement = m_stack[m_size - 1];
     if (topElement.type == PDFPostScriptFunction::OperandType::Real)
     {
-        const PDFReal value = topElement.realNumber;
-        m_stack.pop_back();
-        return value;
+        --m_size;
+        return topElement.realNumber;
     }
     else if (topElement.type == PDFPostScriptFunction::OperandType::Integer)
     {
-        const PDFInteger value = topElement.integerNumber;
-        m_stack.pop_back();
-        return value;
+        --m_size;
+        return topElement.integerNumber;
     }
     else
     {
@@ -1482,16 +1821,16 @@ PDFReal PDFPostScriptFunctionStack::popNumber()
 void PDFPostScriptFunctionStack::exch()
 {
     checkUnderflow(2);
-
-    const size_t size = m_stack.size();
-    std::swap(m_stack[size - 2], m_stack[size - 1]);
+    std::swap(m_stack[m_size - 2], m_stack[m_size - 1]);
 }
 
 void PDFPostScriptFunctionStack::dup()
 {
     checkUnderflow();
-    m_stack.push_back(m_stack.back());
     checkOverflow();
+
+    m_stack[m_size] = m_stack[m_size - 1];
+    ++m_size;
 }
 
 void PDFPostScriptFunctionStack::copy(PDFInteger n)
@@ -1499,13 +1838,11 @@ void PDFPostScriptFunctionStack::copy(PDFInteger n)
     Q_ASSERT(n > 0);
 
     checkUnderflow(static_cast<size_t>(n));
+    checkOverflow(static_cast<size_t>(n));
 
-    size_t startIndex = m_stack.size() - n;
-    for (size_t i = 0; i < static_cast<size_t>(n); ++i)
-    {
-        m_stack.push_back(m_stack[startIndex + i]);
-        checkOverflow();
-    }
+    auto it = std::next(m_stack.begin(), m_size);
+    std::copy(std::prev(it, n), it, it);
+    m_size += n;
 }
 
 void PDFPostScriptFunctionStack::index(PDFInteger n)
@@ -1513,7 +1850,10 @@ void PDFPostScriptFunctionStack::index(PDFInteger n)
     Q_ASSERT(n >= 0);
 
     checkUnderflow(static_cast<size_t>(n) + 1);
-    m_stack.push_back(m_stack[m_stack.size() - 1 - n]);
+    checkOverflow();
+
+    m_stack[m_size] = m_stack[m_size - 1 - n];
+    ++m_size;
 }
 
 void PDFPostScriptFunctionStack::roll(PDFInteger n, PDFInteger j)
@@ -1534,46 +1874,29 @@ void PDFPostScriptFunctionStack::roll(PDFInteger n, PDFInteger j)
 
     checkUnderflow(n);
 
-    // Load operands into temporary array
-    const size_t firstIndexOnStack = m_stack.size() - n;
-    std::vector<OperandObject> operands(n);
-    for (size_t i = 0; i < static_cast<size_t>(n); ++i)
-    {
-        operands[i] = m_stack[firstIndexOnStack + i];
-    }
+    auto itEnd = std::next(m_stack.begin(), m_size);
+    auto itBegin = std::prev(itEnd, n);
 
     if (j > 0)
     {
         // Rotate left j times
-        std::rotate(operands.begin(), operands.end() - j, operands.end());
+        std::rotate(itBegin, std::prev(itEnd, j), itEnd);
     }
     else
     {
         // Rotate right j times
-        std::rotate(operands.rbegin(), operands.rend() + j, operands.rend());
-    }
-
-    // Load data back from temporary array
-    for (size_t i = 0; i < static_cast<size_t>(n); ++i)
-    {
-        m_stack[firstIndexOnStack + i] = operands[i];
+        std::rotate(itBegin, std::next(itBegin, -j), itEnd);
     }
 }
 
-void PDFPostScriptFunctionStack::checkOverflow() const
+void PDFPostScriptFunctionStack::reportOverflow() const
 {
-    if (m_stack.size() > 100)
-    {
-        throw PDFPostScriptFunction::PDFPostScriptFunctionException(PDFTranslationContext::tr("Stack overflow occured (PostScript engine)."));
-    }
+    throw PDFPostScriptFunction::PDFPostScriptFunctionException(PDFTranslationContext::tr("Stack overflow occured (PostScript engine)."));
 }
 
-void PDFPostScriptFunctionStack::checkUnderflow(size_t n) const
+void PDFPostScriptFunctionStack::reportUnderflow() const
 {
-    if (m_stack.size() < n)
-    {
-        throw PDFPostScriptFunction::PDFPostScriptFunctionException(PDFTranslationContext::tr("Stack underflow occured (PostScript engine)."));
-    }
+    throw PDFPostScriptFunction::PDFPostScriptFunctionException(PDFTranslationContext::tr("Stack underflow occured (PostScript engine)."));
 }
 
 PDFPostScriptFunction::Code PDFPostScriptFunction::getCode(const QByteArray& byteArray)
@@ -1644,9 +1967,10 @@ PDFPostScriptFunction::Code PDFPostScriptFunction::getCode(const QByteArray& byt
 
 PDFPostScriptFunction::PDFPostScriptFunction(uint32_t m, uint32_t n, std::vector<PDFReal>&& domain, std::vector<PDFReal>&& range, PDFPostScriptFunction::Program&& program) :
     PDFFunction(m, n, std::move(domain), std::move(range)),
-    m_program(std::move(program))
+    m_program(compileProgram(program)),
+    m_isStackDepthResolved(isStackDepthResolved(m_program, m, n))
 {
-    Q_ASSERT(!m_program.empty());
+    Q_ASSERT(!program.empty());
 }
 
 PDFPostScriptFunction::~PDFPostScriptFunction()
@@ -1678,25 +2002,25 @@ PDFPostScriptFunction::Program PDFPostScriptFunction::parseProgram(const QByteAr
         {
             case PDFLexicalAnalyzer::TokenType::Boolean:
             {
-                result.emplace_back(OperandObject::createBoolean(token.data.toBool()), result.size() + 1);
+                result.emplace_back(OperandObject::createBoolean(token.getBool()), result.size() + 1);
                 break;
             }
 
             case PDFLexicalAnalyzer::TokenType::Integer:
             {
-                result.emplace_back(OperandObject::createInteger(token.data.toLongLong()), result.size() + 1);
+                result.emplace_back(OperandObject::createInteger(token.getInteger()), result.size() + 1);
                 break;
             }
 
             case PDFLexicalAnalyzer::TokenType::Real:
             {
-                result.emplace_back(OperandObject::createReal(token.data.toDouble()), result.size() + 1);
+                result.emplace_back(OperandObject::createReal(token.getReal()), result.size() + 1);
                 break;
             }
 
             case PDFLexicalAnalyzer::TokenType::Command:
             {
-                QByteArray command = token.data.toByteArray();
+                QByteArray command = token.getBytes();
                 if (command == "{")
                 {
                     // Opening bracket - means start of block
@@ -1820,6 +2144,190 @@ PDFPostScriptFunction::Program PDFPostScriptFunction::parseProgram(const QByteAr
     return result;
 }
 
+PDFPostScriptFunction::Program PDFPostScriptFunction::compileProgram(const Program& program)
+{
+    PDFPostScriptFunctionCompiler compiler(program);
+    return compiler.compile();
+}
+
+bool PDFPostScriptFunction::isStackDepthResolved(const Program& program, uint32_t m, uint32_t n)
+{
+    constexpr int UNKNOWN_DEPTH = -1;
+    constexpr int MAX_DEPTH = int(PDFPostScriptFunctionStack::MAX_STACK_SIZE);
+
+    if (m > PDFPostScriptFunctionStack::MAX_STACK_SIZE)
+    {
+        return false;
+    }
+
+    // Stack depth before each instruction (last item is depth at the end of the program)
+    std::vector<int> depths(program.size() + 1, UNKNOWN_DEPTH);
+    std::vector<bool> isJumpTarget(program.size() + 1, false);
+
+    for (InstructionPointer ip = 0; ip < program.size(); ++ip)
+    {
+        const CodeObject& instruction = program[ip];
+        if (instruction.code == Code::Jump || instruction.code == Code::JumpIfFalse)
+        {
+            const InstructionPointer target = instruction.operand.instructionPointer;
+            if (target <= ip || target > program.size())
+            {
+                return false;
+            }
+            isJumpTarget[target] = true;
+        }
+    }
+
+    auto setDepth = [&depths](InstructionPointer ip, int depth)
+    {
+        if (depths[ip] == UNKNOWN_DEPTH)
+        {
+            depths[ip] = depth;
+            return true;
+        }
+
+        // Stack depth must be same for all paths
+        return depths[ip] == depth;
+    };
+
+    // Returns constant integer pushed by the instruction before the current instruction
+    // (offset 1 is the previous instruction). Instructions can't be jump targets.
+    auto getConstantOperand = [&program, &isJumpTarget](InstructionPointer ip, InstructionPointer offset, PDFInteger& value)
+    {
+        if (ip < offset)
+        {
+            return false;
+        }
+
+        for (InstructionPointer i = ip - offset + 1; i <= ip; ++i)
+        {
+            if (isJumpTarget[i])
+            {
+                return false;
+            }
+        }
+
+        const CodeObject& instruction = program[ip - offset];
+        if (instruction.code == Code::Push && instruction.operand.type == OperandType::Integer)
+        {
+            value = instruction.operand.integerNumber;
+            return true;
+        }
+
+        return false;
+    };
+
+    depths[0] = int(m);
+    for (InstructionPointer ip = 0; ip < program.size(); ++ip)
+    {
+        const int depth = depths[ip];
+        if (depth == UNKNOWN_DEPTH)
+        {
+            // Unreachable instruction
+            continue;
+        }
+
+        const CodeObject& instruction = program[ip];
+        const int constantOperandCount = PDFPostScriptFunctionCompiler::getConstantOperandCount(instruction.code);
+
+        int requiredDepth = 0;
+        int depthChange = 0;
+
+        switch (instruction.code)
+        {
+            case Code::Push:
+                depthChange = 1;
+                break;
+
+            case Code::Dup:
+                requiredDepth = 1;
+                depthChange = 1;
+                break;
+
+            case Code::Pop:
+                requiredDepth = 1;
+                depthChange = -1;
+                break;
+
+            case Code::Exch:
+                requiredDepth = 2;
+                break;
+
+            case Code::Copy:
+            case Code::Index:
+            {
+                PDFInteger count = 0;
+                if (!getConstantOperand(ip, 1, count) || count < 0 || count >= MAX_DEPTH)
+                {
+                    return false;
+                }
+
+                requiredDepth = (instruction.code == Code::Copy) ? int(count) + 1 : int(count) + 2;
+                depthChange = (instruction.code == Code::Copy) ? int(count) - 1 : 0;
+                break;
+            }
+
+            case Code::Roll:
+            {
+                PDFInteger count = 0;
+                PDFInteger shift = 0;
+                if (!getConstantOperand(ip, 1, shift) || !getConstantOperand(ip, 2, count) || count < 0 || count >= MAX_DEPTH)
+                {
+                    return false;
+                }
+
+                requiredDepth = int(count) + 2;
+                depthChange = -2;
+                break;
+            }
+
+            case Code::Jump:
+            {
+                if (!setDepth(instruction.operand.instructionPointer, depth))
+                {
+                    return false;
+                }
+                continue;
+            }
+
+            case Code::JumpIfFalse:
+            {
+                requiredDepth = 1;
+                depthChange = -1;
+
+                if (depth < requiredDepth || !setDepth(instruction.operand.instructionPointer, depth - 1))
+                {
+                    return false;
+                }
+                break;
+            }
+
+            default:
+            {
+                if (constantOperandCount < 0)
+                {
+                    // Block operators (they remain only in invalid programs)
+                    return false;
+                }
+
+                // Operators consuming operands and pushing one result
+                requiredDepth = constantOperandCount;
+                depthChange = 1 - constantOperandCount;
+                break;
+            }
+        }
+
+        const int newDepth = depth + depthChange;
+        if (depth < requiredDepth || newDepth > MAX_DEPTH || !setDepth(ip + 1, newDepth))
+        {
+            return false;
+        }
+    }
+
+    // All outputs must be on the stack at the end of the program
+    return depths.back() == int(n);
+}
+
 PDFFunction::FunctionResult PDFPostScriptFunction::apply(const_iterator x_1, const_iterator x_m, iterator y_1, iterator y_n) const
 {
     const size_t m = std::distance(x_1, x_m);
@@ -1834,42 +2342,162 @@ PDFFunction::FunctionResult PDFPostScriptFunction::apply(const_iterator x_1, con
         return PDFTranslationContext::tr("Invalid number of output variables for function. Expected %1, provided %2.").arg(m_n).arg(n);
     }
 
+    return apply(x_1, y_1, 1);
+}
+
+PDFFunction::FunctionResult PDFPostScriptFunction::apply(const_iterator x, iterator y, size_t count) const
+{
     try
     {
-        PDFPostScriptFunctionStack stack;
+        PDFPostScriptFunctionStack stack(!m_isStackDepthResolved);
+        PDFPostScriptFunctionExecutor executor(m_program, stack);
 
-        // Insert input values
-        for (uint32_t i = 0; i < m; ++i)
+        for (size_t point = 0; point < count; ++point, x += m_m, y += m_n)
         {
-            const PDFReal x = *std::next(x_1, i);
-            const PDFReal xClamped = clampInput(i, x);
-            stack.pushReal(xClamped);
+            stack.clear();
+
+            // Insert input values
+            for (uint32_t i = 0; i < m_m; ++i)
+            {
+                stack.pushReal(clampInput(i, x[i]));
+            }
+
+            executor.execute();
+
+            for (uint32_t i = m_n; i > 0; --i)
+            {
+                y[i - 1] = clampOutput(i - 1, stack.popNumber());
+            }
+
+            if (!stack.empty())
+            {
+                return PDFTranslationContext::tr("Stack contains more values, than output size (%1 remains) (PostScript function).").arg(stack.size());
+            }
         }
+    }
+    catch (const PDFPostScriptFunction::PDFPostScriptFunctionException& exception)
+    {
+        return exception.getMessage();
+    }
 
-        PDFPostScriptFunctionExecutor executor(m_program, stack);
-        executor.execute();
+    return true;
+}
+
+bool PDFStitchingFunction::isContinuous() const
+{
+    std::vector<PDFReal> leftValues(m_n, 0.0);
+    std::vector<PDFReal> rightValues(m_n, 0.0);
+
+    for (size_t i = 0; i < m_partialFunctions.size(); ++i)
+    {
+        const PartialFunction& partialFunction = m_partialFunctions[i];
+        if (!partialFunction.function->isContinuous())
+        {
+            return false;
+        }
 
-        uint32_t i = static_cast<uint32_t>(n);
-        auto it = std::make_reverse_iterator(y_n);
-        auto itEnd = std::make_reverse_iterator(y_1);
-        for (; it != itEnd; ++it)
+        if (i == 0)
         {
-            const PDFReal y = stack.popNumber();
-            const PDFReal yClamped = clampOutput(--i, y);
-            *it = yClamped;
+            continue;
         }
 
-        if (!stack.empty())
+        // Compare values of the previous and current function at the common bound
+        const PartialFunction& previousPartialFunction = m_partialFunctions[i - 1];
+        if (!previousPartialFunction.function->apply(&previousPartialFunction.encode1, &previousPartialFunction.encode1 + 1, leftValues.data(), leftValues.data() + leftValues.size()) ||
+            !partialFunction.function->apply(&partialFunction.encode0, &partialFunction.encode0 + 1, rightValues.data(), rightValues.data() + rightValues.size()))
         {
-            return PDFTranslationContext::tr("Stack contains more values, than output size (%1 remains) (PostScript function).").arg(stack.size());
+            return false;
+        }
+
+        for (size_t j = 0; j < m_n; ++j)
+        {
+            if (std::abs(leftValues[j] - rightValues[j]) > CONTINUITY_TOLERANCE)
+            {
+                return false;
+            }
         }
     }
-    catch (const PDFPostScriptFunction::PDFPostScriptFunctionException& exception)
+
+    return true;
+}
+
+bool PDFFunctionLookupTable::isApproximationAccurate(const std::vector<PDFFunctionPtr>& functions)
+{
+    return std::all_of(functions.cbegin(), functions.cend(), [](const PDFFunctionPtr& function) { return function && function->isContinuous(); });
+}
+
+PDFFunctionLookupTable PDFFunctionLookupTable::create(const std::vector<PDFFunctionPtr>& functions,
+                                                      size_t n,
+                                                      PDFReal xMin,
+                                                      PDFReal xMax,
+                                                      size_t sampleCount)
+{
+    PDFFunctionLookupTable table;
+
+    const bool isSingleFunction = functions.size() == 1;
+    if (n == 0 || sampleCount < 2 || functions.empty() || (!isSingleFunction && functions.size() != n))
     {
-        return exception.getMessage();
+        return table;
     }
 
-    return true;
+    std::vector<PDFReal> samples((sampleCount + 1) * n, 0.0);
+    for (size_t i = 0; i < sampleCount; ++i)
+    {
+        const PDFReal x = (i + 1 < sampleCount) ? interpolate(i, 0.0, sampleCount - 1, xMin, xMax) : xMax;
+        PDFFunction::iterator y = samples.data() + i * n;
+
+        if (isSingleFunction)
+        {
+            if (!functions.front()->apply(&x, &x + 1, y, y + n))
+            {
+                return table;
+            }
+        }
+        else
+        {
+            for (size_t j = 0; j < n; ++j)
+            {
+                if (!functions[j]->apply(&x, &x + 1, y + j, y + j + 1))
+                {
+                    return table;
+                }
+            }
+        }
+    }
+
+    // Copy last sample, so we do not have to check the end of the table, when interpolating
+    std::copy(samples.cbegin() + (sampleCount - 1) * n, samples.cbegin() + sampleCount * n, samples.begin() + sampleCount * n);
+
+    table.m_n = n;
+    table.m_sampleCount = sampleCount;
+    table.m_xMin = xMin;
+    table.m_scale = (xMin != xMax) ? PDFReal(sampleCount - 1) / (xMax - xMin) : 0.0;
+    table.m_samples = qMove(samples);
+    return table;
+}
+
+void PDFFunctionLookupTable::apply(PDFReal x, PDFFunction::iterator y) const
+{
+    Q_ASSERT(isValid());
+
+    const PDFReal position = qBound<PDFReal>(0.0, (x - m_xMin) * m_scale, m_sampleCount - 1);
+    const size_t index = static_cast<size_t>(position);
+    const PDFReal t = position - index;
+
+    const PDFReal* sample0 = m_samples.data() + index * m_n;
+    const PDFReal* sample1 = sample0 + m_n;
+    for (size_t i = 0; i < m_n; ++i)
+    {
+        y[i] = sample0[i] + t * (sample1[i] - sample0[i]);
+    }
+}
+
+void PDFFunctionLookupTable::apply(PDFFunction::const_iterator x, PDFFunction::iterator y, size_t count) const
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        apply(x[i], y + i * m_n);
+    }
 }
 
 }   // namespace pdf
@@ -86,6 +86,20 @@ public:
     /// \param y_n Iterator to the end of the output values (one item after last value)
     virtual FunctionResult apply(const_iterator x_1, const_iterator x_m, iterator y_1, iterator y_n) const = 0;
 
+    /// Transforms array of input points to the array of output points. Input array
+    /// contains m values for each point, output array receives n values for each
+    /// point. Default implementation evaluates points one by one, functions
+    /// can override it to evaluate all points at once.
+    /// \param x Input values (count * m values)
+    /// \param y Output values (count * n values)
+    /// \param count Number of points
+    virtual FunctionResult apply(const_iterator x, iterator y, size_t count) const;
+
+    /// Returns true, if function is known to be continuous in its domain (it has
+    /// no hard steps). Then it can be approximated by linear interpolation of its
+    /// samples. Default implementation returns false.
+    virtual bool isContinuous() const { return false; }
+
     /// Creates function from the object. If error occurs, exception is thrown.
     /// \param document Document, owning the pdf object
     /// \param object Object defining the function
@@ -143,6 +157,15 @@ public:
     /// \param y_1 Iterator to the first output value
     /// \param y_n Iterator to the end of the output values (one item after last value)
     virtual FunctionResult apply(const_iterator x_1, const_iterator x_m, iterator y_1, iterator y_n) const override;
+
+    /// Copies input values to the output values. Each point
+    /// has exactly one value.
+    /// \param x Input values (count values)
+    /// \param y Output values (count values)
+    /// \param count Number of points
+    virtual FunctionResult apply(const_iterator x, iterator y, size_t count) const override;
+
+    virtual bool isContinuous() const override { return true; }
 };
 
 /// Sampled function (Type 0 function).
@@ -182,6 +205,17 @@ public:
     /// \param y_n Iterator to the end of the output values (one item after last value)
     virtual FunctionResult apply(const_iterator x_1, const_iterator x_m, iterator y_1, iterator y_n) const override;
 
+    /// Transforms array of input points to the array of output points. Input array
+    /// contains m values for each point, output array receives n values for each
+    /// point.
+    /// \param x Input values (count * m values)
+    /// \param y Output values (count * n values)
+    /// \param count Number of points
+    virtual FunctionResult apply(const_iterator x, iterator y, size_t count) const override;
+
+    /// Samples are always linearly interpolated, so function is continuous
+    virtual bool isContinuous() const override { return true; }
+
     PDFInteger getOrder() const { return m_order; }
 
 private:
@@ -244,6 +278,17 @@ public:
     /// \param y_n Iterator to the end of the output values (one item after last value)
     virtual FunctionResult apply(const_iterator x_1, const_iterator x_m, iterator y_1, iterator y_n) const override;
 
+    /// Transforms array of input points to the array of output points. Input array
+    /// contains m values for each point, output array receives n values for each
+    /// point.
+    /// \param x Input values (count * m values)
+    /// \param y Output values (count * n values)
+    /// \param count Number of points
+    virtual FunctionResult apply(const_iterator x, iterator y, size_t count) const override;
+
+    /// Function is continuous, if domain doesn't contain zero for negative exponent
+    virtual bool isContinuous() const override;
+
 private:
     std::vector<PDFReal> m_c0;
     std::vector<PDFReal> m_c1;
@@ -306,7 +351,25 @@ public:
     /// \param y_n Iterator to the end of the output values (one item after last value)
     virtual FunctionResult apply(const_iterator x_1, const_iterator x_m, iterator y_1, iterator y_n) const override;
 
+    /// Transforms array of input points to the array of output points. Input array
+    /// contains single value for each point, output array receives n values for each
+    /// point. Consecutive points, which fall into the same partial function, are
+    /// evaluated by the partial function at once.
+    /// \param x Input values (count values)
+    /// \param y Output values (count * n values)
+    /// \param count Number of points
+    virtual FunctionResult apply(const_iterator x, iterator y, size_t count) const override;
+
+    /// Function is continuous, if all partial functions are continuous,
+    /// and neighbouring partial functions have the same values at their
+    /// common bound.
+    virtual bool isContinuous() const override;
+
 private:
+    /// Maximal difference of values of partial functions at their common
+    /// bound, for which function is still considered continuous
+    static constexpr PDFReal CONTINUITY_TOLERANCE = 1.0 / 1024.0;
+
     /// Partial function definitions
     std::vector<PartialFunction> m_partialFunctions;
 };
@@ -400,7 +463,12 @@ public:
         Call,
         Return,
         Push,
-        Execute
+        Execute,
+
+        // Special codes of the compiled program (blocks are inlined and conditions
+        // are replaced by jumps, target is stored in the operand).
+        Jump,
+        JumpIfFalse
     };
 
     /// Gets the code from the byte array. If byte array contains invalid data,
@@ -459,6 +527,12 @@ public:
     /// Create a PostScript program from the byte array
     static Program parseProgram(const QByteArray& byteArray);
 
+    /// Compiles the parsed program into the linear program, which is executed. Blocks
+    /// are inlined, if/ifelse operators are replaced by jumps, and operators, which have
+    /// constant operands, are evaluated. If program is invalid, exception is thrown.
+    /// \param program Program created by \p parseProgram
+    static Program compileProgram(const Program& program);
+
     /// Transforms input values to the output values.
     /// \param x_1 Iterator to the first input value
     /// \param x_n Iterator to the end of the input values (one item after last value)
@@ -466,11 +540,87 @@ public:
     /// \param y_n Iterator to the end of the output values (one item after last value)
     virtual FunctionResult apply(const_iterator x_1, const_iterator x_m, iterator y_1, iterator y_n) const override;
 
+    /// Transforms array of input points to the array of output points. Input array
+    /// contains m values for each point, output array receives n values for each
+    /// point. Program is executed using single operand stack for all points.
+    /// \param x Input values (count * m values)
+    /// \param y Output values (count * n values)
+    /// \param count Number of points
+    virtual FunctionResult apply(const_iterator x, iterator y, size_t count) const override;
+
 private:
+    /// Returns true, if stack depth is known for each instruction of the compiled
+    /// program, and stack can't overflow or underflow. Then stack checks can be skipped.
+    static bool isStackDepthResolved(const Program& program, uint32_t m, uint32_t n);
+
     Program m_program;
+    bool m_isStackDepthResolved;
 
     friend class PDFPostScriptFunctionStack;
     friend class PDFPostScriptFunctionExecutor;
+    friend class PDFPostScriptFunctionCompiler;
+};
+
+/// Lookup table of single input function (or functions), sampled in the given
+/// interval. Values between samples are linearly interpolated. Lookup table
+/// is used, when function is evaluated for many points (for example, for each
+/// pixel of the image), so function is evaluated only for the samples.
+class PDF4QTLIBSHARED_EXPORT PDFFunctionLookupTable
+{
+public:
+    explicit PDFFunctionLookupTable() = default;
+
+    /// Default number of samples. Samples are placed in such a way, that
+    /// 8-bit input values in interval [0, 1] are hitting samples exactly.
+    static constexpr size_t DEFAULT_SAMPLE_COUNT = 4 * 255 + 1;
+
+    /// Creates lookup table of the functions. Either single function with n outputs,
+    /// or n functions with single output can be specified. If some function has more
+    /// than one input, or function evaluation fails, invalid lookup table is returned.
+    /// \param functions Functions to be sampled
+    /// \param n Number of output values
+    /// \param xMin Start of the sampled interval
+    /// \param xMax End of the sampled interval
+    /// \param sampleCount Number of samples
+    static PDFFunctionLookupTable create(const std::vector<PDFFunctionPtr>& functions,
+                                         size_t n,
+                                         PDFReal xMin,
+                                         PDFReal xMax,
+                                         size_t sampleCount = DEFAULT_SAMPLE_COUNT);
+
+    /// Returns true, if all functions are continuous, so lookup table
+    /// approximates them well for any input value (not only for
+    /// input values hitting the samples).
+    /// \param functions Functions
+    static bool isApproximationAccurate(const std::vector<PDFFunctionPtr>& functions);
+
+    /// Returns true, if lookup table is valid
+    bool isValid() const { return !m_samples.empty(); }
+
+    /// Returns number of output values
+    size_t getOutputVariableCount() const { return m_n; }
+
+    /// Transforms input value to the output values. Input value
+    /// is clamped to the sampled interval.
+    /// \param x Input value
+    /// \param y Output values (n values)
+    void apply(PDFReal x, PDFFunction::iterator y) const;
+
+    /// Transforms array of input values to the array of output values.
+    /// \param x Input values (count values)
+    /// \param y Output values (count * n values)
+    /// \param count Number of points
+    void apply(PDFFunction::const_iterator x, PDFFunction::iterator y, size_t count) const;
+
+private:
+    size_t m_n = 0;
+    size_t m_sampleCount = 0;
+    PDFReal m_xMin = 0.0;
+    PDFReal m_scale = 0.0;
+
+    /// Samples, n values for each sample. One sample is added
+    /// after the last sample, so interpolation can always use two samples.
+    std::vector<PDFReal> m_samples;
 };
 
 }   // namespace pdf
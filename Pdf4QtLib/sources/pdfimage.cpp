@@ -27,6 +27,8 @@
 #include <openjpeg.h>
 #include <jpeglib.h>
 
+#include <algorithm>
+
 namespace pdf
 {
 
@@ -53,7 +55,8 @@ PDFImage PDFImage::createImage(const PDFDocument* document,
                                PDFColorSpacePointer colorSpace,
                                bool isSoftMask,
                                RenderingIntent renderingIntent,
-                               PDFRenderErrorReporter* errorReporter)
+                               PDFRenderErrorReporter* errorReporter,
+                               int downsampleLevel)
 {
     PDFImage image;
     image.m_colorSpace = colorSpace;
@@ -338,6 +341,14 @@ PDFImage PDFImage::createImage(const PDFDocument* document,
                 }
             }
 
+            // Let the decoder perform downsampling using DCT scaling, it is
+            // much faster than decoding of full resolution image.
+            if (downsampleLevel > 0)
+            {
+                codec.scale_num = 1;
+                codec.scale_denom = 1 << qMin(downsampleLevel, MAX_DOWNSAMPLE_LEVEL);
+            }
+
             jpeg_start_decompress(&codec);
 
             const JDIMENSION rowStride = codec.output_width * codec.output_components;
@@ -429,6 +440,30 @@ PDFImage PDFImage::createImage(const PDFDocument* document,
 
                 if (opj_read_header(opjStream, codec, &jpegImage))
                 {
+                    // Skip highest resolution levels, if image is downsampled. We must
+                    // keep at least one resolution level of each component.
+                    if (downsampleLevel > 0)
+                    {
+                        int reduce = qMin(downsampleLevel, MAX_DOWNSAMPLE_LEVEL);
+                        if (opj_codestream_info_v2_t* info = opj_get_cstr_info(codec))
+                        {
+                            for (OPJ_UINT32 i = 0; i < info->nbcomps && info->m_default_tile_info.tccp_info; ++i)
+                            {
+                                reduce = qMin(reduce, static_cast<int>(info->m_default_tile_info.tccp_info[i].numresolutions) - 1);
+                            }
+                            opj_destroy_cstr_info(&info);
+                        }
+                        else
+                        {
+                            reduce = 0;
+                        }
+
+                        if (reduce > 0)
+                        {
+                            opj_set_decoded_resolution_factor(codec, reduce);
+                        }
+                    }
+
                     if (opj_set_decode_area(codec, jpegImage, decompressParameters.DA_x0, decompressParameters.DA_y0, decompressParameters.DA_x1, decompressParameters.DA_y1))
                     {
                         if (opj_decode(codec, opjStream, jpegImage))
@@ -869,4 +904,96 @@ PDFAlternateImage PDFAlternateImage::parse(const PDFObjectStorage* storage, PDFO
     return result;
 }
 
+int PDFImage::getDownsampleLevel(PDFInteger width, PDFInteger height, PDFReal targetWidth, PDFReal targetHeight)
+{
+    const PDFInteger minimalWidth = qCeil(targetWidth);
+    const PDFInteger minimalHeight = qCeil(targetHeight);
+
+    int level = 0;
+    while (level < MAX_DOWNSAMPLE_LEVEL &&
+           (width >> (level + 1)) >= minimalWidth &&
+           (height >> (level + 1)) >= minimalHeight)
+    {
+        ++level;
+    }
+
+    return level;
+}
+
+PDFImageCache* PDFImageCache::getInstance()
+{
+    static PDFImageCache instance;
+    return &instance;
+}
+
+QImage PDFImageCache::getImage(const Key& key, std::vector<PDFRenderError>& errors)
+{
+    QMutexLocker lock(&m_mutex);
+
+    if (const Entry* entry = m_cache.object(key))
+    {
+        ++m_hits;
+        errors = entry->errors;
+        return entry->image;
+    }
+
+    ++m_misses;
+    return QImage();
+}
+
+void PDFImageCache::insertImage(const Key& key, QImage image, std::vector<PDFRenderError> errors)
+{
+    const qint64 cost = image.sizeInBytes();
+
+    QMutexLocker lock(&m_mutex);
+    if (!image.isNull() && cost <= m_cache.maxCost())
+    {
+        m_cache.insert(key, new Entry{ qMove(image), qMove(errors) }, cost);
+    }
+}
+
+void PDFImageCache::clear()
+{
+    QMutexLocker lock(&m_mutex);
+    m_cache.clear();
+}
+
+void PDFImageCache::setLimit(const void* owner, qint64 limit)
+{
+    QMutexLocker lock(&m_mutex);
+    m_limits[owner] = limit;
+    updateLimit();
+}
+
+void PDFImageCache::removeLimit(const void* owner)
+{
+    QMutexLocker lock(&m_mutex);
+    m_limits.erase(owner);
+    updateLimit();
+}
+
+void PDFImageCache::updateLimit()
+{
+    qint64 limit = DEFAULT_LIMIT;
+
+    if (!m_limits.empty())
+    {
+        limit = std::max_element(m_limits.cbegin(), m_limits.cend(), [](const auto& l, const auto& r) { return l.second < r.second; })->second;
+    }
+
+    m_cache.setMaxCost(limit);
+}
+
+PDFImageCache::Statistics PDFImageCache::getStatistics() const
+{
+    QMutexLocker lock(&m_mutex);
+
+    Statistics statistics;
+    statistics.hits = m_hits;
+    statistics.misses = m_misses;
+    statistics.size = m_cache.totalCost();
+    statistics.limit = m_cache.maxCost();
+    return statistics;
+}
+
 }   // namespace pdf
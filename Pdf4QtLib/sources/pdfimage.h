@@ -21,8 +21,13 @@
 #include "pdfobject.h"
 #include "pdfcolorspaces.h"
 #include "pdfoperationcontrol.h"
+#include "pdfexception.h"
 
 #include <QByteArray>
+#include <QCache>
+#include <QMutex>
+
+#include <map>
 
 class QByteArray;
 
@@ -66,12 +71,27 @@ public:
     /// \param isSoftMask Is it a soft mask image?
     /// \param renderingIntent Default rendering intent of the image
     /// \param errorReporter Error reporter for reporting errors (or warnings)
+    /// \param downsampleLevel Image can be decoded with resolution reduced by factor 2^downsampleLevel.
+    ///        Only decoders supporting downsampling (DCT and JPEG 2000) use this parameter,
+    ///        soft masks and masks are always decoded at full resolution.
     static PDFImage createImage(const PDFDocument* document,
                                 const PDFStream* stream,
                                 PDFColorSpacePointer colorSpace,
                                 bool isSoftMask,
                                 RenderingIntent renderingIntent,
-                                PDFRenderErrorReporter* errorReporter);
+                                PDFRenderErrorReporter* errorReporter,
+                                int downsampleLevel = 0);
+
+    /// Returns highest downsample level, for which image still has at least
+    /// target resolution (so no image quality is lost, when image is painted).
+    /// \param width Image width
+    /// \param height Image height
+    /// \param targetWidth Width of the image in device pixels
+    /// \param targetHeight Height of the image in device pixels
+    static int getDownsampleLevel(PDFInteger width, PDFInteger height, PDFReal targetWidth, PDFReal targetHeight);
+
+    /// Maximal downsample level (libjpeg supports scaling down to 1/8)
+    static constexpr int MAX_DOWNSAMPLE_LEVEL = 3;
 
     /// Returns image transformed from image data and color space
     QImage getImage(const PDFCMS* cms,
@@ -131,6 +151,128 @@ private:
     PDFObject m_pointData;
 };
 
+/// Process-wide cache of final images (decoded and transformed to the device
+/// color space). Images are identified by document content, object reference
+/// of the image XObject, color management system, rendering intent and
+/// downsample level. Images are evicted, when total size exceeds the limit.
+/// Errors reported during image decoding are stored together with the image,
+/// so they can be reported again, when image is taken from the cache.
+/// This class is thread safe.
+class PDF4QTLIBSHARED_EXPORT PDFImageCache
+{
+public:
+    static constexpr const qint64 DEFAULT_LIMIT = 32 * 1024 * 1024;
+
+    struct Key
+    {
+        quint64 contentId = 0;                              ///< Identifier of document content, see PDFObjectStorage::getContentId
+        PDFObjectReference reference;                       ///< Reference to image XObject
+        quint64 cmsId = 0;                                  ///< Identifier of color management system, see PDFCMS::getId
+        RenderingIntent renderingIntent = RenderingIntent::Perceptual;
+        int downsampleLevel = 0;                            ///< Image is downsampled by factor 2^downsampleLevel
+
+        bool operator==(const Key&) const = default;
+    };
+
+    struct Statistics
+    {
+        qint64 hits = 0;
+        qint64 misses = 0;
+        qint64 size = 0;
+        qint64 limit = 0;
+    };
+
+    /// Returns global instance of the image cache
+    static PDFImageCache* getInstance();
+
+    /// Returns image from the cache. If image is not found,
+    /// then null image is returned.
+    /// \param key Key
+    /// \param errors Errors reported during decoding of the image
+    QImage getImage(const Key& key, std::vector<PDFRenderError>& errors);
+
+    /// Inserts image into the cache. Images, which are larger
+    /// than the limit, are not inserted.
+    /// \param key Key
+    /// \param image Image
+    /// \param errors Errors reported during decoding of the image
+    void insertImage(const Key& key, QImage image, std::vector<PDFRenderError> errors);
+
+    /// Removes all images from the cache
+    void clear();
+
+    /// Sets limit of total size of images in bytes requested by \p owner.
+    /// Cache is shared by all owners, so the largest of the requested
+    /// limits is used.
+    /// \param owner Owner of the limit (for example, page compiler)
+    /// \param limit Limit [bytes]
+    void setLimit(const void* owner, qint64 limit);
+
+    /// Removes limit requested by \p owner, must be called,
+    /// when owner is destroyed.
+    /// \param owner Owner of the limit
+    void removeLimit(const void* owner);
+
+    /// Returns cache statistics
+    Statistics getStatistics() const;
+
+private:
+    explicit PDFImageCache() : m_cache(DEFAULT_LIMIT) { }
+
+    struct Entry
+    {
+        QImage image;
+        std::vector<PDFRenderError> errors;
+    };
+
+    /// Sets limit of the cache as the largest of the requested limits
+    /// (or default limit, if no limit is requested).
+    void updateLimit();
+
+    mutable QMutex m_mutex;
+    QCache<Key, Entry> m_cache;
+    std::map<const void*, qint64> m_limits;
+    qint64 m_hits = 0;
+    qint64 m_misses = 0;
+};
+
+/// Render error reporter, which records reported errors and passes them
+/// to another reporter. It is used to store errors, reported during decoding
+/// of the image, together with the image in the image cache.
+class PDFRecordingRenderErrorReporter : public PDFRenderErrorReporter
+{
+public:
+    explicit PDFRecordingRenderErrorReporter(PDFRenderErrorReporter* reporter) :
+        m_reporter(reporter)
+    {
+
+    }
+
+    virtual void reportRenderError(RenderErrorType type, QString message) override
+    {
+        m_errors.emplace_back(type, message);
+        m_reporter->reportRenderError(type, qMove(message));
+    }
+
+    virtual void reportRenderErrorOnce(RenderErrorType type, QString message) override
+    {
+        m_errors.emplace_back(type, message);
+        m_reporter->reportRenderErrorOnce(type, qMove(message));
+    }
+
+    /// Returns recorded errors
+    std::vector<PDFRenderError> takeErrors() { return qMove(m_errors); }
+
+private:
+    PDFRenderErrorReporter* m_reporter;
+    std::vector<PDFRenderError> m_errors;
+};
+
+inline size_t qHash(const PDFImageCache::Key& key, size_t seed = 0)
+{
+    return qHashMulti(seed, key.contentId, key.reference.objectNumber, key.reference.generation, key.cmsId, int(key.renderingIntent), key.downsampleLevel);
+}
+
 }   // namespace pdf
 
 #endif // PDFIMAGE_H
@@ -102,8 +102,17 @@ bool PDFObject::operator==(const PDFObject& other) const
         // values are "equal" (NaN == NaN returns false)
         if (std::holds_alternative<PDFObjectContentPointer>(m_data))
         {
-            Q_ASSERT(std::get<PDFObjectContentPointer>(m_data));
-            return std::get<PDFObjectContentPointer>(m_data)->equals(std::get<PDFObjectContentPointer>(other.m_data).get());
+            const PDFObjectContentPointer& content = std::get<PDFObjectContentPointer>(m_data);
+            const PDFObjectContentPointer& otherContent = std::get<PDFObjectContentPointer>(other.m_data);
+            Q_ASSERT(content);
+
+            // Shared content (for example, object copied to the modified document) is equal
+            if (content == otherContent)
+            {
+                return true;
+            }
+
+            return content->equals(otherContent.get());
         }
 
         return m_data == other.m_data;
@@ -229,6 +229,78 @@ PDFObject PDFObjectUtils::replaceReferences(const PDFObject& object, const std::
     return replaceReferencesVisitor.getObject();
 }
 
+size_t PDFObjectUtils::getHash(const PDFObject& object, size_t seed)
+{
+    seed = qHash(static_cast<int>(object.getType()), seed);
+
+    switch (object.getType())
+    {
+        case PDFObject::Type::Null:
+            break;
+
+        case PDFObject::Type::Bool:
+            seed = qHash(object.getBool(), seed);
+            break;
+
+        case PDFObject::Type::Int:
+            seed = qHash(object.getInteger(), seed);
+            break;
+
+        case PDFObject::Type::Real:
+        {
+            // Zero and negative zero are equal, so they must have the same hash
+            const PDFReal value = object.getReal();
+            seed = qHash(value != 0.0 ? value : 0.0, seed);
+            break;
+        }
+
+        case PDFObject::Type::String:
+        case PDFObject::Type::Name:
+            seed = qHash(object.getString(), seed);
+            break;
+
+        case PDFObject::Type::Array:
+        {
+            const PDFArray* array = object.getArray();
+            for (size_t i = 0, count = array->getCount(); i < count; ++i)
+            {
+                seed = getHash(array->getItem(i), seed);
+            }
+            break;
+        }
+
+        case PDFObject::Type::Dictionary:
+        case PDFObject::Type::Stream:
+        {
+            const PDFDictionary* dictionary = object.isStream() ? object.getStream()->getDictionary() : object.getDictionary();
+            for (size_t i = 0, count = dictionary->getCount(); i < count; ++i)
+            {
+                seed = qHash(dictionary->getKey(i).getString(), seed);
+                seed = getHash(dictionary->getValue(i), seed);
+            }
+
+            if (object.isStream())
+            {
+                seed = qHash(*object.getStream()->getContent(), seed);
+            }
+            break;
+        }
+
+        case PDFObject::Type::Reference:
+        {
+            const PDFObjectReference reference = object.getReference();
+            seed = qHashMulti(seed, reference.objectNumber, reference.generation);
+            break;
+        }
+
+        default:
+            Q_ASSERT(false);
+            break;
+    }
+
+    return seed;
+}
+
 QString PDFObjectUtils::getObjectTypeName(PDFObject::Type type)
 {
     switch (type)
@@ -51,6 +51,13 @@ public:
     /// \param type Type
     static QString getObjectTypeName(PDFObject::Type type);
 
+    /// Returns structural hash of the object. Equal objects have equal hashes (references
+    /// are not followed, so two objects are equal only if they are structurally the same,
+    /// including stream content). Hash can be used to find candidates for equality.
+    /// \param object Object
+    /// \param seed Seed
+    static size_t getHash(const PDFObject& object, size_t seed = 0);
+
 private:
     PDFObjectUtils() = delete;
 };
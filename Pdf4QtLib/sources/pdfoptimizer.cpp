@@ -248,13 +248,21 @@ bool PDFOptimizer::performMergeIdenticalObjects()
     std::map<PDFObjectReference, PDFObjectReference> replacementMap;
     PDFObjectStorage::PDFObjects objects =  m_storage.getObjects();
 
-    // Find same objects
-    QMutex mutex;
+    // Calculate structural hashes of objects, which can be merged. Equal objects
+    // have equal hashes, so we need to compare only objects with the same hash.
+    std::vector<size_t> hashes(objects.size(), 0);
+    std::vector<uint8_t> isCandidate(objects.size(), false);
     PDFIntegerRange<size_t> range(0, objects.size());
-    auto processEntry = [this, &counter, &objects, &mutex, &replacementMap](size_t index)
+    auto calculateHash = [this, &objects, &hashes, &isCandidate](size_t index)
     {
         const PDFObjectStorage::Entry& entry = objects[index];
 
+        if (entry.object.isNull())
+        {
+            // Jakub Melka: we do not merge null objects, they are just removed
+            return;
+        }
+
         // We do not merge special objects, such as pages
         if (const PDFDictionary* dictionary = m_storage.getDictionaryFromObject(entry.object))
         {
@@ -268,26 +276,72 @@ bool PDFOptimizer::performMergeIdenticalObjects()
             }
         }
 
-        for (size_t i = 0; i < index; ++i)
+        hashes[index] = PDFObjectUtils::getHash(entry.object);
+        isCandidate[index] = true;
+    };
+    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, range.begin(), range.end(), calculateHash);
+
+    // Sort candidates by hash, and then by index, so each bucket is
+    // a contiguous range of candidates sorted by object index.
+    std::vector<size_t> candidates;
+    candidates.reserve(objects.size());
+    for (size_t i = 0; i < objects.size(); ++i)
+    {
+        if (isCandidate[i])
+        {
+            candidates.push_back(i);
+        }
+    }
+
+    auto compareCandidates = [&hashes](size_t left, size_t right)
+    {
+        return std::make_pair(hashes[left], left) < std::make_pair(hashes[right], right);
+    };
+    std::sort(candidates.begin(), candidates.end(), compareCandidates);
+
+    std::vector<std::pair<size_t, size_t>> buckets;
+    for (size_t i = 0; i < candidates.size();)
+    {
+        size_t j = i + 1;
+        while (j < candidates.size() && hashes[candidates[j]] == hashes[candidates[i]])
+        {
+            ++j;
+        }
+
+        if (j - i > 1)
+        {
+            buckets.emplace_back(i, j);
+        }
+
+        i = j;
+    }
+
+    // Find same objects in each bucket. Each object is replaced by the first
+    // (lowest index) object equal to it, which is never replaced itself.
+    QMutex mutex;
+    auto processBucket = [&counter, &objects, &candidates, &mutex, &replacementMap](const std::pair<size_t, size_t>& bucket)
+    {
+        std::vector<size_t> representatives;
+
+        for (size_t i = bucket.first; i < bucket.second; ++i)
         {
-            if (objects[i].object.isNull())
+            const size_t index = candidates[i];
+            auto it = std::find_if(representatives.cbegin(), representatives.cend(), [&objects, index](size_t representative) { return objects[representative].object == objects[index].object; });
+
+            if (it == representatives.cend())
             {
-                // Jakub Melka: we do not merge null objects, they are just removed
+                representatives.push_back(index);
                 continue;
             }
 
-            if (objects[i].object == entry.object)
-            {
-                QMutexLocker lock(&mutex);
-                PDFObjectReference oldReference = PDFObjectReference(PDFInteger(index), objects[index].generation);
-                PDFObjectReference newReference = PDFObjectReference(PDFInteger(i), objects[i].generation);
-                replacementMap[oldReference] = newReference;
-                ++counter;
-                break;
-            }
+            QMutexLocker lock(&mutex);
+            PDFObjectReference oldReference = PDFObjectReference(PDFInteger(index), objects[index].generation);
+            PDFObjectReference newReference = PDFObjectReference(PDFInteger(*it), objects[*it].generation);
+            replacementMap[oldReference] = newReference;
+            ++counter;
         }
     };
-    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, range.begin(), range.end(), processEntry);
+    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Unknown, buckets.cbegin(), buckets.cend(), processBucket);
 
     // Replace objects
     if (!replacementMap.empty())
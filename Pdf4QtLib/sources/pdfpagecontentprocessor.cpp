@@ -26,6 +26,10 @@
 
 #include <QPainterPathStroker>
 
+#include <array>
+#include <string>
+#include <iterator>
+
 namespace pdf
 {
 
@@ -157,6 +161,104 @@ static constexpr const std::pair<const char*, PDFPageContentProcessor::Operator>
     { "EX", PDFPageContentProcessor::Operator::CompatibilityEnd }
 };
 
+// Operators are found using perfect hash. Operator has at most three characters,
+// so it can be packed (together with its length) into the 32-bit code. Multiplier
+// of the hash function is found at compile time, so that each operator has its
+// own slot in the hash table, and lookup is just one comparison of the codes.
+
+static constexpr size_t OPERATOR_MAX_LENGTH = 3;
+static constexpr int OPERATOR_HASH_BITS = 10;
+static constexpr size_t OPERATOR_HASH_TABLE_SIZE = size_t(1) << OPERATOR_HASH_BITS;
+static constexpr uint8_t OPERATOR_HASH_EMPTY_SLOT = 0xFF;
+
+static_assert(std::size(operators) < OPERATOR_HASH_EMPTY_SLOT, "Operator index doesn't fit into the hash table slot.");
+
+static constexpr uint32_t getOperatorCode(const char* name, size_t length)
+{
+    if (length == 0 || length > OPERATOR_MAX_LENGTH)
+    {
+        return 0;
+    }
+
+    uint32_t code = uint32_t(length) << 24;
+    for (size_t i = 0; i < length; ++i)
+    {
+        code |= uint32_t(static_cast<uint8_t>(name[i])) << (8 * i);
+    }
+    return code;
+}
+
+static constexpr uint32_t getOperatorHash(uint32_t code, uint32_t multiplier)
+{
+    return (code * multiplier) >> (32 - OPERATOR_HASH_BITS);
+}
+
+static constexpr uint32_t findOperatorHashMultiplier()
+{
+    for (uint32_t multiplier = 2654435761u, i = 0; i < 4096; multiplier += 2, ++i)
+    {
+        std::array<bool, OPERATOR_HASH_TABLE_SIZE> isSlotUsed = { };
+        bool isPerfect = true;
+
+        for (const auto& operatorDescriptor : operators)
+        {
+            const uint32_t code = getOperatorCode(operatorDescriptor.first, std::char_traits<char>::length(operatorDescriptor.first));
+            const uint32_t hash = getOperatorHash(code, multiplier);
+
+            if (isSlotUsed[hash])
+            {
+                isPerfect = false;
+                break;
+            }
+            isSlotUsed[hash] = true;
+        }
+
+        if (isPerfect)
+        {
+            return multiplier;
+        }
+    }
+
+    return 0;
+}
+
+static constexpr uint32_t OPERATOR_HASH_MULTIPLIER = findOperatorHashMultiplier();
+static_assert(OPERATOR_HASH_MULTIPLIER != 0, "Perfect hash of operators not found.");
+
+static constexpr std::array<uint8_t, OPERATOR_HASH_TABLE_SIZE> createOperatorHashTable()
+{
+    std::array<uint8_t, OPERATOR_HASH_TABLE_SIZE> table = { };
+    for (uint8_t& slot : table)
+    {
+        slot = OPERATOR_HASH_EMPTY_SLOT;
+    }
+
+    for (size_t i = 0; i < std::size(operators); ++i)
+    {
+        const uint32_t code = getOperatorCode(operators[i].first, std::char_traits<char>::length(operators[i].first));
+        table[getOperatorHash(code, OPERATOR_HASH_MULTIPLIER)] = static_cast<uint8_t>(i);
+    }
+
+    return table;
+}
+
+static constexpr std::array<uint8_t, OPERATOR_HASH_TABLE_SIZE> operatorHashTable = createOperatorHashTable();
+
+static PDFPageContentProcessor::Operator getOperator(const QByteArray& command)
+{
+    const uint32_t code = getOperatorCode(command.constData(), command.size());
+    if (code)
+    {
+        const uint8_t index = operatorHashTable[getOperatorHash(code, OPERATOR_HASH_MULTIPLIER)];
+        if (index != OPERATOR_HASH_EMPTY_SLOT && getOperatorCode(operators[index].first, std::char_traits<char>::length(operators[index].first)) == code)
+        {
+            return operators[index].second;
+        }
+    }
+
+    return PDFPageContentProcessor::Operator::Invalid;
+}
+
 void PDFPageContentProcessor::initDictionaries(const PDFObject& resourcesObject)
 {
     const PDFObject& resources = m_document->getObject(resourcesObject);
@@ -394,6 +496,11 @@ bool PDFPageContentProcessor::performOriginalImagePainting(const PDFImage& image
     return false;
 }
 
+bool PDFPageContentProcessor::isImageCacheEnabled() const
+{
+    return false;
+}
+
 void PDFPageContentProcessor::performImagePainting(const QImage& image)
 {
     Q_UNUSED(image);
@@ -544,7 +651,7 @@ void PDFPageContentProcessor::processContent(const QByteArray& content)
             {
                 case PDFLexicalAnalyzer::TokenType::Command:
                 {
-                    QByteArray command = token.data.toByteArray();
+                    QByteArray command = token.getBytes();
 
                     if (command == "BI")
                     {
@@ -668,7 +775,7 @@ void PDFPageContentProcessor::processContent(const QByteArray& content)
 
                         QByteArray buffer = content.mid(startDataPosition, dataLength);
                         PDFStream imageStream(std::move(*dictionary), std::move(buffer));
-                        paintXObjectImage(&imageStream);
+                        paintXObjectImage(&imageStream, PDFObjectReference());
                     }
                     else
                     {
@@ -689,7 +796,7 @@ void PDFPageContentProcessor::processContent(const QByteArray& content)
                 default:
                 {
                     // Push the operand onto the operand stack
-                    m_operands.push_back(std::move(token));
+                    m_operands.push_back(Operand(std::move(token)));
                     break;
                 }
             }
@@ -850,7 +957,7 @@ void PDFPageContentProcessor::processPathPainting(const QPainterPath& path, bool
 
                         if (!performPathPaintingUsingShading(path, false, true, shadingPattern))
                         {
-                            PDFMesh mesh = shadingPattern->createMesh(settings, m_CMS, m_graphicState.getRenderingIntent(), this, m_operationControl);
+                            PDFMesh mesh = createShadingMesh(shadingPattern, settings);
 
                             // Now, merge the current path to the mesh clipping path
                             QPainterPath boundingPath = mesh.getBoundingPath();
@@ -967,7 +1074,7 @@ void PDFPageContentProcessor::processPathPainting(const QPainterPath& path, bool
 
                         if (!performPathPaintingUsingShading(strokedPath, true, false, shadingPattern))
                         {
-                            PDFMesh mesh = shadingPattern->createMesh(settings, m_CMS, m_graphicState.getRenderingIntent(), this, m_operationControl);
+                            PDFMesh mesh = createShadingMesh(shadingPattern, settings);
 
                             QPainterPath boundingPath = mesh.getBoundingPath();
                             if (boundingPath.isEmpty())
@@ -1117,17 +1224,7 @@ void PDFPageContentProcessor::processTillingPatternPainting(const PDFTilingPatte
 
 void PDFPageContentProcessor::processCommand(const QByteArray& command)
 {
-    Operator op = Operator::Invalid;
-
-    // Find the command in the command array
-    for (const std::pair<const char*, PDFPageContentProcessor::Operator>& operatorDescriptor : operators)
-    {
-        if (command == operatorDescriptor.first)
-        {
-            op = operatorDescriptor.second;
-            break;
-        }
-    }
+    const Operator op = getOperator(command);
 
     switch (op)
     {
@@ -2110,16 +2207,16 @@ PDFReal PDFPageContentProcessor::readOperand<PDFReal>(size_t index) const
 {
     if (index < m_operands.size())
     {
-        const PDFLexicalAnalyzer::Token& token = m_operands[index];
+        const Operand& operand = m_operands[index];
 
-        switch (token.type)
+        switch (operand.type)
         {
             case PDFLexicalAnalyzer::TokenType::Real:
             case PDFLexicalAnalyzer::TokenType::Integer:
-                return token.data.value<PDFReal>();
+                return operand.real;
 
             default:
-                throw PDFRendererException(RenderErrorType::Error, PDFTranslationContext::tr("Can't read operand (real number) on index %1. Operand is of type '%2'.").arg(index + 1).arg(PDFLexicalAnalyzer::getStringFromOperandType(token.type)));
+                throw PDFRendererException(RenderErrorType::Error, PDFTranslationContext::tr("Can't read operand (real number) on index %1. Operand is of type '%2'.").arg(index + 1).arg(PDFLexicalAnalyzer::getStringFromOperandType(operand.type)));
         }
     }
     else
@@ -2133,15 +2230,15 @@ PDFInteger PDFPageContentProcessor::readOperand<PDFInteger>(size_t index) const
 {
     if (index < m_operands.size())
     {
-        const PDFLexicalAnalyzer::Token& token = m_operands[index];
+        const Operand& operand = m_operands[index];
 
-        switch (token.type)
+        switch (operand.type)
         {
             case PDFLexicalAnalyzer::TokenType::Integer:
-                return token.data.value<PDFInteger>();
+                return operand.integer;
 
             default:
-                throw PDFRendererException(RenderErrorType::Error, PDFTranslationContext::tr("Can't read operand (integer) on index %1. Operand is of type '%2'.").arg(index + 1).arg(PDFLexicalAnalyzer::getStringFromOperandType(token.type)));
+                throw PDFRendererException(RenderErrorType::Error, PDFTranslationContext::tr("Can't read operand (integer) on index %1. Operand is of type '%2'.").arg(index + 1).arg(PDFLexicalAnalyzer::getStringFromOperandType(operand.type)));
         }
     }
     else
@@ -2155,15 +2252,15 @@ PDFPageContentProcessor::PDFOperandName PDFPageContentProcessor::readOperand<PDF
 {
     if (index < m_operands.size())
     {
-        const PDFLexicalAnalyzer::Token& token = m_operands[index];
+        const Operand& operand = m_operands[index];
 
-        switch (token.type)
+        switch (operand.type)
         {
             case PDFLexicalAnalyzer::TokenType::Name:
-                return PDFOperandName{ token.data.toByteArray() };
+                return PDFOperandName{ operand.bytes };
 
             default:
-                throw PDFRendererException(RenderErrorType::Error, PDFTranslationContext::tr("Can't read operand (name) on index %1. Operand is of type '%2'.").arg(index + 1).arg(PDFLexicalAnalyzer::getStringFromOperandType(token.type)));
+                throw PDFRendererException(RenderErrorType::Error, PDFTranslationContext::tr("Can't read operand (name) on index %1. Operand is of type '%2'.").arg(index + 1).arg(PDFLexicalAnalyzer::getStringFromOperandType(operand.type)));
         }
     }
     else
@@ -2178,15 +2275,15 @@ PDFPageContentProcessor::PDFOperandString PDFPageContentProcessor::readOperand<P
 {
     if (index < m_operands.size())
     {
-        const PDFLexicalAnalyzer::Token& token = m_operands[index];
+        const Operand& operand = m_operands[index];
 
-        switch (token.type)
+        switch (operand.type)
         {
             case PDFLexicalAnalyzer::TokenType::String:
-                return PDFOperandString{ token.data.toByteArray() };
+                return PDFOperandString{ operand.bytes };
 
             default:
-                throw PDFRendererException(RenderErrorType::Error, PDFTranslationContext::tr("Can't read operand (string) on index %1. Operand is of type '%2'.").arg(index + 1).arg(PDFLexicalAnalyzer::getStringFromOperandType(token.type)));
+                throw PDFRendererException(RenderErrorType::Error, PDFTranslationContext::tr("Can't read operand (string) on index %1. Operand is of type '%2'.").arg(index + 1).arg(PDFLexicalAnalyzer::getStringFromOperandType(operand.type)));
         }
     }
     else
@@ -2866,19 +2963,19 @@ void PDFPageContentProcessor::operatorTextShowTextIndividualSpacing()
             {
                 case PDFLexicalAnalyzer::TokenType::Integer:
                 {
-                    textSequence.items.push_back(TextSequenceItem(m_operands[i].data.value<PDFInteger>()));
+                    textSequence.items.push_back(TextSequenceItem(m_operands[i].real));
                     break;
                 }
 
                 case PDFLexicalAnalyzer::TokenType::Real:
                 {
-                    textSequence.items.push_back(TextSequenceItem(m_operands[i].data.value<PDFReal>()));
+                    textSequence.items.push_back(TextSequenceItem(m_operands[i].real));
                     break;
                 }
 
                 case PDFLexicalAnalyzer::TokenType::String:
                 {
-                    realizedFont->fillTextSequence(m_operands[i].data.toByteArray(), textSequence, this);
+                    realizedFont->fillTextSequence(m_operands[i].bytes, textSequence, this);
                     break;
                 }
 
@@ -2947,7 +3044,7 @@ void PDFPageContentProcessor::operatorShadingPaintShape(PDFPageContentProcessor:
     processPathPainting(boundingRectPath, false, true, false, boundingRectPath.fillRule());
 }
 
-void PDFPageContentProcessor::paintXObjectImage(const PDFStream* stream)
+void PDFPageContentProcessor::paintXObjectImage(const PDFStream* stream, PDFObjectReference reference)
 {
     if (isContentKindSuppressed(ContentKind::Images))
     {
@@ -2955,12 +3052,54 @@ void PDFPageContentProcessor::paintXObjectImage(const PDFStream* stream)
         return;
     }
 
-    PDFColorSpacePointer colorSpace;
-
     const PDFDictionary* streamDictionary = stream->getDictionary();
-    if (streamDictionary->hasKey("ColorSpace"))
+    const PDFObject& colorSpaceObject = m_document->getObject(streamDictionary->get("ColorSpace"));
+
+    // Determine, if we can decode image at reduced resolution. We compare
+    // image size with size of image unit square in target device space.
+    int downsampleLevel = 0;
+    if (m_imageTargetMatrix)
+    {
+        PDFDocumentDataLoaderDecorator loader(m_document);
+        const PDFInteger width = loader.readIntegerFromDictionary(streamDictionary, "Width", 0);
+        const PDFInteger height = loader.readIntegerFromDictionary(streamDictionary, "Height", 0);
+
+        const QTransform matrix = getCurrentWorldMatrix() * *m_imageTargetMatrix;
+        const QLineF mappedWidthVector = matrix.map(QLineF(0, 0, 1, 0));
+        const QLineF mappedHeightVector = matrix.map(QLineF(0, 0, 0, 1));
+        downsampleLevel = PDFImage::getDownsampleLevel(width, height, mappedWidthVector.length(), mappedHeightVector.length());
+    }
+
+    // Try to find final image in the image cache, so we avoid decoding
+    // of the image data and color conversion.
+    std::optional<PDFImageCache::Key> imageCacheKey;
+    if (reference.isValid() && m_CMS && isImageCacheEnabled() && isColorSpaceCacheable(colorSpaceObject))
+    {
+        imageCacheKey = PDFImageCache::Key();
+        imageCacheKey->contentId = m_document->getStorage().getContentId();
+        imageCacheKey->reference = reference;
+        imageCacheKey->cmsId = m_CMS->getId();
+        imageCacheKey->renderingIntent = m_graphicState.getRenderingIntent();
+        imageCacheKey->downsampleLevel = downsampleLevel;
+    }
+
+    QImage image;
+    if (imageCacheKey)
+    {
+        // Errors reported during decoding of the cached image are reported again
+        std::vector<PDFRenderError> errors;
+        image = PDFImageCache::getInstance()->getImage(*imageCacheKey, errors);
+
+        for (PDFRenderError& error : errors)
+        {
+            reportRenderErrorOnce(error.type, qMove(error.message));
+        }
+    }
+
+    if (image.isNull())
     {
-        const PDFObject& colorSpaceObject = m_document->getObject(streamDictionary->get("ColorSpace"));
+        PDFColorSpacePointer colorSpace;
+
         if (colorSpaceObject.isName() || colorSpaceObject.isArray())
         {
             colorSpace = PDFAbstractColorSpace::createColorSpace(m_colorSpaceDictionary, m_document, colorSpaceObject);
@@ -2969,35 +3108,109 @@ void PDFPageContentProcessor::paintXObjectImage(const PDFStream* stream)
         {
             throw PDFRendererException(RenderErrorType::Error, PDFTranslationContext::tr("Invalid color space of the image."));
         }
+
+        PDFRecordingRenderErrorReporter reporter(this);
+        PDFImage pdfImage = PDFImage::createImage(m_document, stream, qMove(colorSpace), false, m_graphicState.getRenderingIntent(), &reporter, downsampleLevel);
+
+        if (performOriginalImagePainting(pdfImage))
+        {
+            return;
+        }
+
+        image = pdfImage.getImage(m_CMS, &reporter, m_operationControl);
+
+        if (imageCacheKey && !isProcessingCancelled())
+        {
+            PDFImageCache::getInstance()->insertImage(*imageCacheKey, image, reporter.takeErrors());
+        }
     }
 
-    PDFImage pdfImage = PDFImage::createImage(m_document, stream, qMove(colorSpace), false, m_graphicState.getRenderingIntent(), this);
+    if (!isProcessingCancelled())
+    {
+        if (image.format() == QImage::Format_Alpha8)
+        {
+            QSize size = image.size();
+            QImage unmaskedImage(size, QImage::Format_ARGB32_Premultiplied);
+            unmaskedImage.fill(m_graphicState.getFillColor());
+            unmaskedImage.setAlphaChannel(image);
+            image = qMove(unmaskedImage);
+        }
+
+        if (!image.isNull())
+        {
+            performImagePainting(image);
+        }
+        else
+        {
+            throw PDFRendererException(RenderErrorType::Error, PDFTranslationContext::tr("Can't decode the image."));
+        }
+    }
+}
 
-    if (!performOriginalImagePainting(pdfImage))
+bool PDFPageContentProcessor::isColorSpaceCacheable(const PDFObject& colorSpaceObject) const
+{
+    if (!m_colorSpaceDictionary)
     {
-        QImage image = pdfImage.getImage(m_CMS, this, m_operationControl);
+        return true;
+    }
+
+    // Default color spaces from the resource dictionary replace device color spaces
+    if (m_colorSpaceDictionary->hasKey(COLOR_SPACE_NAME_DEFAULT_GRAY) ||
+        m_colorSpaceDictionary->hasKey(COLOR_SPACE_NAME_DEFAULT_RGB) ||
+        m_colorSpaceDictionary->hasKey(COLOR_SPACE_NAME_DEFAULT_CMYK))
+    {
+        return false;
+    }
+
+    // Named color space from the resource dictionary
+    return !colorSpaceObject.isName() || !m_colorSpaceDictionary->hasKey(colorSpaceObject.getString());
+}
 
-        if (!isProcessingCancelled())
+PDFMesh PDFPageContentProcessor::createShadingMesh(const PDFShadingPattern* shadingPattern, const PDFMeshQualitySettings& settings)
+{
+    // Try to find mesh in the shading mesh cache. Meshes are cached in the
+    // pattern space, so we can reuse them for different zoom levels.
+    std::optional<PDFShadingMeshCache::Key> meshCacheKey;
+    if (m_CMS)
+    {
+        meshCacheKey = PDFShadingMeshCache::createKey(shadingPattern, settings, m_pagePointToDevicePointMatrix);
+    }
+
+    if (meshCacheKey)
+    {
+        const PDFDictionary* shadingDictionary = m_document->getDictionaryFromObject(PDFObject::createReference(meshCacheKey->reference));
+        if (shadingDictionary && isColorSpaceCacheable(m_document->getObject(shadingDictionary->get("ColorSpace"))))
         {
-            if (image.format() == QImage::Format_Alpha8)
-            {
-                QSize size = image.size();
-                QImage unmaskedImage(size, QImage::Format_ARGB32_Premultiplied);
-                unmaskedImage.fill(m_graphicState.getFillColor());
-                unmaskedImage.setAlphaChannel(image);
-                image = qMove(unmaskedImage);
-            }
+            meshCacheKey->contentId = m_document->getStorage().getContentId();
+            meshCacheKey->cmsId = m_CMS->getId();
+            meshCacheKey->renderingIntent = m_graphicState.getRenderingIntent();
+        }
+        else
+        {
+            meshCacheKey = std::nullopt;
+        }
+    }
 
-            if (!image.isNull())
-            {
-                performImagePainting(image);
-            }
-            else
-            {
-                throw PDFRendererException(RenderErrorType::Error, PDFTranslationContext::tr("Can't decode the image."));
-            }
+    const QTransform patternSpaceToDeviceSpaceMatrix = shadingPattern->getPatternSpaceToDeviceSpaceMatrix(settings);
+    if (meshCacheKey)
+    {
+        if (std::optional<PDFMesh> mesh = PDFShadingMeshCache::getInstance()->getMesh(*meshCacheKey))
+        {
+            mesh->transform(patternSpaceToDeviceSpaceMatrix);
+            return qMove(*mesh);
         }
     }
+
+    PDFMesh mesh = shadingPattern->createMesh(settings, m_CMS, m_graphicState.getRenderingIntent(), this, m_operationControl);
+
+    if (meshCacheKey && !isProcessingCancelled())
+    {
+        PDFMesh patternSpaceMesh = mesh;
+        patternSpaceMesh.transform(patternSpaceToDeviceSpaceMatrix.inverted());
+        PDFShadingMeshCache::getInstance()->insertMesh(*meshCacheKey, qMove(patternSpaceMesh));
+    }
+
+    return mesh;
 }
 
 void PDFPageContentProcessor::reportWarningAboutColorOperatorsInUTP()
@@ -3038,7 +3251,8 @@ void PDFPageContentProcessor::operatorPaintXObject(PDFOperandName name)
 
     if (m_xobjectDictionary)
     {
-        const PDFObject& object = m_document->getObject(m_xobjectDictionary->get(name.name));
+        const PDFObject& xobject = m_xobjectDictionary->get(name.name);
+        const PDFObject& object = m_document->getObject(xobject);
         if (object.isStream())
         {
             const PDFStream* stream = object.getStream();
@@ -3065,7 +3279,7 @@ void PDFPageContentProcessor::operatorPaintXObject(PDFOperandName name)
             QByteArray subtype = loader.readNameFromDictionary(streamDictionary, "Subtype");
             if (subtype == "Image")
             {
-                paintXObjectImage(stream);
+                paintXObjectImage(stream, xobject.isReference() ? xobject.getReference() : PDFObjectReference());
             }
             else if (subtype == "Form")
             {
@@ -3222,7 +3436,10 @@ void PDFPageContentProcessor::drawText(const TextSequence& textSequence)
                         if (!glyphPath.isEmpty())
                         {
                             QPainterPath transformedGlyph = textRenderingMatrix.map(glyphPath);
+                            m_currentTextGlyph.glyphId = item.glyphId;
+                            m_currentTextGlyph.glyphMatrix = textRenderingMatrix;
                             processPathPainting(transformedGlyph, stroke, fill, true, transformedGlyph.fillRule());
+                            m_currentTextGlyph = TextGlyph();
 
                             if (clipped)
                             {
@@ -3368,13 +3585,65 @@ void PDFPageContentProcessor::checkFillingColor()
     }
 }
 
+PDFPageContentProcessor::Operand::Operand(PDFLexicalAnalyzer::Token&& token) :
+    type(token.type)
+{
+    switch (token.type)
+    {
+        case PDFLexicalAnalyzer::TokenType::Boolean:
+            integer = token.getBool() ? 1 : 0;
+            break;
+
+        case PDFLexicalAnalyzer::TokenType::Integer:
+            integer = token.getInteger();
+            real = PDFReal(integer);
+            break;
+
+        case PDFLexicalAnalyzer::TokenType::Real:
+            real = token.getReal();
+            break;
+
+        case PDFLexicalAnalyzer::TokenType::String:
+        case PDFLexicalAnalyzer::TokenType::Name:
+        case PDFLexicalAnalyzer::TokenType::Command:
+            bytes = qMove(token.bytes);
+            break;
+
+        default:
+            break;
+    }
+}
+
+PDFLexicalAnalyzer::Token PDFPageContentProcessor::Operand::toToken() const
+{
+    switch (type)
+    {
+        case PDFLexicalAnalyzer::TokenType::Boolean:
+            return PDFLexicalAnalyzer::Token(type, integer != 0);
+
+        case PDFLexicalAnalyzer::TokenType::Integer:
+            return PDFLexicalAnalyzer::Token(type, integer);
+
+        case PDFLexicalAnalyzer::TokenType::Real:
+            return PDFLexicalAnalyzer::Token(type, real);
+
+        case PDFLexicalAnalyzer::TokenType::String:
+        case PDFLexicalAnalyzer::TokenType::Name:
+        case PDFLexicalAnalyzer::TokenType::Command:
+            return PDFLexicalAnalyzer::Token(type, bytes);
+
+        default:
+            return PDFLexicalAnalyzer::Token(type);
+    }
+}
+
 PDFObject PDFPageContentProcessor::readObjectFromOperandStack(size_t startPosition) const
 {
     auto tokenFetcher = [this, &startPosition]()
     {
         if (startPosition < m_operands.size())
         {
-            return m_operands[startPosition++];
+            return m_operands[startPosition++].toToken();
         }
         return PDFLexicalAnalyzer::Token();
     };
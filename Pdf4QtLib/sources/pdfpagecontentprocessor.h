@@ -34,6 +34,7 @@
 
 #include <stack>
 #include <tuple>
+#include <optional>
 #include <type_traits>
 
 namespace pdf
@@ -247,6 +248,14 @@ public:
     /// Returns true, if page content processing is being cancelled
     bool isProcessingCancelled() const;
 
+    /// Sets matrix, which maps device space of this processor to the target device
+    /// space (in pixels), in which the content will be finally painted. If it is set,
+    /// then images are decoded with the lowest resolution sufficient for the target
+    /// device (if decoder supports it). Content must not be painted with higher scale,
+    /// than given by this matrix, otherwise image quality is degraded.
+    /// \param matrix Matrix mapping device space of the processor to target device space
+    void setImageTargetMatrix(const QTransform& matrix) { m_imageTargetMatrix = matrix; }
+
 protected:
 
     struct PDFTransparencyGroup
@@ -572,6 +581,11 @@ protected:
     /// \returns true, if image is successfully processed
     virtual bool performOriginalImagePainting(const PDFImage& image);
 
+    /// Returns true, if final images of image XObjects can be taken from
+    /// the process-wide image cache (and stored into it). Image cache can be
+    /// used only, if processor doesn't process original images.
+    virtual bool isImageCacheEnabled() const;
+
     /// This function has to be implemented in the client drawing implementation, it should
     /// draw the image.
     /// \param image Image to be painted
@@ -678,6 +692,17 @@ protected:
     /// Returns current world matrix (translating actual point to the device point)
     QTransform getCurrentWorldMatrix() const { return getGraphicState()->getCurrentTransformationMatrix() * m_pagePointToDevicePointMatrix; }
 
+    /// Glyph of the font, which is being painted
+    struct TextGlyph
+    {
+        quint64 glyphId = 0;        ///< Unique identifier of the glyph (zero, if no glyph is being painted)
+        QTransform glyphMatrix;     ///< Transformation from glyph space to the user space
+    };
+
+    /// Returns glyph, which is being painted by text painting operator. Glyph is valid
+    /// only during path painting of the text, otherwise glyph identifier is zero.
+    const TextGlyph& getCurrentTextGlyph() const { return m_currentTextGlyph; }
+
     /// Returns page bounding rectangle in device space
     const QRectF& getPageBoundingRectDeviceSpace() const { return m_pageBoundingRectDeviceSpace; }
 
@@ -1001,7 +1026,21 @@ private:
     PDFObject readObjectFromOperandStack(size_t startPosition) const;
 
     /// Implementation of painting of XObject image
-    void paintXObjectImage(const PDFStream* stream);
+    /// \param stream Image stream
+    /// \param reference Reference to the image stream (invalid for inline images)
+    void paintXObjectImage(const PDFStream* stream, PDFObjectReference reference);
+
+    /// Returns true, if colors in the color space doesn't depend on
+    /// the resource dictionary (so final images or meshes using this
+    /// color space can be cached).
+    /// \param colorSpaceObject Color space of the image or shading
+    bool isColorSpaceCacheable(const PDFObject& colorSpaceObject) const;
+
+    /// Creates mesh of the shading pattern in the device space. Mesh is taken
+    /// from the process-wide shading mesh cache, if it is possible.
+    /// \param shadingPattern Shading pattern
+    /// \param settings Meshing settings
+    PDFMesh createShadingMesh(const PDFShadingPattern* shadingPattern, const PDFMeshQualitySettings& settings);
 
     /// Report warning about color operators in uncolored tiling pattern
     void reportWarningAboutColorOperatorsInUTP();
@@ -1032,8 +1071,27 @@ private:
     PDFColorSpacePointer m_deviceRGBColorSpace;
     PDFColorSpacePointer m_deviceCMYKColorSpace;
 
-    /// Array with current operand arguments
-    PDFFlatArray<PDFLexicalAnalyzer::Token, 33> m_operands;
+    /// Operand of the content stream operator. Values are stored directly (not in
+    /// the QVariant), so reading of operands doesn't need any type conversions.
+    struct Operand
+    {
+        Operand() = default;
+        explicit Operand(PDFLexicalAnalyzer::Token&& token);
+
+        /// Converts operand back to the token (used when object is parsed from operands)
+        PDFLexicalAnalyzer::Token toToken() const;
+
+        PDFLexicalAnalyzer::TokenType type = PDFLexicalAnalyzer::TokenType::EndOfFile;
+        PDFInteger integer = 0;     ///< Value of integer or boolean operand
+        PDFReal real = 0.0;         ///< Value of real operand (integer operand is converted too)
+        QByteArray bytes;           ///< Value of string or name operand
+    };
+
+    /// Array with current operand arguments. Operands are stored in the fixed size block,
+    /// only when there are more operands (for example, long arrays of text show operator),
+    /// they are stored in the variable block. Capacity of the variable block is kept,
+    /// so operand stack doesn't allocate memory when it is reused.
+    PDFFlatArray<Operand, 33> m_operands;
 
     /// Stack with saved graphic states
     std::stack<PDFPageContentProcessorState> m_stack;
@@ -1069,6 +1127,9 @@ private:
     /// is in device space coordinates.
     QPainterPath m_textClippingPath;
 
+    /// Glyph, which is currently being painted
+    TextGlyph m_currentTextGlyph;
+
     /// Base matrix to be used when drawing patterns. Concatenate this matrix
     /// with pattern matrix to get transformation from pattern space to device space.
     QTransform m_patternBaseMatrix;
@@ -1076,6 +1137,10 @@ private:
     /// Matrix mapping page points to the device points
     QTransform m_pagePointToDevicePointMatrix;
 
+    /// Matrix mapping device points to target device pixels, used to determine
+    /// resolution of decoded images (if not set, images are decoded at full resolution)
+    std::optional<QTransform> m_imageTargetMatrix;
+
     /// Bounding rectangle of pages media box in device space coordinates. If drawing rotation
     /// is zero, then it corresponds to the scaled media box of the page.
     QRectF m_pageBoundingRectDeviceSpace;
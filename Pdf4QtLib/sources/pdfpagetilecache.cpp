@@ -0,0 +1,369 @@
+//    Copyright (C) 2023 Jakub Melka
+//
+//    This file is part of PDF4QT.
+//
+//    PDF4QT is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    with the written consent of the copyright owner, any later version.
+//
+//    PDF4QT is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public License
+//    along with PDF4QT. If not, see <https://www.gnu.org/licenses/>.
+
+#include "pdfpagetilecache.h"
+#include "pdfpainter.h"
+#include "pdfdbgheap.h"
+
+#include <QPainter>
+#include <QPaintDevice>
+#include <QRegion>
+#include <QThread>
+#include <QtMath>
+#include <QtConcurrent/QtConcurrent>
+
+#include <algorithm>
+#include <limits>
+
+namespace pdf
+{
+
+PDFPageTileCache::PDFPageTileCache(QObject* parent) :
+    BaseClass(parent),
+    m_tiles(DEFAULT_LIMIT),
+    m_maxRunningJobs(qMax(QThread::idealThreadCount() - 1, 1))
+{
+
+}
+
+PDFPageTileCache::~PDFPageTileCache()
+{
+    m_queue.clear();
+
+    for (const auto& runningJob : m_runningJobs)
+    {
+        runningJob.first->disconnect(this);
+        runningJob.first->waitForFinished();
+    }
+}
+
+bool PDFPageTileCache::Key::isSamePageSettings(const Key& other) const
+{
+    return pageIndex == other.pageIndex &&
+           devicePixelRatio == other.devicePixelRatio &&
+           features == other.features &&
+           paperColor == other.paperColor &&
+           opacity == other.opacity;
+}
+
+void PDFPageTileCache::drawPage(QPainter* painter, const Page& page, QRect placedRect, QRect rect)
+{
+    Q_ASSERT(painter);
+    Q_ASSERT(page.compiledPage);
+    Q_ASSERT(page.size == placedRect.size());
+
+    const qreal devicePixelRatio = painter->device()->devicePixelRatioF();
+    const QRect pageRect(QPoint(0, 0), page.size);
+    const QRect visibleRect = rect.intersected(placedRect).translated(-placedRect.topLeft());
+
+    if (visibleRect.isEmpty())
+    {
+        return;
+    }
+
+    // Tiles of this page queued for another zoom (or other settings) are not needed anymore
+    const Key pageKey = createKey(page, devicePixelRatio, 0, 0);
+    auto isObsolete = [&pageKey](const Job& job)
+    {
+        return job.key.pageIndex == pageKey.pageIndex && (!job.key.isSamePageSettings(pageKey) || job.key.width != pageKey.width || job.key.height != pageKey.height);
+    };
+    m_queue.erase(std::remove_if(m_queue.begin(), m_queue.end(), isObsolete), m_queue.end());
+
+    const QPoint offset = placedRect.topLeft();
+    const int firstColumn = visibleRect.left() / TILE_SIZE;
+    const int lastColumn = visibleRect.right() / TILE_SIZE;
+    const int firstRow = visibleRect.top() / TILE_SIZE;
+    const int lastRow = visibleRect.bottom() / TILE_SIZE;
+
+    // Keys are retrieved only when some tile is missing
+    QList<Key> keys;
+    bool keysRetrieved = false;
+
+    painter->save();
+    painter->setRenderHint(QPainter::SmoothPixmapTransform, true);
+
+    for (int row = firstRow; row <= lastRow; ++row)
+    {
+        for (int column = firstColumn; column <= lastColumn; ++column)
+        {
+            const Key key = createKey(page, devicePixelRatio, column, row);
+            const QRect tileRect = getTileRect(key).intersected(pageRect);
+
+            if (const QImage* image = m_tiles.object(key))
+            {
+                painter->drawImage(tileRect.translated(offset), *image);
+                continue;
+            }
+
+            if (!keysRetrieved)
+            {
+                keys = m_tiles.keys();
+                keysRetrieved = true;
+            }
+
+            if (drawScaledTiles(painter, key, tileRect, offset, keys))
+            {
+                // Sharp tile will be rendered asynchronously
+                enqueue({ key, page, tileRect, devicePixelRatio });
+            }
+            else
+            {
+                // We have nothing to show, so we must render the tile immediately
+                QImage image = renderTile(page, tileRect, devicePixelRatio);
+                painter->drawImage(tileRect.translated(offset), image);
+                const qint64 cost = image.sizeInBytes();
+                m_tiles.insert(key, new QImage(qMove(image)), cost);
+            }
+        }
+    }
+
+    painter->restore();
+
+    // Prefetch tiles around the visible area, so scrolling doesn't need to render them
+    for (int row = firstRow - 1; row <= lastRow + 1; ++row)
+    {
+        for (int column = firstColumn - 1; column <= lastColumn + 1; ++column)
+        {
+            const bool isVisible = row >= firstRow && row <= lastRow && column >= firstColumn && column <= lastColumn;
+            if (isVisible || row < 0 || column < 0)
+            {
+                continue;
+            }
+
+            const Key key = createKey(page, devicePixelRatio, column, row);
+            const QRect tileRect = getTileRect(key).intersected(pageRect);
+            if (!tileRect.isEmpty())
+            {
+                enqueue({ key, page, tileRect, devicePixelRatio });
+            }
+        }
+    }
+
+    startJobs();
+}
+
+void PDFPageTileCache::invalidate(bool all, const std::vector<PDFInteger>& pages)
+{
+    // Results of running jobs of invalidated pages are discarded
+    ++m_generation;
+
+    if (all)
+    {
+        m_invalidationGeneration = m_generation;
+        m_pageInvalidationGenerations.clear();
+        m_tiles.clear();
+        m_queue.clear();
+        return;
+    }
+
+    for (PDFInteger pageIndex : pages)
+    {
+        m_pageInvalidationGenerations[pageIndex] = m_generation;
+    }
+
+    auto isInvalidated = [&pages](PDFInteger pageIndex)
+    {
+        return std::find(pages.cbegin(), pages.cend(), pageIndex) != pages.cend();
+    };
+
+    const QList<Key> keys = m_tiles.keys();
+    for (const Key& key : keys)
+    {
+        if (isInvalidated(key.pageIndex))
+        {
+            m_tiles.remove(key);
+        }
+    }
+
+    m_queue.erase(std::remove_if(m_queue.begin(), m_queue.end(), [&](const Job& job) { return isInvalidated(job.key.pageIndex); }), m_queue.end());
+}
+
+void PDFPageTileCache::setLimit(qint64 limit)
+{
+    m_tiles.setMaxCost(limit);
+}
+
+QImage PDFPageTileCache::renderTile(const Page& page, QRect tileRect, qreal devicePixelRatio)
+{
+    QImage image(qCeil(tileRect.width() * devicePixelRatio), qCeil(tileRect.height() * devicePixelRatio), QImage::Format_ARGB32_Premultiplied);
+    image.setDevicePixelRatio(devicePixelRatio);
+    image.fill(page.paperColor.isValid() ? page.paperColor : QColor(Qt::transparent));
+
+    QPainter painter(&image);
+    QTransform matrix = page.pagePointToDevicePointMatrix * QTransform::fromTranslate(-tileRect.left(), -tileRect.top());
+    page.compiledPage->draw(&painter, page.cropBox, matrix, page.features, page.opacity, QRectF(QPointF(0, 0), tileRect.size()));
+    painter.end();
+
+    return image;
+}
+
+PDFPageTileCache::Key PDFPageTileCache::createKey(const Page& page, qreal devicePixelRatio, int column, int row)
+{
+    Key key;
+    key.pageIndex = page.pageIndex;
+    key.width = page.size.width();
+    key.height = page.size.height();
+    key.devicePixelRatio = qRound(devicePixelRatio * 1000.0);
+    key.features = int(page.features);
+    key.paperColor = page.paperColor.isValid() ? page.paperColor.rgba() : 0;
+    key.opacity = page.opacity;
+    key.column = column;
+    key.row = row;
+    return key;
+}
+
+QRect PDFPageTileCache::getTileRect(const Key& key)
+{
+    return QRect(key.column * TILE_SIZE, key.row * TILE_SIZE, TILE_SIZE, TILE_SIZE);
+}
+
+bool PDFPageTileCache::drawScaledTiles(QPainter* painter, const Key& key, QRect tileRect, QPoint offset, const QList<Key>& keys)
+{
+    // Find page size of the other zoom, which is nearest to the current page size.
+    // Larger tiles are preferred, because they lose less detail, when scaled down.
+    QSize bestSize;
+    int bestDifference = std::numeric_limits<int>::max();
+    for (const Key& otherKey : keys)
+    {
+        if (!otherKey.isSamePageSettings(key) || (otherKey.width == key.width && otherKey.height == key.height))
+        {
+            continue;
+        }
+
+        const int difference = qAbs(otherKey.width - key.width) * (otherKey.width < key.width ? 2 : 1);
+        if (difference < bestDifference)
+        {
+            bestDifference = difference;
+            bestSize = QSize(otherKey.width, otherKey.height);
+        }
+    }
+
+    if (!bestSize.isValid())
+    {
+        return false;
+    }
+
+    const qreal scaleX = qreal(key.width) / qreal(bestSize.width());
+    const qreal scaleY = qreal(key.height) / qreal(bestSize.height());
+    const QRect otherPageRect(QPoint(0, 0), bestSize);
+
+    QRegion coveredRegion;
+    painter->save();
+    painter->setClipRect(tileRect.translated(offset), Qt::IntersectClip);
+
+    for (const Key& otherKey : keys)
+    {
+        if (!otherKey.isSamePageSettings(key) || otherKey.width != bestSize.width() || otherKey.height != bestSize.height())
+        {
+            continue;
+        }
+
+        const QRect otherTileRect = getTileRect(otherKey).intersected(otherPageRect);
+        const QRectF targetRect(otherTileRect.left() * scaleX, otherTileRect.top() * scaleY, otherTileRect.width() * scaleX, otherTileRect.height() * scaleY);
+        if (!targetRect.intersects(tileRect))
+        {
+            continue;
+        }
+
+        if (const QImage* image = m_tiles.object(otherKey))
+        {
+            painter->drawImage(targetRect.translated(offset), *image);
+            coveredRegion += targetRect.toAlignedRect().intersected(tileRect);
+        }
+    }
+
+    painter->restore();
+    return QRegion(tileRect).subtracted(coveredRegion).isEmpty();
+}
+
+void PDFPageTileCache::enqueue(Job job)
+{
+    if (m_tiles.contains(job.key))
+    {
+        return;
+    }
+
+    for (const auto& runningJob : m_runningJobs)
+    {
+        // Outdated running job doesn't prevent rendering of the tile
+        if (runningJob.second.key == job.key && !isInvalidated(job.key.pageIndex, runningJob.second.generation))
+        {
+            return;
+        }
+    }
+
+    for (const Job& queuedJob : m_queue)
+    {
+        if (queuedJob.key == job.key)
+        {
+            return;
+        }
+    }
+
+    m_queue.push_back(qMove(job));
+
+    // Oldest jobs are usually prefetched tiles, which are no longer needed
+    while (m_queue.size() > MAX_QUEUED_JOBS)
+    {
+        m_queue.pop_front();
+    }
+}
+
+void PDFPageTileCache::startJobs()
+{
+    while (!m_queue.empty() && int(m_runningJobs.size()) < m_maxRunningJobs)
+    {
+        Job job = qMove(m_queue.front());
+        m_queue.pop_front();
+
+        QFutureWatcher<QImage>* watcher = new QFutureWatcher<QImage>(this);
+        m_runningJobs[watcher] = { job.key, m_generation };
+
+        connect(watcher, &QFutureWatcher<QImage>::finished, this, [this, watcher]() { onJobFinished(watcher); });
+        watcher->setFuture(QtConcurrent::run([job]() { return renderTile(job.page, job.tileRect, job.devicePixelRatio); }));
+    }
+}
+
+bool PDFPageTileCache::isInvalidated(PDFInteger pageIndex, quint64 generation) const
+{
+    if (generation < m_invalidationGeneration)
+    {
+        return true;
+    }
+
+    auto it = m_pageInvalidationGenerations.find(pageIndex);
+    return it != m_pageInvalidationGenerations.cend() && generation < it->second;
+}
+
+void PDFPageTileCache::onJobFinished(QFutureWatcher<QImage>* watcher)
+{
+    QImage image = watcher->result();
+    const RunningJob runningJob = m_runningJobs.at(watcher);
+    m_runningJobs.erase(watcher);
+    watcher->deleteLater();
+
+    if (!isInvalidated(runningJob.key.pageIndex, runningJob.generation))
+    {
+        const qint64 cost = image.sizeInBytes();
+        m_tiles.insert(runningJob.key, new QImage(qMove(image)), cost);
+        Q_EMIT tileRendered();
+    }
+
+    startJobs();
+}
+
+}   // namespace pdf
@@ -0,0 +1,177 @@
+//    Copyright (C) 2023 Jakub Melka
+//
+//    This file is part of PDF4QT.
+//
+//    PDF4QT is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    with the written consent of the copyright owner, any later version.
+//
+//    PDF4QT is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public License
+//    along with PDF4QT. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef PDFPAGETILECACHE_H
+#define PDFPAGETILECACHE_H
+
+#include "pdfrenderer.h"
+
+#include <QCache>
+#include <QImage>
+#include <QColor>
+#include <QFutureWatcher>
+
+#include <deque>
+#include <map>
+
+namespace pdf
+{
+class PDFPrecompiledPage;
+
+/// Cache of rasterized page tiles used by the draw widget proxy. Page is divided
+/// into tiles of fixed size (in device independent pixels), which are rendered
+/// from the precompiled page. Repaint of the view (for example, when scrolling,
+/// or when tool overlay is changed) then just draws cached tile images. Tiles are
+/// identified by page, page size in pixels (so zoom and rotation) and rendering
+/// parameters. When zoom is changed, tiles for the previous zoom are drawn scaled,
+/// while sharp tiles are being rendered on worker threads.
+class PDF4QTLIBSHARED_EXPORT PDFPageTileCache : public QObject
+{
+    Q_OBJECT
+
+private:
+    using BaseClass = QObject;
+
+public:
+    explicit PDFPageTileCache(QObject* parent);
+    virtual ~PDFPageTileCache() override;
+
+    /// Size of the tile in device independent pixels
+    static constexpr int TILE_SIZE = 256;
+
+    /// Default limit of total size of tile images in bytes
+    static constexpr qint64 DEFAULT_LIMIT = 128 * 1024 * 1024;
+
+    /// Page, which is drawn using tiles
+    struct Page
+    {
+        PDFInteger pageIndex = -1;
+        QSharedPointer<const PDFPrecompiledPage> compiledPage;
+        QRectF cropBox;
+        QTransform pagePointToDevicePointMatrix;    ///< Transforms page to the rectangle (0, 0, size)
+        QSize size;                                 ///< Size of the page rectangle in pixels
+        PDFRenderer::Features features;
+        PDFReal opacity = 1.0;
+        QColor paperColor;                          ///< Paper color (invalid color, if paper is not drawn)
+    };
+
+    struct Key
+    {
+        PDFInteger pageIndex = -1;
+        int width = 0;
+        int height = 0;
+        int devicePixelRatio = 0;                   ///< Device pixel ratio multiplied by 1000
+        int features = 0;
+        QRgb paperColor = 0;
+        PDFReal opacity = 1.0;
+        int column = 0;
+        int row = 0;
+
+        bool operator==(const Key&) const = default;
+
+        /// Returns true, if tile belongs to the page drawn with same settings,
+        /// but page can have different size (tile has different zoom).
+        bool isSamePageSettings(const Key& other) const;
+    };
+
+    /// Draws part \p rect of the page, which is placed at \p placedRect. Cached tiles
+    /// are drawn, missing tiles are drawn scaled from tiles of other zoom, if they
+    /// are available, and sharp tiles are rendered asynchronously. If no such tiles
+    /// are available, missing tiles are rendered immediately. Tiles surrounding
+    /// the visible area are prefetched asynchronously.
+    /// \param painter Painter (must not have transformation)
+    /// \param page Page to be drawn
+    /// \param placedRect Rectangle of the page in painter's coordinates
+    /// \param rect Part of the painter area, which is being painted
+    void drawPage(QPainter* painter, const Page& page, QRect placedRect, QRect rect);
+
+    /// Removes tiles of the given pages (or all tiles). Tiles, which are being
+    /// rendered for these pages, are discarded, tiles of other pages are kept.
+    /// \param all Remove all tiles
+    /// \param pages Pages, whose tiles are removed
+    void invalidate(bool all, const std::vector<PDFInteger>& pages);
+
+    /// Sets limit of total size of tile images in bytes
+    void setLimit(qint64 limit);
+
+    /// Draws part of the page to the new tile image
+    /// \param page Page
+    /// \param tileRect Tile rectangle in page rectangle coordinates
+    /// \param devicePixelRatio Device pixel ratio of the image
+    static QImage renderTile(const Page& page, QRect tileRect, qreal devicePixelRatio);
+
+signals:
+    /// Emitted when tile has been rendered asynchronously, so view should be repainted
+    void tileRendered();
+
+private:
+    /// Maximal number of tiles waiting for rendering
+    static constexpr size_t MAX_QUEUED_JOBS = 128;
+
+    struct Job
+    {
+        Key key;
+        Page page;
+        QRect tileRect;
+        qreal devicePixelRatio = 1.0;
+    };
+
+    struct RunningJob
+    {
+        Key key;
+        quint64 generation = 0;                     ///< Generation, in which job was started
+    };
+
+    /// Returns key of the tile
+    static Key createKey(const Page& page, qreal devicePixelRatio, int column, int row);
+
+    /// Returns rectangle of the tile in page rectangle coordinates
+    static QRect getTileRect(const Key& key);
+
+    /// Draws tiles of other zoom, which are covering tile \p key, scaled to the current
+    /// zoom. Returns true, if tile is covered completely.
+    bool drawScaledTiles(QPainter* painter, const Key& key, QRect tileRect, QPoint offset, const QList<Key>& keys);
+
+    /// Adds tile to the render queue, if it is not already rendered or queued
+    void enqueue(Job job);
+
+    /// Starts queued jobs, if there are free workers
+    void startJobs();
+
+    /// Returns true, if page was invalidated after the given generation,
+    /// so tiles of the page rendered in this generation are outdated.
+    bool isInvalidated(PDFInteger pageIndex, quint64 generation) const;
+
+    void onJobFinished(QFutureWatcher<QImage>* watcher);
+
+    QCache<Key, QImage> m_tiles;
+    std::deque<Job> m_queue;
+    std::map<QFutureWatcher<QImage>*, RunningJob> m_runningJobs;
+    quint64 m_generation = 0;                                       ///< Increased by each invalidation
+    quint64 m_invalidationGeneration = 0;                           ///< Generation, in which all pages were invalidated
+    std::map<PDFInteger, quint64> m_pageInvalidationGenerations;    ///< Generations, in which pages were invalidated
+    int m_maxRunningJobs = 1;
+};
+
+inline size_t qHash(const PDFPageTileCache::Key& key, size_t seed = 0)
+{
+    return qHashMulti(seed, key.pageIndex, key.width, key.height, key.devicePixelRatio, key.features, key.paperColor, key.opacity, key.column, key.row);
+}
+
+}   // namespace pdf
+
+#endif // PDFPAGETILECACHE_H
@@ -21,7 +21,10 @@
 #include "pdfdbgheap.h"
 
 #include <QPainter>
+#include <QPaintDevice>
+#include <QPaintEngine>
 #include <QCryptographicHash>
+#include <QtMath>
 
 namespace pdf
 {
@@ -238,6 +241,11 @@ void PDFPainterBase::performEndTransparencyGroup(ProcessOrder order, const PDFTr
     }
 }
 
+bool PDFPainterBase::isImageCacheEnabled() const
+{
+    return true;
+}
+
 PDFPainter::PDFPainter(QPainter* painter,
                        PDFRenderer::Features features,
                        QTransform pagePointToDevicePointMatrix,
@@ -419,6 +427,13 @@ void PDFPrecompiledPageGenerator::performPathPainting(const QPainterPath& path,
     Q_ASSERT(stroke || fill);
     Q_ASSERT(path.fillRule() == fillRule);
 
+    const TextGlyph& glyph = getCurrentTextGlyph();
+    if (text && fill && !stroke && glyph.glyphId)
+    {
+        m_precompiledPage->addGlyphPath(getCurrentBrush(), path, glyph.glyphId, glyph.glyphMatrix);
+        return;
+    }
+
     QPen pen = stroke ? getCurrentPen() : QPen(Qt::NoPen);
     QBrush brush = fill ? getCurrentBrush() : QBrush(Qt::NoBrush);
     m_precompiledPage->addPath(qMove(pen), qMove(brush), path, text);
@@ -494,6 +509,14 @@ void PDFPrecompiledPageGenerator::performRestoreGraphicState(PDFPageContentProce
     }
 }
 
+void PDFPrecompiledPageGenerator::performOutputCharacter(const PDFTextCharacterInfo& info)
+{
+    if (m_textLayout && !isContentSuppressed() && !info.character.isSpace())
+    {
+        m_textLayout->addCharacter(info);
+    }
+}
+
 void PDFPrecompiledPageGenerator::setWorldMatrix(const QTransform& matrix)
 {
     m_precompiledPage->addSetWorldMatrix(matrix);
@@ -508,11 +531,48 @@ void PDFPrecompiledPage::draw(QPainter* painter,
                               const QRectF& cropBox,
                               const QTransform& pagePointToDevicePointMatrix,
                               PDFRenderer::Features features,
-                              PDFReal opacity) const
+                              PDFReal opacity,
+                              const QRectF& exposedRect) const
 {
     Q_ASSERT(painter);
     Q_ASSERT(pagePointToDevicePointMatrix.isInvertible());
 
+    // Determine painted area in page coordinates. Area is enlarged by cosmetic pen
+    // width and a small margin for antialiasing, because cosmetic pens
+    // have width in device pixels and aren't included in bounding boxes.
+    const bool isCullingEnabled = exposedRect.isValid() && m_instructionBounds.size() == m_instructions.size();
+    QRectF exposedPageRect;
+    if (isCullingEnabled)
+    {
+        const PDFReal margin = m_maxCosmeticPenWidth * 0.5 + 2.0;
+        exposedPageRect = pagePointToDevicePointMatrix.inverted().mapRect(exposedRect.adjusted(-margin, -margin, margin, margin));
+    }
+
+    // Bounding boxes can be degenerate (for example, horizontal line drawn
+    // by cosmetic pen), so touching rectangles are considered as intersecting.
+    auto isOutside = [&exposedPageRect](const QRectF& boundingBox)
+    {
+        return boundingBox.right() < exposedPageRect.left() || boundingBox.left() > exposedPageRect.right() ||
+               boundingBox.bottom() < exposedPageRect.top() || boundingBox.top() > exposedPageRect.bottom();
+    };
+
+    auto isCulled = [&](size_t index)
+    {
+        if (!isCullingEnabled)
+        {
+            return false;
+        }
+
+        const InstructionBlockBounds& blockBounds = m_instructionBlockBounds[index / INSTRUCTION_BLOCK_SIZE];
+        if (blockBounds.isBounded && isOutside(blockBounds.boundingBox))
+        {
+            return true;
+        }
+
+        const InstructionBounds& bounds = m_instructionBounds[index];
+        return bounds.isBounded && isOutside(bounds.boundingBox);
+    };
+
     painter->save();
     painter->setWorldTransform(QTransform());
     painter->setOpacity(opacity);
@@ -530,16 +590,29 @@ void PDFPrecompiledPage::draw(QPainter* painter,
     painter->setRenderHint(QPainter::SmoothPixmapTransform, features.testFlag(PDFRenderer::SmoothImages));
 
     // Process all instructions
-    for (const Instruction& instruction : m_instructions)
+    for (size_t i = 0, instructionCount = m_instructions.size(); i < instructionCount; ++i)
     {
+        const Instruction& instruction = m_instructions[i];
         switch (instruction.type)
         {
             case InstructionType::DrawPath:
             {
+                if (isCulled(i))
+                {
+                    break;
+                }
+
                 const PathPaintData& data = m_paths[instruction.dataIndex];
 
                 // Set antialiasing
                 const bool antialiasing = (data.isText && features.testFlag(PDFRenderer::TextAntialiasing)) || (!data.isText && features.testFlag(PDFRenderer::Antialiasing));
+
+                if (data.glyphId && features.testFlag(PDFRenderer::GlyphCache) &&
+                    PDFGlyphAtlas::getInstance()->drawGlyph(painter, data.path, data.brush, data.glyphId, data.glyphMatrix, antialiasing))
+                {
+                    break;
+                }
+
                 painter->setRenderHint(QPainter::Antialiasing, antialiasing);
                 painter->setPen(data.pen);
                 painter->setBrush(data.brush);
@@ -549,6 +622,11 @@ void PDFPrecompiledPage::draw(QPainter* painter,
 
             case InstructionType::DrawImage:
             {
+                if (isCulled(i))
+                {
+                    break;
+                }
+
                 const ImageData& data = m_images[instruction.dataIndex];
                 const QImage& image = data.image;
 
@@ -570,6 +648,11 @@ void PDFPrecompiledPage::draw(QPainter* painter,
 
             case InstructionType::DrawMesh:
             {
+                if (isCulled(i))
+                {
+                    break;
+                }
+
                 const MeshPaintData& data = m_meshes[instruction.dataIndex];
 
                 painter->save();
@@ -581,6 +664,18 @@ void PDFPrecompiledPage::draw(QPainter* painter,
 
             case InstructionType::Clip:
             {
+                if (isCullingEnabled)
+                {
+                    const InstructionBounds& bounds = m_instructionBounds[i];
+                    if (bounds.isBounded && isOutside(bounds.boundingBox))
+                    {
+                        // Nothing is visible until the clip is restored, so we can skip all
+                        // instructions in the clip scope. Restoring instruction is executed.
+                        i = bounds.scopeEnd - 1;
+                        break;
+                    }
+                }
+
                 painter->setClipPath(m_clips[instruction.dataIndex].clipPath, Qt::IntersectClip);
                 break;
             }
@@ -647,6 +742,7 @@ void PDFPrecompiledPage::redact(QPainterPath redactPath, const QTransform& matri
                 QPainterPath mappedRedactPath = currentMatrix.map(redactPath);
                 PathPaintData& path = m_paths[instruction.dataIndex];
                 path.path = path.path.subtracted(mappedRedactPath);
+                path.glyphId = 0;
                 break;
             }
 
@@ -710,6 +806,8 @@ void PDFPrecompiledPage::redact(QPainterPath redactPath, const QTransform& matri
         addRestoreGraphicState();
         addPath(Qt::NoPen, QBrush(color), matrix.map(redactPath), false);
     }
+
+    buildInstructionBounds();
 }
 
 void PDFPrecompiledPage::addPath(QPen pen, QBrush brush, QPainterPath path, bool isText)
@@ -718,6 +816,14 @@ void PDFPrecompiledPage::addPath(QPen pen, QBrush brush, QPainterPath path, bool
     m_paths.emplace_back(qMove(pen), qMove(brush), qMove(path), isText);
 }
 
+void PDFPrecompiledPage::addGlyphPath(QBrush brush, QPainterPath path, quint64 glyphId, const QTransform& glyphMatrix)
+{
+    m_instructions.emplace_back(InstructionType::DrawPath, m_paths.size());
+    PathPaintData& data = m_paths.emplace_back(QPen(Qt::NoPen), qMove(brush), qMove(path), true);
+    data.glyphId = glyphId;
+    data.glyphMatrix = glyphMatrix;
+}
+
 void PDFPrecompiledPage::addClip(QPainterPath path)
 {
     m_instructions.emplace_back(InstructionType::Clip, m_clips.size());
@@ -803,6 +909,8 @@ void PDFPrecompiledPage::finalize(qint64 compilingTimeNS, QList<PDFRenderError>
     m_compilingTimeNS = compilingTimeNS;
     m_errors = qMove(errors);
 
+    buildInstructionBounds();
+
     // Determine memory consumption
     m_memoryConsumptionEstimate = sizeof(*this);
     m_memoryConsumptionEstimate += sizeof(Instruction) * m_instructions.capacity();
@@ -812,6 +920,8 @@ void PDFPrecompiledPage::finalize(qint64 compilingTimeNS, QList<PDFRenderError>
     m_memoryConsumptionEstimate += sizeof(MeshPaintData) * m_meshes.capacity();
     m_memoryConsumptionEstimate += sizeof(QTransform) * m_matrices.capacity();
     m_memoryConsumptionEstimate += sizeof(QPainter::CompositionMode) * m_compositionModes.capacity();
+    m_memoryConsumptionEstimate += sizeof(InstructionBounds) * m_instructionBounds.capacity();
+    m_memoryConsumptionEstimate += sizeof(InstructionBlockBounds) * m_instructionBlockBounds.capacity();
     m_memoryConsumptionEstimate += sizeof(PDFRenderError) * m_errors.size();
 
     auto calculateQPathMemoryConsumption = [](const QPainterPath& path)
@@ -836,6 +946,148 @@ void PDFPrecompiledPage::finalize(qint64 compilingTimeNS, QList<PDFRenderError>
     }
 }
 
+void PDFPrecompiledPage::buildInstructionBounds()
+{
+    const size_t instructionCount = m_instructions.size();
+
+    m_instructionBounds.clear();
+    m_instructionBounds.resize(instructionCount);
+    m_instructionBlockBounds.clear();
+    m_instructionBlockBounds.resize((instructionCount + INSTRUCTION_BLOCK_SIZE - 1) / INSTRUCTION_BLOCK_SIZE);
+    m_maxCosmeticPenWidth = 0.0;
+
+    struct State
+    {
+        QTransform matrix;
+        bool hasMatrix = false;         ///< Until world matrix is set, graphics is in device coordinates
+        std::vector<size_t> clips;      ///< Clip instructions, which are restored with this state
+    };
+
+    std::vector<State> stateStack;
+    stateStack.emplace_back();
+
+    for (size_t i = 0; i < instructionCount; ++i)
+    {
+        const Instruction& instruction = m_instructions[i];
+        InstructionBounds& bounds = m_instructionBounds[i];
+        State& state = stateStack.back();
+
+        auto setBoundingBox = [&](const QRectF& boundingBox)
+        {
+            bounds.isBounded = state.hasMatrix;
+            bounds.boundingBox = state.matrix.mapRect(boundingBox);
+        };
+
+        switch (instruction.type)
+        {
+            case InstructionType::DrawPath:
+            {
+                const PathPaintData& data = m_paths[instruction.dataIndex];
+                QRectF boundingBox = data.path.controlPointRect();
+
+                if (data.pen.style() != Qt::NoPen)
+                {
+                    if (data.pen.isCosmetic())
+                    {
+                        m_maxCosmeticPenWidth = qMax(m_maxCosmeticPenWidth, qMax(data.pen.widthF(), 1.0));
+                    }
+                    else
+                    {
+                        // Miter joins can exceed the half of the pen width, up to the miter limit
+                        const PDFReal margin = data.pen.widthF() * 0.5 * qMax(data.pen.miterLimit(), 2.0);
+                        boundingBox.adjust(-margin, -margin, margin, margin);
+                    }
+                }
+
+                setBoundingBox(boundingBox);
+                break;
+            }
+
+            case InstructionType::DrawImage:
+                setBoundingBox(QRectF(0.0, 0.0, 1.0, 1.0));
+                break;
+
+            case InstructionType::DrawMesh:
+            {
+                // Mesh is painted in page coordinates and it is bounded only by bounding path
+                const QPainterPath& boundingPath = m_meshes[instruction.dataIndex].mesh.getBoundingPath();
+                bounds.isBounded = !boundingPath.isEmpty();
+                bounds.boundingBox = boundingPath.boundingRect();
+                break;
+            }
+
+            case InstructionType::Clip:
+            {
+                setBoundingBox(m_clips[instruction.dataIndex].clipPath.boundingRect());
+                bounds.scopeEnd = instructionCount;
+                state.clips.push_back(i);
+                break;
+            }
+
+            case InstructionType::SaveGraphicState:
+            {
+                State newState;
+                newState.matrix = state.matrix;
+                newState.hasMatrix = state.hasMatrix;
+                stateStack.push_back(qMove(newState));
+                break;
+            }
+
+            case InstructionType::RestoreGraphicState:
+            {
+                if (stateStack.size() > 1)
+                {
+                    for (size_t clipIndex : state.clips)
+                    {
+                        m_instructionBounds[clipIndex].scopeEnd = i;
+                    }
+                    stateStack.pop_back();
+                }
+                break;
+            }
+
+            case InstructionType::SetWorldMatrix:
+            {
+                state.matrix = m_matrices[instruction.dataIndex];
+                state.hasMatrix = true;
+                break;
+            }
+
+            case InstructionType::SetCompositionMode:
+                break;
+
+            default:
+            {
+                Q_ASSERT(false);
+                break;
+            }
+        }
+
+        // Update block bounds by painting instructions
+        if (instruction.type == InstructionType::DrawPath ||
+            instruction.type == InstructionType::DrawImage ||
+            instruction.type == InstructionType::DrawMesh)
+        {
+            InstructionBlockBounds& blockBounds = m_instructionBlockBounds[i / INSTRUCTION_BLOCK_SIZE];
+            blockBounds.isBounded = blockBounds.isBounded && bounds.isBounded;
+
+            if (!blockBounds.hasBoundingBox)
+            {
+                blockBounds.boundingBox = bounds.boundingBox;
+                blockBounds.hasBoundingBox = true;
+            }
+            else
+            {
+                // We can't use QRectF::united, because it ignores degenerate rectangles
+                const QRectF& box = bounds.boundingBox;
+                QRectF& blockBox = blockBounds.boundingBox;
+                blockBox.setCoords(qMin(blockBox.left(), box.left()), qMin(blockBox.top(), box.top()),
+                                   qMax(blockBox.right(), box.right()), qMax(blockBox.bottom(), box.bottom()));
+            }
+        }
+    }
+}
+
 PDFPrecompiledPage::GraphicPieceInfos PDFPrecompiledPage::calculateGraphicPieceInfos(QRectF mediaBox,
                                                                                      PDFReal epsilon) const
 {
@@ -1056,4 +1308,156 @@ PDFPrecompiledPage::GraphicPieceInfos PDFPrecompiledPage::calculateGraphicPieceI
     return infos;
 }
 
+
+PDFGlyphAtlas* PDFGlyphAtlas::getInstance()
+{
+    static PDFGlyphAtlas instance;
+    return &instance;
+}
+
+bool PDFGlyphAtlas::drawGlyph(QPainter* painter,
+                              const QPainterPath& path,
+                              const QBrush& brush,
+                              quint64 glyphId,
+                              const QTransform& glyphMatrix,
+                              bool antialiasing)
+{
+    // Glyph images are only used for raster devices, printers and vector
+    // devices (such as pdf writer) must get glyphs as paths.
+    QPaintEngine* paintEngine = painter->paintEngine();
+    if (!paintEngine || paintEngine->type() != QPaintEngine::Raster)
+    {
+        return false;
+    }
+
+    if (brush.style() != Qt::SolidPattern ||
+        painter->compositionMode() != QPainter::CompositionMode_SourceOver ||
+        painter->viewTransformEnabled() ||
+        !glyphMatrix.isInvertible())
+    {
+        return false;
+    }
+
+    const qreal devicePixelRatio = painter->device()->devicePixelRatioF();
+    const QTransform worldMatrix = painter->worldTransform();
+    const QTransform deviceMatrix = worldMatrix * QTransform::fromScale(devicePixelRatio, devicePixelRatio);
+    const QTransform glyphToDeviceMatrix = glyphMatrix * deviceMatrix;
+
+    // Rotated or skewed glyphs are drawn as paths
+    if (glyphToDeviceMatrix.type() > QTransform::TxScale)
+    {
+        return false;
+    }
+
+    const QRectF deviceBoundingRect = deviceMatrix.mapRect(path.controlPointRect());
+    if (deviceBoundingRect.width() > MAX_GLYPH_SIZE || deviceBoundingRect.height() > MAX_GLYPH_SIZE)
+    {
+        return false;
+    }
+
+    // Split origin of the glyph to the whole pixel position and quantized subpixel position
+    const QPointF origin = glyphToDeviceMatrix.map(QPointF(0.0, 0.0));
+    auto splitCoordinate = [](qreal value, int& pixel, int& subpixel)
+    {
+        pixel = qFloor(value);
+        subpixel = qRound((value - pixel) * SUBPIXEL_POSITIONS);
+
+        if (subpixel == SUBPIXEL_POSITIONS)
+        {
+            ++pixel;
+            subpixel = 0;
+        }
+    };
+
+    Key key;
+    key.glyphId = glyphId;
+    key.scaleX = qRound(glyphToDeviceMatrix.m11() * SCALE_QUANTIZATION);
+    key.scaleY = qRound(glyphToDeviceMatrix.m22() * SCALE_QUANTIZATION);
+    key.color = brush.color().rgba();
+    key.antialiasing = antialiasing;
+
+    int originX = 0;
+    int originY = 0;
+    splitCoordinate(origin.x(), originX, key.subpixelX);
+    splitCoordinate(origin.y(), originY, key.subpixelY);
+
+    if (key.scaleX == 0 || key.scaleY == 0)
+    {
+        return false;
+    }
+
+    Sprite sprite;
+    bool isCached = false;
+
+    {
+        QMutexLocker lock(&m_mutex);
+        if (const Sprite* cachedSprite = m_cache.object(key))
+        {
+            sprite = *cachedSprite;
+            isCached = true;
+        }
+    }
+
+    if (!isCached)
+    {
+        // Glyph is rasterized with quantized scale and subpixel position, so it
+        // looks the same for all occurences of the glyph with the same key.
+        const QTransform spriteMatrix(key.scaleX / SCALE_QUANTIZATION, 0.0,
+                                      0.0, key.scaleY / SCALE_QUANTIZATION,
+                                      qreal(key.subpixelX) / SUBPIXEL_POSITIONS, qreal(key.subpixelY) / SUBPIXEL_POSITIONS);
+        const QPainterPath spritePath = (glyphMatrix.inverted() * spriteMatrix).map(path);
+        const QRect spriteRect = spritePath.controlPointRect().toAlignedRect().adjusted(-1, -1, 1, 1);
+
+        sprite.image = QImage(spriteRect.size(), QImage::Format_ARGB32_Premultiplied);
+        sprite.image.fill(Qt::transparent);
+        sprite.offset = spriteRect.topLeft();
+
+        QPainter spritePainter(&sprite.image);
+        spritePainter.setRenderHint(QPainter::Antialiasing, antialiasing);
+        spritePainter.setPen(Qt::NoPen);
+        spritePainter.setBrush(brush.color());
+        spritePainter.translate(-spriteRect.left(), -spriteRect.top());
+        spritePainter.drawPath(spritePath);
+        spritePainter.end();
+
+        const qint64 cost = sprite.image.sizeInBytes();
+
+        QMutexLocker lock(&m_mutex);
+        m_cache.insert(key, new Sprite(sprite), cost);
+    }
+
+    // Image is drawn in device pixels, so it is not resampled
+    painter->setWorldTransform(QTransform::fromScale(1.0 / devicePixelRatio, 1.0 / devicePixelRatio));
+    painter->drawImage(QPoint(originX, originY) + sprite.offset, sprite.image);
+    painter->setWorldTransform(worldMatrix);
+    return true;
+}
+
+void PDFGlyphAtlas::clear()
+{
+    QMutexLocker lock(&m_mutex);
+    m_cache.clear();
+}
+
+void PDFGlyphAtlas::removeGlyphs(const std::vector<quint64>& glyphIds)
+{
+    Q_ASSERT(std::is_sorted(glyphIds.cbegin(), glyphIds.cend()));
+
+    QMutexLocker lock(&m_mutex);
+    const QList<Key> keys = m_cache.keys();
+    for (const Key& key : keys)
+    {
+        if (std::binary_search(glyphIds.cbegin(), glyphIds.cend(), key.glyphId))
+        {
+            m_cache.remove(key);
+        }
+    }
+}
+
+void PDFGlyphAtlas::setLimit(qint64 limit)
+{
+    QMutexLocker lock(&m_mutex);
+    m_cache.setMaxCost(limit);
+}
+
 }   // namespace pdf
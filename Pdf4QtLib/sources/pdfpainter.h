@@ -27,6 +27,8 @@
 
 #include <QPen>
 #include <QBrush>
+#include <QCache>
+#include <QMutex>
 #include <QElapsedTimer>
 
 namespace pdf
@@ -54,6 +56,7 @@ protected:
     virtual void performUpdateGraphicsState(const PDFPageContentProcessorState& state) override;
     virtual void performBeginTransparencyGroup(ProcessOrder order, const PDFTransparencyGroup& transparencyGroup) override;
     virtual void performEndTransparencyGroup(ProcessOrder order, const PDFTransparencyGroup& transparencyGroup) override;
+    virtual bool isImageCacheEnabled() const override;
     virtual void setWorldMatrix(const QTransform& matrix) = 0;
     virtual void setCompositionMode(QPainter::CompositionMode mode) = 0;
 
@@ -189,11 +192,14 @@ public:
     /// \param pagePointToDevicePointMatrix Page point to device point transformation matrix
     /// \param features Renderer features
     /// \param opacity Opacity of page graphics
+    /// \param exposedRect Painted area in device coordinates (invalid rectangle means whole page),
+    ///        graphics outside this area is skipped
     void draw(QPainter* painter,
               const QRectF& cropBox,
               const QTransform& pagePointToDevicePointMatrix,
               PDFRenderer::Features features,
-              PDFReal opacity) const;
+              PDFReal opacity,
+              const QRectF& exposedRect = QRectF()) const;
 
     /// Redact path - remove all content intersecting given path,
     /// and fill redact path with given color.
@@ -202,6 +208,14 @@ public:
     void redact(QPainterPath redactPath, const QTransform& matrix, QColor color);
 
     void addPath(QPen pen, QBrush brush, QPainterPath path, bool isText);
+
+    /// Adds filled text glyph. Glyph is drawn as path, but it can be drawn from
+    /// cache of rasterized glyphs, if renderer feature \p GlyphCache is set.
+    /// \param brush Fill brush
+    /// \param path Glyph path in user space coordinates
+    /// \param glyphId Unique identifier of the glyph
+    /// \param glyphMatrix Transformation from glyph space to user space
+    void addGlyphPath(QBrush brush, QPainterPath path, quint64 glyphId, const QTransform& glyphMatrix);
     void addClip(QPainterPath path);
     void addImage(QImage image);
     void addMesh(PDFMesh mesh, PDFReal alpha);
@@ -306,6 +320,8 @@ private:
         QBrush brush;
         QPainterPath path;
         bool isText = false;
+        quint64 glyphId = 0;        ///< Glyph identifier, if path is a filled glyph, zero otherwise
+        QTransform glyphMatrix;     ///< Transformation from glyph space to user space (for glyphs only)
     };
 
     struct ClipData
@@ -346,6 +362,29 @@ private:
         PDFReal alpha = 1.0;
     };
 
+    /// Bounds of the instruction, used to skip instructions outside the painted area
+    struct InstructionBounds
+    {
+        QRectF boundingBox;     ///< Bounding box in page coordinates
+        bool isBounded = false; ///< If false, then instruction is always executed
+        size_t scopeEnd = 0;    ///< For clip instruction, index of the instruction, which restores the clip
+    };
+
+    /// Bounds of a block of consecutive instructions
+    struct InstructionBlockBounds
+    {
+        QRectF boundingBox;     ///< Union of bounding boxes of painting instructions in page coordinates
+        bool hasBoundingBox = false;
+        bool isBounded = true;  ///< If false, then some painting instruction in the block is not bounded
+    };
+
+    /// Number of instructions in one block of instruction bounds
+    static constexpr size_t INSTRUCTION_BLOCK_SIZE = 64;
+
+    /// Calculates instruction bounds (bounding boxes of painting instructions and
+    /// clip scopes), so instructions outside the painted area can be skipped.
+    void buildInstructionBounds();
+
     qint64 m_compilingTimeNS = 0;
     qint64 m_memoryConsumptionEstimate = 0;
     QColor m_paperColor = QColor(Qt::white);
@@ -356,6 +395,9 @@ private:
     std::vector<MeshPaintData> m_meshes;
     std::vector<QTransform> m_matrices;
     std::vector<QPainter::CompositionMode> m_compositionModes;
+    std::vector<InstructionBounds> m_instructionBounds;
+    std::vector<InstructionBlockBounds> m_instructionBlockBounds;
+    PDFReal m_maxCosmeticPenWidth = 0.0;
     QList<PDFRenderError> m_errors;
     PDFSnapInfo m_snapInfo;
     QElapsedTimer m_expirationTimer;
@@ -377,6 +419,13 @@ public:
                                                 const PDFOptionalContentActivity* optionalContentActivity,
                                                 const PDFMeshQualitySettings& meshQualitySettings);
 
+    /// Sets text layout, to which characters of the page are added. So text
+    /// layout is created in the same pass as precompiled page, and page
+    /// contents doesn't have to be processed again. Text layout algorithm
+    /// must be performed by the caller, after page contents are processed.
+    /// \param textLayout Text layout (or nullptr, if no text layout is created)
+    void setTextLayout(PDFTextLayout* textLayout) { m_textLayout = textLayout; }
+
 protected:
     virtual void performPathPainting(const QPainterPath& path, bool stroke, bool fill, bool text, Qt::FillRule fillRule) override;
     virtual void performClipping(const QPainterPath& path, Qt::FillRule fillRule) override;
@@ -384,13 +433,98 @@ protected:
     virtual void performMeshPainting(const PDFMesh& mesh) override;
     virtual void performSaveGraphicState(ProcessOrder order) override;
     virtual void performRestoreGraphicState(ProcessOrder order) override;
+    virtual void performOutputCharacter(const PDFTextCharacterInfo& info) override;
     virtual void setWorldMatrix(const QTransform& matrix) override;
     virtual void setCompositionMode(QPainter::CompositionMode mode) override;
 
 private:
     PDFPrecompiledPage* m_precompiledPage;
+    PDFTextLayout* m_textLayout = nullptr;
+};
+
+/// Process-wide cache of rasterized glyphs. Small glyphs, which are not rotated,
+/// are drawn as images from this cache instead of filling glyph paths. Glyph images
+/// are identified by glyph, scale of the glyph in device space, subpixel position
+/// (quantized) of the glyph origin, fill color and antialiasing. Images are stored
+/// already filled with the color, so drawing a cached glyph is just a blit.
+/// Glyphs, which can't be drawn from the cache, must be drawn as paths.
+/// This class is thread safe.
+class PDF4QTLIBSHARED_EXPORT PDFGlyphAtlas
+{
+public:
+    static constexpr const qint64 DEFAULT_LIMIT = 16 * 1024 * 1024;
+
+    /// Maximal size of the glyph in device pixels, larger glyphs are drawn as paths
+    static constexpr const int MAX_GLYPH_SIZE = 64;
+
+    /// Number of subpixel positions of the glyph origin in each direction
+    static constexpr const int SUBPIXEL_POSITIONS = 4;
+
+    /// Quantization of the glyph scale
+    static constexpr const PDFReal SCALE_QUANTIZATION = 256.0;
+
+    struct Key
+    {
+        quint64 glyphId = 0;
+        int scaleX = 0;             ///< Horizontal scale multiplied by SCALE_QUANTIZATION
+        int scaleY = 0;             ///< Vertical scale multiplied by SCALE_QUANTIZATION
+        int subpixelX = 0;          ///< Subpixel position of the origin (0..SUBPIXEL_POSITIONS-1)
+        int subpixelY = 0;          ///< Subpixel position of the origin (0..SUBPIXEL_POSITIONS-1)
+        QRgb color = 0;
+        bool antialiasing = false;
+
+        bool operator==(const Key&) const = default;
+    };
+
+    /// Returns global instance of the glyph atlas
+    static PDFGlyphAtlas* getInstance();
+
+    /// Draws glyph using current painter's world transformation. If glyph is
+    /// not in the cache, it is rasterized and inserted. If glyph can't be drawn
+    /// from the cache (for example, it is rotated, too large, brush is not
+    /// a solid color, or painter doesn't paint to the raster device), then
+    /// nothing is drawn and false is returned.
+    /// \param painter Painter
+    /// \param path Glyph path in user space coordinates
+    /// \param brush Fill brush
+    /// \param glyphId Unique identifier of the glyph
+    /// \param glyphMatrix Transformation from glyph space to user space
+    /// \param antialiasing Draw glyph with antialiasing
+    bool drawGlyph(QPainter* painter,
+                   const QPainterPath& path,
+                   const QBrush& brush,
+                   quint64 glyphId,
+                   const QTransform& glyphMatrix,
+                   bool antialiasing);
+
+    /// Removes all glyphs from the cache
+    void clear();
+
+    /// Removes glyphs with given identifiers from the cache
+    /// \param glyphIds Sorted identifiers of glyphs
+    void removeGlyphs(const std::vector<quint64>& glyphIds);
+
+    /// Sets limit of total size of glyph images in bytes
+    void setLimit(qint64 limit);
+
+private:
+    explicit PDFGlyphAtlas() : m_cache(DEFAULT_LIMIT) { }
+
+    struct Sprite
+    {
+        QImage image;
+        QPoint offset;  ///< Offset of the image from the glyph origin in device pixels
+    };
+
+    QMutex m_mutex;
+    QCache<Key, Sprite> m_cache;
 };
 
+inline size_t qHash(const PDFGlyphAtlas::Key& key, size_t seed = 0)
+{
+    return qHashMulti(seed, key.glyphId, key.scaleX, key.scaleY, key.subpixelX, key.subpixelY, key.color, key.antialiasing);
+}
+
 }   // namespace pdf
 
 #endif // PDFPAINTER_H
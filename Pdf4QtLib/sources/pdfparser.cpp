@@ -39,6 +39,53 @@ PDFLexicalAnalyzer::PDFLexicalAnalyzer(const char* begin, const char* end) :
 
 }
 
+bool PDFLexicalAnalyzer::Token::operator==(const Token& other) const
+{
+    if (type != other.type)
+    {
+        return false;
+    }
+
+    switch (type)
+    {
+        case TokenType::Boolean:
+        case TokenType::Integer:
+            return integer == other.integer;
+
+        case TokenType::Real:
+            return real == other.real || qFuzzyCompare(real, other.real);
+
+        case TokenType::String:
+        case TokenType::Name:
+        case TokenType::Command:
+            return bytes == other.bytes;
+
+        default:
+            break;
+    }
+
+    return true;
+}
+
+bool PDFLexicalAnalyzer::Token::hasValue() const
+{
+    switch (type)
+    {
+        case TokenType::Boolean:
+        case TokenType::Integer:
+        case TokenType::Real:
+        case TokenType::String:
+        case TokenType::Name:
+        case TokenType::Command:
+            return true;
+
+        default:
+            break;
+    }
+
+    return false;
+}
+
 PDFLexicalAnalyzer::Token PDFLexicalAnalyzer::fetch()
 {
     // Skip whitespace/comments at first
@@ -164,7 +211,7 @@ PDFLexicalAnalyzer::Token PDFLexicalAnalyzer::fetch()
                 real = -real;
             }
 
-            return !treatAsReal ? Token(TokenType::Integer, QVariant(static_cast<qint64>(integer))) : Token(TokenType::Real, real);
+            return !treatAsReal ? Token(TokenType::Integer, integer) : Token(TokenType::Real, real);
         }
 
         case CHAR_LEFT_BRACKET:
@@ -172,13 +219,35 @@ PDFLexicalAnalyzer::Token PDFLexicalAnalyzer::fetch()
             // String '(', sequence of literal characters enclosed in "()", see PDF 1.7 Reference,
             // chapter 3.2.3. Note: literal string can have properly balanced brackets inside.
 
+            // Skip first character
+            fetchChar();
+
+            // Most of the strings don't contain escape sequences, so we try to find
+            // the end of the string at first and create the string in one step.
             int parenthesisBalance = 1;
+            for (const char* it = m_current; it != m_end; ++it)
+            {
+                const char character = *it;
+                if (character == CHAR_BACKSLASH)
+                {
+                    break;
+                }
+                else if (character == CHAR_LEFT_BRACKET)
+                {
+                    ++parenthesisBalance;
+                }
+                else if (character == CHAR_RIGHT_BRACKET && --parenthesisBalance == 0)
+                {
+                    QByteArray string(m_current, it - m_current);
+                    m_current = it + 1;
+                    return Token(TokenType::String, qMove(string));
+                }
+            }
+
+            parenthesisBalance = 1;
             QByteArray string;
             string.reserve(STRING_BUFFER_RESERVE);
 
-            // Skip first character
-            fetchChar();
-
             while (true)
             {
                 // Scan string, see, what next char is.
@@ -196,7 +265,7 @@ PDFLexicalAnalyzer::Token PDFLexicalAnalyzer::fetch()
                         if (--parenthesisBalance == 0)
                         {
                             // We are done.
-                            return Token(TokenType::String, string);
+                            return Token(TokenType::String, qMove(string));
                         }
                         else
                         {
@@ -304,6 +373,20 @@ PDFLexicalAnalyzer::Token PDFLexicalAnalyzer::fetch()
 
             fetchChar();
 
+            // Names without '#' characters are created directly from the stream data
+            const char* nameEnd = m_current;
+            while (nameEnd != m_end && isRegular(*nameEnd) && *nameEnd != CHAR_MARK)
+            {
+                ++nameEnd;
+            }
+
+            if (nameEnd == m_end || *nameEnd != CHAR_MARK)
+            {
+                QByteArray name(m_current, nameEnd - m_current);
+                m_current = nameEnd;
+                return Token(TokenType::Name, qMove(name));
+            }
+
             QByteArray name;
             name.reserve(NAME_BUFFER_RESERVE);
 
@@ -431,14 +514,14 @@ PDFLexicalAnalyzer::Token PDFLexicalAnalyzer::fetch()
             if (isRegular(lookChar()))
             {
                 // It should be sequence of regular characters - command, true, false, null...
-                QByteArray command;
-                command.reserve(COMMAND_BUFFER_RESERVE);
-
+                const char* commandStart = m_current;
                 while (!isAtEnd() && isRegular(lookChar()))
                 {
-                    command += fetchChar();
+                    ++m_current;
                 }
 
+                // Keywords are checked before the command string is created
+                const QByteArray command = QByteArray::fromRawData(commandStart, m_current - commandStart);
                 if (command == BOOL_OBJECT_TRUE_STRING)
                 {
                     return Token(TokenType::Boolean, true);
@@ -453,7 +536,7 @@ PDFLexicalAnalyzer::Token PDFLexicalAnalyzer::fetch()
                 }
                 else
                 {
-                    return Token(TokenType::Command, std::move(command));
+                    return Token(TokenType::Command, QByteArray(command.constData(), command.size()));
                 }
             }
             else if (m_tokenizingPostScriptFunction)
@@ -546,6 +629,20 @@ QByteArray PDFLexicalAnalyzer::fetchByteArray(PDFInteger length)
     return result;
 }
 
+QByteArray PDFLexicalAnalyzer::fetchRawByteArray(PDFInteger length)
+{
+    Q_ASSERT(length >= 0);
+
+    if (std::distance(m_current, m_end) < length)
+    {
+        error(tr("Can't read %1 bytes from the input stream. Input stream end reached.").arg(length));
+    }
+
+    QByteArray result = QByteArray::fromRawData(m_current, length);
+    std::advance(m_current, length);
+    return result;
+}
+
 PDFInteger PDFLexicalAnalyzer::findSubstring(const char* str, PDFInteger position) const
 {
     const PDFInteger length = std::distance(m_begin, m_end);
@@ -705,26 +802,23 @@ PDFObject PDFParser::getObject()
     {
         case PDFLexicalAnalyzer::TokenType::Boolean:
         {
-            Q_ASSERT(m_lookAhead1.data.typeId() == QMetaType::Bool);
-            const bool value = m_lookAhead1.data.toBool();
+            const bool value = m_lookAhead1.getBool();
             shift();
             return PDFObject::createBool(value);
         }
 
         case PDFLexicalAnalyzer::TokenType::Integer:
         {
-            Q_ASSERT(m_lookAhead1.data.typeId() == QMetaType::LongLong);
-            const PDFInteger value = m_lookAhead1.data.toLongLong();
+            const PDFInteger value = m_lookAhead1.getInteger();
             shift();
 
             // We must check, if we are reading reference. In this case,
             // actual value is integer and next value is command "R".
             if (m_lookAhead1.type == PDFLexicalAnalyzer::TokenType::Integer &&
                 m_lookAhead2.type == PDFLexicalAnalyzer::TokenType::Command &&
-                m_lookAhead2.data.toByteArray() == PDF_REFERENCE_COMMAND)
+                m_lookAhead2.getBytes() == PDF_REFERENCE_COMMAND)
             {
-                Q_ASSERT(m_lookAhead1.data.typeId() == QMetaType::LongLong);
-                const PDFInteger generation = m_lookAhead1.data.toLongLong();
+                const PDFInteger generation = m_lookAhead1.getInteger();
                 shift();
                 shift();
                 return PDFObject::createReference(PDFObjectReference(value, generation));
@@ -738,16 +832,14 @@ PDFObject PDFParser::getObject()
 
         case PDFLexicalAnalyzer::TokenType::Real:
         {
-            Q_ASSERT(m_lookAhead1.data.typeId() == QMetaType::Double);
-            const PDFReal value = m_lookAhead1.data.toDouble();
+            const PDFReal value = m_lookAhead1.getReal();
             shift();
             return PDFObject::createReal(value);
         }
 
         case PDFLexicalAnalyzer::TokenType::String:
         {
-            Q_ASSERT(m_lookAhead1.data.typeId() == QMetaType::QByteArray);
-            QByteArray array = m_lookAhead1.data.toByteArray();
+            QByteArray array = qMove(m_lookAhead1.bytes);
             array.shrink_to_fit();
             shift();
             return PDFObject::createString(std::move(array));
@@ -755,8 +847,7 @@ PDFObject PDFParser::getObject()
 
         case PDFLexicalAnalyzer::TokenType::Name:
         {
-            Q_ASSERT(m_lookAhead1.data.typeId() == QMetaType::QByteArray);
-            QByteArray array = m_lookAhead1.data.toByteArray();
+            QByteArray array = qMove(m_lookAhead1.bytes);
             array.shrink_to_fit();
             shift();
             return PDFObject::createName(std::move(array));
@@ -809,7 +900,7 @@ PDFObject PDFParser::getObject()
                     error(tr("Dictionary key must be a name."));
                 }
 
-                QByteArray key = m_lookAhead1.data.toByteArray();
+                QByteArray key = qMove(m_lookAhead1.bytes);
                 shift();
 
                 // Second value should be a value
@@ -826,7 +917,7 @@ PDFObject PDFParser::getObject()
 
             // Is it a content stream?
             if (m_lookAhead2.type == PDFLexicalAnalyzer::TokenType::Command &&
-                m_lookAhead2.data.toByteArray() == PDF_STREAM_START_COMMAND)
+                m_lookAhead2.getBytes() == PDF_STREAM_START_COMMAND)
             {
                 if (!m_features.testFlag(AllowStreams))
                 {
@@ -856,7 +947,7 @@ PDFObject PDFParser::getObject()
 
                 // Skip the stream start, then fetch data of the stream
                 m_lexicalAnalyzer.skipStreamStart();
-                QByteArray buffer = m_lexicalAnalyzer.fetchByteArray(length);
+                QByteArray buffer = m_features.testFlag(ReferenceStreamData) ? m_lexicalAnalyzer.fetchRawByteArray(length) : m_lexicalAnalyzer.fetchByteArray(length);
 
                 // According to the PDF Reference 1.7, chapter 3.2.7, stream content can also be specified
                 // in the external file. If this is the case, then we must try to load the stream data
@@ -887,7 +978,7 @@ PDFObject PDFParser::getObject()
                 m_lookAhead2 = fetch();
 
                 if (m_lookAhead1.type == PDFLexicalAnalyzer::TokenType::Command &&
-                    m_lookAhead1.data.toByteArray() == PDF_STREAM_END_COMMAND)
+                    m_lookAhead1.getBytes() == PDF_STREAM_END_COMMAND)
                 {
                     // Everything OK, just advance and return stream object
                     shift();
@@ -956,7 +1047,7 @@ void PDFParser::seek(PDFInteger offset)
 bool PDFParser::fetchCommand(const char* command)
 {
     if (m_lookAhead1.type == PDFLexicalAnalyzer::TokenType::Command &&
-        m_lookAhead1.data.toByteArray() == command)
+        m_lookAhead1.getBytes() == command)
     {
         shift();
         return true;
@@ -24,7 +24,6 @@
 #include "pdfflatmap.h"
 
 #include <QtCore>
-#include <QVariant>
 #include <QByteArray>
 
 #include <set>
@@ -104,11 +103,21 @@ public:
 
     Q_ENUM(TokenType)
 
+    /// Token of the lexical analyzer. Value of the token is stored according to the
+    /// token type - booleans and integers in \p integer, reals in \p real, and
+    /// strings, names and commands in \p bytes. Tokens are fetched in large numbers
+    /// (content streams, cross reference tables, CMaps, PostScript functions),
+    /// so value is not wrapped in the variant type.
     struct Token
     {
         explicit Token() : type(TokenType::EndOfFile) { }
         explicit Token(TokenType type) : type(type) { }
-        explicit Token(TokenType type, QVariant data) : type(type), data(qMove(data)) { }
+        explicit Token(TokenType type, bool value) : type(type), integer(value ? 1 : 0) { }
+        explicit Token(TokenType type, int value) : type(type), integer(value) { }
+        explicit Token(TokenType type, PDFInteger value) : type(type), integer(value) { }
+        explicit Token(TokenType type, PDFReal value) : type(type), real(value) { }
+        explicit Token(TokenType type, QByteArray value) : type(type), bytes(qMove(value)) { }
+        explicit Token(TokenType type, const char* value) : type(type), bytes(value) { }
 
         Token(const Token&) = default;
         Token(Token&&) = default;
@@ -116,10 +125,29 @@ public:
         Token& operator=(const Token&) = default;
         Token& operator=(Token&&) = default;
 
-        bool operator==(const Token& other) const { return type == other.type && data == other.data; }
+        bool operator==(const Token& other) const;
+
+        /// Returns true, if token carries a value (boolean, number, string, name or command)
+        bool hasValue() const;
+
+        bool getBool() const { return integer != 0; }
+        PDFInteger getInteger() const { return integer; }
+
+        /// Returns value of the real token, integer token is converted to the real
+        PDFReal getReal() const { return type == TokenType::Integer ? PDFReal(integer) : real; }
+
+        /// Returns value of the string, name or command token
+        const QByteArray& getBytes() const { return bytes; }
 
         TokenType type;
-        QVariant data;
+
+        union
+        {
+            PDFInteger integer = 0;
+            PDFReal real;
+        };
+
+        QByteArray bytes;
     };
 
     /// Fetches a new token from the input stream. If we are at end of the input
@@ -141,6 +169,12 @@ public:
     /// \param length Length of the buffer
     QByteArray fetchByteArray(PDFInteger length);
 
+    /// Reads number of bytes from the buffer and creates a byte array referencing
+    /// the buffer (data are not copied). Buffer must outlive the returned byte array.
+    /// If end of stream appears before desired end byte, exception is thrown.
+    /// \param length Length of the buffer
+    QByteArray fetchRawByteArray(PDFInteger length);
+
     /// Returns, if whole stream was scanned
     inline bool isAtEnd() const { return m_current == m_end; }
 
@@ -290,8 +324,9 @@ class PDF4QTLIBSHARED_EXPORT PDFParser
 public:
     enum Feature
     {
-        None            = 0x0000,
-        AllowStreams    = 0x0001
+        None                = 0x0000,
+        AllowStreams        = 0x0001,
+        ReferenceStreamData = 0x0002,   ///< Stream data reference the parsed buffer instead of being copied, buffer must outlive the streams
     };
 
     Q_DECLARE_FLAGS(Features, Feature)
@@ -390,4 +425,6 @@ constexpr bool PDFLexicalAnalyzer::isDelimiter(char character)
 
 }   // namespace pdf
 
+Q_DECLARE_OPERATORS_FOR_FLAGS(pdf::PDFParser::Features)
+
 #endif // PDFPARSER_H
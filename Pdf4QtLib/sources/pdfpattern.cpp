@@ -25,7 +25,10 @@
 #include "pdfdbgheap.h"
 
 #include <QPainter>
+#include <QPaintEngine>
 
+#include <cmath>
+#include <limits>
 #include <execution>
 
 namespace pdf
@@ -167,6 +170,7 @@ PDFPatternPtr PDFPattern::createShadingPattern(const PDFDictionary* colorSpaceDi
     PDFDocumentDataLoaderDecorator loader(document);
     const PDFDictionary* shadingDictionary = nullptr;
     const PDFStream* stream = nullptr;
+    const PDFObjectReference shadingReference = shadingObject.isReference() ? shadingObject.getReference() : PDFObjectReference();
 
     if (dereferencedShadingObject.isDictionary())
     {
@@ -271,6 +275,7 @@ PDFPatternPtr PDFPattern::createShadingPattern(const PDFDictionary* colorSpaceDi
             functionShading->m_functions = qMove(functions);
             functionShading->m_matrix = matrix;
             functionShading->m_patternGraphicState = patternGraphicState;
+            functionShading->m_shadingReference = shadingReference;
 
             return result;
         }
@@ -317,6 +322,7 @@ PDFPatternPtr PDFPattern::createShadingPattern(const PDFDictionary* colorSpaceDi
             axialShading->m_functions = qMove(functions);
             axialShading->m_matrix = matrix;
             axialShading->m_patternGraphicState = patternGraphicState;
+            axialShading->m_shadingReference = shadingReference;
 
             return result;
         }
@@ -370,6 +376,7 @@ PDFPatternPtr PDFPattern::createShadingPattern(const PDFDictionary* colorSpaceDi
             radialShading->m_functions = qMove(functions);
             radialShading->m_matrix = matrix;
             radialShading->m_patternGraphicState = patternGraphicState;
+            radialShading->m_shadingReference = shadingReference;
 
             return result;
         }
@@ -452,6 +459,7 @@ PDFPatternPtr PDFPattern::createShadingPattern(const PDFDictionary* colorSpaceDi
             type4567Shading->m_colorSpace = colorSpace;
             type4567Shading->m_matrix = matrix;
             type4567Shading->m_patternGraphicState = patternGraphicState;
+            type4567Shading->m_shadingReference = shadingReference;
             type4567Shading->m_bitsPerCoordinate = static_cast<uint8_t>(bitsPerCoordinate);
             type4567Shading->m_bitsPerComponent = static_cast<uint8_t>(bitsPerComponent);
             type4567Shading->m_xmin = decode[0];
@@ -1194,6 +1202,15 @@ public:
         m_tMin = qMin(m_tAtStart, m_tAtEnd);
         m_tMax = qMax(m_tAtStart, m_tAtEnd);
 
+        // Color functions are sampled into the lookup table, because they are evaluated for each pixel.
+        // Discontinuous functions (hard color stops) are evaluated exactly, because
+        // interpolation between samples would blur the color stops.
+        const PDFAbstractColorSpace* colorSpace = axialShadingPattern->getColorSpace();
+        if (colorSpace && PDFFunctionLookupTable::isApproximationAccurate(axialShadingPattern->getFunctions()))
+        {
+            m_lookupTable = PDFFunctionLookupTable::create(axialShadingPattern->getFunctions(), colorSpace->getColorComponentCount(), m_tMin, m_tMax);
+        }
+
         m_p1p2GCS = p1p2GCS;
     }
 
@@ -1255,7 +1272,11 @@ public:
             return false;
         }
 
-        if (functions.size() == 1)
+        if (m_lookupTable.isValid())
+        {
+            m_lookupTable.apply(t, colorBuffer.data());
+        }
+        else if (functions.size() == 1)
         {
             Q_ASSERT(outputBuffer.size() <= colorBuffer.size());
             PDFFunction::FunctionResult result = functions.front()->apply(&t, &t + 1, colorBuffer.data(), colorBuffer.data() + outputBuffer.size());
@@ -1304,6 +1325,7 @@ private:
     PDFReal m_tAtEnd;
     PDFReal m_tMin;
     PDFReal m_tMax;
+    PDFFunctionLookupTable m_lookupTable;
 };
 
 PDFShadingSampler* PDFAxialShading::createSampler(QTransform userSpaceToDeviceSpaceMatrix) const
@@ -1336,6 +1358,14 @@ void PDFMesh::paint(QPainter* painter, PDFReal alpha) const
         painter->drawPath(m_backgroundPath);
     }
 
+    // Raster devices are painted using our rasterizer, it is much faster,
+    // than painting each triangle by the painter.
+    if (paintRaster(painter, alpha))
+    {
+        painter->restore();
+        return;
+    }
+
     QColor color;
 
     // Draw all triangles
@@ -1357,6 +1387,197 @@ void PDFMesh::paint(QPainter* painter, PDFReal alpha) const
     painter->restore();
 }
 
+bool PDFMesh::paintRaster(QPainter* painter, PDFReal alpha) const
+{
+    QPaintEngine* paintEngine = painter->paintEngine();
+    if (!paintEngine || paintEngine->type() != QPaintEngine::Raster)
+    {
+        return false;
+    }
+
+    // Determine rectangle in device pixels, which is painted
+    const QTransform deviceTransform = painter->deviceTransform();
+    const QPaintDevice* device = painter->device();
+    QSizeF deviceSize(device->width(), device->height());
+    if (device->devType() != QInternal::Image && device->devType() != QInternal::Pixmap)
+    {
+        // Size of other devices (widgets) is in logical pixels
+        deviceSize *= device->devicePixelRatioF();
+    }
+    QRectF paintedRect(QPointF(0, 0), deviceSize);
+
+    if (painter->hasClipping())
+    {
+        paintedRect = paintedRect.intersected(deviceTransform.mapRect(painter->clipBoundingRect()));
+    }
+
+    std::vector<QPointF> vertices;
+    vertices.reserve(m_vertices.size());
+    QPointF minVertex(std::numeric_limits<PDFReal>::infinity(), std::numeric_limits<PDFReal>::infinity());
+    QPointF maxVertex(-std::numeric_limits<PDFReal>::infinity(), -std::numeric_limits<PDFReal>::infinity());
+    for (const QPointF& vertex : m_vertices)
+    {
+        const QPointF deviceVertex = deviceTransform.map(vertex);
+        if (std::isfinite(deviceVertex.x()) && std::isfinite(deviceVertex.y()))
+        {
+            minVertex = QPointF(qMin(minVertex.x(), deviceVertex.x()), qMin(minVertex.y(), deviceVertex.y()));
+            maxVertex = QPointF(qMax(maxVertex.x(), deviceVertex.x()), qMax(maxVertex.y(), deviceVertex.y()));
+        }
+        vertices.push_back(deviceVertex);
+    }
+
+    if (minVertex.x() > maxVertex.x() || minVertex.y() > maxVertex.y())
+    {
+        // No valid vertex
+        return true;
+    }
+
+    const QRectF meshRect(minVertex, maxVertex);
+    const QRect imageRect = paintedRect.intersected(meshRect).toAlignedRect();
+    if (imageRect.isEmpty())
+    {
+        return true;
+    }
+
+    QImage image(imageRect.size(), QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+
+    const int width = image.width();
+    const int height = image.height();
+    const QPointF offset = imageRect.topLeft();
+
+    auto compareVertices = [](const QPointF& left, const QPointF& right)
+    {
+        return std::make_pair(left.y(), left.x()) < std::make_pair(right.y(), right.x());
+    };
+
+    // Rasterizer doesn't antialias edges. Triangles on the border of the mesh
+    // (triangles having an edge, which isn't shared with another triangle) are painted
+    // with antialiasing first, then rasterizer overwrites all pixels, whose centers are
+    // inside some triangle. So only pixels on the outer border of the mesh keep
+    // antialiased coverage, and there are no seams between triangles.
+    {
+        struct Edge
+        {
+            QPointF p1;
+            QPointF p2;
+            size_t triangleIndex = 0;
+        };
+
+        auto compareEdges = [](const Edge& left, const Edge& right)
+        {
+            return std::make_tuple(left.p1.y(), left.p1.x(), left.p2.y(), left.p2.x()) < std::make_tuple(right.p1.y(), right.p1.x(), right.p2.y(), right.p2.x());
+        };
+
+        std::vector<Edge> edges;
+        edges.reserve(m_triangles.size() * 3);
+        for (size_t i = 0; i < m_triangles.size(); ++i)
+        {
+            const Triangle& triangle = m_triangles[i];
+            for (const auto& [v1, v2] : { std::make_pair(triangle.v1, triangle.v2), std::make_pair(triangle.v2, triangle.v3), std::make_pair(triangle.v3, triangle.v1) })
+            {
+                Edge edge{ vertices[v1], vertices[v2], i };
+                if (compareVertices(edge.p2, edge.p1))
+                {
+                    std::swap(edge.p1, edge.p2);
+                }
+                edges.push_back(edge);
+            }
+        }
+        std::sort(edges.begin(), edges.end(), compareEdges);
+
+        std::vector<bool> isBorderTriangle(m_triangles.size(), false);
+        for (auto it = edges.cbegin(); it != edges.cend();)
+        {
+            auto itEnd = std::find_if(std::next(it), edges.cend(), [&](const Edge& edge) { return compareEdges(*it, edge); });
+            if (std::next(it) == itEnd)
+            {
+                isBorderTriangle[it->triangleIndex] = true;
+            }
+            it = itEnd;
+        }
+
+        QPainter imagePainter(&image);
+        imagePainter.setRenderHint(QPainter::Antialiasing, true);
+        imagePainter.setPen(Qt::NoPen);
+        imagePainter.translate(-offset);
+
+        for (size_t i = 0; i < m_triangles.size(); ++i)
+        {
+            if (isBorderTriangle[i])
+            {
+                const Triangle& triangle = m_triangles[i];
+                std::array<QPointF, 3> triangleCorners = { vertices[triangle.v1], vertices[triangle.v2], vertices[triangle.v3] };
+                imagePainter.setBrush(QBrush(QColor::fromRgba(triangle.color), Qt::SolidPattern));
+                imagePainter.drawConvexPolygon(triangleCorners.data(), static_cast<int>(triangleCorners.size()));
+            }
+        }
+    }
+
+    // Returns first pixel index, whose center is greater or equal to the coordinate,
+    // clamped to the interval [0, limit].
+    auto getPixelIndex = [](PDFReal coordinate, int limit)
+    {
+        return static_cast<int>(qBound<PDFReal>(0.0, std::ceil(coordinate - 0.5), limit));
+    };
+
+    for (const Triangle& triangle : m_triangles)
+    {
+        std::array<QPointF, 3> points = { vertices[triangle.v1] - offset, vertices[triangle.v2] - offset, vertices[triangle.v3] - offset };
+        std::sort(points.begin(), points.end(), compareVertices);
+
+        const QPointF& p0 = points[0];
+        const QPointF& p1 = points[1];
+        const QPointF& p2 = points[2];
+
+        if (!std::isfinite(p0.x()) || !std::isfinite(p0.y()) ||
+            !std::isfinite(p1.x()) || !std::isfinite(p1.y()) ||
+            !std::isfinite(p2.x()) || !std::isfinite(p2.y()))
+        {
+            continue;
+        }
+
+        const int rowStart = getPixelIndex(p0.y(), height);
+        const int rowMiddle = getPixelIndex(p1.y(), height);
+        const int rowEnd = getPixelIndex(p2.y(), height);
+
+        if (rowStart == rowEnd)
+        {
+            continue;
+        }
+
+        // Edges are always computed from the vertex with lower y (or lower x, if y
+        // is the same), so shared edge has exactly the same coordinates in both triangles.
+        const PDFReal slope02 = (p2.x() - p0.x()) / (p2.y() - p0.y());
+        const PDFReal slope01 = (p1.y() != p0.y()) ? (p1.x() - p0.x()) / (p1.y() - p0.y()) : 0.0;
+        const PDFReal slope12 = (p2.y() != p1.y()) ? (p2.x() - p1.x()) / (p2.y() - p1.y()) : 0.0;
+
+        const QRgb color = qPremultiply(triangle.color);
+
+        for (int row = rowStart; row < rowEnd; ++row)
+        {
+            const PDFReal y = row + 0.5;
+            const PDFReal x1 = p0.x() + (y - p0.y()) * slope02;
+            const PDFReal x2 = (row < rowMiddle) ? p0.x() + (y - p0.y()) * slope01 : p1.x() + (y - p1.y()) * slope12;
+
+            const int columnStart = getPixelIndex(qMin(x1, x2), width);
+            const int columnEnd = getPixelIndex(qMax(x1, x2), width);
+
+            QRgb* scanline = reinterpret_cast<QRgb*>(image.scanLine(row));
+            std::fill(scanline + columnStart, scanline + columnEnd, color);
+        }
+    }
+
+    // Draw the image without any transformation, so image pixels are device pixels
+    // (world transform is set to the inverse of the window and viewport transform).
+    painter->setWorldTransform(deviceTransform.inverted() * painter->worldTransform());
+    painter->setRenderHint(QPainter::SmoothPixmapTransform, false);
+    painter->setOpacity(painter->opacity() * alpha);
+    painter->drawImage(imageRect.topLeft(), image);
+
+    return true;
+}
+
 void PDFMesh::transform(const QTransform& matrix)
 {
     for (QPointF& vertex : m_vertices)
@@ -1774,6 +1995,15 @@ public:
         m_tMin = qMin(m_tAtStart, m_tAtEnd);
         m_tMax = qMax(m_tAtStart, m_tAtEnd);
 
+        // Color functions are sampled into the lookup table, because they are evaluated for each pixel.
+        // Discontinuous functions (hard color stops) are evaluated exactly, because
+        // interpolation between samples would blur the color stops.
+        const PDFAbstractColorSpace* colorSpace = radialShadingPattern->getColorSpace();
+        if (colorSpace && PDFFunctionLookupTable::isApproximationAccurate(radialShadingPattern->getFunctions()))
+        {
+            m_lookupTable = PDFFunctionLookupTable::create(radialShadingPattern->getFunctions(), colorSpace->getColorComponentCount(), m_tMin, m_tMax);
+        }
+
         m_r0 = r0;
         m_r1 = r1;
 
@@ -1928,7 +2158,11 @@ public:
             return false;
         }
 
-        if (functions.size() == 1)
+        if (m_lookupTable.isValid())
+        {
+            m_lookupTable.apply(t, colorBuffer.data());
+        }
+        else if (functions.size() == 1)
         {
             Q_ASSERT(outputBuffer.size() <= colorBuffer.size());
             PDFFunction::FunctionResult result = functions.front()->apply(&t, &t + 1, colorBuffer.data(), colorBuffer.data() + outputBuffer.size());
@@ -1979,6 +2213,7 @@ private:
     PDFReal m_tMax;
     PDFReal m_r0;
     PDFReal m_r1;
+    PDFFunctionLookupTable m_lookupTable;
 };
 
 PDFShadingSampler* PDFRadialShading::createSampler(QTransform userSpaceToDeviceSpaceMatrix) const
@@ -3727,4 +3962,108 @@ bool PDFShadingSampler::fillBackgroundColor(PDFColorBuffer outputBuffer) const
     return false;
 }
 
+PDFShadingMeshCache* PDFShadingMeshCache::getInstance()
+{
+    static PDFShadingMeshCache instance;
+    return &instance;
+}
+
+std::optional<PDFShadingMeshCache::Key> PDFShadingMeshCache::createKey(const PDFShadingPattern* shadingPattern,
+                                                                       const PDFMeshQualitySettings& settings,
+                                                                       const QTransform& pagePointToDevicePointMatrix)
+{
+    const QTransform patternSpaceToDeviceSpaceMatrix = shadingPattern->getPatternSpaceToDeviceSpaceMatrix(settings);
+    const PDFReal zoom = std::sqrt(std::abs(pagePointToDevicePointMatrix.determinant()));
+    if (!shadingPattern->getShadingReference().isValid() ||
+        !patternSpaceToDeviceSpaceMatrix.isInvertible() ||
+        !pagePointToDevicePointMatrix.isInvertible() ||
+        !std::isfinite(zoom) || zoom <= 0.0)
+    {
+        return std::nullopt;
+    }
+
+    // Values are stored in single precision, so small rounding errors (for example,
+    // from mapping of the page rectangle to the device space and back) don't
+    // produce different keys for the same placement of the pattern.
+    const QTransform devicePointToPagePointMatrix = pagePointToDevicePointMatrix.inverted();
+    const QTransform patternSpaceToPageSpaceMatrix = patternSpaceToDeviceSpaceMatrix * devicePointToPagePointMatrix;
+    const QRectF meshingArea = devicePointToPagePointMatrix.mapRect(settings.deviceSpaceMeshingArea);
+    const QColor& backgroundColor = shadingPattern->getBackgroundColor();
+
+    Key key;
+    key.reference = shadingPattern->getShadingReference();
+    key.backgroundColor = backgroundColor.isValid() ? backgroundColor.rgba() : 0;
+    key.patternSpaceToPageSpaceMatrix = { float(patternSpaceToPageSpaceMatrix.m11()), float(patternSpaceToPageSpaceMatrix.m12()),
+                                          float(patternSpaceToPageSpaceMatrix.m21()), float(patternSpaceToPageSpaceMatrix.m22()),
+                                          float(patternSpaceToPageSpaceMatrix.dx()), float(patternSpaceToPageSpaceMatrix.dy()) };
+    key.meshingArea = { float(meshingArea.left()), float(meshingArea.top()), float(meshingArea.width()), float(meshingArea.height()) };
+    key.qualitySettings = { float(settings.minimalMeshResolutionRatio), float(settings.preferredMeshResolutionRatio),
+                            float(settings.tolerance), float(settings.patchTestPoints),
+                            float(settings.patchResolutionMappingRatioLow), float(settings.patchResolutionMappingRatioHigh) };
+    key.zoomLevel = std::ilogb(zoom);
+    return key;
+}
+
+std::optional<PDFMesh> PDFShadingMeshCache::getMesh(const Key& key)
+{
+    QMutexLocker lock(&m_mutex);
+
+    if (const PDFMesh* mesh = m_cache.object(key))
+    {
+        ++m_hits;
+        return *mesh;
+    }
+
+    ++m_misses;
+    return std::nullopt;
+}
+
+void PDFShadingMeshCache::insertMesh(const Key& key, PDFMesh mesh)
+{
+    const qint64 cost = mesh.getMemoryConsumptionEstimate();
+
+    QMutexLocker lock(&m_mutex);
+    if (cost <= m_cache.maxCost())
+    {
+        m_cache.insert(key, new PDFMesh(qMove(mesh)), cost);
+    }
+}
+
+void PDFShadingMeshCache::clear()
+{
+    QMutexLocker lock(&m_mutex);
+    m_cache.clear();
+}
+
+void PDFShadingMeshCache::removeContent(quint64 contentId)
+{
+    QMutexLocker lock(&m_mutex);
+    const QList<Key> keys = m_cache.keys();
+    for (const Key& key : keys)
+    {
+        if (key.contentId == contentId)
+        {
+            m_cache.remove(key);
+        }
+    }
+}
+
+void PDFShadingMeshCache::setLimit(qint64 limit)
+{
+    QMutexLocker lock(&m_mutex);
+    m_cache.setMaxCost(limit);
+}
+
+PDFShadingMeshCache::Statistics PDFShadingMeshCache::getStatistics() const
+{
+    QMutexLocker lock(&m_mutex);
+
+    Statistics statistics;
+    statistics.hits = m_hits;
+    statistics.misses = m_misses;
+    statistics.size = m_cache.totalCost();
+    statistics.limit = m_cache.maxCost();
+    return statistics;
+}
+
 }   // namespace pdf
@@ -23,10 +23,14 @@
 #include "pdfcolorspaces.h"
 #include "pdfmeshqualitysettings.h"
 
+#include <QCache>
+#include <QMutex>
 #include <QTransform>
 #include <QPainterPath>
 
+#include <array>
 #include <memory>
+#include <optional>
 
 namespace pdf
 {
@@ -148,6 +152,16 @@ public:
     void invertColors();
 
 private:
+    /// Paints triangles using scanline rasterizer into the image, which is then
+    /// drawn by the painter. Triangles are rasterized in device pixels, pixel
+    /// is filled, if its center lies inside the triangle (top-left edges are
+    /// inclusive), so triangles sharing an edge have no seams between them.
+    /// Outer border of the mesh is antialiased. Returns false, if painter
+    /// doesn't paint on a raster device.
+    /// \param painter Painter, onto which is mesh drawn
+    /// \param alpha Opacity factor
+    bool paintRaster(QPainter* painter, PDFReal alpha) const;
+
     std::vector<QPointF> m_vertices;
     std::vector<Triangle> m_triangles;
     QPainterPath m_boundingPath;
@@ -337,6 +351,10 @@ public:
     /// Returns true, if shading pattern should be anti-aliased
     bool isAntialiasing() const { return m_antiAlias; }
 
+    /// Returns reference to the shading object, if shading was created from
+    /// the indirect object. Otherwise, invalid reference is returned.
+    PDFObjectReference getShadingReference() const { return m_shadingReference; }
+
     /// Returns matrix transforming pattern space to device space
     QTransform getPatternSpaceToDeviceSpaceMatrix(const PDFMeshQualitySettings& settings) const;
 
@@ -356,6 +374,7 @@ protected:
     PDFColorSpacePointer m_colorSpace;
     QColor m_backgroundColor;
     PDFColor m_originalBackgroundColor;
+    PDFObjectReference m_shadingReference;
     bool m_antiAlias = false;
 };
 
@@ -741,6 +760,98 @@ private:
     friend class PDFPattern;
 };
 
+/// Process-wide cache of shading meshes. Meshes are stored in the pattern space
+/// coordinate system, so they can be reused for any zoom of the page, only
+/// transformation to the device space is performed. Meshes are identified
+/// by document content, object reference of the shading, color management system,
+/// rendering intent, placement of the pattern on the page, meshing quality and
+/// zoom level. Zoom level is logarithmic (base 2), so mesh is tessellated again
+/// only if zoom changes at least by a factor of two. This class is thread safe.
+class PDF4QTLIBSHARED_EXPORT PDFShadingMeshCache
+{
+public:
+    static constexpr const qint64 DEFAULT_LIMIT = 16 * 1024 * 1024;
+
+    struct Key
+    {
+        quint64 contentId = 0;                              ///< Identifier of document content, see PDFObjectStorage::getContentId
+        PDFObjectReference reference;                       ///< Reference to shading object
+        quint64 cmsId = 0;                                  ///< Identifier of color management system, see PDFCMS::getId
+        RenderingIntent renderingIntent = RenderingIntent::Perceptual;
+        QRgb backgroundColor = 0;                           ///< Background color of the shading (zero, if background is not painted)
+        std::array<float, 6> patternSpaceToPageSpaceMatrix = { };
+        std::array<float, 4> meshingArea = { };             ///< Meshing area in page space (left, top, width, height)
+        std::array<float, 6> qualitySettings = { };         ///< Meshing quality settings, which doesn't depend on the zoom
+        int zoomLevel = 0;                                  ///< Zoom of the page is in interval [2^zoomLevel, 2^(zoomLevel + 1))
+
+        bool operator==(const Key&) const = default;
+    };
+
+    struct Statistics
+    {
+        qint64 hits = 0;
+        qint64 misses = 0;
+        qint64 size = 0;
+        qint64 limit = 0;
+    };
+
+    /// Returns global instance of the shading mesh cache
+    static PDFShadingMeshCache* getInstance();
+
+    /// Creates key for the shading pattern. Key contains only values
+    /// derived from the shading pattern, meshing settings and page placement,
+    /// document, color management and rendering intent identification must
+    /// be filled by the caller. If shading pattern can't be cached, then
+    /// std::nullopt is returned.
+    /// \param shadingPattern Shading pattern
+    /// \param settings Meshing settings
+    /// \param pagePointToDevicePointMatrix Matrix mapping page space to the device space
+    static std::optional<Key> createKey(const PDFShadingPattern* shadingPattern,
+                                        const PDFMeshQualitySettings& settings,
+                                        const QTransform& pagePointToDevicePointMatrix);
+
+    /// Returns mesh from the cache (in pattern space). If mesh is not found,
+    /// then std::nullopt is returned.
+    /// \param key Key
+    std::optional<PDFMesh> getMesh(const Key& key);
+
+    /// Inserts mesh (in pattern space) into the cache. Meshes, which
+    /// are larger than the limit, are not inserted.
+    /// \param key Key
+    /// \param mesh Mesh
+    void insertMesh(const Key& key, PDFMesh mesh);
+
+    /// Removes all meshes from the cache
+    void clear();
+
+    /// Removes meshes of the given document content from the cache
+    /// \param contentId Identifier of document content, see PDFObjectStorage::getContentId
+    void removeContent(quint64 contentId);
+
+    /// Sets limit of total size of meshes in bytes
+    void setLimit(qint64 limit);
+
+    /// Returns cache statistics
+    Statistics getStatistics() const;
+
+private:
+    explicit PDFShadingMeshCache() : m_cache(DEFAULT_LIMIT) { }
+
+    mutable QMutex m_mutex;
+    QCache<Key, PDFMesh> m_cache;
+    qint64 m_hits = 0;
+    qint64 m_misses = 0;
+};
+
+inline size_t qHash(const PDFShadingMeshCache::Key& key, size_t seed = 0)
+{
+    size_t hash = qHashMulti(seed, key.contentId, key.reference.objectNumber, key.reference.generation, key.cmsId, int(key.renderingIntent), key.backgroundColor, key.zoomLevel);
+    hash = qHashRange(key.patternSpaceToPageSpaceMatrix.cbegin(), key.patternSpaceToPageSpaceMatrix.cend(), hash);
+    hash = qHashRange(key.meshingArea.cbegin(), key.meshingArea.cend(), hash);
+    hash = qHashRange(key.qualitySettings.cbegin(), key.qualitySettings.cend(), hash);
+    return hash;
+}
+
 }   // namespace pdf
 
 #endif // PDFPATTERN_H
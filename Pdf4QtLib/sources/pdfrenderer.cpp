@@ -158,6 +158,21 @@ QList<PDFRenderError> PDFRenderer::render(QPainter* painter, const QTransform& m
 }
 
 void PDFRenderer::compile(PDFPrecompiledPage* precompiledPage, size_t pageIndex) const
+{
+    compileImpl(precompiledPage, nullptr, pageIndex, nullptr);
+}
+
+void PDFRenderer::compile(PDFPrecompiledPage* precompiledPage, size_t pageIndex, const QTransform& pagePointToDevicePointMatrix) const
+{
+    compileImpl(precompiledPage, nullptr, pageIndex, &pagePointToDevicePointMatrix);
+}
+
+void PDFRenderer::compile(PDFPrecompiledPage* precompiledPage, PDFTextLayout* textLayout, size_t pageIndex) const
+{
+    compileImpl(precompiledPage, textLayout, pageIndex, nullptr);
+}
+
+void PDFRenderer::compileImpl(PDFPrecompiledPage* precompiledPage, PDFTextLayout* textLayout, size_t pageIndex, const QTransform* pagePointToDevicePointMatrix) const
 {
     const PDFCatalog* catalog = m_document->getCatalog();
     if (pageIndex >= catalog->getPageCount() || !catalog->getPage(pageIndex))
@@ -175,8 +190,19 @@ void PDFRenderer::compile(PDFPrecompiledPage* precompiledPage, size_t pageIndex)
 
     PDFPrecompiledPageGenerator generator(precompiledPage, m_features, page, m_document, m_fontCache, m_cms, m_optionalContentActivity, m_meshQualitySettings);
     generator.setOperationControl(m_operationControl);
+    if (pagePointToDevicePointMatrix)
+    {
+        generator.setImageTargetMatrix(*pagePointToDevicePointMatrix);
+    }
+    generator.setTextLayout(textLayout);
     QList<PDFRenderError> errors = generator.processContents();
 
+    if (textLayout)
+    {
+        textLayout->perform();
+        textLayout->optimize();
+    }
+
     if (m_features.testFlag(InvertColors))
     {
         precompiledPage->invertColors();
@@ -468,7 +494,8 @@ void PDFRasterizerPool::render(const std::vector<PDFInteger>& pageIndices,
         PDFPrecompiledPage precompiledPage;
         PDFCMSPointer cms = m_cmsManager->getCurrentCMS();
         PDFRenderer renderer(m_document, m_fontCache, cms.data(), m_optionalContentActivity, m_features, m_meshQualitySettings);
-        renderer.compile(&precompiledPage, pageIndex);
+        const QSize imageSize = imageSizeGetter(page);
+        renderer.compile(&precompiledPage, pageIndex, PDFRenderer::createPagePointToDevicePointMatrix(page, QRect(QPoint(0, 0), imageSize)));
 
         qint64 pageCompileTime = pageTimer.restart();
 
@@ -489,7 +516,7 @@ void PDFRasterizerPool::render(const std::vector<PDFInteger>& pageIndices,
         pageTimer.restart();
         PDFRasterizer* rasterizer = acquire();
         qint64 pageWaitTime = pageTimer.restart();
-        QImage image = rasterizer->render(pageIndex, page, &precompiledPage, imageSizeGetter(page), m_features, &annotationManager, PageRotation::None);
+        QImage image = rasterizer->render(pageIndex, page, &precompiledPage, imageSize, m_features, &annotationManager, PageRotation::None);
         qint64 pageRenderTime = pageTimer.elapsed();
         release(rasterizer);
 
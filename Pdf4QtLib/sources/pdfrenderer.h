@@ -41,6 +41,7 @@ class PDFCMS;
 class PDFProgress;
 class PDFFontCache;
 class PDFCMSManager;
+class PDFTextLayout;
 class PDFPrecompiledPage;
 class PDFAnnotationManager;
 class PDFOptionalContentActivity;
@@ -88,6 +89,7 @@ public:
         InvertColors            = 0x0100,   ///< Invert colors
         DenyExtraGraphics       = 0x0200,   ///< Do not display additional graphics, for example from tools
         DisplayAnnotations      = 0x0400,   ///< Display annotations
+        GlyphCache              = 0x0800,   ///< Draw small glyphs using cache of rasterized glyphs (faster drawing of text)
     };
 
     Q_DECLARE_FLAGS(Features, Feature)
@@ -119,6 +121,23 @@ public:
     /// \param pageIndex Index of page to be compiled
     void compile(PDFPrecompiledPage* precompiledPage, size_t pageIndex) const;
 
+    /// Compiles page for the known target resolution. Images are decoded with the lowest
+    /// resolution sufficient for painting the page using \p pagePointToDevicePointMatrix,
+    /// so compiled page shouldn't be painted with higher scale than given by this matrix.
+    /// \param precompiledPage Precompiled page pointer
+    /// \param pageIndex Index of page to be compiled
+    /// \param pagePointToDevicePointMatrix Matrix, which will be used for painting of the page
+    void compile(PDFPrecompiledPage* precompiledPage, size_t pageIndex, const QTransform& pagePointToDevicePointMatrix) const;
+
+    /// Compiles page and creates its text layout in single pass of the page contents
+    /// processing, so page contents are interpreted only once. Text layout
+    /// should be empty, characters are added to it and layout algorithm
+    /// is performed on them.
+    /// \param precompiledPage Precompiled page pointer
+    /// \param textLayout Text layout
+    /// \param pageIndex Index of page to be compiled
+    void compile(PDFPrecompiledPage* precompiledPage, PDFTextLayout* textLayout, size_t pageIndex) const;
+
     /// Creates page point to device point matrix for the given rectangle. It creates transformation
     /// from page's media box to the target rectangle.
     /// \param page Page, for which we want to create matrix
@@ -137,12 +156,14 @@ public:
                                                         PageRotation rotation);
 
     /// Returns default renderer features
-    static constexpr Features getDefaultFeatures() { return Features(Antialiasing | TextAntialiasing | ClipToCropBox | DisplayAnnotations); }
+    static constexpr Features getDefaultFeatures() { return Features(Antialiasing | TextAntialiasing | ClipToCropBox | DisplayAnnotations | GlyphCache); }
 
     const PDFOperationControl* getOperationControl() const;
     void setOperationControl(const PDFOperationControl* newOperationControl);
 
 private:
+    void compileImpl(PDFPrecompiledPage* precompiledPage, PDFTextLayout* textLayout, size_t pageIndex, const QTransform* pagePointToDevicePointMatrix) const;
+
     const PDFDocument* m_document;
     const PDFFontCache* m_fontCache;
     const PDFCMS* m_cms;
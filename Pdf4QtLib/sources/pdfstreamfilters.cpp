@@ -697,6 +697,13 @@ QByteArray PDFStreamFilterStorage::getDecodedStream(const PDFStream* stream, con
         }
     }
 
+    // Stream data can reference memory mapped file. Decoded data can outlive
+    // the document, so we must not return data referencing the mapped file.
+    if (result.constData() == stream->getContent()->constData())
+    {
+        result.detach();
+    }
+
     return result;
 }
 
@@ -0,0 +1,352 @@
+//    Copyright (C) 2023 Jakub Melka
+//
+//    This file is part of PDF4QT.
+//
+//    PDF4QT is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    with the written consent of the copyright owner, any later version.
+//
+//    PDF4QT is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public License
+//    along with PDF4QT.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "pdftextindex.h"
+#include "pdfexecutionpolicy.h"
+#include "pdfdbgheap.h"
+
+namespace pdf
+{
+
+PDFTextIndex::PDFTextIndex(PDFTextFlow::FlowFlags flowFlags) :
+    m_flowFlags(flowFlags)
+{
+
+}
+
+PDFTextIndex PDFTextIndex::create(const PDFTextLayoutStorage& storage, PDFTextFlow::FlowFlags flowFlags)
+{
+    PDFTextIndex index(flowFlags);
+
+    std::vector<PDFInteger> pageIndices;
+    for (PDFInteger pageIndex = 0, pageCount = PDFInteger(storage.getCount()); pageIndex < pageCount; ++pageIndex)
+    {
+        if (storage.hasTextLayout(pageIndex))
+        {
+            pageIndices.push_back(pageIndex);
+        }
+    }
+
+    QMutex mutex;
+    auto indexPage = [&index, &storage, &mutex](PDFInteger pageIndex)
+    {
+        index.addPage(pageIndex, storage.getTextLayout(pageIndex), &mutex);
+    };
+    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, pageIndices.cbegin(), pageIndices.cend(), indexPage);
+
+    return index;
+}
+
+void PDFTextIndex::addPage(PDFInteger pageIndex, const PDFTextLayout& layout, QMutex* mutex)
+{
+    struct PageToken
+    {
+        QString normalizedWord;
+        QString word;
+        Posting posting;
+    };
+
+    // Text flows are created and tokenized without locking,
+    // mutex is locked only when postings are inserted into the index.
+    {
+        QMutexLocker lock(mutex);
+        if (isPageIndexed(pageIndex))
+        {
+            return;
+        }
+    }
+
+    std::vector<PageToken> pageTokens;
+    PDFTextFlows textFlows = PDFTextFlow::createTextFlows(layout, m_flowFlags, pageIndex);
+    for (size_t flowIndex = 0; flowIndex < textFlows.size(); ++flowIndex)
+    {
+        std::vector<Token> tokens = tokenize(textFlows[flowIndex].getText());
+        for (size_t position = 0; position < tokens.size(); ++position)
+        {
+            PageToken pageToken;
+            pageToken.normalizedWord = normalize(tokens[position].word);
+            pageToken.word = qMove(tokens[position].word);
+            pageToken.posting.pageIndex = quint32(pageIndex);
+            pageToken.posting.flowIndex = quint32(flowIndex);
+            pageToken.posting.position = quint32(position);
+            pageToken.posting.characterIndex = quint32(tokens[position].characterIndex);
+            pageTokens.emplace_back(qMove(pageToken));
+        }
+    }
+
+    QMutexLocker lock(mutex);
+    if (!m_pageIndices.insert(pageIndex).second)
+    {
+        // Page was indexed by another thread in the meantime
+        return;
+    }
+
+    for (PageToken& pageToken : pageTokens)
+    {
+        auto it = m_wordIndices.find(pageToken.word);
+        if (it == m_wordIndices.end())
+        {
+            it = m_wordIndices.insert(pageToken.word, quint32(m_words.size()));
+            m_words.push_back(pageToken.word);
+        }
+
+        // Postings are kept sorted, so queries don't need to sort them. Pages are
+        // usually indexed in ascending order, so postings are appended at the end.
+        pageToken.posting.wordIndex = it.value();
+        std::vector<Posting>& postings = m_postings[pageToken.normalizedWord];
+        postings.insert(std::upper_bound(postings.begin(), postings.end(), pageToken.posting), pageToken.posting);
+    }
+}
+
+PDFTextIndex::Matches PDFTextIndex::query(const QString& text, QueryFlags flags) const
+{
+    Matches matches;
+
+    std::vector<Token> tokens = tokenize(text);
+    if (tokens.empty())
+    {
+        return matches;
+    }
+
+    // Find postings of each word of the query. Postings of a single word are sorted,
+    // so they are used directly. Postings of multiple words (prefix query) are merged,
+    // and postings of case sensitive query are filtered.
+    const bool isCaseSensitive = flags.testFlag(CaseSensitive);
+    std::vector<std::vector<Posting>> mergedPostings(tokens.size());
+    std::vector<const std::vector<Posting>*> tokenPostings(tokens.size(), nullptr);
+    for (size_t i = 0; i < tokens.size(); ++i)
+    {
+        const QString& word = tokens[i].word;
+        const QString normalizedWord = normalize(word);
+        const bool isPrefix = flags.testFlag(Prefix) && i + 1 == tokens.size();
+
+        std::vector<Posting>& merged = mergedPostings[i];
+        const std::vector<Posting>* postings = nullptr;
+        for (auto it = m_postings.lower_bound(normalizedWord); it != m_postings.cend(); ++it)
+        {
+            if (isPrefix ? !it->first.startsWith(normalizedWord) : it->first != normalizedWord)
+            {
+                break;
+            }
+
+            if (!isCaseSensitive && !postings && merged.empty())
+            {
+                postings = &it->second;
+                continue;
+            }
+
+            if (postings)
+            {
+                merged = *postings;
+                postings = nullptr;
+            }
+
+            const auto mergedSize = merged.size();
+            for (const Posting& posting : it->second)
+            {
+                if (isCaseSensitive)
+                {
+                    const QString& postingWord = m_words[posting.wordIndex];
+                    if (isPrefix ? !postingWord.startsWith(word) : postingWord != word)
+                    {
+                        continue;
+                    }
+                }
+
+                merged.push_back(posting);
+            }
+            std::inplace_merge(merged.begin(), merged.begin() + mergedSize, merged.end());
+        }
+
+        if (!postings)
+        {
+            postings = &merged;
+        }
+
+        if (postings->empty())
+        {
+            // Some word of the query is not in the index
+            return matches;
+        }
+
+        tokenPostings[i] = postings;
+    }
+
+    // Words of the query must follow each other in the text flow
+    for (const Posting& firstPosting : *tokenPostings.front())
+    {
+        const Posting* lastPosting = &firstPosting;
+        for (size_t i = 1; i < tokenPostings.size() && lastPosting; ++i)
+        {
+            Posting nextPosting = firstPosting;
+            nextPosting.position += quint32(i);
+
+            const std::vector<Posting>& postings = *tokenPostings[i];
+            auto it = std::lower_bound(postings.cbegin(), postings.cend(), nextPosting);
+            lastPosting = (it != postings.cend() && !(nextPosting < *it)) ? &*it : nullptr;
+        }
+
+        if (!lastPosting)
+        {
+            continue;
+        }
+
+        const quint32 lastCharacterEnd = lastPosting->characterIndex + quint32(m_words[lastPosting->wordIndex].size());
+
+        Match match;
+        match.pageIndex = firstPosting.pageIndex;
+        match.flowIndex = firstPosting.flowIndex;
+        match.characterIndex = firstPosting.characterIndex;
+        match.length = lastCharacterEnd - firstPosting.characterIndex;
+        matches.push_back(match);
+    }
+
+    std::sort(matches.begin(), matches.end());
+    return matches;
+}
+
+std::vector<PDFInteger> PDFTextIndex::getCandidatePages(const QString& text, const std::vector<PDFInteger>& pageIndices) const
+{
+    std::vector<Token> tokens = tokenize(text);
+    if (tokens.empty())
+    {
+        return pageIndices;
+    }
+
+    // Each word of the text must be contained in some word of the page. We scan
+    // the words of the index, not the text of the pages, so the search is fast,
+    // even if text layouts are compressed.
+    std::vector<PDFInteger> wordPageIndices;
+    for (size_t i = 0; i < tokens.size(); ++i)
+    {
+        const QString normalizedWord = normalize(tokens[i].word);
+
+        std::vector<PDFInteger> tokenPageIndices;
+        for (const auto& [word, postings] : m_postings)
+        {
+            if (!word.contains(normalizedWord))
+            {
+                continue;
+            }
+
+            for (const Posting& posting : postings)
+            {
+                if (tokenPageIndices.empty() || tokenPageIndices.back() != PDFInteger(posting.pageIndex))
+                {
+                    tokenPageIndices.push_back(posting.pageIndex);
+                }
+            }
+        }
+        std::sort(tokenPageIndices.begin(), tokenPageIndices.end());
+        tokenPageIndices.erase(std::unique(tokenPageIndices.begin(), tokenPageIndices.end()), tokenPageIndices.end());
+
+        if (i == 0)
+        {
+            wordPageIndices = qMove(tokenPageIndices);
+        }
+        else
+        {
+            std::vector<PDFInteger> intersection;
+            std::set_intersection(wordPageIndices.cbegin(), wordPageIndices.cend(), tokenPageIndices.cbegin(), tokenPageIndices.cend(), std::back_inserter(intersection));
+            wordPageIndices = qMove(intersection);
+        }
+
+        if (wordPageIndices.empty())
+        {
+            break;
+        }
+    }
+
+    std::vector<PDFInteger> candidatePageIndices;
+    for (PDFInteger pageIndex : pageIndices)
+    {
+        if (!isPageIndexed(pageIndex) || std::binary_search(wordPageIndices.cbegin(), wordPageIndices.cend(), pageIndex))
+        {
+            candidatePageIndices.push_back(pageIndex);
+        }
+    }
+    return candidatePageIndices;
+}
+
+PDFFindResults PDFTextIndex::createFindResults(const Matches& matches, const PDFTextLayoutStorage& storage) const
+{
+    PDFFindResults results;
+
+    // Matches of each page form continuous range, because matches are sorted
+    std::vector<std::pair<Matches::const_iterator, Matches::const_iterator>> pageMatches;
+    for (auto it = matches.cbegin(); it != matches.cend();)
+    {
+        auto itEnd = std::find_if(it, matches.cend(), [it](const Match& match) { return match.pageIndex != it->pageIndex; });
+        pageMatches.emplace_back(it, itEnd);
+        it = itEnd;
+    }
+
+    QMutex resultsMutex;
+    auto createPageFindResults = [this, &storage, &results, &resultsMutex](const std::pair<Matches::const_iterator, Matches::const_iterator>& range)
+    {
+        const PDFInteger pageIndex = range.first->pageIndex;
+        PDFTextFlows textFlows = PDFTextFlow::createTextFlows(storage.getTextLayout(pageIndex), m_flowFlags, pageIndex);
+
+        PDFFindResults pageResults;
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (it->flowIndex < PDFInteger(textFlows.size()))
+            {
+                PDFFindResult result = textFlows[it->flowIndex].createFindResult(it->characterIndex, it->length);
+                if (!result.textSelectionItems.empty())
+                {
+                    pageResults.emplace_back(qMove(result));
+                }
+            }
+        }
+
+        QMutexLocker lock(&resultsMutex);
+        results.insert(results.end(), std::make_move_iterator(pageResults.begin()), std::make_move_iterator(pageResults.end()));
+    };
+    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, pageMatches.cbegin(), pageMatches.cend(), createPageFindResults);
+
+    std::sort(results.begin(), results.end());
+    return results;
+}
+
+std::vector<PDFTextIndex::Token> PDFTextIndex::tokenize(const QString& text)
+{
+    std::vector<Token> tokens;
+
+    const qsizetype length = text.size();
+    qsizetype index = 0;
+    while (index < length)
+    {
+        if (!text[index].isLetterOrNumber())
+        {
+            ++index;
+            continue;
+        }
+
+        const qsizetype start = index;
+        while (index < length && text[index].isLetterOrNumber())
+        {
+            ++index;
+        }
+
+        tokens.push_back(Token{ text.mid(start, index - start), start });
+    }
+
+    return tokens;
+}
+
+}   // namespace pdf
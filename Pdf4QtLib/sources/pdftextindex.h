@@ -0,0 +1,160 @@
+//    Copyright (C) 2023 Jakub Melka
+//
+//    This file is part of PDF4QT.
+//
+//    PDF4QT is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    with the written consent of the copyright owner, any later version.
+//
+//    PDF4QT is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public License
+//    along with PDF4QT.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef PDFTEXTINDEX_H
+#define PDFTEXTINDEX_H
+
+#include "pdfglobal.h"
+#include "pdftextlayout.h"
+
+#include <QHash>
+#include <QMutex>
+
+#include <map>
+#include <set>
+#include <compare>
+
+namespace pdf
+{
+
+/// Full-text index of text layouts. Index maps normalized tokens (words folded
+/// to lower case) to their occurences (postings) in text flows of pages. Queries
+/// (words, word prefixes and phrases) are evaluated using the index only, text
+/// layouts are accessed just for creating find results of the matches. Index
+/// can be created from the text layout storage, or page by page, as text layouts
+/// are being created. Regular expressions are not supported by the index,
+/// use PDFTextLayoutStorage::find for them. For substring searches, index can
+/// select candidate pages, which are then searched by PDFTextLayoutStorage::find.
+class PDF4QTLIBSHARED_EXPORT PDFTextIndex
+{
+public:
+    explicit PDFTextIndex(PDFTextFlow::FlowFlags flowFlags = PDFTextFlow::SeparateBlocks);
+
+    enum QueryFlag
+    {
+        None            = 0x0000,
+        CaseSensitive   = 0x0001,   ///< Letter case of words must match
+        Prefix          = 0x0002,   ///< Last word of the query matches beginning of the word
+    };
+    Q_DECLARE_FLAGS(QueryFlags, QueryFlag)
+
+    /// Match of the query in the text flow
+    struct Match
+    {
+        PDFInteger pageIndex = 0;
+        PDFInteger flowIndex = 0;       ///< Index of text flow on the page
+        PDFInteger characterIndex = 0;  ///< Index of the first matched character in the text flow
+        PDFInteger length = 0;          ///< Count of matched characters
+
+        auto operator<=>(const Match&) const = default;
+    };
+    using Matches = std::vector<Match>;
+
+    /// Creates index of all text layouts in the storage. Pages are
+    /// indexed in parallel.
+    /// \param storage Text layout storage
+    /// \param flowFlags Flags of text flows created from text layouts
+    static PDFTextIndex create(const PDFTextLayoutStorage& storage, PDFTextFlow::FlowFlags flowFlags);
+
+    /// Adds text layout of the page into the index. If page is already indexed,
+    /// nothing happens. Function is thread safe, if mutex is provided.
+    /// \param pageIndex Page index
+    /// \param layout Text layout of the page
+    /// \param mutex Mutex for locking (calls of addPage from multiple threads)
+    void addPage(PDFInteger pageIndex, const PDFTextLayout& layout, QMutex* mutex);
+
+    /// Finds all occurences of the query. Query is split into words, and words
+    /// must follow each other in the text flow (characters between the words,
+    /// such as spaces and punctuation, are ignored). Matches are sorted.
+    /// \param text Query text
+    /// \param flags Query flags
+    Matches query(const QString& text, QueryFlags flags) const;
+
+    /// Returns pages from \p pageIndices, which can contain the text as a substring
+    /// (in any letter case). Word list of the index is scanned instead of the text
+    /// of pages: every word of the text must be a part of some word on the page.
+    /// Pages, which are not indexed, are always returned. If text doesn't contain
+    /// any word, all pages are returned.
+    /// \param text Text to be found
+    /// \param pageIndices Indices of pages
+    std::vector<PDFInteger> getCandidatePages(const QString& text, const std::vector<PDFInteger>& pageIndices) const;
+
+    /// Creates find results for matches. Only text layouts of
+    /// pages containing some match are accessed.
+    /// \param matches Matches (result of the query)
+    /// \param storage Text layout storage, from which index was created
+    PDFFindResults createFindResults(const Matches& matches, const PDFTextLayoutStorage& storage) const;
+
+    /// Returns flags of text flows, for which index was created
+    PDFTextFlow::FlowFlags getFlowFlags() const { return m_flowFlags; }
+
+    /// Returns count of distinct normalized words in the index
+    size_t getWordCount() const { return m_postings.size(); }
+
+    /// Returns true, if page is indexed
+    /// \param pageIndex Page index
+    bool isPageIndexed(PDFInteger pageIndex) const { return m_pageIndices.count(pageIndex); }
+
+private:
+    /// Occurence of a word in a text flow
+    struct Posting
+    {
+        quint32 pageIndex = 0;
+        quint32 flowIndex = 0;
+        quint32 position = 0;       ///< Ordinal number of the word in the text flow
+        quint32 characterIndex = 0; ///< Index of the first character of the word in the text flow
+        quint32 wordIndex = 0;      ///< Index of the word (as it is written in the text) in m_words
+
+        /// Postings are ordered by their position in the document
+        bool operator<(const Posting& other) const { return std::tie(pageIndex, flowIndex, position) < std::tie(other.pageIndex, other.flowIndex, other.position); }
+    };
+
+    /// Word of the text with its position in the text flow
+    struct Token
+    {
+        QString word;
+        qsizetype characterIndex = 0;
+    };
+
+    /// Splits text into words (sequences of letters and digits)
+    /// \param text Text
+    static std::vector<Token> tokenize(const QString& text);
+
+    /// Returns normalized word (which is a key of postings)
+    /// \param word Word
+    static QString normalize(const QString& word) { return word.toCaseFolded(); }
+
+    PDFTextFlow::FlowFlags m_flowFlags;
+
+    /// Postings of normalized words, sorted by normalized word, so words
+    /// with common prefix form a continuous range. Postings of each word
+    /// are sorted by their position in the document.
+    std::map<QString, std::vector<Posting>> m_postings;
+
+    /// Words as they are written in the text (for case sensitive queries)
+    std::vector<QString> m_words;
+    QHash<QString, quint32> m_wordIndices;
+
+    /// Indices of indexed pages
+    std::set<PDFInteger> m_pageIndices;
+};
+
+}   // namespace pdf
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(pdf::PDFTextIndex::QueryFlags)
+
+#endif // PDFTEXTINDEX_H
@@ -17,11 +17,25 @@
 
 #include "pdftextlayout.h"
 #include "pdfutils.h"
+#include "pdfcatalog.h"
+#include "pdfdocument.h"
+#include "pdfsecurityhandler.h"
+#include "pdfconstants.h"
 #include "pdfexecutionpolicy.h"
 #include "pdfdbgheap.h"
 
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
 #include <QPainter>
+#include <QSaveFile>
+#include <QSysInfo>
+#include <QCryptographicHash>
 
+#include <span>
+#include <type_traits>
+#include <cstring>
 #include <execution>
 
 namespace pdf
@@ -1010,54 +1024,471 @@ QDataStream& operator>>(QDataStream& stream, TextCharacter& character)
     return stream;
 }
 
-PDFTextLayout PDFTextLayoutStorage::getTextLayout(PDFInteger pageIndex) const
+namespace
+{
+
+/// Header of the flat text layout buffer, followed by arrays
+/// of characters, angles, blocks, lines, line characters and
+/// path elements (in this order).
+struct FlatTextLayoutHeader
+{
+    static constexpr quint32 MAGIC = 0x4C545446; // 'FTTL'
+    static constexpr quint32 VERSION = 1;
+
+    quint32 magic = MAGIC;
+    quint32 version = VERSION;
+    quint64 characterCount = 0;
+    quint64 angleCount = 0;
+    quint64 blockCount = 0;
+    quint64 lineCount = 0;
+    quint64 lineCharacterCount = 0;
+    quint64 pathElementCount = 0;
+    quint64 samples = 0;
+    PDFReal distanceSensitivity = 0.0;
+    PDFReal charactersOnLineSensitivity = 0.0;
+    PDFReal fontSensitivity = 0.0;
+    PDFReal blockVerticalSensitivity = 0.0;
+    PDFReal blockOverlapSensitivity = 0.0;
+};
+
+/// Painter path, elements are stored in the array of path elements
+struct FlatPath
 {
-    PDFTextLayout result;
+    quint64 elementOffset = 0;
+    quint32 elementCount = 0;
+    qint32 fillRule = 0;
+};
+
+struct FlatPathElement
+{
+    PDFReal x = 0.0;
+    PDFReal y = 0.0;
+    qint32 type = 0;
+    qint32 reserved = 0;
+};
+
+struct FlatCharacter
+{
+    PDFReal x = 0.0;
+    PDFReal y = 0.0;
+    PDFReal angle = 0.0;
+    PDFReal fontSize = 0.0;
+    PDFReal advance = 0.0;
+    FlatPath boundingBox;
+    quint32 character = 0;
+    quint32 reserved = 0;
+};
+
+/// Text line (characters are stored in the array of line characters) or text
+/// block (lines are stored in the array of lines)
+struct FlatTextItem
+{
+    quint64 offset = 0;
+    quint64 count = 0;
+    FlatPath boundingBox;
+    PDFReal topLeftX = 0.0;
+    PDFReal topLeftY = 0.0;
+};
+
+static_assert(std::is_trivially_copyable_v<FlatTextLayoutHeader>);
+static_assert(std::is_trivially_copyable_v<FlatCharacter>);
+static_assert(std::is_trivially_copyable_v<FlatTextItem>);
+static_assert(std::is_trivially_copyable_v<FlatPathElement>);
+
+}   // namespace
+
+QByteArray PDFTextLayoutStorage::serialize(const PDFTextLayout& layout)
+{
+    std::vector<FlatCharacter> characters;
+    std::vector<FlatTextItem> blocks;
+    std::vector<FlatTextItem> lines;
+    std::vector<FlatCharacter> lineCharacters;
+    std::vector<FlatPathElement> pathElements;
 
-    if (pageIndex >= 0 && pageIndex < static_cast<PDFInteger>(m_offsets.size()))
+    auto addPath = [&pathElements](const QPainterPath& path)
     {
-        QDataStream layoutStream(const_cast<QByteArray*>(&m_textLayouts), QIODevice::ReadOnly);
-        layoutStream.skipRawData(m_offsets[pageIndex]);
+        FlatPath flatPath;
+        flatPath.elementOffset = pathElements.size();
+        flatPath.elementCount = quint32(path.elementCount());
+        flatPath.fillRule = path.fillRule();
 
-        QByteArray buffer;
-        layoutStream >> buffer;
-        buffer = qUncompress(buffer);
+        for (int i = 0, count = path.elementCount(); i < count; ++i)
+        {
+            const QPainterPath::Element& element = path.elementAt(i);
+
+            FlatPathElement flatElement;
+            flatElement.x = element.x;
+            flatElement.y = element.y;
+            flatElement.type = element.type;
+            pathElements.push_back(flatElement);
+        }
+
+        return flatPath;
+    };
 
-        QDataStream stream(&buffer, QIODevice::ReadOnly);
-        stream >> result;
+    auto addCharacter = [&addPath](std::vector<FlatCharacter>& target, const TextCharacter& character)
+    {
+        FlatCharacter flatCharacter;
+        flatCharacter.x = character.position.x();
+        flatCharacter.y = character.position.y();
+        flatCharacter.angle = character.angle;
+        flatCharacter.fontSize = character.fontSize;
+        flatCharacter.advance = character.advance;
+        flatCharacter.boundingBox = addPath(character.boundingBox);
+        flatCharacter.character = character.character.unicode();
+        target.push_back(flatCharacter);
+    };
+
+    auto createItem = [&addPath](size_t offset, size_t count, const QPainterPath& boundingBox, const QPointF& topLeft)
+    {
+        FlatTextItem item;
+        item.offset = offset;
+        item.count = count;
+        item.boundingBox = addPath(boundingBox);
+        item.topLeftX = topLeft.x();
+        item.topLeftY = topLeft.y();
+        return item;
+    };
+
+    characters.reserve(layout.m_characters.size());
+    lineCharacters.reserve(layout.m_characters.size());
+    for (const TextCharacter& character : layout.m_characters)
+    {
+        addCharacter(characters, character);
     }
 
-    return result;
+    for (const PDFTextBlock& block : layout.m_blocks)
+    {
+        blocks.push_back(createItem(lines.size(), block.m_lines.size(), block.m_boundingBox, block.m_topLeft));
+
+        for (const PDFTextLine& line : block.m_lines)
+        {
+            lines.push_back(createItem(lineCharacters.size(), line.m_characters.size(), line.m_boundingBox, line.m_topLeft));
+
+            for (const TextCharacter& character : line.m_characters)
+            {
+                addCharacter(lineCharacters, character);
+            }
+        }
+    }
+
+    const std::vector<PDFReal> angles(layout.m_angles.cbegin(), layout.m_angles.cend());
+
+    FlatTextLayoutHeader header;
+    header.characterCount = characters.size();
+    header.angleCount = angles.size();
+    header.blockCount = blocks.size();
+    header.lineCount = lines.size();
+    header.lineCharacterCount = lineCharacters.size();
+    header.pathElementCount = pathElements.size();
+    header.samples = layout.m_settings.samples;
+    header.distanceSensitivity = layout.m_settings.distanceSensitivity;
+    header.charactersOnLineSensitivity = layout.m_settings.charactersOnLineSensitivity;
+    header.fontSensitivity = layout.m_settings.fontSensitivity;
+    header.blockVerticalSensitivity = layout.m_settings.blockVerticalSensitivity;
+    header.blockOverlapSensitivity = layout.m_settings.blockOverlapSensitivity;
+
+    QByteArray buffer;
+    buffer.reserve(qsizetype(sizeof(header) +
+                             sizeof(FlatCharacter) * (characters.size() + lineCharacters.size()) +
+                             sizeof(PDFReal) * angles.size() +
+                             sizeof(FlatTextItem) * (blocks.size() + lines.size()) +
+                             sizeof(FlatPathElement) * pathElements.size()));
+
+    auto append = [&buffer](const auto& items)
+    {
+        buffer.append(reinterpret_cast<const char*>(items.data()), qsizetype(sizeof(typename std::decay_t<decltype(items)>::value_type) * items.size()));
+    };
+
+    buffer.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    append(characters);
+    append(angles);
+    append(blocks);
+    append(lines);
+    append(lineCharacters);
+    append(pathElements);
+    return buffer;
 }
 
-void PDFTextLayoutStorage::setTextLayout(PDFInteger pageIndex, const PDFTextLayout& layout, QMutex* mutex)
+PDFTextLayout PDFTextLayoutStorage::deserialize(const QByteArray& buffer)
 {
-    QByteArray result;
+    PDFTextLayout layout;
+
+    FlatTextLayoutHeader header;
+    if (size_t(buffer.size()) < sizeof(header))
+    {
+        return layout;
+    }
+
+    std::memcpy(&header, buffer.constData(), sizeof(header));
+    if (header.magic != FlatTextLayoutHeader::MAGIC || header.version != FlatTextLayoutHeader::VERSION)
+    {
+        return layout;
+    }
+
+    // Check, that arrays fit exactly into the buffer (counts are
+    // checked first, so computed size can't overflow).
+    const quint64 bufferSize = quint64(buffer.size());
+    const quint64 counts[] = { header.characterCount, header.angleCount, header.blockCount, header.lineCount, header.lineCharacterCount, header.pathElementCount };
+    if (std::any_of(std::begin(counts), std::end(counts), [bufferSize](quint64 count) { return count > bufferSize; }))
     {
-        QDataStream stream(&result, QIODevice::WriteOnly);
-        stream << layout;
+        return layout;
     }
-    result = qCompress(result, 9);
+
+    const quint64 expectedSize = sizeof(header) +
+                                 sizeof(FlatCharacter) * (header.characterCount + header.lineCharacterCount) +
+                                 sizeof(PDFReal) * header.angleCount +
+                                 sizeof(FlatTextItem) * (header.blockCount + header.lineCount) +
+                                 sizeof(FlatPathElement) * header.pathElementCount;
+    if (expectedSize != bufferSize)
+    {
+        return layout;
+    }
+
+    const char* data = buffer.constData() + sizeof(header);
+    auto read = [&data](auto& items, quint64 count)
+    {
+        items.resize(count);
+        const size_t size = sizeof(typename std::decay_t<decltype(items)>::value_type) * count;
+        if (size > 0)
+        {
+            std::memcpy(items.data(), data, size);
+        }
+        data += size;
+    };
+
+    std::vector<FlatCharacter> characters;
+    std::vector<PDFReal> angles;
+    std::vector<FlatTextItem> blocks;
+    std::vector<FlatTextItem> lines;
+    std::vector<FlatCharacter> lineCharacters;
+    std::vector<FlatPathElement> pathElements;
+    read(characters, header.characterCount);
+    read(angles, header.angleCount);
+    read(blocks, header.blockCount);
+    read(lines, header.lineCount);
+    read(lineCharacters, header.lineCharacterCount);
+    read(pathElements, header.pathElementCount);
+
+    bool isValid = true;
+    auto createPath = [&pathElements, &isValid](const FlatPath& flatPath)
+    {
+        QPainterPath path;
+        if (flatPath.elementOffset > pathElements.size() || flatPath.elementCount > pathElements.size() - flatPath.elementOffset)
+        {
+            isValid = false;
+            return path;
+        }
+
+        path.reserve(int(flatPath.elementCount));
+        path.setFillRule(flatPath.fillRule == Qt::WindingFill ? Qt::WindingFill : Qt::OddEvenFill);
+
+        const FlatPathElement* element = pathElements.data() + flatPath.elementOffset;
+        const FlatPathElement* elementEnd = element + flatPath.elementCount;
+        for (; element != elementEnd; ++element)
+        {
+            switch (element->type)
+            {
+                case QPainterPath::MoveToElement:
+                    path.moveTo(element->x, element->y);
+                    break;
+
+                case QPainterPath::LineToElement:
+                    path.lineTo(element->x, element->y);
+                    break;
+
+                case QPainterPath::CurveToElement:
+                {
+                    // Curve is followed by two data elements (second control point and end point)
+                    if (std::distance(element, elementEnd) < 3)
+                    {
+                        isValid = false;
+                        return path;
+                    }
+
+                    const FlatPathElement* data1 = element + 1;
+                    const FlatPathElement* data2 = element + 2;
+                    path.cubicTo(element->x, element->y, data1->x, data1->y, data2->x, data2->y);
+                    element = data2;
+                    break;
+                }
+
+                default:
+                    isValid = false;
+                    return path;
+            }
+        }
+
+        return path;
+    };
+
+    auto createCharacter = [&createPath](const FlatCharacter& flatCharacter)
+    {
+        TextCharacter character;
+        character.character = QChar(char16_t(flatCharacter.character));
+        character.position = QPointF(flatCharacter.x, flatCharacter.y);
+        character.angle = flatCharacter.angle;
+        character.fontSize = flatCharacter.fontSize;
+        character.advance = flatCharacter.advance;
+        character.boundingBox = createPath(flatCharacter.boundingBox);
+        return character;
+    };
+
+    layout.m_characters.reserve(characters.size());
+    for (const FlatCharacter& flatCharacter : characters)
+    {
+        layout.m_characters.push_back(createCharacter(flatCharacter));
+    }
+
+    layout.m_angles.insert(angles.cbegin(), angles.cend());
+
+    layout.m_settings.samples = size_t(header.samples);
+    layout.m_settings.distanceSensitivity = header.distanceSensitivity;
+    layout.m_settings.charactersOnLineSensitivity = header.charactersOnLineSensitivity;
+    layout.m_settings.fontSensitivity = header.fontSensitivity;
+    layout.m_settings.blockVerticalSensitivity = header.blockVerticalSensitivity;
+    layout.m_settings.blockOverlapSensitivity = header.blockOverlapSensitivity;
+
+    layout.m_blocks.reserve(blocks.size());
+    for (const FlatTextItem& flatBlock : blocks)
+    {
+        if (flatBlock.offset > lines.size() || flatBlock.count > lines.size() - flatBlock.offset)
+        {
+            return PDFTextLayout();
+        }
+
+        PDFTextBlock block;
+        block.m_boundingBox = createPath(flatBlock.boundingBox);
+        block.m_topLeft = QPointF(flatBlock.topLeftX, flatBlock.topLeftY);
+        block.m_lines.reserve(flatBlock.count);
+
+        for (const FlatTextItem& flatLine : std::span(lines.data() + flatBlock.offset, flatBlock.count))
+        {
+            if (flatLine.offset > lineCharacters.size() || flatLine.count > lineCharacters.size() - flatLine.offset)
+            {
+                return PDFTextLayout();
+            }
+
+            PDFTextLine line;
+            line.m_boundingBox = createPath(flatLine.boundingBox);
+            line.m_topLeft = QPointF(flatLine.topLeftX, flatLine.topLeftY);
+            line.m_characters.reserve(flatLine.count);
+
+            for (const FlatCharacter& flatCharacter : std::span(lineCharacters.data() + flatLine.offset, flatLine.count))
+            {
+                line.m_characters.push_back(createCharacter(flatCharacter));
+            }
+
+            block.m_lines.push_back(qMove(line));
+        }
+
+        layout.m_blocks.push_back(qMove(block));
+    }
+
+    if (!isValid)
+    {
+        return PDFTextLayout();
+    }
+
+    return layout;
+}
+
+PDFTextLayout PDFTextLayoutStorage::getTextLayout(PDFInteger pageIndex) const
+{
+    PDFTextLayout result;
+
+    if (hasTextLayout(pageIndex))
+    {
+        result = deserialize(qUncompress(m_textLayouts[pageIndex]));
+    }
+
+    return result;
+}
+
+void PDFTextLayoutStorage::setTextLayout(PDFInteger pageIndex, const PDFTextLayout& layout, QMutex* mutex)
+{
+    QByteArray result = qCompress(serialize(layout), COMPRESSION_LEVEL);
 
     QMutexLocker lock(mutex);
-    m_offsets[pageIndex] = m_textLayouts.size();
+    m_textLayouts[pageIndex] = qMove(result);
+}
 
-    QDataStream layoutStream(&m_textLayouts, QIODevice::Append | QIODevice::WriteOnly);
-    layoutStream << result;
+void PDFTextLayoutStorage::merge(const PDFTextLayoutStorage& storage)
+{
+    Q_ASSERT(m_textLayouts.size() == storage.m_textLayouts.size());
+
+    for (size_t i = 0, count = qMin(m_textLayouts.size(), storage.m_textLayouts.size()); i < count; ++i)
+    {
+        if (m_textLayouts[i].isEmpty())
+        {
+            m_textLayouts[i] = storage.m_textLayouts[i];
+        }
+    }
+
+    for (const QSharedPointer<QFile>& mappedFile : storage.m_mappedFiles)
+    {
+        if (std::find(m_mappedFiles.cbegin(), m_mappedFiles.cend(), mappedFile) == m_mappedFiles.cend())
+        {
+            m_mappedFiles.push_back(mappedFile);
+        }
+    }
 }
 
 PDFFindResults PDFTextLayoutStorage::find(const QString& text, Qt::CaseSensitivity caseSensitivity, PDFTextFlow::FlowFlags flowFlags) const
+{
+    return find(text, caseSensitivity, flowFlags, getPageIndices());
+}
+
+PDFFindResults PDFTextLayoutStorage::find(const QString& text, Qt::CaseSensitivity caseSensitivity, PDFTextFlow::FlowFlags flowFlags, const std::vector<PDFInteger>& pageIndices) const
+{
+    return findImpl(pageIndices, flowFlags, [&text, caseSensitivity](const PDFTextFlow& textFlow) { return textFlow.find(text, caseSensitivity); });
+}
+
+PDFFindResults PDFTextLayoutStorage::find(const QRegularExpression& expression, PDFTextFlow::FlowFlags flowFlags) const
+{
+    return find(expression, flowFlags, getPageIndices());
+}
+
+PDFFindResults PDFTextLayoutStorage::find(const QRegularExpression& expression, PDFTextFlow::FlowFlags flowFlags, const std::vector<PDFInteger>& pageIndices) const
+{
+    return findImpl(pageIndices, flowFlags, [&expression](const PDFTextFlow& textFlow) { return textFlow.find(expression); });
+}
+
+std::vector<PDFInteger> PDFTextLayoutStorage::getPageIndices() const
+{
+    std::vector<PDFInteger> pageIndices;
+    pageIndices.reserve(m_textLayouts.size());
+
+    for (size_t i = 0; i < m_textLayouts.size(); ++i)
+    {
+        if (!m_textLayouts[i].isEmpty())
+        {
+            pageIndices.push_back(PDFInteger(i));
+        }
+    }
+
+    return pageIndices;
+}
+
+PDFFindResults PDFTextLayoutStorage::findImpl(const std::vector<PDFInteger>& pageIndices,
+                                              PDFTextFlow::FlowFlags flowFlags,
+                                              const std::function<PDFFindResults(const PDFTextFlow&)>& findFunction) const
 {
     PDFFindResults results;
 
     QMutex resultsMutex;
-    auto findImpl = [this, flowFlags, caseSensitivity, &results, &resultsMutex, &text](size_t pageIndex)
+    auto findOnPage = [this, flowFlags, &results, &resultsMutex, &findFunction](PDFInteger pageIndex)
     {
+        if (!hasTextLayout(pageIndex))
+        {
+            return;
+        }
+
         PDFTextLayout textLayout = getTextLayout(pageIndex);
         PDFTextFlows textFlows = PDFTextFlow::createTextFlows(textLayout, flowFlags, pageIndex);
         for (const PDFTextFlow& textFlow : textFlows)
         {
-            PDFFindResults flowResults = textFlow.find(text, caseSensitivity);
+            PDFFindResults flowResults = findFunction(textFlow);
 
             // Jakub Melka: Do not lock mutex, if we didn't find anything. In that case, just skip to next flow.
             if (!flowResults.empty())
@@ -1068,40 +1499,221 @@ PDFFindResults PDFTextLayoutStorage::find(const QString& text, Qt::CaseSensitivi
         }
     };
 
-    auto range = PDFIntegerRange<size_t>(0, m_offsets.size());
-    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, range.begin(), range.end(), findImpl);
+    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, pageIndices.cbegin(), pageIndices.cend(), findOnPage);
 
     std::sort(results.begin(), results.end());
     return results;
 }
 
-PDFFindResults PDFTextLayoutStorage::find(const QRegularExpression& expression, PDFTextFlow::FlowFlags flowFlags) const
+QByteArray PDFTextLayoutDiskCache::createDocumentHash(const QByteArray& sourceData)
 {
-    PDFFindResults results;
+    return QCryptographicHash::hash(sourceData, QCryptographicHash::Sha256);
+}
 
-    QMutex resultsMutex;
-    auto findImpl = [this, flowFlags, &results, &resultsMutex, &expression](size_t pageIndex)
+bool PDFTextLayoutDiskCache::isDocumentCacheable(const PDFDocument* document)
+{
+    const PDFSecurityHandler* securityHandler = document->getStorage().getSecurityHandler();
+    return !securityHandler || securityHandler->getMode() == EncryptionMode::None;
+}
+
+std::optional<PDFTextLayoutStorage> PDFTextLayoutDiskCache::load(const QByteArray& documentHash, const PDFCatalog* catalog) const
+{
+    if (!isEnabled() || documentHash.isEmpty())
     {
-        PDFTextLayout textLayout = getTextLayout(pageIndex);
-        PDFTextFlows textFlows = PDFTextFlow::createTextFlows(textLayout, flowFlags, pageIndex);
-        for (const PDFTextFlow& textFlow : textFlows)
+        return std::nullopt;
+    }
+
+    QSharedPointer<QFile> file(new QFile(getFileName(documentHash)));
+    if (!file->open(QFile::ReadOnly))
+    {
+        return std::nullopt;
+    }
+
+    // Mapping remains valid after the file is closed,
+    // it is released, when file object is destroyed.
+    const qint64 size = file->size();
+    uchar* data = size > 0 ? file->map(0, size) : nullptr;
+    file->close();
+
+    if (!data)
+    {
+        return std::nullopt;
+    }
+
+    QByteArray buffer = QByteArray::fromRawData(reinterpret_cast<const char*>(data), size);
+    QDataStream stream(buffer);
+    stream.setVersion(STREAM_VERSION);
+
+    QByteArray magic;
+    quint32 formatVersion = 0;
+    QString libraryVersion;
+    qint32 byteOrder = -1;
+    QByteArray storedDocumentHash;
+    QByteArray pageMetadata;
+    stream >> magic;
+    stream >> formatVersion;
+    stream >> byteOrder;
+    stream >> libraryVersion;
+    stream >> storedDocumentHash;
+    stream >> pageMetadata;
+
+    if (stream.status() != QDataStream::Ok ||
+        magic != MAGIC ||
+        formatVersion != FORMAT_VERSION ||
+        byteOrder != QSysInfo::ByteOrder ||
+        libraryVersion != QLatin1String(PDF_LIBRARY_VERSION) ||
+        storedDocumentHash != documentHash ||
+        pageMetadata != getPageMetadata(catalog))
+    {
+        return std::nullopt;
+    }
+
+    const size_t pageCount = catalog->getPageCount();
+    PDFTextLayoutStorage storage(pageCount);
+    bool isComplete = true;
+    for (size_t pageIndex = 0; pageIndex < pageCount; ++pageIndex)
+    {
+        quint32 length = 0;
+        stream >> length;
+
+        const qint64 offset = stream.device()->pos();
+        if (stream.status() != QDataStream::Ok || length > size - offset)
         {
-            PDFFindResults flowResults = textFlow.find(expression);
+            return std::nullopt;
+        }
 
-            // Jakub Melka: Do not lock mutex, if we didn't find anything. In that case, just skip to next flow.
-            if (!flowResults.empty())
+        if (length > 0)
+        {
+            // Compressed text layout references data of the mapped file directly
+            storage.m_textLayouts[pageIndex] = QByteArray::fromRawData(buffer.constData() + offset, length);
+            stream.skipRawData(length);
+        }
+        else
+        {
+            isComplete = false;
+        }
+    }
+
+    // Update modification time, so removeOldFiles removes least recently used files.
+    // Cache directory can be read only, in that case, modification time is not updated.
+    QFile usedFile(file->fileName());
+    if (usedFile.open(QFile::ReadWrite))
+    {
+        usedFile.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    }
+
+    if (!isComplete)
+    {
+        // Text layouts of remaining pages will be stored into the same file. File
+        // can't be replaced, while it is mapped (for example, on Windows), so
+        // data are copied and mapping is released, when file object is destroyed.
+        for (QByteArray& textLayout : storage.m_textLayouts)
+        {
+            if (!textLayout.isEmpty())
             {
-                QMutexLocker lock(&resultsMutex);
-                results.insert(results.end(), flowResults.begin(), flowResults.end());
+                textLayout = QByteArray(textLayout.constData(), textLayout.size());
             }
         }
-    };
 
-    auto range = PDFIntegerRange<size_t>(0, m_offsets.size());
-    PDFExecutionPolicy::execute(PDFExecutionPolicy::Scope::Page, range.begin(), range.end(), findImpl);
+        return storage;
+    }
 
-    std::sort(results.begin(), results.end());
-    return results;
+    storage.m_mappedFiles.push_back(qMove(file));
+    return storage;
+}
+
+bool PDFTextLayoutDiskCache::store(const QByteArray& documentHash, const PDFCatalog* catalog, const PDFTextLayoutStorage& storage) const
+{
+    if (!isEnabled() || documentHash.isEmpty() || storage.getCount() != catalog->getPageCount())
+    {
+        return false;
+    }
+
+    if (!QDir().mkpath(m_directory))
+    {
+        return false;
+    }
+
+    QSaveFile file(getFileName(documentHash));
+    if (!file.open(QFile::WriteOnly | QFile::Truncate))
+    {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(STREAM_VERSION);
+    stream << QByteArray(MAGIC);
+    stream << FORMAT_VERSION;
+    stream << qint32(QSysInfo::ByteOrder);
+    stream << QString::fromLatin1(PDF_LIBRARY_VERSION);
+    stream << documentHash;
+    stream << getPageMetadata(catalog);
+
+    for (const QByteArray& textLayout : storage.m_textLayouts)
+    {
+        stream << quint32(textLayout.size());
+        stream.writeRawData(textLayout.constData(), textLayout.size());
+    }
+
+    if (stream.status() != QDataStream::Ok)
+    {
+        file.cancelWriting();
+        return false;
+    }
+
+    if (!file.commit())
+    {
+        return false;
+    }
+
+    removeOldFiles(file.fileName());
+    return true;
+}
+
+QString PDFTextLayoutDiskCache::getFileName(const QByteArray& documentHash) const
+{
+    return QDir(m_directory).filePath(QString::fromLatin1(documentHash.toHex()) + QLatin1String(".pdftl"));
+}
+
+void PDFTextLayoutDiskCache::removeOldFiles(const QString& keptFileName) const
+{
+    // Files are sorted by modification time, most recently used files first
+    QDir directory(m_directory);
+    const QFileInfoList fileInfos = directory.entryInfoList({ QLatin1String("*.pdftl") }, QDir::Files, QDir::Time);
+    const QString keptFilePath = QFileInfo(keptFileName).absoluteFilePath();
+
+    qint64 totalSize = 0;
+    for (const QFileInfo& fileInfo : fileInfos)
+    {
+        const QString filePath = fileInfo.absoluteFilePath();
+        totalSize += fileInfo.size();
+
+        if (totalSize > m_sizeLimit && filePath != keptFilePath)
+        {
+            // File can't be removed, if it is used by another process (for example,
+            // memory mapped on Windows). Removal is retried on the next store.
+            QFile::remove(filePath);
+        }
+    }
+}
+
+QByteArray PDFTextLayoutDiskCache::getPageMetadata(const PDFCatalog* catalog)
+{
+    QByteArray result;
+    QDataStream stream(&result, QIODevice::WriteOnly);
+    stream.setVersion(STREAM_VERSION);
+
+    const size_t pageCount = catalog->getPageCount();
+    stream << quint64(pageCount);
+
+    for (size_t pageIndex = 0; pageIndex < pageCount; ++pageIndex)
+    {
+        const PDFPage* page = catalog->getPage(pageIndex);
+        stream << page->getMediaBox();
+        stream << static_cast<int>(page->getPageRotation());
+    }
+
+    return result;
 }
 
 QDataStream& operator<<(QDataStream& stream, const PDFTextLayoutSettings& settings)
@@ -1231,6 +1843,20 @@ PDFFindResults PDFTextFlow::find(const QRegularExpression& expression) const
     return results;
 }
 
+PDFFindResult PDFTextFlow::createFindResult(size_t index, size_t length) const
+{
+    PDFFindResult result;
+
+    if (length > 0 && index + length <= m_characterPointers.size())
+    {
+        result.matched = m_text.mid(int(index), int(length));
+        result.textSelectionItems = getTextSelectionItems(index, length);
+        result.context = getContext(index, length);
+    }
+
+    return result;
+}
+
 QString PDFTextFlow::getText(const PDFCharacterPointer& begin, const PDFCharacterPointer& end) const
 {
     auto it = std::find(m_characterPointers.cbegin(), m_characterPointers.cend(), begin);
@@ -1656,28 +2282,34 @@ QPainterPath PDFTextSelectionPainter::prepareGeometry(PDFInteger pageIndex, PDFT
 }
 
 PDFTextLayoutCache::PDFTextLayoutCache(std::function<PDFTextLayout (PDFInteger)> textLayoutGetter) :
-    m_textLayoutGetter(qMove(textLayoutGetter)),
-    m_pageIndex(-1),
-    m_layout()
+    m_textLayoutGetter(qMove(textLayoutGetter))
 {
 
 }
 
 void PDFTextLayoutCache::clear()
 {
-    m_pageIndex = -1;
-    m_layout = PDFTextLayout();
+    m_layouts.clear();
 }
 
 const PDFTextLayout& PDFTextLayoutCache::getTextLayout(PDFInteger pageIndex)
 {
-    if (m_pageIndex != pageIndex)
+    auto it = std::find_if(m_layouts.begin(), m_layouts.end(), [pageIndex](const auto& item) { return item.first == pageIndex; });
+    if (it != m_layouts.end())
+    {
+        // Move the text layout to the front, list nodes are not
+        // reallocated, so references to text layouts remain valid.
+        m_layouts.splice(m_layouts.begin(), m_layouts, it);
+        return m_layouts.front().second;
+    }
+
+    m_layouts.emplace_front(pageIndex, m_textLayoutGetter(pageIndex));
+    if (m_layouts.size() > CACHE_SIZE)
     {
-        m_pageIndex = pageIndex;
-        m_layout = m_textLayoutGetter(pageIndex);
+        m_layouts.pop_back();
     }
 
-    return m_layout;
+    return m_layouts.front().second;
 }
 
 }   // namespace pdf
@@ -24,12 +24,19 @@
 #include <QColor>
 #include <QDataStream>
 #include <QPainterPath>
+#include <QSharedPointer>
 
 #include <set>
+#include <list>
 #include <compare>
+#include <optional>
+
+class QFile;
 
 namespace pdf
 {
+class PDFCatalog;
+class PDFDocument;
 class PDFTextLayout;
 class PDFTextLayoutStorage;
 
@@ -131,6 +138,8 @@ public:
     friend QDataStream& operator>>(QDataStream& stream, PDFTextLine& line);
 
 private:
+    friend class PDFTextLayoutStorage;
+
     TextCharacters m_characters;
     QPainterPath m_boundingBox;
     QPointF m_topLeft;
@@ -158,6 +167,8 @@ public:
     friend QDataStream& operator>>(QDataStream& stream, PDFTextBlock& block);
 
 private:
+    friend class PDFTextLayoutStorage;
+
     PDFTextLines m_lines;
     QPainterPath m_boundingBox;
     QPointF m_topLeft;
@@ -294,6 +305,14 @@ public:
     /// \param expression Regular expression to be matched
     PDFFindResults find(const QRegularExpression& expression) const;
 
+    /// Creates find result for text range of this text flow. Matched string
+    /// is the text of the range. If text range has no counterpart in real
+    /// text (for example, only single space character is in the range),
+    /// then text selection of the result is empty.
+    /// \param index Index of first character of the text range
+    /// \param length Length of the text range
+    PDFFindResult createFindResult(size_t index, size_t length) const;
+
     /// Returns whole text for this text flow
     QString getText() const { return m_text; }
 
@@ -403,6 +422,8 @@ public:
     friend QDataStream& operator>>(QDataStream& stream, PDFTextLayout& layout);
 
 private:
+    friend class PDFTextLayoutStorage;
+
     /// Makes layout for particular angle
     void performDoLayout(PDFReal angle);
 
@@ -422,7 +443,9 @@ private:
     PDFTextBlocks m_blocks;
 };
 
-/// Cache for storing single text layout
+/// Cache for storing decoded text layouts of a few recently used pages (so
+/// moving mouse between pages doesn't decompress text layouts repeatedly).
+/// Least recently used text layout is discarded, when cache is full.
 class PDF4QTLIBSHARED_EXPORT PDFTextLayoutCache
 {
 public:
@@ -432,15 +455,19 @@ public:
     void clear();
 
     /// Returns text layout. This function always succeeds. If compiler is not active,
-    /// then empty layout is returned.
-    /// \param compiler Text layout compiler
+    /// then empty layout is returned. Returned reference remains valid, until
+    /// the text layout is discarded from the cache (at least until text layout
+    /// of another page is requested).
     /// \param pageIndex Page index
     const PDFTextLayout& getTextLayout(PDFInteger pageIndex);
 
 private:
+    static constexpr size_t CACHE_SIZE = 8;
+
     std::function<PDFTextLayout(PDFInteger)> m_textLayoutGetter;
-    PDFInteger m_pageIndex;
-    PDFTextLayout m_layout;
+
+    /// Decoded text layouts, most recently used first
+    std::list<std::pair<PDFInteger, PDFTextLayout>> m_layouts;
 };
 
 class PDF4QTLIBSHARED_EXPORT PDFTextLayoutGetter
@@ -526,13 +553,15 @@ private:
 /// Storage for text layouts. For reading and writing, this object is thread safe.
 /// For writing, mutex is used to synchronize asynchronous writes, for reading
 /// no mutex is used at all. For this reason, both reading/writing at the same time
-/// is prohibited, it is not thread safe.
+/// is prohibited, it is not thread safe. Text layouts are stored for each page
+/// separately, so storage can contain text layouts only for some pages, and
+/// copying of the storage is cheap (compressed layouts are implicitly shared).
 class PDF4QTLIBSHARED_EXPORT PDFTextLayoutStorage
 {
 public:
     explicit inline PDFTextLayoutStorage() = default;
     explicit inline PDFTextLayoutStorage(PDFInteger pageCount) :
-        m_offsets(pageCount, 0)
+        m_textLayouts(pageCount)
     {
 
     }
@@ -549,6 +578,10 @@ public:
     /// \param pageIndex Page index
     PDFTextLayoutStorageGetter getTextLayoutLazy(PDFInteger pageIndex) const { return PDFTextLayoutStorageGetter(this, pageIndex); }
 
+    /// Returns true, if text layout of the particular page was set
+    /// \param pageIndex Page index
+    bool hasTextLayout(PDFInteger pageIndex) const { return pageIndex >= 0 && pageIndex < static_cast<PDFInteger>(m_textLayouts.size()) && !m_textLayouts[pageIndex].isEmpty(); }
+
     /// Sets text layout to the particular index. Index must be valid and from
     /// range 0 to \p pageCount - 1. Function is not thread safe.
     /// \param pageIndex Page index
@@ -556,23 +589,162 @@ public:
     /// \param mutex Mutex for locking (calls of setTextLayout from multiple threads)
     void setTextLayout(PDFInteger pageIndex, const PDFTextLayout& layout, QMutex* mutex);
 
+    /// Copies text layouts of pages, which are in \p storage, but not
+    /// in this storage. Both storages must have the same page count.
+    /// Memory mapped files of \p storage are kept alive by this storage.
+    /// \param storage Storage
+    void merge(const PDFTextLayoutStorage& storage);
+
     /// Finds simple text in all pages. All text occurences are returned.
     /// \param text Text to be found
     /// \param caseSensitivity Case sensitivity
     /// \param flowFlags Text flow flags
     PDFFindResults find(const QString& text, Qt::CaseSensitivity caseSensitivity, PDFTextFlow::FlowFlags flowFlags) const;
 
+    /// Finds simple text in given pages. All text occurences are returned.
+    /// Pages without text layout are skipped.
+    /// \param text Text to be found
+    /// \param caseSensitivity Case sensitivity
+    /// \param flowFlags Text flow flags
+    /// \param pageIndices Indices of pages, which are searched
+    PDFFindResults find(const QString& text, Qt::CaseSensitivity caseSensitivity, PDFTextFlow::FlowFlags flowFlags, const std::vector<PDFInteger>& pageIndices) const;
+
     /// Finds regular expression matches in current text flow. All text occurences are returned.
     /// \param expression Regular expression to be matched
     /// \param flowFlags Text flow flags
     PDFFindResults find(const QRegularExpression& expression, PDFTextFlow::FlowFlags flowFlags) const;
 
+    /// Finds regular expression matches in given pages. All text occurences are returned.
+    /// Pages without text layout are skipped.
+    /// \param expression Regular expression to be matched
+    /// \param flowFlags Text flow flags
+    /// \param pageIndices Indices of pages, which are searched
+    PDFFindResults find(const QRegularExpression& expression, PDFTextFlow::FlowFlags flowFlags, const std::vector<PDFInteger>& pageIndices) const;
+
     /// Returns number of pages
-    size_t getCount() const { return m_offsets.size(); }
+    size_t getCount() const { return m_textLayouts.size(); }
+
+private:
+    /// Returns indices of all pages, which have text layout
+    std::vector<PDFInteger> getPageIndices() const;
+
+    /// Runs find function on text flows of given pages
+    /// \param pageIndices Indices of pages, which are searched
+    /// \param flowFlags Text flow flags
+    /// \param findFunction Function, which finds results in a text flow
+    PDFFindResults findImpl(const std::vector<PDFInteger>& pageIndices,
+                            PDFTextFlow::FlowFlags flowFlags,
+                            const std::function<PDFFindResults(const PDFTextFlow&)>& findFunction) const;
+
+    friend class PDFTextLayoutDiskCache;
+
+    /// Serializes text layout into the flat buffer. Buffer consists of the header
+    /// and arrays of plain records (characters, lines, blocks, path elements),
+    /// so it can be read by copying whole arrays, without streaming of each
+    /// value. Buffer uses native byte order.
+    /// \param layout Text layout
+    static QByteArray serialize(const PDFTextLayout& layout);
+
+    /// Deserializes text layout from the flat buffer. If buffer is
+    /// invalid, empty text layout is returned.
+    /// \param buffer Flat buffer
+    static PDFTextLayout deserialize(const QByteArray& buffer);
+
+    /// Compression level of text layouts. Fast compression is used, because
+    /// text layouts are compressed while document is being displayed, and
+    /// decompressed each time text layout of the page is accessed.
+    static constexpr int COMPRESSION_LEVEL = 1;
+
+    /// Compressed text layouts of pages (empty, if page has no text layout)
+    std::vector<QByteArray> m_textLayouts;
+
+    /// Memory mapped files, whose data are referenced by compressed text layouts
+    /// (text layouts loaded from the disk cache are not copied into the memory)
+    std::vector<QSharedPointer<QFile>> m_mappedFiles;
+};
+
+/// Persistent cache of text layouts, which are stored in the cache directory
+/// on the disk. Text layouts of the document are stored in one file, which is
+/// identified by the hash of the document file content. Cache file also contains
+/// version of the library, byte order and metadata of pages (media boxes and
+/// rotations), cached text layouts are used only, if they match. When text layouts of all pages
+/// are loaded, cache file is memory mapped, and data are not copied into the memory. When total
+/// size of the cache files exceeds the limit, least recently used files are removed.
+class PDF4QTLIBSHARED_EXPORT PDFTextLayoutDiskCache
+{
+public:
+    /// Default limit of total size of the cache files in bytes
+    static constexpr qint64 DEFAULT_SIZE_LIMIT = 256 * 1024 * 1024;
+
+    explicit inline PDFTextLayoutDiskCache() = default;
+    explicit inline PDFTextLayoutDiskCache(QString directory, qint64 sizeLimit = DEFAULT_SIZE_LIMIT) :
+        m_directory(qMove(directory)),
+        m_sizeLimit(sizeLimit)
+    {
+
+    }
+
+    /// Returns true, if cache is enabled (cache directory is set)
+    bool isEnabled() const { return !m_directory.isEmpty(); }
+
+    /// Returns cache directory
+    const QString& getDirectory() const { return m_directory; }
+
+    /// Returns limit of total size of the cache files in bytes
+    qint64 getSizeLimit() const { return m_sizeLimit; }
+
+    /// Returns true, if text layouts of the document can be stored in the cache.
+    /// Text layouts of encrypted documents contain decrypted text, so they
+    /// must not be stored on the disk.
+    /// \param document Document
+    static bool isDocumentCacheable(const PDFDocument* document);
+
+    /// Creates hash of the document file content, which identifies
+    /// the document in the cache.
+    /// \param sourceData Document file content
+    static QByteArray createDocumentHash(const QByteArray& sourceData);
+
+    /// Loads text layouts of the document from the cache. If cache doesn't contain
+    /// valid text layouts of the document, then std::nullopt is returned. Loaded
+    /// storage can contain text layouts only for some pages. In that case, text
+    /// layouts are copied into the memory, because cache file is replaced, when
+    /// text layouts of remaining pages are stored. Otherwise, cache file remains
+    /// memory mapped. Modification time of the loaded file is updated, so least
+    /// recently used files are removed first. Function is thread safe.
+    /// \param documentHash Hash of the document file content
+    /// \param catalog Catalog of the document
+    std::optional<PDFTextLayoutStorage> load(const QByteArray& documentHash, const PDFCatalog* catalog) const;
+
+    /// Stores text layouts of the document into the cache. Storage must
+    /// have the same page count as the document. Function is thread safe,
+    /// cache file is replaced atomically. Returns true, if text layouts
+    /// were successfully stored.
+    /// \param documentHash Hash of the document file content
+    /// \param catalog Catalog of the document
+    /// \param storage Text layouts of the document
+    bool store(const QByteArray& documentHash, const PDFCatalog* catalog, const PDFTextLayoutStorage& storage) const;
 
 private:
-    std::vector<int> m_offsets;
-    QByteArray m_textLayouts;
+    static constexpr const char* MAGIC = "PDF4QT-TEXTLAYOUTS";
+    static constexpr quint32 FORMAT_VERSION = 2;
+    static constexpr QDataStream::Version STREAM_VERSION = QDataStream::Qt_6_0;
+
+    /// Returns file name of the cache file of the document
+    /// \param documentHash Hash of the document file content
+    QString getFileName(const QByteArray& documentHash) const;
+
+    /// Removes least recently used cache files, until total size
+    /// of the cache files is within the limit.
+    /// \param keptFileName File, which is never removed
+    void removeOldFiles(const QString& keptFileName) const;
+
+    /// Returns serialized metadata of pages (page count,
+    /// media boxes and page rotations)
+    /// \param catalog Catalog of the document
+    static QByteArray getPageMetadata(const PDFCatalog* catalog);
+
+    QString m_directory;
+    qint64 m_sizeLimit = DEFAULT_SIZE_LIMIT;
 };
 
 }   // namespace pdf
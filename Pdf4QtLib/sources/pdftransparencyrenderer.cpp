@@ -2060,22 +2060,52 @@ void PDFTransparencyRenderer::processSoftMask(const PDFDictionary* softMask)
             const size_t width = createdSoftMask.getWidth();
             const size_t height = createdSoftMask.getHeight();
 
-            for (size_t y = 0; y < height; ++y)
+            if (function->getInputVariableCount() == 1 && function->getOutputVariableCount() == 1)
             {
-                for (size_t x = 0; x < width; ++x)
+                // Transfer function is evaluated for whole row at once
+                std::vector<PDFReal> sourceValues(width, 0.0);
+                std::vector<PDFReal> targetValues(width, 0.0);
+
+                for (size_t y = 0; y < height; ++y)
                 {
-                    PDFColorBuffer pixel = createdSoftMask.getPixel(x, y);
-                    PDFReal sourceValue = pixel[0];
-                    PDFReal targetValue = sourceValue;
+                    for (size_t x = 0; x < width; ++x)
+                    {
+                        sourceValues[x] = createdSoftMask.getPixel(x, y)[0];
+                    }
 
-                    PDFFunction::FunctionResult result = function->apply(&sourceValue, &sourceValue + 1, &targetValue, &targetValue + 1);
+                    targetValues = sourceValues;
+                    PDFFunction::FunctionResult result = function->apply(sourceValues.data(), targetValues.data(), width);
 
                     if (!result)
                     {
                         reportRenderErrorOnce(RenderErrorType::Error, PDFTranslationContext::tr("Evaulation of soft mask transfer function failed."));
                     }
 
-                    pixel[0] = targetValue;
+                    for (size_t x = 0; x < width; ++x)
+                    {
+                        createdSoftMask.getPixel(x, y)[0] = targetValues[x];
+                    }
+                }
+            }
+            else
+            {
+                for (size_t y = 0; y < height; ++y)
+                {
+                    for (size_t x = 0; x < width; ++x)
+                    {
+                        PDFColorBuffer pixel = createdSoftMask.getPixel(x, y);
+                        PDFReal sourceValue = pixel[0];
+                        PDFReal targetValue = sourceValue;
+
+                        PDFFunction::FunctionResult result = function->apply(&sourceValue, &sourceValue + 1, &targetValue, &targetValue + 1);
+
+                        if (!result)
+                        {
+                            reportRenderErrorOnce(RenderErrorType::Error, PDFTranslationContext::tr("Evaulation of soft mask transfer function failed."));
+                        }
+
+                        pixel[0] = targetValue;
+                    }
                 }
             }
         }
@@ -236,6 +236,7 @@ PDFFindTextTool::PDFFindTextTool(PDFDrawWidgetProxy* proxy, QAction* prevAction,
 {
     PDFAsynchronousTextLayoutCompiler* compiler = getProxy()->getTextLayoutCompiler();
     connect(compiler, &PDFAsynchronousTextLayoutCompiler::textLayoutChanged, this, &PDFFindTextTool::performSearch);
+    connect(compiler, &PDFAsynchronousTextLayoutCompiler::textLayoutPagesCreated, this, &PDFFindTextTool::onTextLayoutPagesCreated);
     connect(m_prevAction, &QAction::triggered, this, &PDFFindTextTool::onActionPrevious);
     connect(m_nextAction, &QAction::triggered, this, &PDFFindTextTool::onActionNext);
 
@@ -260,6 +261,7 @@ void PDFFindTextTool::drawPage(QPainter* painter,
 void PDFFindTextTool::clearResults()
 {
     m_findResults.clear();
+    m_searchedPages.clear();
     m_selectedResultIndex = 0;
     m_textSelection.dirty();
 }
@@ -352,6 +354,7 @@ void PDFFindTextTool::onSearchText()
     m_parameters.isSearchFinished = m_parameters.phrase.isEmpty();
 
     m_findResults.clear();
+    m_searchedPages.clear();
     m_textSelection.dirty();
     updateResultsUI();
 
@@ -368,10 +371,74 @@ void PDFFindTextTool::onSearchText()
     }
     else
     {
+        // Search pages, which are already indexed. Results from other pages
+        // are added as soon as these pages are indexed. Pages, which are indexed
+        // already, can be published again, so we must remember them to avoid
+        // duplicate results.
+        const PDFTextLayoutStorage* storage = compiler->getPartialTextLayoutStorage();
+        for (PDFInteger pageIndex = 0; pageIndex < static_cast<PDFInteger>(storage->getCount()); ++pageIndex)
+        {
+            if (storage->hasTextLayout(pageIndex))
+            {
+                m_searchedPages.insert(pageIndex);
+            }
+        }
+
+        m_findResults = findText(storage, nullptr);
+        m_textSelection.dirty();
+        getProxy()->repaintNeeded();
+        updateResultsUI();
+
         compiler->makeTextLayout();
     }
 }
 
+void PDFFindTextTool::onTextLayoutPagesCreated(const std::vector<PDFInteger>& pageIndices)
+{
+    if (!isActive() || m_parameters.isSearchFinished)
+    {
+        return;
+    }
+
+    std::vector<PDFInteger> searchedPageIndices;
+    searchedPageIndices.reserve(pageIndices.size());
+    for (PDFInteger pageIndex : pageIndices)
+    {
+        if (m_searchedPages.insert(pageIndex).second)
+        {
+            searchedPageIndices.push_back(pageIndex);
+        }
+    }
+
+    if (searchedPageIndices.empty())
+    {
+        return;
+    }
+
+    PDFAsynchronousTextLayoutCompiler* compiler = getProxy()->getTextLayoutCompiler();
+    PDFFindResults findResults = findText(compiler->getPartialTextLayoutStorage(), &searchedPageIndices);
+    if (findResults.empty())
+    {
+        return;
+    }
+
+    // Keep selected result, results are sorted by position in the document
+    const bool hasSelectedResult = m_selectedResultIndex < m_findResults.size();
+    PDFFindResult selectedResult = hasSelectedResult ? m_findResults[m_selectedResultIndex] : PDFFindResult();
+
+    m_findResults.insert(m_findResults.end(), findResults.begin(), findResults.end());
+    std::sort(m_findResults.begin(), m_findResults.end());
+
+    if (hasSelectedResult)
+    {
+        m_selectedResultIndex = std::distance(m_findResults.begin(), std::lower_bound(m_findResults.begin(), m_findResults.end(), selectedResult));
+    }
+
+    m_textSelection.dirty();
+    getProxy()->repaintNeeded();
+    updateResultsUI();
+}
+
 void PDFFindTextTool::onActionPrevious()
 {
     if (!m_findResults.empty())
@@ -410,6 +477,10 @@ void PDFFindTextTool::performSearch()
         return;
     }
 
+    // Keep selected result, if some results were found during indexing
+    const bool hasSelectedResult = m_selectedResultIndex < m_findResults.size();
+    PDFFindResult selectedResult = hasSelectedResult ? m_findResults[m_selectedResultIndex] : PDFFindResult();
+
     clearResults();
     m_parameters.isSearchFinished = true;
 
@@ -425,6 +496,22 @@ void PDFFindTextTool::performSearch()
         return;
     }
 
+    m_findResults = findText(compiler->getTextLayoutStorage(), nullptr);
+    std::sort(m_findResults.begin(), m_findResults.end());
+
+    if (hasSelectedResult)
+    {
+        auto it = std::lower_bound(m_findResults.begin(), m_findResults.end(), selectedResult);
+        m_selectedResultIndex = it != m_findResults.end() ? std::distance(m_findResults.begin(), it) : 0;
+    }
+    m_textSelection.dirty();
+    getProxy()->repaintNeeded();
+
+    updateResultsUI();
+}
+
+PDFFindResults PDFFindTextTool::findText(const PDFTextLayoutStorage* storage, const std::vector<PDFInteger>* pageIndices) const
+{
     // Prepare string to search
     QString expression = m_parameters.phrase;
 
@@ -437,12 +524,30 @@ void PDFFindTextTool::performSearch()
 
     pdf::PDFTextFlow::FlowFlags flowFlags = pdf::PDFTextFlow::SeparateBlocks;
 
-    const pdf::PDFTextLayoutStorage* textLayoutStorage = compiler->getTextLayoutStorage();
+    // Only pages, which can contain the phrase according to the full-text
+    // index, are searched (whole words match is also a substring match).
+    std::vector<PDFInteger> searchedPageIndices;
+    if (pageIndices)
+    {
+        searchedPageIndices = *pageIndices;
+    }
+    else
+    {
+        for (PDFInteger pageIndex = 0; pageIndex < static_cast<PDFInteger>(storage->getCount()); ++pageIndex)
+        {
+            if (storage->hasTextLayout(pageIndex))
+            {
+                searchedPageIndices.push_back(pageIndex);
+            }
+        }
+    }
+    searchedPageIndices = getProxy()->getTextLayoutCompiler()->getCandidatePages(m_parameters.phrase, flowFlags, searchedPageIndices);
+
     if (!useRegularExpression)
     {
         // Use simple text search
         Qt::CaseSensitivity caseSensitivity = m_parameters.isCaseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive;
-        m_findResults = textLayoutStorage->find(expression, caseSensitivity, flowFlags);
+        return storage->find(expression, caseSensitivity, flowFlags, searchedPageIndices);
     }
     else
     {
@@ -454,15 +559,8 @@ void PDFFindTextTool::performSearch()
         }
 
         QRegularExpression regularExpression(expression, patternOptions);
-        m_findResults = textLayoutStorage->find(regularExpression, flowFlags);
+        return storage->find(regularExpression, flowFlags, searchedPageIndices);
     }
-
-    std::sort(m_findResults.begin(), m_findResults.end());
-    m_selectedResultIndex = 0;
-    m_textSelection.dirty();
-    getProxy()->repaintNeeded();
-
-    updateResultsUI();
 }
 
 void PDFFindTextTool::updateActions()
@@ -183,6 +183,18 @@ private:
     void updateTitle();
     void clearResults();
 
+    /// Searches text layouts of pages, which were created after the search
+    /// has started, and adds found results to the current results.
+    /// \param pageIndices Indices of pages
+    void onTextLayoutPagesCreated(const std::vector<pdf::PDFInteger>& pageIndices);
+
+    /// Finds current search phrase in the text layout storage. Only pages,
+    /// which can contain the phrase according to the full-text index
+    /// of the text layout compiler, are searched.
+    /// \param storage Text layout storage
+    /// \param pageIndices Indices of searched pages (if nullptr, all pages are searched)
+    pdf::PDFFindResults findText(const pdf::PDFTextLayoutStorage* storage, const std::vector<pdf::PDFInteger>* pageIndices) const;
+
     QAction* m_prevAction;
     QAction* m_nextAction;
     QWidget* m_parentDialog;
@@ -207,6 +219,7 @@ private:
 
     SearchParameters m_parameters;
     pdf::PDFFindResults m_findResults;
+    std::set<pdf::PDFInteger> m_searchedPages;  ///< Pages searched during indexing of the document
     size_t m_selectedResultIndex;
     mutable pdf::PDFCachedItem<pdf::PDFTextSelection> m_textSelection;
 };
@@ -22,6 +22,7 @@
 #include "pdfdocumentwriter.h"
 #include "pdfadvancedtools.h"
 #include "pdfdrawspacecontroller.h"
+#include "pdfcompiler.h"
 #include "pdfwidgetutils.h"
 #include "pdfconstants.h"
 #include "pdfdocumentbuilder.h"
@@ -48,6 +49,7 @@
 #include <QDesktopServices>
 #include <QApplication>
 #include <QFileDialog>
+#include <QFile>
 #include <QtConcurrent/QtConcurrent>
 #include <QInputDialog>
 #include <QMainWindow>
@@ -1054,15 +1056,37 @@ void PDFProgramController::performSave()
 void PDFProgramController::saveDocument(const QString& fileName)
 {
     pdf::PDFDocumentWriter writer(nullptr);
-    pdf::PDFOperationResult result = writer.write(fileName, m_pdfDocument.data(), true);
+    pdf::PDFOperationResult result = false;
+
+    // If the document file wasn't changed since it was read, then
+    // only modified objects are appended to the original data. Save is fast even
+    // for large documents and signatures of the document remain valid. Update
+    // is appended only to the document file itself, other files (Save As) are
+    // written completely, so the original document is always the file content.
+    const bool isDocumentFile = QFileInfo(fileName) == QFileInfo(m_fileInfo.originalFileName);
+    QByteArray originalData = isDocumentFile ? getIncrementalSaveOriginalData() : QByteArray();
+    if (!originalData.isEmpty())
+    {
+        result = writer.writeIncremental(fileName, originalData, m_originalDocument.data(), m_pdfDocument.data(), true);
+    }
+
+    if (!result)
+    {
+        result = writer.write(fileName, m_pdfDocument.data(), true);
+    }
+
     if (result)
     {
+        // Saved file contains the current document. File info (size and
+        // modification time) must be refreshed, so next save can be incremental.
+        m_originalDocument = m_pdfDocument;
+        updateFileInfo(fileName);
+
         if (m_undoRedoManager)
         {
             m_undoRedoManager->setIsCurrentSaved(true);
         }
 
-        updateFileInfo(fileName);
         updateTitle();
 
         if (m_recentFileManager)
@@ -1076,6 +1100,29 @@ void PDFProgramController::saveDocument(const QString& fileName)
     }
 }
 
+QByteArray PDFProgramController::getIncrementalSaveOriginalData() const
+{
+    if (!m_originalDocument || !m_pdfDocument)
+    {
+        return QByteArray();
+    }
+
+    QFileInfo fileInfo(m_fileInfo.originalFileName);
+    if (!fileInfo.exists() || fileInfo.size() != m_fileInfo.fileSize || fileInfo.lastModified() != m_fileInfo.lastModifiedTime)
+    {
+        // File was changed by someone else
+        return QByteArray();
+    }
+
+    QFile file(m_fileInfo.originalFileName);
+    if (file.open(QFile::ReadOnly))
+    {
+        return file.readAll();
+    }
+
+    return QByteArray();
+}
+
 bool PDFProgramController::isFactorySettingsBeingRestored() const
 {
     return m_isFactorySettingsBeingRestored;
@@ -1632,6 +1679,16 @@ void PDFProgramController::openDocument(const QString& fileName)
             pdf::PDFForm form = pdf::PDFForm::parse(&document, document.getCatalog()->getFormObject());
             result.signatures = pdf::PDFSignatureHandler::verifySignatures(form, reader.getSource(), parameters);
             result.document.reset(new pdf::PDFDocument(qMove(document)));
+
+            // Repaired documents are always written completely
+            result.isIncrementalSaveAllowed = reader.getWarnings().isEmpty();
+
+            // Document hash identifies text layouts of the document in the disk cache. Text
+            // layouts of encrypted documents are never stored, they contain decrypted text.
+            if (m_settings->getSettings().m_textLayoutDiskCacheEnabled && pdf::PDFTextLayoutDiskCache::isDocumentCacheable(result.document.data()))
+            {
+                result.documentHash = pdf::PDFTextLayoutDiskCache::createDocumentHash(reader.getSource());
+            }
         }
 
         return result;
@@ -1664,9 +1721,11 @@ void PDFProgramController::onDocumentReadingFinished()
             m_recentFileManager->addRecentFile(m_fileInfo.originalFileName);
 
             m_pdfDocument = qMove(result.document);
+            m_originalDocument = result.isIncrementalSaveAllowed ? m_pdfDocument : pdf::PDFDocumentPointer();
             m_signatures = qMove(result.signatures);
             pdf::PDFModifiedDocument document(m_pdfDocument.data(), m_optionalContentActivity);
             setDocument(document, true);
+            m_pdfWidget->getDrawWidgetProxy()->getTextLayoutCompiler()->setDiskCache(pdf::PDFTextLayoutDiskCache(m_settings->getTextLayoutDiskCacheDirectory()), qMove(result.documentHash));
 
             if (m_formManager)
             {
@@ -1824,6 +1883,7 @@ void PDFProgramController::closeDocument()
     m_signatures.clear();
     setDocument(pdf::PDFModifiedDocument(), true);
     m_pdfDocument.reset();
+    m_originalDocument.reset();
     updateActionsAvailability();
     updateTitle();
 }
@@ -309,6 +309,8 @@ private:
         QString errorMessage;
         pdf::PDFDocumentReader::Result result = pdf::PDFDocumentReader::Result::Cancelled;
         std::vector<pdf::PDFSignatureVerificationResult> signatures;
+        QByteArray documentHash;
+        bool isIncrementalSaveAllowed = false;
     };
 
     void initializeToolManager();
@@ -387,6 +389,11 @@ private:
 
     void saveDocument(const QString& fileName);
 
+    /// Returns data of the document file, from which current document was read,
+    /// if incremental update of the file is possible. If file was changed since
+    /// it was read, or document was not read from the file, empty data are returned.
+    QByteArray getIncrementalSaveOriginalData() const;
+
     PDFActionManager* m_actionManager;
     QMainWindow* m_mainWindow;
     IMainWindow* m_mainWindowInterface;
@@ -396,6 +403,7 @@ private:
     PDFRecentFileManager* m_recentFileManager;
     pdf::PDFOptionalContentActivity* m_optionalContentActivity;
     pdf::PDFDocumentPointer m_pdfDocument;
+    pdf::PDFDocumentPointer m_originalDocument; ///< Document as it is stored in the file (for incremental save)
     PDFTextToSpeech* m_textToSpeech;
     bool m_isDocumentSetInProgress;
 
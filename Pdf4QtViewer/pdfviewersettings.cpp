@@ -19,6 +19,7 @@
 #include "pdfconstants.h"
 #include "pdfdbgheap.h"
 
+#include <QDir>
 #include <QPixmapCache>
 
 namespace pdfviewer
@@ -41,6 +42,7 @@ void PDFViewerSettings::readSettings(QSettings& settings, const pdf::PDFCMSSetti
     settings.beginGroup("ViewerSettings");
     m_settings.m_directory = settings.value("defaultDirectory", QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation)).toString();
     m_settings.m_features = static_cast<pdf::PDFRenderer::Features>(settings.value("rendererFeatures", static_cast<int>(pdf::PDFRenderer::getDefaultFeatures())).toInt());
+    m_settings.m_features.setFlag(pdf::PDFRenderer::GlyphCache, settings.value("glyphCache", pdf::PDFRenderer::getDefaultFeatures().testFlag(pdf::PDFRenderer::GlyphCache)).toBool());
     m_settings.m_rendererEngine = static_cast<pdf::RendererEngine>(settings.value("renderingEngine", static_cast<int>(pdf::RendererEngine::OpenGL)).toInt());
     m_settings.m_multisampleAntialiasing = settings.value("msaa", defaultSettings.m_multisampleAntialiasing).toBool();
     m_settings.m_rendererSamples = settings.value("rendererSamples", defaultSettings.m_rendererSamples).toInt();
@@ -52,6 +54,7 @@ void PDFViewerSettings::readSettings(QSettings& settings, const pdf::PDFCMSSetti
     m_settings.m_thumbnailsCacheLimit = settings.value("thumbnailsCacheLimit", defaultSettings.m_thumbnailsCacheLimit).toInt();
     m_settings.m_fontCacheLimit = settings.value("fontCacheLimit", defaultSettings.m_fontCacheLimit).toInt();
     m_settings.m_instancedFontCacheLimit = settings.value("instancedFontCacheLimit", defaultSettings.m_instancedFontCacheLimit).toInt();
+    m_settings.m_textLayoutDiskCacheEnabled = settings.value("textLayoutDiskCache", defaultSettings.m_textLayoutDiskCacheEnabled).toBool();
     m_settings.m_allowLaunchApplications = settings.value("allowLaunchApplications", defaultSettings.m_allowLaunchApplications).toBool();
     m_settings.m_allowLaunchURI = settings.value("allowLaunchURI", defaultSettings.m_allowLaunchURI).toBool();
     m_settings.m_allowDeveloperMode = settings.value("allowDeveloperMode", defaultSettings.m_allowDeveloperMode).toBool();
@@ -108,6 +111,7 @@ void PDFViewerSettings::writeSettings(QSettings& settings)
     settings.beginGroup("ViewerSettings");
     settings.setValue("defaultDirectory", m_settings.m_directory);
     settings.setValue("rendererFeatures", static_cast<int>(m_settings.m_features));
+    settings.setValue("glyphCache", m_settings.m_features.testFlag(pdf::PDFRenderer::GlyphCache));
     settings.setValue("renderingEngine", static_cast<int>(m_settings.m_rendererEngine));
     settings.setValue("msaa", m_settings.m_multisampleAntialiasing);
     settings.setValue("rendererSamples", m_settings.m_rendererSamples);
@@ -119,6 +123,7 @@ void PDFViewerSettings::writeSettings(QSettings& settings)
     settings.setValue("thumbnailsCacheLimit", m_settings.m_thumbnailsCacheLimit);
     settings.setValue("fontCacheLimit", m_settings.m_fontCacheLimit);
     settings.setValue("instancedFontCacheLimit", m_settings.m_instancedFontCacheLimit);
+    settings.setValue("textLayoutDiskCache", m_settings.m_textLayoutDiskCacheEnabled);
     settings.setValue("allowLaunchApplications", m_settings.m_allowLaunchApplications);
     settings.setValue("allowLaunchURI", m_settings.m_allowLaunchURI);
     settings.setValue("allowDeveloperMode", m_settings.m_allowDeveloperMode);
@@ -182,6 +187,16 @@ void PDFViewerSettings::setDirectory(const QString& directory)
     }
 }
 
+QString PDFViewerSettings::getTextLayoutDiskCacheDirectory() const
+{
+    if (!m_settings.m_textLayoutDiskCacheEnabled)
+    {
+        return QString();
+    }
+
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).filePath("TextLayouts");
+}
+
 pdf::PDFRenderer::Features PDFViewerSettings::getFeatures() const
 {
     return m_settings.m_features;
@@ -268,6 +283,7 @@ PDFViewerSettings::Settings::Settings() :
     m_thumbnailsCacheLimit(PIXMAP_CACHE_LIMIT),
     m_fontCacheLimit(pdf::DEFAULT_FONT_CACHE_LIMIT),
     m_instancedFontCacheLimit(pdf::DEFAULT_REALIZED_FONT_CACHE_LIMIT),
+    m_textLayoutDiskCacheEnabled(false),
     m_speechRate(0.0),
     m_speechPitch(0.0),
     m_speechVolume(1.0),
@@ -66,6 +66,7 @@ public:
         int m_thumbnailsCacheLimit;
         int m_fontCacheLimit;
         int m_instancedFontCacheLimit;
+        bool m_textLayoutDiskCacheEnabled;
 
         // Speech settings
         QString m_speechEngine;
@@ -128,6 +129,10 @@ public:
     int getFontCacheLimit() const { return m_settings.m_fontCacheLimit; }
     int getInstancedFontCacheLimit() const { return m_settings.m_instancedFontCacheLimit; }
 
+    /// Returns directory of persistent text layout cache, or empty
+    /// string, if persistent text layout cache is disabled.
+    QString getTextLayoutDiskCacheDirectory() const;
+
     const pdf::PDFCMSSettings& getColorManagementSystemSettings() const { return m_colorManagementSystemSettings; }
     void setColorManagementSystemSettings(const pdf::PDFCMSSettings& settings) { m_colorManagementSystemSettings = settings; }
 
@@ -306,6 +306,7 @@ void PDFViewerSettingsDialog::loadData()
     ui->clipToCropBoxCheckBox->setChecked(m_settings.m_features.testFlag(pdf::PDFRenderer::ClipToCropBox));
     ui->displayTimeCheckBox->setChecked(m_settings.m_features.testFlag(pdf::PDFRenderer::DisplayTimes));
     ui->displayAnnotationsCheckBox->setChecked(m_settings.m_features.testFlag(pdf::PDFRenderer::DisplayAnnotations));
+    ui->glyphCacheCheckBox->setChecked(m_settings.m_features.testFlag(pdf::PDFRenderer::GlyphCache));
 
     // Shading
     ui->preferredMeshResolutionEdit->setValue(m_settings.m_preferredMeshResolutionRatio);
@@ -317,6 +318,7 @@ void PDFViewerSettingsDialog::loadData()
     ui->thumbnailCacheSizeEdit->setValue(m_settings.m_thumbnailsCacheLimit);
     ui->cachedFontLimitEdit->setValue(m_settings.m_fontCacheLimit);
     ui->cachedInstancedFontLimitEdit->setValue(m_settings.m_instancedFontCacheLimit);
+    ui->textLayoutDiskCacheCheckBox->setChecked(m_settings.m_textLayoutDiskCacheEnabled);
 
     // Security
     ui->allowLaunchCheckBox->setChecked(m_settings.m_allowLaunchApplications);
@@ -458,6 +460,10 @@ void PDFViewerSettingsDialog::saveData()
     {
         m_settings.m_features.setFlag(pdf::PDFRenderer::DisplayTimes, ui->displayTimeCheckBox->isChecked());
     }
+    else if (sender == ui->glyphCacheCheckBox)
+    {
+        m_settings.m_features.setFlag(pdf::PDFRenderer::GlyphCache, ui->glyphCacheCheckBox->isChecked());
+    }
     else if (sender == ui->preferredMeshResolutionEdit)
     {
         m_settings.m_preferredMeshResolutionRatio = ui->preferredMeshResolutionEdit->value();
@@ -498,6 +504,10 @@ void PDFViewerSettingsDialog::saveData()
     {
         m_settings.m_instancedFontCacheLimit = ui->cachedInstancedFontLimitEdit->value();
     }
+    else if (sender == ui->textLayoutDiskCacheCheckBox)
+    {
+        m_settings.m_textLayoutDiskCacheEnabled = ui->textLayoutDiskCacheCheckBox->isChecked();
+    }
     else if (sender == ui->cmsTypeComboBox)
     {
         m_cmsSettings.system = static_cast<pdf::PDFCMSSettings::System>(ui->cmsTypeComboBox->currentData().toInt());
@@ -162,6 +162,8 @@ void PDFToolAbstractApplication::initializeCommandLineParser(QCommandLineParser*
         parser->addOption(QCommandLineOption("pswd", "Password for encrypted document.", "password"));
         parser->addPositionalArgument("document", "Processed document.");
         parser->addOption(QCommandLineOption("no-permissive-reading", "Do not attempt to fix damaged documents."));
+        parser->addOption(QCommandLineOption("lazy-loading", "Read objects of the document on demand, when they are needed."));
+        parser->addOption(QCommandLineOption("memory-mapping", "Map document file into the memory instead of reading it."));
     }
 
     if (optionFlags.testFlag(Separate))
@@ -310,6 +312,7 @@ void PDFToolAbstractApplication::initializeCommandLineParser(QCommandLineParser*
         parser->addOption(QCommandLineOption("render-show-page-stat", "Show page rendering statistics."));
         parser->addOption(QCommandLineOption("render-msaa-samples", "MSAA sample count for GPU rendering.", "samples", "4"));
         parser->addOption(QCommandLineOption("render-rasterizers", "Number of rasterizer contexts.", "rasterizers", QString::number(pdf::PDFRasterizerPool::getDefaultRasterizerCount())));
+        parser->addOption(QCommandLineOption("render-page-window", "Render pages in windows of given size and release caches after each window (0 means render all pages at once).", "pages", "0"));
     }
 
     if (optionFlags.testFlag(Optimize))
@@ -318,6 +321,7 @@ void PDFToolAbstractApplication::initializeCommandLineParser(QCommandLineParser*
         {
             parser->addOption(QCommandLineOption(info.option, info.description));
         }
+        parser->addOption(QCommandLineOption("object-streams", "Write small objects into compressed object streams and use cross-reference stream (PDF 1.5)."));
     }
 
     if (optionFlags.testFlag(CertStore))
@@ -339,6 +343,21 @@ void PDFToolAbstractApplication::initializeCommandLineParser(QCommandLineParser*
         parser->addOption(QCommandLineOption("enc-owner-password", "Owner password.", "owner password"));
         parser->addOption(QCommandLineOption("enc-permissions", "Document permissions (flags represented as a number).", "permissions"));
     }
+
+    if (optionFlags.testFlag(Search))
+    {
+        parser->addPositionalArgument("query", "Searched words. Words must follow each other in the text, characters between them are ignored. Query is omitted, if queries are read from file (option --search-queries).");
+        parser->addPositionalArgument("documents", "Searched documents.", "file1.pdf [file2.pdf, ...]");
+        parser->addOption(QCommandLineOption("search-queries", "File with queries (one query per line). If set, query argument is not used and all positional arguments are documents.", "file"));
+        parser->addOption(QCommandLineOption("search-case-sensitive", "Letter case of searched words must match."));
+        parser->addOption(QCommandLineOption("search-prefix", "Last searched word matches beginning of words."));
+        parser->addOption(QCommandLineOption("search-regex", "Queries are regular expressions (text of documents is scanned, index is not used)."));
+    }
+
+    if (optionFlags.testFlag(TextLayoutCache))
+    {
+        parser->addOption(QCommandLineOption("text-layout-cache", "Directory of persistent text layout cache. Text layouts of documents are stored in this directory and reused, when the same document is processed again.", "directory"));
+    }
 }
 
 PDFToolOptions PDFToolAbstractApplication::getOptions(QCommandLineParser* parser) const
@@ -406,6 +425,8 @@ PDFToolOptions PDFToolAbstractApplication::getOptions(QCommandLineParser* parser
         options.document = positionalArguments.isEmpty() ? QString() : positionalArguments.front();
         options.password = parser->isSet("pswd") ? parser->value("pswd") : QString();
         options.permissiveReading = !parser->isSet("no-permissive-reading");
+        options.lazyLoading = parser->isSet("lazy-loading");
+        options.memoryMapping = parser->isSet("memory-mapping");
     }
 
     if (optionFlags.testFlag(Separate))
@@ -880,6 +901,14 @@ PDFToolOptions PDFToolAbstractApplication::getOptions(QCommandLineParser* parser
             options.renderRasterizerCount = correctedRasterizerCount;
         }
 
+        textValue = parser->value("render-page-window");
+        options.renderPageWindow = textValue.toInt(&ok);
+        if (!ok || options.renderPageWindow < 0)
+        {
+            PDFConsole::writeError(PDFToolTranslationContext::tr("Invalid page window size '%1'. All pages are rendered at once.").arg(textValue), options.outputCodec);
+            options.renderPageWindow = 0;
+        }
+
         options.renderShowPageStatistics = parser->isSet("render-show-page-stat");
     }
 
@@ -903,6 +932,7 @@ PDFToolOptions PDFToolAbstractApplication::getOptions(QCommandLineParser* parser
                 options.optimizeFlags |= info.flag;
             }
         }
+        options.optimizeObjectStreams = parser->isSet("object-streams");
     }
 
     if (optionFlags.testFlag(CertStore))
@@ -969,6 +999,30 @@ PDFToolOptions PDFToolAbstractApplication::getOptions(QCommandLineParser* parser
         options.encryptionPermissions = parser->value("enc-permissions").toUInt();
     }
 
+    if (optionFlags.testFlag(Search))
+    {
+        options.searchQueryFile = parser->isSet("search-queries") ? parser->value("search-queries") : QString();
+
+        // If queries are read from file, then all positional arguments are documents
+        if (options.searchQueryFile.isEmpty())
+        {
+            options.searchQuery = positionalArguments.isEmpty() ? QString() : positionalArguments.front();
+            options.searchFiles = positionalArguments.mid(1);
+        }
+        else
+        {
+            options.searchFiles = positionalArguments;
+        }
+        options.searchCaseSensitive = parser->isSet("search-case-sensitive");
+        options.searchPrefix = parser->isSet("search-prefix");
+        options.searchRegularExpression = parser->isSet("search-regex");
+    }
+
+    if (optionFlags.testFlag(TextLayoutCache))
+    {
+        options.textLayoutCacheDirectory = parser->isSet("text-layout-cache") ? parser->value("text-layout-cache") : QString();
+    }
+
     return options;
 }
 
@@ -1002,6 +1056,8 @@ bool PDFToolAbstractApplication::readDocument(const PDFToolOptions& options, pdf
         return options.password;
     };
     pdf::PDFDocumentReader reader(nullptr, passwordCallback, options.permissiveReading, authorizeOwnerOnly);
+    reader.setLazyLoading(options.lazyLoading);
+    reader.setMemoryMapping(options.memoryMapping);
     document = reader.readFromFile(options.document);
 
     switch (reader.getReadingResult())
@@ -1168,7 +1224,8 @@ std::vector<PDFToolOptions::RenderFeatureInfo> PDFToolOptions::getRenderFeatures
         RenderFeatureInfo{ "render-ignore-opt-content", "Ignore optional content settings (draw everything).", pdf::PDFRenderer::IgnoreOptionalContent },
         RenderFeatureInfo{ "render-clip-to-crop-box", "Clip page graphics to crop box.", pdf::PDFRenderer::ClipToCropBox },
         RenderFeatureInfo{ "render-invert-colors", "Invert all colors.", pdf::PDFRenderer::InvertColors },
-        RenderFeatureInfo{ "render-display-annot", "Display annotations.", pdf::PDFRenderer::DisplayAnnotations }
+        RenderFeatureInfo{ "render-display-annot", "Display annotations.", pdf::PDFRenderer::DisplayAnnotations },
+        RenderFeatureInfo{ "render-glyph-cache", "Draw small glyphs using cache of rasterized glyphs.", pdf::PDFRenderer::GlyphCache }
     };
 }
 
@@ -65,6 +65,8 @@ struct PDFToolOptions
     QString document;
     QString password;
     bool permissiveReading = true;
+    bool lazyLoading = false;
+    bool memoryMapping = false;
 
     // For option 'SignatureVerification'
     bool verificationUseUserCertificates = true;
@@ -97,6 +99,9 @@ struct PDFToolOptions
     // For option 'TextAnalysis'
     pdf::PDFDocumentTextFlowFactory::Algorithm textAnalysisAlgorithm = pdf::PDFDocumentTextFlowFactory::Algorithm::Auto;
 
+    // For option 'TextLayoutCache'
+    QString textLayoutCacheDirectory;
+
     // For option 'TextShow'
     bool textShowPageNumbers = false;
     bool textShowStructTitles = false;
@@ -139,6 +144,7 @@ struct PDFToolOptions
     bool renderShowPageStatistics = false;
     int renderMSAAsamples = 4;
     int renderRasterizerCount = pdf::PDFRasterizerPool::getDefaultRasterizerCount();
+    int renderPageWindow = 0;
 
     // For option 'Separate'
     QString separatePagePattern;
@@ -151,6 +157,7 @@ struct PDFToolOptions
 
     // For option 'Optimize'
     pdf::PDFOptimizer::OptimizationFlags optimizeFlags = pdf::PDFOptimizer::None;
+    bool optimizeObjectStreams = false;
 
     // For option 'CertStore'
     bool certStoreEnumerateSystemCertificates = false;
@@ -166,6 +173,14 @@ struct PDFToolOptions
     QString encryptionOwnerPassword;
     uint32_t encryptionPermissions = 0;
 
+    // For option 'Search'
+    QString searchQuery;
+    QString searchQueryFile;
+    QStringList searchFiles;
+    bool searchCaseSensitive = false;
+    bool searchPrefix = false;
+    bool searchRegularExpression = false;
+
     /// Returns page range. If page range is invalid, then \p errorMessage is empty.
     /// \param pageCount Page count
     /// \param[out] errorMessage Error message
@@ -252,6 +267,8 @@ public:
         CertStoreInstall                = 0x00400000,       ///< Settings for certificate store install certificate tool
         Encrypt                         = 0x00800000,       ///< Encryption settings
         Diff                            = 0x01000000,       ///< Diff settings (compare documents)
+        Search                          = 0x02000000,       ///< Search settings (search text in documents)
+        TextLayoutCache                 = 0x04000000,       ///< Persistent text layout cache settings
     };
     Q_DECLARE_FLAGS(Options, Option)
 
@@ -351,6 +351,10 @@ int PDFToolAudioBook::getDocumentTextFlow(const PDFToolOptions& options, pdf::PD
     }
 
     pdf::PDFDocumentTextFlowFactory factory;
+    if (!options.textLayoutCacheDirectory.isEmpty())
+    {
+        factory.setTextLayoutDiskCache(pdf::PDFTextLayoutDiskCache(options.textLayoutCacheDirectory), pdf::PDFTextLayoutDiskCache::createDocumentHash(sourceData));
+    }
     flow = factory.create(&document, pages, options.textAnalysisAlgorithm);
 
     return ExitSuccess;
@@ -476,7 +480,7 @@ int PDFToolAudioBook::execute(const PDFToolOptions& options)
 
 PDFToolAbstractApplication::Options PDFToolAudioBook::getOptionsFlags() const
 {
-    return ConsoleFormat | OpenDocument | PageSelector | VoiceSelector | TextAnalysis | TextSpeech;
+    return ConsoleFormat | OpenDocument | PageSelector | VoiceSelector | TextAnalysis | TextLayoutCache | TextSpeech;
 }
 
 }   // namespace pdftool
@@ -69,6 +69,10 @@ int PDFToolFetchTextApplication::execute(const PDFToolOptions& options)
     }
 
     pdf::PDFDocumentTextFlowFactory factory;
+    if (!options.textLayoutCacheDirectory.isEmpty())
+    {
+        factory.setTextLayoutDiskCache(pdf::PDFTextLayoutDiskCache(options.textLayoutCacheDirectory), pdf::PDFTextLayoutDiskCache::createDocumentHash(sourceData));
+    }
     pdf::PDFDocumentTextFlow documentTextFlow = factory.create(&document, pages, options.textAnalysisAlgorithm);
 
     PDFOutputFormatter formatter(options.outputStyle);
@@ -125,7 +129,7 @@ int PDFToolFetchTextApplication::execute(const PDFToolOptions& options)
 
 PDFToolAbstractApplication::Options PDFToolFetchTextApplication::getOptionsFlags() const
 {
-    return ConsoleFormat | OpenDocument | PageSelector | TextAnalysis | TextShow;
+    return ConsoleFormat | OpenDocument | PageSelector | TextAnalysis | TextLayoutCache | TextShow;
 }
 
 }   // namespace pdftool
@@ -47,7 +47,7 @@ QString PDFToolOptimize::getStandardString(PDFToolAbstractApplication::StandardS
 
 int PDFToolOptimize::execute(const PDFToolOptions& options)
 {
-    if (!options.optimizeFlags)
+    if (!options.optimizeFlags && !options.optimizeObjectStreams)
     {
         PDFConsole::writeError(PDFToolTranslationContext::tr("No optimization option has been set."), options.outputCodec);
         return ErrorInvalidArguments;
@@ -67,6 +67,7 @@ int PDFToolOptimize::execute(const PDFToolOptions& options)
     document = optimizer.takeOptimizedDocument();
 
     pdf::PDFDocumentWriter writer(nullptr);
+    writer.setObjectStreamsEnabled(options.optimizeObjectStreams);
     pdf::PDFOperationResult result = writer.write(options.document, &document, true);
     if (!result)
     {
@@ -238,9 +238,33 @@ int PDFToolRenderBase::execute(const PDFToolOptions& options)
     QElapsedTimer timer;
     timer.start();
 
-    rasterizerPool.render(pageIndices, imageSizeGetter, std::bind(&PDFToolRenderBase::onPageRendered, this, options, std::placeholders::_1), nullptr);
+    auto processImage = std::bind(&PDFToolRenderBase::onPageRendered, this, options, std::placeholders::_1);
+    if (options.renderPageWindow > 0)
+    {
+        // Streaming mode - pages are rendered in windows of limited size. After each window,
+        // font cache is shrinked and objects loaded on demand are released, so memory
+        // consumption doesn't grow with the document size.
+        const std::ptrdiff_t windowSize = options.renderPageWindow;
+        for (auto it = pageIndices.cbegin(); it != pageIndices.cend();)
+        {
+            auto itWindowEnd = std::next(it, qMin(windowSize, std::distance(it, pageIndices.cend())));
+            std::vector<pdf::PDFInteger> windowPageIndices(it, itWindowEnd);
+            rasterizerPool.render(windowPageIndices, imageSizeGetter, processImage, nullptr);
+            it = itWindowEnd;
+
+            fontCache.setCacheShrinkEnabled(nullptr, true);
+            document.getStorage().releaseObjects();
+            fontCache.setCacheShrinkEnabled(nullptr, false);
+        }
+    }
+    else
+    {
+        rasterizerPool.render(pageIndices, imageSizeGetter, processImage, nullptr);
+    }
 
     m_wallTime = timer.elapsed();
+    m_decodedStreamCacheStatistics = document.getStorage().getDecodedStreamCache()->getStatistics();
+    m_shadingMeshCacheStatistics = pdf::PDFShadingMeshCache::getInstance()->getStatistics();
 
     fontCache.setCacheShrinkEnabled(nullptr, true);
 
@@ -326,6 +350,12 @@ void PDFToolRenderBase::writeStatistics(PDFOutputFormatter& formatter)
         writeValue("render-time-ratio", PDFToolTranslationContext::tr("Render time ratio"), locale.toString(renderRatio, 'f', 2), PDFToolTranslationContext::tr("%"));
         writeValue("wait-time-ratio", PDFToolTranslationContext::tr("Wait time ratio"), locale.toString(waitRatio, 'f', 2), PDFToolTranslationContext::tr("%"));
         writeValue("write-time-ratio", PDFToolTranslationContext::tr("Write time ratio"), locale.toString(writeRatio, 'f', 2), PDFToolTranslationContext::tr("%"));
+        writeValue("decoded-stream-cache-hits", PDFToolTranslationContext::tr("Decoded stream cache hits"), locale.toString(m_decodedStreamCacheStatistics.hits), PDFToolTranslationContext::tr("-"));
+        writeValue("decoded-stream-cache-misses", PDFToolTranslationContext::tr("Decoded stream cache misses"), locale.toString(m_decodedStreamCacheStatistics.misses), PDFToolTranslationContext::tr("-"));
+        writeValue("decoded-stream-cache-size", PDFToolTranslationContext::tr("Decoded stream cache size"), locale.toString(m_decodedStreamCacheStatistics.size), PDFToolTranslationContext::tr("bytes"));
+        writeValue("shading-mesh-cache-hits", PDFToolTranslationContext::tr("Shading mesh cache hits"), locale.toString(m_shadingMeshCacheStatistics.hits), PDFToolTranslationContext::tr("-"));
+        writeValue("shading-mesh-cache-misses", PDFToolTranslationContext::tr("Shading mesh cache misses"), locale.toString(m_shadingMeshCacheStatistics.misses), PDFToolTranslationContext::tr("-"));
+        writeValue("shading-mesh-cache-size", PDFToolTranslationContext::tr("Shading mesh cache size"), locale.toString(m_shadingMeshCacheStatistics.size), PDFToolTranslationContext::tr("bytes"));
 
         formatter.endTable();
         formatter.endl();
@@ -20,6 +20,7 @@
 
 #include "pdftoolabstractapplication.h"
 #include "pdfexception.h"
+#include "pdfpattern.h"
 
 namespace pdftool
 {
@@ -53,6 +54,8 @@ protected:
 
     std::vector<PageInfo> m_pageInfo;
     qint64 m_wallTime = 0;
+    pdf::PDFDecodedStreamCache::Statistics m_decodedStreamCacheStatistics;
+    pdf::PDFShadingMeshCache::Statistics m_shadingMeshCacheStatistics;
 };
 
 class PDFToolRender : public PDFToolRenderBase
@@ -0,0 +1,223 @@
+//    Copyright (C) 2023 Jakub Melka
+//
+//    This file is part of PDF4QT.
+//
+//    PDF4QT is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU Lesser General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    with the written consent of the copyright owner, any later version.
+//
+//    PDF4QT is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU Lesser General Public License for more details.
+//
+//    You should have received a copy of the GNU Lesser General Public License
+//    along with PDF4QT.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include "pdftoolsearch.h"
+#include "pdfdocumenttextflow.h"
+#include "pdftextindex.h"
+
+#include <QFile>
+#include <QRegularExpression>
+
+#include <numeric>
+
+namespace pdftool
+{
+
+static PDFToolSearch s_toolSearchApplication;
+
+QString PDFToolSearch::getStandardString(PDFToolAbstractApplication::StandardString standardString) const
+{
+    switch (standardString)
+    {
+        case Command:
+            return "search";
+
+        case Name:
+            return PDFToolTranslationContext::tr("Search text");
+
+        case Description:
+            return PDFToolTranslationContext::tr("Search text in documents using full-text index.");
+
+        default:
+            Q_ASSERT(false);
+            break;
+    }
+
+    return QString();
+}
+
+int PDFToolSearch::execute(const PDFToolOptions& options)
+{
+    QStringList queries;
+    if (!options.searchQuery.isEmpty())
+    {
+        queries << options.searchQuery;
+    }
+
+    if (!options.searchQueryFile.isEmpty())
+    {
+        QFile file(options.searchQueryFile);
+        if (!file.open(QFile::ReadOnly | QFile::Text))
+        {
+            PDFConsole::writeError(PDFToolTranslationContext::tr("Cannot open file '%1'.").arg(options.searchQueryFile), options.outputCodec);
+            return ErrorInvalidArguments;
+        }
+
+        for (const QString& line : QString::fromUtf8(file.readAll()).split(QChar('\n')))
+        {
+            QString query = line.trimmed();
+            if (!query.isEmpty())
+            {
+                queries << query;
+            }
+        }
+    }
+
+    if (queries.isEmpty())
+    {
+        PDFConsole::writeError(PDFToolTranslationContext::tr("No query specified."), options.outputCodec);
+        return ErrorInvalidArguments;
+    }
+
+    if (options.searchFiles.isEmpty())
+    {
+        PDFConsole::writeError(PDFToolTranslationContext::tr("No document specified."), options.outputCodec);
+        return ErrorNoDocumentSpecified;
+    }
+
+    std::vector<QRegularExpression> expressions;
+    if (options.searchRegularExpression)
+    {
+        QRegularExpression::PatternOptions patternOptions = QRegularExpression::UseUnicodePropertiesOption;
+        if (!options.searchCaseSensitive)
+        {
+            patternOptions |= QRegularExpression::CaseInsensitiveOption;
+        }
+
+        for (const QString& query : queries)
+        {
+            QRegularExpression expression(query, patternOptions);
+            if (!expression.isValid())
+            {
+                PDFConsole::writeError(PDFToolTranslationContext::tr("Invalid regular expression '%1': %2").arg(query, expression.errorString()), options.outputCodec);
+                return ErrorInvalidArguments;
+            }
+            expressions.emplace_back(qMove(expression));
+        }
+    }
+
+    pdf::PDFTextIndex::QueryFlags queryFlags = pdf::PDFTextIndex::None;
+    queryFlags.setFlag(pdf::PDFTextIndex::CaseSensitive, options.searchCaseSensitive);
+    queryFlags.setFlag(pdf::PDFTextIndex::Prefix, options.searchPrefix);
+
+    const pdf::PDFTextFlow::FlowFlags flowFlags = pdf::PDFTextFlow::FlowFlags(pdf::PDFTextFlow::SeparateBlocks) | pdf::PDFTextFlow::RemoveSoftHyphen;
+
+    QLocale locale;
+    int exitCode = ExitSuccess;
+    int resultCount = 0;
+
+    PDFOutputFormatter formatter(options.outputStyle);
+    formatter.beginDocument("search", PDFToolTranslationContext::tr("Search Results"));
+    formatter.endl();
+
+    formatter.beginTable("results", PDFToolTranslationContext::tr("Found Occurences"));
+
+    formatter.beginTableHeaderRow("header");
+    formatter.writeTableHeaderColumn("no", PDFToolTranslationContext::tr("No."), Qt::AlignLeft);
+    formatter.writeTableHeaderColumn("document", PDFToolTranslationContext::tr("Document"), Qt::AlignLeft);
+    formatter.writeTableHeaderColumn("query", PDFToolTranslationContext::tr("Query"), Qt::AlignLeft);
+    formatter.writeTableHeaderColumn("page-number", PDFToolTranslationContext::tr("Page"), Qt::AlignLeft);
+    formatter.writeTableHeaderColumn("matched", PDFToolTranslationContext::tr("Matched"), Qt::AlignLeft);
+    formatter.writeTableHeaderColumn("context", PDFToolTranslationContext::tr("Context"), Qt::AlignLeft);
+    formatter.endTableHeaderRow();
+
+    for (const QString& fileName : options.searchFiles)
+    {
+        PDFToolOptions documentOptions = options;
+        documentOptions.document = fileName;
+
+        pdf::PDFDocument document;
+        QByteArray sourceData;
+        if (!readDocument(documentOptions, document, &sourceData, false))
+        {
+            exitCode = ErrorDocumentReading;
+            continue;
+        }
+
+        if (!document.getStorage().getSecurityHandler()->isAllowed(pdf::PDFSecurityHandler::Permission::CopyContent))
+        {
+            PDFConsole::writeError(PDFToolTranslationContext::tr("Document '%1' doesn't allow to copy content.").arg(fileName), options.outputCodec);
+            exitCode = ErrorPermissions;
+            continue;
+        }
+
+        std::vector<pdf::PDFInteger> pageIndices(document.getCatalog()->getPageCount(), 0);
+        std::iota(pageIndices.begin(), pageIndices.end(), 0);
+
+        pdf::PDFDocumentTextFlowFactory factory;
+        if (!options.textLayoutCacheDirectory.isEmpty())
+        {
+            factory.setTextLayoutDiskCache(pdf::PDFTextLayoutDiskCache(options.textLayoutCacheDirectory), pdf::PDFTextLayoutDiskCache::createDocumentHash(sourceData));
+        }
+        pdf::PDFTextLayoutStorage textLayouts = factory.createTextLayouts(&document, pageIndices);
+
+        for (const pdf::PDFRenderError& error : factory.getErrors())
+        {
+            PDFConsole::writeError(error.message, options.outputCodec);
+        }
+
+        // Index is created once for the document and then used for all queries
+        std::optional<pdf::PDFTextIndex> textIndex;
+        if (!options.searchRegularExpression)
+        {
+            textIndex = pdf::PDFTextIndex::create(textLayouts, flowFlags);
+        }
+
+        for (int i = 0; i < queries.size(); ++i)
+        {
+            pdf::PDFFindResults findResults;
+            if (textIndex)
+            {
+                findResults = textIndex->createFindResults(textIndex->query(queries[i], queryFlags), textLayouts);
+            }
+            else
+            {
+                findResults = textLayouts.find(expressions[i], flowFlags);
+            }
+
+            for (const pdf::PDFFindResult& findResult : findResults)
+            {
+                const pdf::PDFInteger pageIndex = findResult.textSelectionItems.front().first.pageIndex;
+
+                formatter.beginTableRow("result", resultCount);
+                formatter.writeTableColumn("no", locale.toString(resultCount + 1), Qt::AlignRight);
+                formatter.writeTableColumn("document", fileName, Qt::AlignLeft);
+                formatter.writeTableColumn("query", queries[i], Qt::AlignLeft);
+                formatter.writeTableColumn("page-number", locale.toString(pageIndex + 1), Qt::AlignRight);
+                formatter.writeTableColumn("matched", findResult.matched, Qt::AlignLeft);
+                formatter.writeTableColumn("context", findResult.context, Qt::AlignLeft);
+                formatter.endTableRow();
+                ++resultCount;
+            }
+        }
+    }
+
+    formatter.endTable();
+    formatter.endDocument();
+
+    PDFConsole::writeText(formatter.getString(), options.outputCodec);
+
+    return exitCode;
+}
+
+PDFToolAbstractApplication::Options PDFToolSearch::getOptionsFlags() const
+{
+    return ConsoleFormat | Search | TextLayoutCache;
+}
+
+}   // namespace pdftool
@@ -18,6 +18,8 @@
 
 #include <QtTest>
 #include <QMetaType>
+#include <QPainter>
+#include <QPdfWriter>
 
 #include "pdfparser.h"
 #include "pdfconstants.h"
@@ -27,6 +29,13 @@
 #include "pdfdocument.h"
 #include "pdfexception.h"
 #include "pdfjbig2decoder.h"
+#include "pdfdocumentbuilder.h"
+#include "pdfdocumentreader.h"
+#include "pdfdocumentwriter.h"
+#include "pdftextlayout.h"
+#include "pdftextindex.h"
+#include "pdfpainter.h"
+#include "pdfimage.h"
 
 #include <regex>
 
@@ -51,6 +60,8 @@ private slots:
     void test_bool();
     void test_ad();
     void test_command();
+    void test_token_values();
+    void benchmark_content_stream_lexing();
     void test_invalid_input();
     void test_header_regexp();
     void test_flat_map();
@@ -60,12 +71,25 @@ private slots:
     void test_stitching_function();
     void test_postscript_function();
     void test_jbig2_arithmetic_decoder();
+    void test_lazy_loading();
+    void test_object_stream_output();
+    void test_incremental_update_output();
+    void test_glyph_atlas();
+    void test_image_cache();
+    void test_text_layout_storage_merge();
+    void test_text_layout_storage_find();
+    void test_text_layout_disk_cache();
+    void test_text_index();
+    void test_text_layout_serialization();
 
 private:
     void scanWholeStream(const char* stream);
     void testTokens(const char* stream, const std::vector<pdf::PDFLexicalAnalyzer::Token>& tokens);
 
     QString getStringFromTokens(const std::vector<pdf::PDFLexicalAnalyzer::Token>& tokens);
+
+    /// Creates text layout of single line of text
+    static pdf::PDFTextLayout createTextLayout(const QString& text);
 };
 
 LexicalAnalyzerTest::LexicalAnalyzerTest()
@@ -215,6 +239,65 @@ void LexicalAnalyzerTest::test_command()
     testTokens("command1 command2", { Token(Type::Command, QByteArray("command1")), Token(Type::Command, QByteArray("command2")) });
 }
 
+void LexicalAnalyzerTest::test_token_values()
+{
+    using Token = pdf::PDFLexicalAnalyzer::Token;
+    using Type = pdf::PDFLexicalAnalyzer::TokenType;
+
+    // Strings and names with and without escape sequences must give the same values
+    testTokens("(Text) (T\\\\ext) (Te\\(xt\\)) (\\124ext)", { Token(Type::String, "Text"), Token(Type::String, "T\\ext"), Token(Type::String, "Te(xt)"), Token(Type::String, "Text") });
+    testTokens("/Name /N#61me /Nam#65", { Token(Type::Name, "Name"), Token(Type::Name, "Name"), Token(Type::Name, "Name") });
+    testTokens("()(a(b)c)", { Token(Type::String, ""), Token(Type::String, "a(b)c") });
+    testTokens("truefalse true false nullx", { Token(Type::Command, "truefalse"), Token(Type::Boolean, true), Token(Type::Boolean, false), Token(Type::Command, "nullx") });
+
+    // Typical content stream
+    const char* stream = "BT /F1 12 Tf 0.5 0 0 -0.5 72 720 Tm [(Hello) -250 (World)] TJ ET q 1 0 0 RG /GS1 gs 10.5 20 m 30 40 l S Q";
+    testTokens(stream, { Token(Type::Command, "BT"), Token(Type::Name, "F1"), Token(Type::Integer, 12), Token(Type::Command, "Tf"),
+                         Token(Type::Real, 0.5), Token(Type::Integer, 0), Token(Type::Integer, 0), Token(Type::Real, -0.5), Token(Type::Integer, 72), Token(Type::Integer, 720), Token(Type::Command, "Tm"),
+                         Token(Type::ArrayStart), Token(Type::String, "Hello"), Token(Type::Integer, -250), Token(Type::String, "World"), Token(Type::ArrayEnd), Token(Type::Command, "TJ"), Token(Type::Command, "ET"),
+                         Token(Type::Command, "q"), Token(Type::Integer, 1), Token(Type::Integer, 0), Token(Type::Integer, 0), Token(Type::Command, "RG"), Token(Type::Name, "GS1"), Token(Type::Command, "gs"),
+                         Token(Type::Real, 10.5), Token(Type::Integer, 20), Token(Type::Command, "m"), Token(Type::Integer, 30), Token(Type::Integer, 40), Token(Type::Command, "l"), Token(Type::Command, "S"), Token(Type::Command, "Q") });
+
+    // Accessors
+    pdf::PDFLexicalAnalyzer analyzer(stream, stream + strlen(stream));
+    analyzer.fetch();
+    QCOMPARE(analyzer.fetch().getBytes(), QByteArray("F1"));
+    Token integerToken = analyzer.fetch();
+    QCOMPARE(integerToken.getInteger(), pdf::PDFInteger(12));
+    QCOMPARE(integerToken.getReal(), pdf::PDFReal(12.0));
+    QVERIFY(integerToken.hasValue());
+    QVERIFY(!Token(Type::ArrayStart).hasValue());
+    QVERIFY(Token(Type::Boolean, true).getBool());
+    QVERIFY(Token(Type::Integer, 1) != Token(Type::Real, 1.0));
+    QVERIFY(Token(Type::Name, "F1") != Token(Type::String, "F1"));
+}
+
+void LexicalAnalyzerTest::benchmark_content_stream_lexing()
+{
+    using Type = pdf::PDFLexicalAnalyzer::TokenType;
+
+    // Typical content stream (33 tokens)
+    const char* stream = "BT /F1 12 Tf 0.5 0 0 -0.5 72 720 Tm [(Hello) -250 (World)] TJ ET q 1 0 0 RG /GS1 gs 10.5 20 m 30 40 l S Q";
+
+    QByteArray contentStream;
+    for (int i = 0; i < 1000; ++i)
+    {
+        contentStream.append(stream);
+        contentStream.append('\n');
+    }
+
+    QBENCHMARK
+    {
+        pdf::PDFLexicalAnalyzer contentStreamAnalyzer(contentStream.constData(), contentStream.constData() + contentStream.size());
+        size_t tokenCount = 0;
+        while (contentStreamAnalyzer.fetch().type != Type::EndOfFile)
+        {
+            ++tokenCount;
+        }
+        QCOMPARE(tokenCount, size_t(33 * 1000));
+    }
+}
+
 void LexicalAnalyzerTest::test_invalid_input()
 {
     QByteArray bigNumber(500, '0');
@@ -602,6 +685,59 @@ void LexicalAnalyzerTest::test_sampled_function()
         QVERIFY(!function);
     });
 
+    {
+        // Function with two inputs and three outputs, batch evaluation must give
+        // the same results as evaluation of single points (including the points
+        // outside of the domain).
+        QByteArray data = " << "
+                          "     /FunctionType 0 "
+                          "     /Domain [ 0 1 -1 1 ] "
+                          "     /Range [ 0 1 0 1 0 1 ] "
+                          "     /Size [ 3 2 ] "
+                          "     /BitsPerSample 8 "
+                          "     /Order 1 "
+                          "     /Encode [ 2 0 0 1 ] "
+                          "     /Decode [ 0 1 1 0 0 0.5 ] "
+                          "     /Length 18 "
+                          " >> "
+                          " stream\n";
+        data.append(QByteArray::fromHex("00FF80 40C020 FF0010 1020F0 7F7F7F A0B0C0"));
+        data.append(" endstream ");
+
+        pdf::PDFDocument document;
+        pdf::PDFParser parser(data, nullptr, pdf::PDFParser::AllowStreams);
+        pdf::PDFFunctionPtr function = pdf::PDFFunction::createFunction(&document, parser.getObject());
+
+        QVERIFY(function);
+        QCOMPARE(function->getInputVariableCount(), uint32_t(2));
+        QCOMPARE(function->getOutputVariableCount(), uint32_t(3));
+
+        std::vector<double> values;
+        for (double x = -0.25; x <= 1.25; x += 0.05)
+        {
+            for (double y = -1.5; y <= 1.5; y += 0.1)
+            {
+                values.push_back(x);
+                values.push_back(y);
+            }
+        }
+
+        const size_t pointCount = values.size() / 2;
+        std::vector<double> batchResults(pointCount * 3, -1.0);
+        QVERIFY(function->apply(values.data(), batchResults.data(), pointCount));
+
+        for (size_t i = 0; i < pointCount; ++i)
+        {
+            double actual[3] = { -1.0, -1.0, -1.0 };
+            QVERIFY(function->apply(values.data() + 2 * i, values.data() + 2 * i + 2, actual, actual + 3));
+
+            for (size_t j = 0; j < 3; ++j)
+            {
+                QCOMPARE(batchResults[3 * i + j], actual[j]);
+            }
+        }
+    }
+
     // Test invalid inputs
     QVERIFY_THROWS_EXCEPTION(pdf::PDFException,
     {
@@ -880,6 +1016,62 @@ void LexicalAnalyzerTest::test_stitching_function()
             QVERIFY(function->apply(&value, &value + 1, &actual, &actual + 1));
             QVERIFY(qFuzzyCompare(expected, actual));
         }
+
+        // Batch evaluation must give the same results as evaluation of single points
+        std::vector<double> values;
+        for (double value = -1.0; value <= 3.0; value += 0.01)
+        {
+            values.push_back(value);
+        }
+        std::reverse(values.begin() + values.size() / 2, values.end());
+
+        std::vector<double> batchResults(values.size(), 0.0);
+        QVERIFY(function->apply(values.data(), batchResults.data(), values.size()));
+
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            double actual = 0.0;
+            QVERIFY(function->apply(&values[i], &values[i] + 1, &actual, &actual + 1));
+            QCOMPARE(batchResults[i], actual);
+        }
+
+        // Lookup table is exact at samples and interpolates between them
+        pdf::PDFFunctionLookupTable lookupTable = pdf::PDFFunctionLookupTable::create({ function }, 1, 0.0, 1.0, 11);
+        QVERIFY(lookupTable.isValid());
+
+        const double lookupTableValues[] = { -1.0, 0.0, 0.2, 0.8, 0.85, 1.0, 2.0 };
+        const double lookupTableExpected[] = { 0.0, 0.0, 0.2, 0.64, 0.725, 1.0, 1.0 };
+        double lookupTableResults[std::size(lookupTableValues)] = { };
+        lookupTable.apply(lookupTableValues, lookupTableResults, std::size(lookupTableValues));
+
+        for (size_t i = 0; i < std::size(lookupTableValues); ++i)
+        {
+            QVERIFY(qAbs(lookupTableResults[i] - lookupTableExpected[i]) < 1e-9);
+        }
+
+        // Function has hard step at the bound (0.5 and 0.25), so it
+        // must not be approximated by the lookup table in shadings.
+        QVERIFY(!function->isContinuous());
+        QVERIFY(!pdf::PDFFunctionLookupTable::isApproximationAccurate({ function }));
+    }
+
+    {
+        QByteArray data = " << "
+                          "     /FunctionType 3 "
+                          "     /Domain [ 0 1 ] "
+                          "     /Bounds [ 0.5 ] "
+                          "     /Encode [ 0 0.5 0 1.0 ] "
+                          "     /Functions [ /Identity << /FunctionType 2 /Domain [ 0 1.0 ] /C0 [ 0.5 ] /C1 [ 1.0 ] /N 1.0 >> ] "
+                          " >> ";
+
+        pdf::PDFDocument document;
+        pdf::PDFParser parser(data, nullptr, pdf::PDFParser::None);
+        pdf::PDFFunctionPtr function = pdf::PDFFunction::createFunction(&document, parser.getObject());
+
+        // Both partial functions have value 0.5 at the bound
+        QVERIFY(function);
+        QVERIFY(function->isContinuous());
+        QVERIFY(pdf::PDFFunctionLookupTable::isApproximationAccurate({ function }));
     }
 
     QVERIFY_THROWS_EXCEPTION(pdf::PDFException,
@@ -995,6 +1187,9 @@ void LexicalAnalyzerTest::test_postscript_function()
         pdf::PDFFunctionPtr function = pdf::PDFFunction::createFunction(&document, parser.getObject());
 
         QVERIFY(function);
+
+        std::vector<double> values;
+        std::vector<double> results;
         for (double value = -1.0; value <= 3.0; value += 0.01)
         {
             const double clampedValue = qBound(0.0, value, 1.0);
@@ -1020,7 +1215,18 @@ void LexicalAnalyzerTest::test_postscript_function()
 
                 QVERIFY(isSame);
             }
+
+            values.push_back(value);
+            results.push_back(actual);
         }
+
+        // Batch evaluation must give the same results
+        const pdf::PDFPostScriptFunction* postScriptFunction = dynamic_cast<const pdf::PDFPostScriptFunction*>(function.get());
+        QVERIFY(postScriptFunction);
+
+        std::vector<double> batchResults(values.size(), 0.0);
+        QVERIFY(postScriptFunction->apply(values.data(), batchResults.data(), values.size()));
+        QVERIFY(batchResults == results);
     };
 
     test01("dup mul", [](double x) { return x * x; });
@@ -1061,6 +1267,11 @@ void LexicalAnalyzerTest::test_postscript_function()
     test01("pop 4 3 2 1   3 -1 roll 3 eq { 1 eq { 2 eq { 4 eq { 1.0 } { 0.0 } ifelse } { 0.0 } ifelse } { 0.0 } ifelse } { 0.0 } ifelse", [](double) { return 1.0; }); // we should have 4 2 1 3
     test01("2.0 2 copy div 3 1 roll exp add", [](double x) { return qBound(0.0, 0.5 * x + std::pow(x, 2.0), 1.0); });
     test01("2.0 1 index exch div exch pop", [](double x) { return x / 2.0; });
+    test01("2 3 add 10 div mul", [](double x) { return x * 0.5; });
+    test01("true { 0.5 mul } if 1 2 lt { 2.0 mul } { 3.0 mul } ifelse", [](double x) { return x; });
+    test01("{ 0.5 mul } 1 2 add pop", [](double x) { return x * 0.5; });
+    test01("dup 0.5 lt { 0.25 lt { 0.1 } { 0.2 } ifelse } { pop 0.9 } ifelse", [](double x) { return (x < 0.5) ? ((x < 0.25) ? 0.1 : 0.2) : 0.9; });
+    test01("0.5 exch dup 0.5 gt { 1 } { 0 } ifelse index exch pop exch pop", [](double x) { return qMin(x, 0.5); });
 }
 
 void LexicalAnalyzerTest::test_jbig2_arithmetic_decoder()
@@ -1102,6 +1313,774 @@ void LexicalAnalyzerTest::test_jbig2_arithmetic_decoder()
     QVERIFY(decompressed == decompressedByAD);
 }
 
+void LexicalAnalyzerTest::test_lazy_loading()
+{
+    // Document is read eagerly and lazily, objects must be the same,
+    // both for cross-reference table and for object streams.
+    for (const bool objectStreams : { false, true })
+    {
+        pdf::PDFDocumentBuilder builder;
+        builder.createDocument();
+        builder.appendPage(QRectF(0, 0, 612, 792));
+
+        std::shared_ptr<pdf::PDFArray> array = std::make_shared<pdf::PDFArray>();
+        array->appendItem(pdf::PDFObject::createName("Name"));
+        array->appendItem(pdf::PDFObject::createString("String"));
+        array->appendItem(pdf::PDFObject::createReal(3.5));
+        builder.addObject(pdf::PDFObject::createArray(qMove(array)));
+
+        pdf::PDFDictionary streamDictionary;
+        streamDictionary.addEntry(pdf::PDFInplaceOrMemoryString("Length"), pdf::PDFObject::createInteger(11));
+        pdf::PDFObjectReference streamReference = builder.addObject(pdf::PDFObject::createStream(std::make_shared<pdf::PDFStream>(qMove(streamDictionary), QByteArray("Stream data"))));
+        pdf::PDFObjectReference changedReference = builder.addObject(pdf::PDFObject::createInteger(1));
+        for (int i = 0; i < 10; ++i)
+        {
+            builder.addObject(pdf::PDFObject::createInteger(i));
+        }
+        pdf::PDFDocument document = builder.build();
+
+        QBuffer buffer;
+        buffer.open(QBuffer::WriteOnly);
+        pdf::PDFDocumentWriter writer(nullptr);
+        writer.setObjectStreamsEnabled(objectStreams);
+        QVERIFY(writer.write(&buffer, &document));
+        buffer.close();
+
+        pdf::PDFDocumentReader eagerReader(nullptr, [](bool* ok) { *ok = false; return QString(); }, false, false);
+        pdf::PDFDocument eagerDocument = eagerReader.readFromBuffer(buffer.data());
+        QCOMPARE(eagerReader.getReadingResult(), pdf::PDFDocumentReader::Result::OK);
+
+        pdf::PDFDocumentReader lazyReader(nullptr, [](bool* ok) { *ok = false; return QString(); }, false, false);
+        lazyReader.setLazyLoading(true, 2);
+        pdf::PDFDocument lazyDocument = lazyReader.readFromBuffer(buffer.data());
+        QCOMPARE(lazyReader.getReadingResult(), pdf::PDFDocumentReader::Result::OK);
+        QVERIFY(lazyDocument.getStorage().isLazyLoading());
+        QCOMPARE(lazyDocument.getCatalog()->getPageCount(), size_t(1));
+
+        const pdf::PDFObjectStorage::PDFObjects& objects = eagerDocument.getStorage().getObjects();
+        auto compareObjects = [&objects](const pdf::PDFObjectStorage& storage, pdf::PDFObjectReference skippedReference)
+        {
+            for (size_t i = 0; i < objects.size(); ++i)
+            {
+                pdf::PDFObjectReference reference(pdf::PDFInteger(i), objects[i].generation);
+                if (reference != skippedReference && storage.getObject(reference) != objects[i].object)
+                {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        // Released objects are loaded again
+        const pdf::PDFObjectStorage& lazyStorage = lazyDocument.getStorage();
+        QVERIFY(compareObjects(lazyStorage, pdf::PDFObjectReference()));
+        lazyStorage.releaseObjects();
+        QVERIFY(compareObjects(lazyStorage, pdf::PDFObjectReference()));
+
+        // Modified object is never released
+        pdf::PDFObjectStorage modifiedStorage = lazyStorage;
+        modifiedStorage.setObject(changedReference, pdf::PDFObject::createInteger(100));
+        QVERIFY(compareObjects(modifiedStorage, changedReference));
+        modifiedStorage.releaseObjects();
+        QCOMPARE(modifiedStorage.getObject(changedReference).getInteger(), pdf::PDFInteger(100));
+        QVERIFY(compareObjects(modifiedStorage, changedReference));
+        QCOMPARE(lazyStorage.getObject(changedReference).getInteger(), pdf::PDFInteger(1));
+
+        if (!objectStreams)
+        {
+            // Damaged cross reference table (object offset refers to another object),
+            // document is read completely, as it is read without lazy loading.
+            QByteArray damagedData = buffer.data();
+            const int xrefEntriesIndex = damagedData.lastIndexOf("0000000000 65535 f");
+            QVERIFY(xrefEntriesIndex != -1);
+            const int entryLength = 20;
+            const int changedEntryIndex = xrefEntriesIndex + int(changedReference.objectNumber) * entryLength;
+            damagedData.replace(changedEntryIndex, 10, damagedData.mid(xrefEntriesIndex + entryLength, 10));
+
+            pdf::PDFDocumentReader damagedEagerReader(nullptr, [](bool* ok) { *ok = false; return QString(); }, true, false);
+            pdf::PDFDocument damagedEagerDocument = damagedEagerReader.readFromBuffer(damagedData);
+
+            pdf::PDFDocumentReader damagedLazyReader(nullptr, [](bool* ok) { *ok = false; return QString(); }, true, false);
+            damagedLazyReader.setLazyLoading(true, 2);
+            pdf::PDFDocument damagedLazyDocument = damagedLazyReader.readFromBuffer(damagedData);
+            QCOMPARE(damagedLazyReader.getReadingResult(), damagedEagerReader.getReadingResult());
+            QVERIFY(!damagedLazyDocument.getStorage().isLazyLoading());
+            QVERIFY(!damagedLazyReader.getWarnings().isEmpty());
+            QVERIFY(damagedLazyDocument.getStorage().getObjects() == damagedEagerDocument.getStorage().getObjects());
+
+            // Objects of memory mapped document copied to another storage, and
+            // decoded stream data, must remain valid after the document is destroyed.
+            QTemporaryDir directory;
+            QVERIFY(directory.isValid());
+            const QString fileName = directory.filePath("mapped.pdf");
+            QFile file(fileName);
+            QVERIFY(file.open(QFile::WriteOnly));
+            file.write(buffer.data());
+            file.close();
+
+            pdf::PDFDocumentBuilder copyBuilder;
+            copyBuilder.createDocument();
+            QByteArray decodedStream;
+            std::vector<pdf::PDFObject> copiedObjects;
+            {
+                pdf::PDFDocumentReader mappedReader(nullptr, [](bool* ok) { *ok = false; return QString(); }, false, false);
+                mappedReader.setMemoryMapping(true);
+                pdf::PDFDocument mappedDocument = mappedReader.readFromFile(fileName);
+                QCOMPARE(mappedReader.getReadingResult(), pdf::PDFDocumentReader::Result::OK);
+                copiedObjects = copyBuilder.copyFrom({ pdf::PDFObject::createReference(streamReference) }, mappedDocument.getStorage(), true);
+                decodedStream = mappedDocument.getDecodedStream(mappedDocument.getObjectByReference(streamReference).getStream());
+            }
+            QCOMPARE(decodedStream, QByteArray("Stream data"));
+
+            pdf::PDFDocument copiedDocument = copyBuilder.build();
+            const pdf::PDFObject& copiedObject = copiedDocument.getObject(copiedObjects.front());
+            QVERIFY(copiedObject.isStream());
+            QCOMPARE(*copiedObject.getStream()->getContent(), QByteArray("Stream data"));
+        }
+    }
+
+    // Objects are loaded only once, until they are released
+    class CountingObjectLoader : public pdf::PDFObjectLoader
+    {
+    public:
+        virtual pdf::PDFObject loadObject(pdf::PDFObjectReference reference) const override
+        {
+            ++loadCount;
+            return pdf::PDFObject::createInteger(reference.objectNumber * 10);
+        }
+
+        mutable int loadCount = 0;
+    };
+
+    QSharedPointer<CountingObjectLoader> loader(new CountingObjectLoader());
+    pdf::PDFObjectStorage storage(pdf::PDFObjectStorage::PDFObjects(4), pdf::PDFObject(), pdf::PDFSecurityHandlerPointer());
+    storage.setObjectLoader(loader, 1);
+
+    auto getValue = [&storage](pdf::PDFInteger objectNumber) { return storage.getObject(pdf::PDFObjectReference(objectNumber, 0)).getInteger(); };
+
+    QCOMPARE(getValue(1), pdf::PDFInteger(10));
+    QCOMPARE(getValue(2), pdf::PDFInteger(20));
+    QCOMPARE(getValue(3), pdf::PDFInteger(30));
+    QCOMPARE(getValue(1), pdf::PDFInteger(10));
+    QCOMPARE(loader->loadCount, 3);
+
+    // Oldest objects are released, last loaded object is kept
+    storage.releaseObjects();
+    QCOMPARE(getValue(3), pdf::PDFInteger(30));
+    QCOMPARE(loader->loadCount, 3);
+    QCOMPARE(getValue(1), pdf::PDFInteger(10));
+    QCOMPARE(loader->loadCount, 4);
+
+    // Modified objects (released or resident) are kept
+    storage.setObject(pdf::PDFObjectReference(2, 0), pdf::PDFObject::createInteger(200));
+    storage.setObject(pdf::PDFObjectReference(1, 0), pdf::PDFObject::createInteger(100));
+    QCOMPARE(getValue(0), pdf::PDFInteger(0));
+    QCOMPARE(loader->loadCount, 5);
+    storage.releaseObjects();
+    storage.releaseObjects();
+    QCOMPARE(getValue(2), pdf::PDFInteger(200));
+    QCOMPARE(getValue(1), pdf::PDFInteger(100));
+    QCOMPARE(loader->loadCount, 5);
+    QCOMPARE(getValue(3), pdf::PDFInteger(30));
+    QCOMPARE(loader->loadCount, 6);
+}
+
+void LexicalAnalyzerTest::test_object_stream_output()
+{
+    pdf::PDFDocumentBuilder builder;
+    builder.createDocument();
+    builder.appendPage(QRectF(0, 0, 612, 792));
+
+    // Stream with indirect length, length object must be readable
+    // before object streams are read.
+    const QByteArray streamData = "BT /F1 12 Tf 72 720 Td (Hello) Tj ET";
+    pdf::PDFObjectReference lengthReference = builder.addObject(pdf::PDFObject::createInteger(streamData.size()));
+    pdf::PDFDictionary streamDictionary;
+    streamDictionary.addEntry(pdf::PDFInplaceOrMemoryString("Length"), pdf::PDFObject::createReference(lengthReference));
+    pdf::PDFObjectReference streamReference = builder.addObject(pdf::PDFObject::createStream(std::make_shared<pdf::PDFStream>(qMove(streamDictionary), QByteArray(streamData))));
+    pdf::PDFObjectReference arrayReference = builder.addObject(pdf::PDFObject::createArray(std::make_shared<pdf::PDFArray>()));
+    pdf::PDFDocument document = builder.build();
+
+    QBuffer buffer;
+    buffer.open(QBuffer::WriteOnly);
+    pdf::PDFDocumentWriter writer(nullptr);
+    writer.setObjectStreamsEnabled(true);
+    QVERIFY(writer.write(&buffer, &document));
+    buffer.close();
+
+    QVERIFY(buffer.data().contains("/ObjStm"));
+    QVERIFY(buffer.data().contains("/XRef"));
+
+    pdf::PDFDocumentReader reader(nullptr, [](bool* ok) { *ok = false; return QString(); }, false, false);
+    pdf::PDFDocument readDocument = reader.readFromBuffer(buffer.data());
+    QCOMPARE(reader.getReadingResult(), pdf::PDFDocumentReader::Result::OK);
+    QCOMPARE(readDocument.getCatalog()->getPageCount(), size_t(1));
+
+    const pdf::PDFObject& lengthObject = readDocument.getObjectByReference(lengthReference);
+    QVERIFY(lengthObject.isInt());
+    QCOMPARE(lengthObject.getInteger(), pdf::PDFInteger(streamData.size()));
+
+    const pdf::PDFObject& streamObject = readDocument.getObjectByReference(streamReference);
+    QVERIFY(streamObject.isStream());
+    QCOMPARE(*streamObject.getStream()->getContent(), streamData);
+
+    QVERIFY(readDocument.getObjectByReference(arrayReference).isArray());
+}
+
+void LexicalAnalyzerTest::test_incremental_update_output()
+{
+    // Original document is written both with classic cross-reference table
+    // and with cross-reference stream, update must use the same format.
+    for (const bool objectStreams : { false, true })
+    {
+        pdf::PDFDocumentBuilder builder;
+        builder.createDocument();
+        builder.appendPage(QRectF(0, 0, 612, 792));
+        pdf::PDFObjectReference changedReference = builder.addObject(pdf::PDFObject::createInteger(1));
+        pdf::PDFObjectReference unchangedReference = builder.addObject(pdf::PDFObject::createInteger(2));
+        pdf::PDFObjectReference deletedReference = builder.addObject(pdf::PDFObject::createInteger(3));
+        pdf::PDFDocument document = builder.build();
+
+        QBuffer originalBuffer;
+        originalBuffer.open(QBuffer::WriteOnly);
+        pdf::PDFDocumentWriter writer(nullptr);
+        writer.setObjectStreamsEnabled(objectStreams);
+        QVERIFY(writer.write(&originalBuffer, &document));
+        originalBuffer.close();
+        const QByteArray originalData = originalBuffer.data();
+
+        pdf::PDFDocumentReader originalReader(nullptr, [](bool* ok) { *ok = false; return QString(); }, false, false);
+        pdf::PDFDocument originalDocument = originalReader.readFromBuffer(originalData);
+        QCOMPARE(originalReader.getReadingResult(), pdf::PDFDocumentReader::Result::OK);
+
+        pdf::PDFDocumentBuilder modifier(&originalDocument);
+        modifier.setObject(changedReference, pdf::PDFObject::createInteger(10));
+        modifier.setObject(deletedReference, pdf::PDFObject());
+        pdf::PDFObjectReference addedReference = modifier.addObject(pdf::PDFObject::createInteger(20));
+        pdf::PDFDocument modifiedDocument = modifier.build();
+
+        QBuffer buffer;
+        buffer.open(QBuffer::WriteOnly);
+        QVERIFY(pdf::PDFDocumentWriter(nullptr).writeIncremental(&buffer, originalData, &originalDocument, &modifiedDocument));
+        buffer.close();
+
+        // Original data are kept unchanged, only the update is appended
+        const QByteArray data = buffer.data();
+        QVERIFY(data.size() > originalData.size());
+        QVERIFY(data.startsWith(originalData));
+        QVERIFY(data.mid(originalData.size()).contains("/Prev"));
+
+        // Deleted object is the head of the list of free objects
+        if (!objectStreams)
+        {
+            const QByteArray freeListHead = QString("%1 65535 f").arg(deletedReference.objectNumber, 10, 10, QChar('0')).toLatin1();
+            QVERIFY(data.mid(originalData.size()).contains(freeListHead));
+        }
+
+        pdf::PDFDocumentReader reader(nullptr, [](bool* ok) { *ok = false; return QString(); }, false, false);
+        pdf::PDFDocument readDocument = reader.readFromBuffer(data);
+        QCOMPARE(reader.getReadingResult(), pdf::PDFDocumentReader::Result::OK);
+        QVERIFY(reader.getWarnings().isEmpty());
+        QCOMPARE(readDocument.getCatalog()->getPageCount(), size_t(1));
+        QCOMPARE(readDocument.getObjectByReference(changedReference).getInteger(), pdf::PDFInteger(10));
+        QCOMPARE(readDocument.getObjectByReference(unchangedReference).getInteger(), pdf::PDFInteger(2));
+        QCOMPARE(readDocument.getObjectByReference(addedReference).getInteger(), pdf::PDFInteger(20));
+        QVERIFY(readDocument.getObjectByReference(deletedReference).isNull());
+    }
+}
+
+void LexicalAnalyzerTest::test_glyph_atlas()
+{
+    // Glyph in glyph space, with a hole and a slanted edge
+    QPainterPath glyphPath;
+    glyphPath.setFillRule(Qt::OddEvenFill);
+    glyphPath.addRect(0.0, 0.0, 0.5, 0.7);
+    glyphPath.addEllipse(QPointF(0.25, 0.35), 0.15, 0.2);
+    glyphPath.moveTo(0.5, 0.0);
+    glyphPath.lineTo(0.7, 0.0);
+    glyphPath.lineTo(0.5, 0.4);
+    glyphPath.closeSubpath();
+
+    // Scale and origin of the glyph in device space are exactly representable
+    // by the quantized values of the atlas, so glyph must be the same as the filled path.
+    const QTransform glyphMatrix(12.0, 0.0, 0.0, -12.0, 5.0, 30.0);
+    const QTransform worldMatrix = QTransform::fromScale(2.0, 2.0) * QTransform::fromTranslate(10.25, 20.5);
+    const QPainterPath path = glyphMatrix.map(glyphPath);
+    const QColor color(20, 90, 160);
+    const quint64 glyphId = 0xFFFF0001;
+
+    auto createImage = []()
+    {
+        QImage image(64, 128, QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::transparent);
+        return image;
+    };
+
+    auto compareImages = [](const QImage& image1, const QImage& image2)
+    {
+        int maxDifference = 0;
+        for (int y = 0; y < image1.height(); ++y)
+        {
+            for (int x = 0; x < image1.width(); ++x)
+            {
+                const QRgb pixel1 = image1.pixel(x, y);
+                const QRgb pixel2 = image2.pixel(x, y);
+                maxDifference = qMax(maxDifference, qAbs(qRed(pixel1) - qRed(pixel2)));
+                maxDifference = qMax(maxDifference, qAbs(qGreen(pixel1) - qGreen(pixel2)));
+                maxDifference = qMax(maxDifference, qAbs(qBlue(pixel1) - qBlue(pixel2)));
+                maxDifference = qMax(maxDifference, qAbs(qAlpha(pixel1) - qAlpha(pixel2)));
+            }
+        }
+        return maxDifference;
+    };
+
+    pdf::PDFGlyphAtlas* atlas = pdf::PDFGlyphAtlas::getInstance();
+
+    for (const bool antialiasing : { false, true })
+    {
+        QImage pathImage = createImage();
+        {
+            QPainter painter(&pathImage);
+            painter.setRenderHint(QPainter::Antialiasing, antialiasing);
+            painter.setWorldTransform(worldMatrix);
+            painter.fillPath(path, color);
+        }
+        QVERIFY(pathImage != createImage());
+
+        // Second pass draws the glyph from the cache
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            QImage glyphImage = createImage();
+            {
+                QPainter painter(&glyphImage);
+                painter.setRenderHint(QPainter::Antialiasing, antialiasing);
+                painter.setWorldTransform(worldMatrix);
+                QVERIFY(atlas->drawGlyph(&painter, path, QBrush(color), glyphId, glyphMatrix, antialiasing));
+                QCOMPARE(painter.worldTransform(), worldMatrix);
+            }
+
+            QVERIFY(compareImages(pathImage, glyphImage) <= 8);
+        }
+    }
+
+    // Rotated glyph is not drawn from the cache
+    {
+        QImage image = createImage();
+        QPainter painter(&image);
+        painter.setWorldTransform(QTransform().rotate(30.0) * worldMatrix);
+        QVERIFY(!atlas->drawGlyph(&painter, path, QBrush(color), glyphId, glyphMatrix, true));
+    }
+
+    // Vector devices get glyphs as paths
+    {
+        QBuffer buffer;
+        buffer.open(QBuffer::WriteOnly);
+        QPdfWriter pdfWriter(&buffer);
+        QPainter painter(&pdfWriter);
+        painter.setWorldTransform(worldMatrix);
+        QVERIFY(!atlas->drawGlyph(&painter, path, QBrush(color), glyphId, glyphMatrix, true));
+    }
+
+    atlas->removeGlyphs({ glyphId });
+}
+
+void LexicalAnalyzerTest::test_image_cache()
+{
+    pdf::PDFImageCache* cache = pdf::PDFImageCache::getInstance();
+    cache->clear();
+
+    // Cache is shared, so the largest requested limit is used
+    int firstOwner = 0;
+    int secondOwner = 0;
+    cache->setLimit(&firstOwner, 1024 * 1024);
+    cache->setLimit(&secondOwner, 4 * 1024 * 1024);
+    QCOMPARE(cache->getStatistics().limit, qint64(4 * 1024 * 1024));
+    cache->setLimit(&firstOwner, 2 * 1024 * 1024);
+    QCOMPARE(cache->getStatistics().limit, qint64(4 * 1024 * 1024));
+    cache->removeLimit(&secondOwner);
+    QCOMPARE(cache->getStatistics().limit, qint64(2 * 1024 * 1024));
+
+    // Errors reported during decoding are returned together with the image
+    pdf::PDFImageCache::Key key;
+    key.contentId = 1;
+    key.reference = pdf::PDFObjectReference(5, 0);
+
+    QImage image(16, 16, QImage::Format_RGB32);
+    image.fill(Qt::red);
+    std::vector<pdf::PDFRenderError> errors;
+    errors.emplace_back(pdf::RenderErrorType::Warning, QString("Image warning"));
+    cache->insertImage(key, image, qMove(errors));
+
+    std::vector<pdf::PDFRenderError> cachedErrors;
+    QCOMPARE(cache->getImage(key, cachedErrors), image);
+    QCOMPARE(cachedErrors.size(), size_t(1));
+    QCOMPARE(cachedErrors.front().type, pdf::RenderErrorType::Warning);
+    QCOMPARE(cachedErrors.front().message, QString("Image warning"));
+
+    key.downsampleLevel = 1;
+    cachedErrors.clear();
+    QVERIFY(cache->getImage(key, cachedErrors).isNull());
+    QVERIFY(cachedErrors.empty());
+
+    cache->removeLimit(&firstOwner);
+    QCOMPARE(cache->getStatistics().limit, pdf::PDFImageCache::DEFAULT_LIMIT);
+    cache->clear();
+}
+
+void LexicalAnalyzerTest::test_text_layout_storage_merge()
+{
+    auto getMatchedTexts = [](const pdf::PDFTextLayoutStorage& storage, const QString& text)
+    {
+        QStringList matchedTexts;
+        for (const pdf::PDFFindResult& result : storage.find(text, Qt::CaseInsensitive, pdf::PDFTextFlow::SeparateBlocks))
+        {
+            matchedTexts << QString("%1:%2").arg(result.textSelectionItems.front().first.pageIndex).arg(result.matched);
+        }
+        return matchedTexts;
+    };
+
+    pdf::PDFTextLayoutStorage storage(4);
+    storage.setTextLayout(0, createTextLayout("alpha beta"), nullptr);
+    storage.setTextLayout(2, createTextLayout("gamma alpha"), nullptr);
+
+    pdf::PDFTextLayoutStorage partialStorage(4);
+    partialStorage.setTextLayout(1, createTextLayout("alpha delta"), nullptr);
+    partialStorage.setTextLayout(2, createTextLayout("epsilon"), nullptr);
+
+    // Missing pages are copied, existing pages are not overwritten
+    storage.merge(partialStorage);
+    QVERIFY(storage.hasTextLayout(0));
+    QVERIFY(storage.hasTextLayout(1));
+    QVERIFY(storage.hasTextLayout(2));
+    QVERIFY(!storage.hasTextLayout(3));
+    QCOMPARE(getMatchedTexts(storage, "alpha"), QStringList({ "0:alpha", "1:alpha", "2:alpha" }));
+    QCOMPARE(getMatchedTexts(storage, "delta"), QStringList({ "1:delta" }));
+    QCOMPARE(getMatchedTexts(storage, "epsilon"), QStringList());
+
+    // Merged storage is not changed
+    QVERIFY(!partialStorage.hasTextLayout(0));
+    QCOMPARE(getMatchedTexts(partialStorage, "epsilon"), QStringList({ "2:epsilon" }));
+
+    // Merge of empty storage doesn't change anything
+    storage.merge(pdf::PDFTextLayoutStorage(4));
+    QCOMPARE(getMatchedTexts(storage, "alpha"), QStringList({ "0:alpha", "1:alpha", "2:alpha" }));
+}
+
+void LexicalAnalyzerTest::test_text_layout_storage_find()
+{
+    auto getPageIndices = [](const pdf::PDFFindResults& results)
+    {
+        std::vector<pdf::PDFInteger> pageIndices;
+        for (const pdf::PDFFindResult& result : results)
+        {
+            pageIndices.push_back(result.textSelectionItems.front().first.pageIndex);
+        }
+        return pageIndices;
+    };
+
+    pdf::PDFTextLayoutStorage storage(4);
+    storage.setTextLayout(0, createTextLayout("alpha beta"), nullptr);
+    storage.setTextLayout(1, createTextLayout("beta alpha"), nullptr);
+    storage.setTextLayout(3, createTextLayout("Alpha"), nullptr);
+
+    const pdf::PDFTextFlow::FlowFlags flowFlags = pdf::PDFTextFlow::SeparateBlocks;
+    const QRegularExpression expression("alpha", QRegularExpression::CaseInsensitiveOption);
+
+    // All pages
+    QCOMPARE(getPageIndices(storage.find("alpha", Qt::CaseInsensitive, flowFlags)), std::vector<pdf::PDFInteger>({ 0, 1, 3 }));
+    QCOMPARE(getPageIndices(storage.find("alpha", Qt::CaseSensitive, flowFlags)), std::vector<pdf::PDFInteger>({ 0, 1 }));
+    QCOMPARE(getPageIndices(storage.find(expression, flowFlags)), std::vector<pdf::PDFInteger>({ 0, 1, 3 }));
+
+    // Only given pages are searched, results are sorted
+    QCOMPARE(getPageIndices(storage.find("alpha", Qt::CaseInsensitive, flowFlags, { 3, 1 })), std::vector<pdf::PDFInteger>({ 1, 3 }));
+    QCOMPARE(getPageIndices(storage.find(expression, flowFlags, { 3, 1 })), std::vector<pdf::PDFInteger>({ 1, 3 }));
+    QCOMPARE(getPageIndices(storage.find("beta", Qt::CaseInsensitive, flowFlags, { 1 })), std::vector<pdf::PDFInteger>({ 1 }));
+
+    // Pages without text layout are skipped
+    QVERIFY(storage.find("alpha", Qt::CaseInsensitive, flowFlags, { 2 }).empty());
+    QVERIFY(storage.find(expression, flowFlags, { 2 }).empty());
+    QCOMPARE(getPageIndices(storage.find("alpha", Qt::CaseInsensitive, flowFlags, { 0, 2 })), std::vector<pdf::PDFInteger>({ 0 }));
+    QVERIFY(storage.find("alpha", Qt::CaseInsensitive, flowFlags, { }).empty());
+}
+
+void LexicalAnalyzerTest::test_text_layout_disk_cache()
+{
+    auto createDocument = [](int pageCount)
+    {
+        pdf::PDFDocumentBuilder builder;
+        builder.createDocument();
+        for (int i = 0; i < pageCount; ++i)
+        {
+            builder.appendPage(QRectF(0, 0, 612, 792));
+        }
+        return builder.build();
+    };
+
+    auto getText = [](const pdf::PDFTextLayout& layout)
+    {
+        QString text;
+        for (const pdf::PDFTextBlock& block : layout.getTextBlocks())
+        {
+            for (const pdf::PDFTextLine& line : block.getLines())
+            {
+                for (const pdf::TextCharacter& character : line.getCharacters())
+                {
+                    text += character.character;
+                }
+            }
+        }
+        return text;
+    };
+
+    pdf::PDFDocument document = createDocument(2);
+    pdf::PDFDocument otherDocument = createDocument(3);
+    const pdf::PDFCatalog* catalog = document.getCatalog();
+    QVERIFY(pdf::PDFTextLayoutDiskCache::isDocumentCacheable(&document));
+
+    const QString text = "Hello";
+    pdf::PDFTextLayout layout = createTextLayout(text);
+    QCOMPARE(getText(layout), text);
+
+    pdf::PDFTextLayoutStorage storage(2);
+    storage.setTextLayout(0, layout, nullptr);
+
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+
+    pdf::PDFTextLayoutDiskCache cache(directory.path());
+    const QByteArray documentHash = pdf::PDFTextLayoutDiskCache::createDocumentHash("document");
+    const QString fileName = directory.filePath(QString::fromLatin1(documentHash.toHex()) + ".pdftl");
+    QVERIFY(cache.store(documentHash, catalog, storage));
+    QVERIFY(QFile::exists(fileName));
+
+    // Load stored text layouts
+    std::optional<pdf::PDFTextLayoutStorage> loadedStorage = cache.load(documentHash, catalog);
+    QVERIFY(loadedStorage.has_value());
+    QCOMPARE(loadedStorage->getCount(), size_t(2));
+    QVERIFY(loadedStorage->hasTextLayout(0));
+    QVERIFY(!loadedStorage->hasTextLayout(1));
+    QCOMPARE(getText(loadedStorage->getTextLayout(0)), text);
+
+    // Cache file of another document, or of document with different pages, is not used
+    QVERIFY(!cache.load(pdf::PDFTextLayoutDiskCache::createDocumentHash("other document"), catalog).has_value());
+    QVERIFY(!cache.load(documentHash, otherDocument.getCatalog()).has_value());
+    QVERIFY(!cache.store(documentHash, otherDocument.getCatalog(), storage));
+
+    // Text layouts of partially cached document are copied into the memory,
+    // so cache file can be replaced, while loaded storage is used.
+    QVERIFY(cache.store(documentHash, catalog, storage));
+    QCOMPARE(getText(loadedStorage->getTextLayout(0)), text);
+    loadedStorage.reset();
+
+    QFile file(fileName);
+    QVERIFY(file.open(QFile::ReadOnly));
+    const QByteArray data = file.readAll();
+    file.close();
+
+    auto writeCacheFile = [&fileName](const QByteArray& fileData)
+    {
+        QFile file(fileName);
+        return file.open(QFile::WriteOnly | QFile::Truncate) && file.write(fileData) == fileData.size();
+    };
+
+    // Mismatched header (magic is stored after its length)
+    QByteArray corruptedData = data;
+    corruptedData[4] = 'X';
+    QVERIFY(writeCacheFile(corruptedData));
+    QVERIFY(!cache.load(documentHash, catalog).has_value());
+
+    // Truncated file
+    QVERIFY(writeCacheFile(data.left(data.size() - 4)));
+    QVERIFY(!cache.load(documentHash, catalog).has_value());
+
+    QVERIFY(writeCacheFile(data));
+    QVERIFY(cache.load(documentHash, catalog).has_value());
+
+    auto setFileTime = [&fileName](const QDateTime& dateTime)
+    {
+        QFile file(fileName);
+        return file.open(QFile::ReadWrite) && file.setFileTime(dateTime, QFileDevice::FileModificationTime);
+    };
+
+    // Loading of the file updates its modification time
+    const QDateTime oldDateTime = QDateTime::currentDateTime().addSecs(-3600);
+    QVERIFY(setFileTime(oldDateTime));
+    QVERIFY(cache.load(documentHash, catalog).has_value());
+    QVERIFY(QFileInfo(fileName).lastModified() > oldDateTime.addSecs(1800));
+
+    // Least recently used file is removed, if cache size exceeds the limit
+    QVERIFY(setFileTime(oldDateTime));
+
+    pdf::PDFTextLayoutDiskCache limitedCache(directory.path(), data.size() + data.size() / 2);
+    const QByteArray newDocumentHash = pdf::PDFTextLayoutDiskCache::createDocumentHash("new document");
+    QVERIFY(limitedCache.store(newDocumentHash, catalog, storage));
+    QVERIFY(!QFile::exists(fileName));
+    QVERIFY(limitedCache.load(newDocumentHash, catalog).has_value());
+}
+
+void LexicalAnalyzerTest::test_text_index()
+{
+    pdf::PDFTextLayoutStorage storage(3);
+    storage.setTextLayout(0, createTextLayout("Hello World, hello!"), nullptr);
+    storage.setTextLayout(1, createTextLayout("wonderful Worlds of the world"), nullptr);
+
+    pdf::PDFTextIndex index = pdf::PDFTextIndex::create(storage, pdf::PDFTextFlow::SeparateBlocks);
+    QCOMPARE(index.getWordCount(), size_t(6));
+
+    auto getMatchedTexts = [&](const QString& text, pdf::PDFTextIndex::QueryFlags flags)
+    {
+        QStringList matchedTexts;
+        for (const pdf::PDFFindResult& result : index.createFindResults(index.query(text, flags), storage))
+        {
+            matchedTexts << result.matched;
+        }
+        return matchedTexts;
+    };
+
+    // Words
+    QCOMPARE(getMatchedTexts("hello", pdf::PDFTextIndex::None), QStringList({ "Hello", "hello" }));
+    QCOMPARE(getMatchedTexts("WORLD", pdf::PDFTextIndex::None), QStringList({ "World", "world" }));
+    QCOMPARE(getMatchedTexts("planet", pdf::PDFTextIndex::None), QStringList());
+    QCOMPARE(getMatchedTexts(",", pdf::PDFTextIndex::None), QStringList());
+
+    // Case sensitive words
+    QCOMPARE(getMatchedTexts("Hello", pdf::PDFTextIndex::CaseSensitive), QStringList({ "Hello" }));
+    QCOMPARE(getMatchedTexts("world", pdf::PDFTextIndex::CaseSensitive), QStringList({ "world" }));
+    QCOMPARE(getMatchedTexts("WORLD", pdf::PDFTextIndex::CaseSensitive), QStringList());
+
+    // Prefixes
+    QCOMPARE(getMatchedTexts("wor", pdf::PDFTextIndex::Prefix), QStringList({ "World", "Worlds", "world" }));
+    QCOMPARE(getMatchedTexts("wo", pdf::PDFTextIndex::Prefix), QStringList({ "World", "wonderful", "Worlds", "world" }));
+    QCOMPARE(getMatchedTexts("Wor", pdf::PDFTextIndex::Prefix | pdf::PDFTextIndex::CaseSensitive), QStringList({ "World", "Worlds" }));
+
+    // Phrases (characters between words are ignored, words must not cross pages)
+    QCOMPARE(getMatchedTexts("hello world", pdf::PDFTextIndex::None), QStringList({ "Hello World" }));
+    QCOMPARE(getMatchedTexts("world hello", pdf::PDFTextIndex::None), QStringList({ "World, hello" }));
+    QCOMPARE(getMatchedTexts("hello wonderful", pdf::PDFTextIndex::None), QStringList());
+    QCOMPARE(getMatchedTexts("of the wor", pdf::PDFTextIndex::Prefix), QStringList({ "of the world" }));
+    QCOMPARE(getMatchedTexts("of the wor", pdf::PDFTextIndex::None), QStringList());
+
+    // Matches and find results
+    pdf::PDFTextIndex::Matches matches = index.query("world", pdf::PDFTextIndex::None);
+    QCOMPARE(matches.size(), size_t(2));
+    QCOMPARE(matches[0].pageIndex, pdf::PDFInteger(0));
+    QCOMPARE(matches[0].characterIndex, pdf::PDFInteger(6));
+    QCOMPARE(matches[0].length, pdf::PDFInteger(5));
+    QCOMPARE(matches[1].pageIndex, pdf::PDFInteger(1));
+
+    pdf::PDFFindResults results = index.createFindResults(matches, storage);
+    QCOMPARE(results.size(), size_t(2));
+    QCOMPARE(results[0].textSelectionItems.front().first.pageIndex, pdf::PDFInteger(0));
+    QCOMPARE(results[1].textSelectionItems.front().first.pageIndex, pdf::PDFInteger(1));
+    QVERIFY(index.createFindResults(pdf::PDFTextIndex::Matches(), storage).empty());
+
+    // Index created page by page is the same as index created from the storage
+    pdf::PDFTextIndex pageIndex(pdf::PDFTextFlow::SeparateBlocks);
+    pageIndex.addPage(1, storage.getTextLayout(1), nullptr);
+    pageIndex.addPage(0, storage.getTextLayout(0), nullptr);
+    QCOMPARE(pageIndex.getWordCount(), index.getWordCount());
+    QVERIFY(pageIndex.query("wo", pdf::PDFTextIndex::Prefix) == index.query("wo", pdf::PDFTextIndex::Prefix));
+
+    // Candidate pages for substring search (words of the text are parts of words
+    // on the page, not indexed pages are always candidates)
+    const std::vector<pdf::PDFInteger> allPages = { 0, 1, 2 };
+    QCOMPARE(index.getCandidatePages("orld", allPages), std::vector<pdf::PDFInteger>({ 0, 1, 2 }));
+    QCOMPARE(index.getCandidatePages("ELL", allPages), std::vector<pdf::PDFInteger>({ 0, 2 }));
+    QCOMPARE(index.getCandidatePages("rful wor", allPages), std::vector<pdf::PDFInteger>({ 1, 2 }));
+    QCOMPARE(index.getCandidatePages("hello wonder", allPages), std::vector<pdf::PDFInteger>({ 2 }));
+    QCOMPARE(index.getCandidatePages(", ", allPages), allPages);
+    QCOMPARE(index.getCandidatePages("ello", { 1 }), std::vector<pdf::PDFInteger>());
+    QVERIFY(index.isPageIndexed(0));
+    QVERIFY(!index.isPageIndexed(2));
+
+    // Substring search on candidate pages gives the same results as search of all pages
+    const QString text = "lo wor";
+    pdf::PDFFindResults candidateResults = storage.find(text, Qt::CaseInsensitive, pdf::PDFTextFlow::SeparateBlocks, index.getCandidatePages(text, allPages));
+    pdf::PDFFindResults allResults = storage.find(text, Qt::CaseInsensitive, pdf::PDFTextFlow::SeparateBlocks);
+    QCOMPARE(candidateResults.size(), size_t(1));
+    QCOMPARE(candidateResults.size(), allResults.size());
+    QCOMPARE(candidateResults.front().matched, allResults.front().matched);
+
+    // Page is indexed only once
+    pageIndex.addPage(0, storage.getTextLayout(0), nullptr);
+    QVERIFY(pageIndex.query("hello", pdf::PDFTextIndex::None) == index.query("hello", pdf::PDFTextIndex::None));
+}
+
+void LexicalAnalyzerTest::test_text_layout_serialization()
+{
+    auto getLayoutData = [](const pdf::PDFTextLayout& layout)
+    {
+        QByteArray data;
+        QDataStream stream(&data, QIODevice::WriteOnly);
+        stream << layout;
+        return data;
+    };
+
+    // Text layout with multiple lines and blocks, outlines
+    // of characters (and so bounding boxes) contain curves.
+    pdf::PDFTextLayout layout;
+    auto addText = [&layout](const QString& text, QPointF position, pdf::PDFReal fontSize)
+    {
+        for (int i = 0; i < text.size(); ++i)
+        {
+            pdf::PDFTextCharacterInfo info;
+            info.character = text[i];
+            info.outline.addEllipse(0.0, 0.0, 0.5, 0.7);
+            info.outline.cubicTo(QPointF(0.1, 0.2), QPointF(0.3, 0.4), QPointF(0.5, 0.0));
+            info.advance = 0.6;
+            info.fontSize = 1.0;
+            info.matrix = QTransform(fontSize, 0.0, 0.0, fontSize, position.x() + fontSize * 0.6 * i, position.y());
+            layout.addCharacter(info);
+        }
+    };
+    addText("Hello", QPointF(100.0, 100.0), 12.0);
+    addText("World", QPointF(100.0, 115.0), 12.0);
+    addText("Second block", QPointF(100.0, 400.0), 20.0);
+    layout.perform();
+    QVERIFY(!layout.getTextBlocks().empty());
+
+    const QByteArray layoutData = getLayoutData(layout);
+    const QByteArray simpleLayoutData = getLayoutData(createTextLayout("Hello"));
+    const QByteArray emptyLayoutData = getLayoutData(pdf::PDFTextLayout());
+
+    // Text layouts are stored in the storage in flat compressed form
+    pdf::PDFTextLayoutStorage storage(4);
+    storage.setTextLayout(0, layout, nullptr);
+    storage.setTextLayout(1, createTextLayout("Hello"), nullptr);
+    storage.setTextLayout(2, pdf::PDFTextLayout(), nullptr);
+    QCOMPARE(getLayoutData(storage.getTextLayout(0)), layoutData);
+    QCOMPARE(getLayoutData(storage.getTextLayout(1)), simpleLayoutData);
+    QCOMPARE(getLayoutData(storage.getTextLayout(2)), emptyLayoutData);
+
+    // Page without text layout and invalid page indices
+    QCOMPARE(getLayoutData(storage.getTextLayout(3)), emptyLayoutData);
+    QCOMPARE(getLayoutData(storage.getTextLayout(-1)), emptyLayoutData);
+    QCOMPARE(getLayoutData(storage.getTextLayout(4)), emptyLayoutData);
+
+    // Text layout is decoded repeatedly, copy of the storage shares the data
+    QCOMPARE(getLayoutData(storage.getTextLayout(0)), layoutData);
+    const pdf::PDFTextLayoutStorage storageCopy = storage;
+    QCOMPARE(getLayoutData(storageCopy.getTextLayout(0)), layoutData);
+    QCOMPARE(getLayoutData(storageCopy.getTextLayout(1)), simpleLayoutData);
+}
+
+pdf::PDFTextLayout LexicalAnalyzerTest::createTextLayout(const QString& text)
+{
+    pdf::PDFTextLayout layout;
+    for (int i = 0; i < text.size(); ++i)
+    {
+        pdf::PDFTextCharacterInfo info;
+        info.character = text[i];
+        info.outline.addRect(0.0, 0.0, 0.5, 0.7);
+        info.advance = 0.6;
+        info.fontSize = 1.0;
+        info.matrix = QTransform(12.0, 0.0, 0.0, 12.0, 100.0 + 12.0 * 0.6 * i, 100.0);
+        layout.addCharacter(info);
+    }
+    layout.perform();
+    return layout;
+}
+
 void LexicalAnalyzerTest::scanWholeStream(const char* stream)
 {
     pdf::PDFLexicalAnalyzer analyzer(stream, stream + strlen(stream));
@@ -1145,13 +2124,29 @@ QString LexicalAnalyzerTest::getStringFromTokens(const std::vector<pdf::PDFLexic
     {
         QString tokenTypeAsString = metaEnum.valueToKey(static_cast<int>(token.type));
 
-        if (!token.data.isValid())
-        {
-            stringTokens << tokenTypeAsString;
-        }
-        else
+        switch (token.type)
         {
-            stringTokens << QString("%1(%2)").arg(tokenTypeAsString, token.data.toString());
+            case pdf::PDFLexicalAnalyzer::TokenType::Boolean:
+                stringTokens << QString("%1(%2)").arg(tokenTypeAsString, token.getBool() ? QLatin1String("true") : QLatin1String("false"));
+                break;
+
+            case pdf::PDFLexicalAnalyzer::TokenType::Integer:
+                stringTokens << QString("%1(%2)").arg(tokenTypeAsString).arg(token.getInteger());
+                break;
+
+            case pdf::PDFLexicalAnalyzer::TokenType::Real:
+                stringTokens << QString("%1(%2)").arg(tokenTypeAsString).arg(token.getReal());
+                break;
+
+            case pdf::PDFLexicalAnalyzer::TokenType::String:
+            case pdf::PDFLexicalAnalyzer::TokenType::Name:
+            case pdf::PDFLexicalAnalyzer::TokenType::Command:
+                stringTokens << QString("%1(%2)").arg(tokenTypeAsString, QString::fromLatin1(token.getBytes()));
+                break;
+
+            default:
+                stringTokens << tokenTypeAsString;
+                break;
         }
     }
 